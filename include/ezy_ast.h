@@ -19,6 +19,8 @@
 #include <stdbool.h>
 #include <stdint.h>
 
+struct ezy_symbol_t; // resolved by ezysema_resolve (see ezy_symtab.h)
+
 struct ezy_ast_datatype_t {
   enum ezy_ast_datatype_typ typ;
   bool nullable;
@@ -40,18 +42,27 @@ struct ezy_ast_args_t {
 struct ezy_ast_array_t {
   bool dynamic;
   struct ezy_ast_datatype_t typ;
-  size_t length;
+  size_t length;     // fixed length, or the guide (initial capacity) of a dynamic array
   size_t max_length; // 0 means unlimited (for dynamic arrays)
+  size_t inline_cap; // set by the transpiler: elements kept inline (small vector), 0 = heap only
 };
 
+// struct Name { T field; ... }; members in declaration order, the C
+// field order is chosen by the transpiler unless `@abi` keeps this one
 struct ezy_ast_struct_t {
+  ezy_cstr_t name;
   size_t count;
   struct ezy_ast_args_t* members;
+  bool abi;
+  struct ezy_ast_struct_t *prev; // struct declared before this one, for lookup by name while parsing
 };
 
+// union Name = T1 | T2 | null; members in declaration order, null is ezy_ast_dt_null
 struct ezy_ast_union_t {
+  ezy_cstr_t name;
   size_t count;
   struct ezy_ast_datatype_t *mem_typlist;
+  struct ezy_ast_union_t *prev; // union declared before this one, for lookup by name while parsing
 };
 
 struct ezy_ast_function_t {
@@ -61,12 +72,17 @@ struct ezy_ast_function_t {
   
   struct ezy_ast_args_t* params;
   struct ezy_ast_node_t *body;
+
+  bool region;      // @region: temporaries come from a region released on return
+  int sema_state;   // scratch state for ezysema passes
+  unsigned escapes; // ezysema_escape_* bits, set by ezysema_infer_types
 };
 
 struct ezy_ast_variable_t {
   ezy_cstr_t name;
   struct ezy_ast_datatype_t typ;
   struct ezy_ast_node_t* value;
+  struct ezy_symbol_t* sym;
 };
 
 struct ezy_ast_literal_t {
@@ -93,6 +109,7 @@ struct ezy_ast_call_t {
   ezy_cstr_t func_name;
   size_t arg_count;
   struct ezy_ast_node_t* args;
+  struct ezy_symbol_t* sym;
 };
 
 struct ezy_ast_node_error_t {
@@ -104,6 +121,38 @@ struct ezy_ast_binop_t {
   enum ezy_op_typ operator;
   struct ezy_ast_node_t* left;
   struct ezy_ast_node_t* right;
+  // string +: nonzero when the result never leaves its function
+  // (ezysema_infer_types), the transpiler numbers its stack buffer
+  unsigned stack_buf;
+};
+
+struct ezy_ast_return_t {
+  struct ezy_ast_node_t* value; // NULL for a bare `return;`
+};
+
+struct ezy_ast_array_lit_t {
+  size_t count;
+  struct ezy_ast_node_t* elements;
+};
+
+struct ezy_ast_index_t {
+  struct ezy_ast_node_t* base;
+  struct ezy_ast_node_t* index;
+  bool checked; // bounds checked at run time, decided by the transpiler
+};
+
+// positional elements fill fields in declaration order, a named element
+// (`name = value`) sets that field; names[i].len is 0 for a positional one
+struct ezy_ast_struct_lit_t {
+  size_t count;
+  struct ezy_ast_node_t* elements;
+  ezy_cstr_t* names;
+  size_t* fields; // member index of each element, set by ezysema_infer_types
+};
+
+struct ezy_ast_member_t {
+  struct ezy_ast_node_t* object;
+  ezy_cstr_t name;
 };
 
 typedef struct ezy_ast_node_t {
@@ -115,6 +164,11 @@ typedef struct ezy_ast_node_t {
     struct ezy_ast_variable_t n_variable;
     struct ezy_ast_literal_t n_literal; 
     struct ezy_ast_node_error_t n_error;
+    struct ezy_ast_return_t n_return;
+    struct ezy_ast_array_lit_t n_array_lit;
+    struct ezy_ast_index_t n_index;
+    struct ezy_ast_member_t n_member;
+    struct ezy_ast_struct_lit_t n_struct_lit;
 
     // larger.. so keep by pointer
     struct ezy_ast_function_t* n_function;
@@ -122,6 +176,11 @@ typedef struct ezy_ast_node_t {
     struct ezy_ast_union_t* n_union;
     struct ezy_ast_call_t* n_call;
   } data;
+
+  // static type of the value an expression node evaluates to,
+  // filled in by ezysema_infer_types
+  struct ezy_ast_datatype_t eval_typ;
+
   struct ezy_ast_node_t* next;
 } ezy_ast_node_t;
 
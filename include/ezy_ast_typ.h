@@ -9,6 +9,7 @@ enum ezy_ast_datatype_typ {
   ezy_ast_dt_null,
   ezy_ast_dt_var,
   ezy_ast_dt_infer,
+  ezy_ast_dt_unknown, // result of an external C function, left to the C compiler
 
   /* Standard data types */
 
@@ -47,6 +48,11 @@ enum ezy_ast_node_typ {
   ezy_ast_node_call,
   ezy_ast_node_binop,
   ezy_ast_node_stmt,
+  ezy_ast_node_return,
+  ezy_ast_node_array_lit, // [a, b, c]
+  ezy_ast_node_index,     // a[i]
+  ezy_ast_node_member,    // a.name
+  ezy_ast_node_struct_lit, // {a, b} or {name = a, ...}
 };
 
 #endif // ezy_ast_typ_h
@@ -0,0 +1,77 @@
+#if !defined(ezy_ast_walk_h)
+#define ezy_ast_walk_h
+
+#include <ezy_ast.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// Non-recursive AST traversal. The walker keeps its own frame stack in
+// malloc'd chunks, so neither long statement lists nor deeply nested
+// expressions grow the C stack. Walkers share no state and may run on
+// different threads.
+
+enum ezywalk_action {
+  ezywalk_continue = 0,
+  ezywalk_skip, // from `pre`: do not descend into this node's children
+  ezywalk_stop, // abort the whole walk
+};
+
+struct ezywalk_t;
+
+typedef enum ezywalk_action (*ezywalk_fn)(struct ezywalk_t *w, ezy_ast_node_t *node);
+// called right before descending into child number `child` of `node`,
+// returning ezywalk_skip leaves that child out
+typedef enum ezywalk_action (*ezywalk_child_fn)(struct ezywalk_t *w, ezy_ast_node_t *node, size_t child);
+
+struct ezywalk_frame {
+  ezy_ast_node_t *node;   // NULL for the frame of a statement list
+  ezy_ast_node_t *cursor; // current element when iterating a list
+  size_t child;           // index of the next child to visit
+  bool entered;
+  bool skip;
+};
+
+#define ezywalk_chunk_frames 512
+// frames held inside the walker itself, most walks never need more
+#define ezywalk_inline_frames 16
+
+struct ezywalk_chunk {
+  struct ezywalk_chunk *prev;
+  struct ezywalk_chunk *next;
+  size_t cap;
+  struct ezywalk_frame *frames;
+};
+
+struct ezywalk_t {
+  // hooks, any of them may be NULL
+  ezywalk_fn pre;
+  ezywalk_fn post;
+  ezywalk_child_fn child;
+  void *ctx;
+
+  // valid inside hooks
+  size_t depth;
+  ezy_ast_node_t *parent;
+
+  // frame stack, chunks are kept for reuse by later walks; the walker
+  // points into itself once used, so it must not be copied
+  struct ezywalk_chunk *chunk;
+  size_t used;
+  struct ezywalk_chunk inline_chunk;
+  struct ezywalk_frame inline_frames[ezywalk_inline_frames];
+};
+
+// Visit `node` and everything below it. Children are visited in source
+// order: function bodies statement by statement, call arguments, binop
+// left then right, declaration and return values.
+// Returns false if a hook stopped the walk.
+bool ezywalk_node(struct ezywalk_t *w, ezy_ast_node_t *node);
+
+// Same as ezywalk_node for every node of a `next`-linked list
+// (top-level nodes or a block's statements), each at depth 0.
+bool ezywalk_list(struct ezywalk_t *w, ezy_ast_node_t *head);
+
+// Free the frame chunks a walker allocated. It can be used again after.
+void ezywalk_release(struct ezywalk_t *w);
+
+#endif // ezy_ast_walk_h
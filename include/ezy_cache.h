@@ -0,0 +1,54 @@
+#if !defined(ezy_cache_h)
+#define ezy_cache_h
+
+#include <ezy_sha256.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+// Content addressed store for what the C compiler produces, ccache
+// style: an entry is named by the SHA-256 of everything that decides
+// the output (the generated C, the compiler binary, its command line,
+// the runtime), so a hit can be copied out instead of compiling.
+// Entries live in <dir>/<2 hex digits>/<62 hex digits>. A hit refreshes
+// the entry's mtime, eviction removes the oldest mtimes first (LRU)
+// until the store is under its size bound.
+
+#define ezycache_default_max ((uint64_t)512 << 20)
+
+struct ezycache {
+  char *dir;
+  uint64_t max_bytes;
+};
+
+struct ezycache_stats {
+  uint64_t hits;
+  uint64_t misses;
+  uint64_t entries;
+  uint64_t bytes;
+  uint64_t evicted; // entries removed to stay under max_bytes
+};
+
+// `dir` NULL picks $EZY_CACHE_DIR, $XDG_CACHE_HOME/ezc or ~/.cache/ezc.
+// Creates the directory. False when it is unusable (logged).
+bool ezycache_open(struct ezycache *cache, const char *dir, uint64_t max_bytes);
+void ezycache_close(struct ezycache *cache);
+
+// Copy the entry `key` to `dest` (made executable) and count a hit,
+// or count a miss and return false.
+bool ezycache_fetch(struct ezycache *cache, const uint8_t key[ezysha256_size], const char *dest);
+
+// Add `src` as the entry `key`, then evict down to the size bound.
+bool ezycache_store(struct ezycache *cache, const uint8_t key[ezysha256_size], const char *src);
+
+// Counters kept in <dir>/stats; entries and bytes as of the last store.
+bool ezycache_stats(struct ezycache *cache, struct ezycache_stats *out);
+
+// Hash the identity of a file (path, size, modification time) rather
+// than its bytes, the way ccache checks the compiler. A missing file
+// hashes as its path alone.
+void ezycache_hash_file_id(struct ezysha256 *h, const char *path);
+
+// ezycache_hash_file_id of every file directly in `dir`, by name.
+void ezycache_hash_dir_id(struct ezysha256 *h, const char *dir);
+
+#endif // ezy_cache_h
@@ -1,6 +1,52 @@
 #if !defined(ez_ezycompile_h)
 #define ez_ezycompile_h
 
+#include <ezy_report.h>
+#include <ezy_transpile_c.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Wall time of each stage of ezycompile, in milliseconds. The C compiler
+// starts before parsing, `cc` is the wait for it after the C is written.
+struct ezycompile_times {
+  double read;
+  double parse;
+  double sema;
+  double transpile;
+  double pipe; // writing the C into the compiler
+  double cc;
+  double cache; // hashing the C, fetching or storing the executable
+  double total;
+  bool cache_hit; // the executable came from the cache, cc did not run
+};
+
+struct ezycompile_opts {
+  const char *output;          // the executable, "a.out" when NULL
+  const char *cc;              // the C compiler, $CC or "cc" when NULL
+  const char *const *cc_flags; // passed through: -O2, -march=native, -flto, ...
+  size_t cc_flag_count;
+  const char *runtime_include; // runtime/include
+  const char *runtime_lib;     // obj/libezyrt.a
+  bool timings;                // print the stage times to stderr
+  bool cache;                  // look the executable up in the object cache
+  const char *cache_dir;       // see ezycache_open
+  uint64_t cache_max;          // bytes, ezycache_default_max when 0
+  struct ezycompile_times *times; // filled in when not NULL
+  struct ezyreport *report;        // phases and counters added when on (--time-report)
+  struct ezytranspile_opts transpile;
+};
+
+// Compile `filename` to an executable: the generated C is streamed into
+// `cc -x c -` over a pipe, no temporary file. Returns the exit status,
+// 0 on success. With `cache` the C is hashed first and a hit is copied
+// out without starting the compiler.
 int ezycompile(const char* filename);
+int ezycompile_opts(const char *filename, const struct ezycompile_opts *opts);
+
+// Same for a program of several modules (see ezyproject_load), loaded
+// with transpile.jobs workers. `parse` times the whole load, reading and
+// analysis included.
+int ezycompile_files(const char *const *paths, size_t count, const struct ezycompile_opts *opts);
 
-#endif // ez_ezycompile_h
\ No newline at end of file
+#endif // ez_ezycompile_h
@@ -0,0 +1,34 @@
+#if !defined(ezy_daemon_h)
+#define ezy_daemon_h
+
+#include <stdbool.h>
+#include <stddef.h>
+
+// Compile server: `ezc --daemon` stays resident on a Unix domain socket
+// and runs each request in process, so the parser arena and the heap are
+// already faulted in and nothing is loaded again. A client passes its
+// working directory, arguments, the environment ezc reads and its
+// stdin/stdout/stderr (SCM_RIGHTS), and gets the exit status back;
+// output goes straight to the client's descriptors. Requests are served
+// one at a time. Client and server only talk to a peer of the same user
+// (SO_PEERCRED, getpeereid on the BSDs).
+
+// runs one request with the client's cwd, environment and descriptors
+// in place, returns its exit status
+typedef int (*ezydaemon_job)(int argc, const char **argv);
+
+// $XDG_RUNTIME_DIR/ezc.sock, else ezc.sock in /tmp/ezc-<uid>, a 0700
+// directory made if missing. False when it does not fit in `size` or the
+// directory is not this user's alone.
+bool ezydaemon_default_path(char *buf, size_t size);
+
+// Serve on `path` until SIGINT or SIGTERM, then remove the socket.
+// Returns the exit status of the server.
+int ezydaemon_serve(const char *path, ezydaemon_job job);
+
+// Forward argc/argv to the server on `path`. False when no server
+// answers there (nothing has run, the caller compiles locally), else
+// *status is the request's exit status.
+bool ezydaemon_forward(const char *path, int argc, const char **argv, int *status);
+
+#endif // ezy_daemon_h
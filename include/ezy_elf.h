@@ -0,0 +1,81 @@
+#if !defined(ezy_elf_h)
+#define ezy_elf_h
+
+#include <ezy_typ.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Writer for 64-bit little endian relocatable ELF objects (x86-64): one
+// .text, one .rodata, the relocations against .text and a symbol table.
+// The code generator appends bytes and relocations, ezyelf_finish lays
+// the file out. Nothing here knows about instructions.
+
+#define ezyelf_r_x86_64_pc32 2  // S + A - P, RIP relative data
+#define ezyelf_r_x86_64_plt32 4 // L + A - P, calls
+
+// the section symbols every object starts with
+#define ezyelf_sym_text 1
+#define ezyelf_sym_rodata 2
+
+struct ezyelf_buf {
+  uint8_t *data;
+  size_t len;
+  size_t cap;
+};
+
+struct ezyelf_sym {
+  ezy_cstr_t name;
+  uint32_t name_off; // in .strtab, set by ezyelf_finish
+  uint8_t info;
+  uint16_t shndx;
+  uint64_t value;
+  uint64_t size;
+};
+
+struct ezyelf_rela {
+  uint64_t offset;
+  uint32_t sym;
+  uint32_t type;
+  int64_t addend;
+};
+
+struct ezyelf_obj {
+  struct ezyelf_buf text;
+  struct ezyelf_buf rodata;
+
+  struct ezyelf_sym *syms;
+  size_t sym_count;
+  size_t sym_cap;
+  uint32_t *map; // open addressing over global names, 0 is empty
+  size_t map_cap; // power of two
+
+  struct ezyelf_rela *relas;
+  size_t rela_count;
+  size_t rela_cap;
+
+  bool failed; // an allocation failed, ezyelf_finish returns NULL
+};
+
+void ezyelf_init(struct ezyelf_obj *obj);
+void ezyelf_free(struct ezyelf_obj *obj);
+
+// Append `n` bytes, returns where they start (their offset).
+size_t ezyelf_append(struct ezyelf_obj *obj, struct ezyelf_buf *buf, const void *src, size_t n);
+
+// Constant data aligned to `align` (a power of two), returns its offset.
+size_t ezyelf_rodata(struct ezyelf_obj *obj, const void *src, size_t n, size_t align);
+
+// The global symbol `name`, added undefined on first use.
+uint32_t ezyelf_symbol(struct ezyelf_obj *obj, ezy_cstr_t name);
+
+// `sym` is a function of `size` bytes at `offset` in .text.
+void ezyelf_define(struct ezyelf_obj *obj, uint32_t sym, size_t offset, size_t size);
+
+void ezyelf_reloc(struct ezyelf_obj *obj, size_t offset, uint32_t sym, uint32_t type, int64_t addend);
+
+// The object file as a chunk chain, NULL on failure. Release it with
+// ezyemit_free.
+ezy_multistr_t *ezyelf_finish(struct ezyelf_obj *obj);
+
+#endif // ezy_elf_h
@@ -0,0 +1,83 @@
+#if !defined(ezy_emit_h)
+#define ezy_emit_h
+
+#include <ezy_typ.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+// Output emitter for generated code. Fragments are written straight into
+// the tail chunk of an ezy_multistr_t chain; chunks are malloc'd with
+// their bytes inline and grow geometrically.
+
+#define ezyemit_initial_chunk (16 * 1024)
+#define ezyemit_max_chunk (4 * 1024 * 1024)
+
+typedef struct ezy_emit_t {
+  ezy_multistr_t *head;
+  ezy_multistr_t *tail;
+  size_t cap;        // capacity of the tail chunk
+  size_t next_cap;   // capacity of the next chunk to allocate
+  bool failed;       // set once an allocation failed, later writes are dropped
+} ezy_emit_t;
+
+void ezyemit_init(ezy_emit_t *e);
+
+// Free a chain produced by an emitter (its head).
+void ezyemit_free(ezy_multistr_t *chain);
+
+// Make sure `n` bytes are writable at the end of the tail chunk and return
+// a pointer to them (NULL on allocation failure). Commit what was written
+// with ezyemit_commit.
+char *ezyemit_reserve_slow(ezy_emit_t *e, size_t n);
+
+static inline char *ezyemit_reserve(ezy_emit_t *e, size_t n)
+{
+  if (e->tail != NULL && e->tail->str.len + n <= e->cap)
+    return (char *)e->tail->str.ptr + e->tail->str.len;
+  return ezyemit_reserve_slow(e, n);
+}
+
+static inline void ezyemit_commit(ezy_emit_t *e, size_t n)
+{
+  e->tail->str.len += n;
+}
+
+static inline void ezyemit_bytes(ezy_emit_t *e, const char *src, size_t n)
+{
+  char *dst = ezyemit_reserve(e, n);
+  if (dst == NULL)
+    return;
+  memcpy(dst, src, n);
+  ezyemit_commit(e, n);
+}
+
+static inline void ezyemit_char(ezy_emit_t *e, char c)
+{
+  char *dst = ezyemit_reserve(e, 1);
+  if (dst == NULL)
+    return;
+  *dst = c;
+  ezyemit_commit(e, 1);
+}
+
+// NUL-terminated constant text, the length folds away for literals
+#define ezyemit_str(e, s) ezyemit_bytes((e), (s), strlen(s))
+
+// identifiers are copied verbatim from the source
+static inline void ezyemit_ident(ezy_emit_t *e, ezy_cstr_t name)
+{
+  ezyemit_bytes(e, name.ptr, name.len);
+}
+
+void ezyemit_uint(ezy_emit_t *e, uint64_t v);
+void ezyemit_int(ezy_emit_t *e, int64_t v);
+
+// Shortest decimal that reads back as the same double, always a C
+// floating literal (`2.0`, not `2`).
+void ezyemit_float(ezy_emit_t *e, double v);
+
+// printf-style fallback for the rare fragments that need it
+void ezyemit_fmt(ezy_emit_t *e, const char *fmt, ...);
+
+#endif // ezy_emit_h
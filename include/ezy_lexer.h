@@ -32,4 +32,9 @@ ezy_tkn_t ezylex_peek_tkn(size_t);
 void ezylex_consume_tkn(size_t);
 void ezylex_consume_all_tkn();
 
+// Tokens lexed for the parser on this thread so far, eof aside.
+size_t ezylex_token_count();
+// Lex the whole of `src` without parsing it, to time the lexer alone.
+void ezylex_scan(const char *src);
+
 #endif // ez_ezylexer_h
@@ -0,0 +1,25 @@
+#if !defined(ezy_output_h)
+#define ezy_output_h
+
+#include <ezy_typ.h>
+#include <stdbool.h>
+
+enum ezyout_flags {
+  ezyout_flag_none = 0,
+  // write to a temporary file next to the target and rename it over the
+  // target once complete, readers never see partial output
+  ezyout_flag_atomic = 1 << 0,
+};
+
+// Write every chunk of `chain` to `path`, "-" means stdout. Chunks are
+// handed to the OS as they are, without concatenating them first.
+// Returns false on failure (errors are logged).
+bool ezyout_write_file(const char *path, const ezy_multistr_t *chain, unsigned flags);
+
+#if !defined(_WIN32)
+// Write every chunk of `chain` to the descriptor `fd` (a file or a pipe)
+// with writev, nothing is logged. Returns false on failure, errno set.
+bool ezyout_write_fd(int fd, const ezy_multistr_t *chain);
+#endif
+
+#endif // ezy_output_h
@@ -5,4 +5,8 @@
 
 ezy_ast_node_t* ezyparse_parse(const char* src);
 
+// Lexer and parser errors of the last ezyparse_parse on this thread; the
+// tree is only fit for the later passes when it is 0.
+size_t ezyparse_error_count(void);
+
 #endif // ezy_parser_h
@@ -2,12 +2,14 @@
 #define ezy_parser_arena_h
 #include <stdint.h>
 #include <stdbool.h>
+#include <stddef.h>
 
 struct ezyparse_arena {
   uint8_t* mainbuf;
   size_t size;
   size_t used;
   struct ezyparse_arena* next;
+  struct ezyparse_arena* cur; // first block only: the block allocations come from
 };
 
 #define ezyparse_arena_size (1024*1024) // 1MB per arena block
@@ -15,5 +17,19 @@ struct ezyparse_arena {
 void* ezyparse_arena_alloc(size_t size);
 bool ezyparse_arena_backtrack(size_t size, void* final_ptr);
 void ezyparse_arena_clear();
+// true: clear rewinds the blocks instead of freeing the extra ones, and
+// the first block is faulted in up front (the compile server)
+void ezyparse_arena_retain(bool retain);
+
+// Arenas of their own, for worker threads. ezyparse_arena_use makes
+// `arena` the calling thread's arena (NULL: the shared static one) and
+// returns the previous one; alloc, backtrack and clear act on it.
+struct ezyparse_arena* ezyparse_arena_create(void);
+void ezyparse_arena_destroy(struct ezyparse_arena* arena);
+struct ezyparse_arena* ezyparse_arena_use(struct ezyparse_arena* arena);
+
+// Bytes in use and allocated, and the block count, of `arena` (NULL:
+// the calling thread's).
+void ezyparse_arena_usage(const struct ezyparse_arena* arena, size_t* used, size_t* reserved, size_t* blocks);
 
 #endif // ezy_parser_arena_h
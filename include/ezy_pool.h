@@ -0,0 +1,34 @@
+#if !defined(ezy_pool_h)
+#define ezy_pool_h
+
+#include <stdbool.h>
+#include <stddef.h>
+
+// Work stealing thread pool. Every worker owns a deque: it pushes the
+// tasks it submits and pops them newest first, an idle worker steals the
+// oldest task of another. A run lasts until no task is queued or running,
+// so tasks may submit more tasks (a dependency graph as it unlocks).
+
+typedef void (*ezypool_fn)(void *arg);
+
+struct ezypool;
+
+// `workers` threads per run, the caller of ezypool_run included.
+struct ezypool *ezypool_create(int workers);
+void ezypool_destroy(struct ezypool *pool);
+
+// Queue a task: on the calling worker's deque inside a run, spread over
+// the workers outside of one. False when out of memory (nothing queued).
+bool ezypool_submit(struct ezypool *pool, ezypool_fn fn, void *arg);
+
+// Run the queued tasks and everything they submit, return when all are
+// done.
+void ezypool_run(struct ezypool *pool);
+
+// Index of the calling worker in [0, workers) during a run, the caller
+// of ezypool_run being 0; -1 on any other thread.
+int ezypool_worker(void);
+
+int ezypool_workers(const struct ezypool *pool);
+
+#endif // ezy_pool_h
@@ -0,0 +1,55 @@
+#if !defined(ezy_project_h)
+#define ezy_project_h
+
+#include <ezy_ast.h>
+#include <ezy_transpile_c.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// A program of several modules (.ez files). Each module sees the
+// functions and globals of the others; types stay module local, they are
+// resolved while parsing. A module depends on the modules that declare
+// the names it uses. Modules are lexed and parsed, analysed in
+// dependency order (cycles together) and transpiled as tasks of a work
+// stealing pool, each worker allocating from its own parser arena.
+
+struct ezyproj_module;
+struct ezyproj_unit;
+struct ezypool;
+struct ezyparse_arena;
+struct ezyreport;
+
+struct ezyproject {
+  // every module's top-level nodes, a module after those it depends on
+  ezy_ast_node_t *program;
+
+  struct ezyproj_module *modules;
+  size_t module_count;
+  struct ezyproj_unit *units; // strongly connected groups of modules
+  size_t unit_count;
+
+  struct ezypool *pool;
+  struct ezyparse_arena **arenas; // one per worker, the AST lives there
+};
+
+// Paths listed in a manifest, one per line relative to the manifest's
+// directory; blank lines and lines starting with '#' are skipped.
+// Release the list with ezyproject_manifest_free.
+bool ezyproject_manifest(const char *path, char ***paths, size_t *count);
+void ezyproject_manifest_free(char **paths, size_t count);
+
+// Read, parse and analyse the modules with `jobs` workers. False when a
+// module cannot be read, has errors or two declare the same name (all
+// logged); release
+// `proj` with ezyproject_free either way. `report` (may be NULL) gets the
+// parse, link and analysis phases, the token count and the arenas.
+bool ezyproject_load(struct ezyproject *proj, const char *const *paths, size_t count, int jobs,
+                     struct ezyreport *report);
+
+// ezytranspile_c_opts of the program, one task per module. NULL on
+// failure.
+ezy_multistr_t *ezyproject_transpile_c(struct ezyproject *proj, const struct ezytranspile_opts *opts);
+
+void ezyproject_free(struct ezyproject *proj);
+
+#endif // ezy_project_h
@@ -0,0 +1,65 @@
+#if !defined(ezy_report_h)
+#define ezy_report_h
+
+#include <ezy_ast.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+
+// Where a compile spends its time and memory (--time-report): wall and
+// CPU time of each phase, plus a few size counters. Probes on a report
+// that is not on cost one branch.
+
+#define ezyreport_max_phases 16
+
+struct ezyparse_arena;
+
+struct ezyreport_phase {
+  const char *name;
+  double wall_ms;
+  double cpu_ms; // every thread of the process
+};
+
+struct ezyreport {
+  bool on;
+  bool json;
+
+  struct ezyreport_phase phases[ezyreport_max_phases];
+  size_t phase_count;
+  double wall_start;
+  double cpu_start;
+  double wall_mark; // end of the last phase
+  double cpu_mark;
+
+  size_t modules;
+  size_t tokens;
+  size_t nodes;          // AST nodes, expressions and statements included
+  size_t arena_bytes;    // parser arena in use at its peak (it only grows until cleared)
+  size_t arena_reserved; // allocated for it
+  size_t arena_blocks;
+  size_t output_bytes;
+};
+
+// Start the clock, the first phase begins now.
+void ezyreport_start(struct ezyreport *r);
+
+// Close the phase running since the last mark; a name seen before adds
+// to that phase.
+void ezyreport_mark(struct ezyreport *r, const char *name);
+
+static inline void ezyreport_phase(struct ezyreport *r, const char *name)
+{
+  if (r != NULL && r->on)
+    ezyreport_mark(r, name);
+}
+
+// Add the usage of a parser arena, NULL for the calling thread's.
+void ezyreport_arena(struct ezyreport *r, const struct ezyparse_arena *arena);
+
+size_t ezyreport_count_nodes(ezy_ast_node_t *root);
+size_t ezyreport_count_bytes(const ezy_multistr_t *chunks);
+
+// The report as a table, or as one JSON object with `json`.
+void ezyreport_print(const struct ezyreport *r, FILE *f);
+
+#endif // ezy_report_h
@@ -0,0 +1,34 @@
+#if !defined(ezy_sema_h)
+#define ezy_sema_h
+
+#include <ezy_ast.h>
+#include <ezy_symtab.h>
+#include <stddef.h>
+
+// Resolve every variable reference and call to its declaring symbol.
+// Returns false if a name could not be resolved or is declared twice
+// (errors are logged). Calls to undeclared functions are left for the C
+// compiler, with a warning.
+bool ezysema_resolve(ezy_ast_node_t *root);
+
+// Same for one module of a program: the functions and globals declared
+// at the top of the `imports` lists (the modules it uses, analysed
+// already) are visible too. Their nodes are only read.
+bool ezysema_resolve_module(ezy_ast_node_t *root, ezy_ast_node_t *const *imports, size_t import_count);
+
+// Compute `eval_typ` for every expression, fill in inferred declaration
+// types and inferred function return types. Must run after ezysema_resolve.
+// Anything that cannot be typed statically becomes `var`. Returns false
+// if an error was reported (an array initializer that does not fit, an
+// unsafe @region function, ...); the program must not be compiled then.
+bool ezysema_infer_types(ezy_ast_node_t *root);
+
+// What a function's body may do with heap memory it did not allocate
+// itself, through its own statements or its callees (function escapes).
+enum ezysema_escape {
+  ezysema_escape_global = 1, // stores into or grows a global
+  ezysema_escape_param = 2,  // stores into or grows a parameter
+  ezysema_escape_extern = 4, // passes heap memory to a C function
+};
+
+#endif // ezy_sema_h
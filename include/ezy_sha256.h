@@ -0,0 +1,25 @@
+#if !defined(ezy_sha256_h)
+#define ezy_sha256_h
+
+#include <stddef.h>
+#include <stdint.h>
+
+// FIPS 180-4 SHA-256, streaming.
+
+#define ezysha256_size 32
+
+struct ezysha256 {
+  uint32_t state[8];
+  uint64_t bytes; // hashed so far
+  uint8_t block[64];
+  size_t fill;    // bytes waiting in block
+};
+
+void ezysha256_init(struct ezysha256 *h);
+void ezysha256_update(struct ezysha256 *h, const void *data, size_t n);
+void ezysha256_final(struct ezysha256 *h, uint8_t digest[ezysha256_size]);
+
+// digest as 64 lowercase hex digits and a NUL
+void ezysha256_hex(const uint8_t digest[ezysha256_size], char out[2 * ezysha256_size + 1]);
+
+#endif // ezy_sha256_h
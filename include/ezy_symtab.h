@@ -0,0 +1,75 @@
+#if !defined(ezy_symtab_h)
+#define ezy_symtab_h
+
+#include <ezy_ast.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+enum ezy_sym_kind {
+  ezy_sym_invalid = 0,
+  ezy_sym_builtin,
+  ezy_sym_function,
+  ezy_sym_global,
+  ezy_sym_param,
+  ezy_sym_local,
+};
+
+struct ezy_symbol_t {
+  enum ezy_sym_kind kind;
+  ezy_cstr_t name;
+  uint32_t hash;
+  uint32_t depth; // scope depth the symbol was declared at
+
+  // points into the declaring node, so later passes see refined types
+  struct ezy_ast_datatype_t *typ;
+  union {
+    struct ezy_ast_function_t *function;
+    struct ezy_ast_node_t *variable; // variable_decl node
+    struct ezy_ast_args_t *param;
+  } decl;
+
+  // a local string or dynamic array whose value may outlive its
+  // function, set by ezysema_infer_types
+  bool escapes;
+
+  // scratch of the transpiler's range analysis: the values a local
+  // integer holds, or the least length of a local dynamic array
+  bool ranged;
+  int64_t range_lo;
+  int64_t range_hi;
+
+  // scratch of the native and bytecode backends: a local's index in its
+  // function, a function's index in the program
+  uint32_t slot;
+
+  // symbol hidden by this one, restored when its scope is popped
+  struct ezy_symbol_t *shadowed;
+};
+
+// One open-addressing map for every scope, plus an undo log of declarations.
+// Popping a scope walks the log back to the scope mark, so lookups stay O(1)
+// no matter how many scopes are open.
+struct ezysym_table {
+  struct ezy_symbol_t **slots;
+  size_t cap; // power of two
+  size_t used;
+
+  struct ezy_symbol_t **log;
+  size_t log_len;
+  size_t log_cap;
+
+  size_t *marks; // log length at each scope push
+  size_t depth;
+  size_t marks_cap;
+};
+
+void ezysym_init(struct ezysym_table *tab);
+void ezysym_free(struct ezysym_table *tab);
+
+void ezysym_push_scope(struct ezysym_table *tab);
+void ezysym_pop_scope(struct ezysym_table *tab);
+
+struct ezy_symbol_t *ezysym_declare(struct ezysym_table *tab, enum ezy_sym_kind kind, ezy_cstr_t name);
+struct ezy_symbol_t *ezysym_lookup(const struct ezysym_table *tab, ezy_cstr_t name);
+
+#endif // ezy_symtab_h
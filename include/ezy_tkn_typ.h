@@ -74,6 +74,7 @@ enum ezy_op_typ
   /* Others */
   ezy_op_qn, // '?'
   ezy_op_dot,
+  ezy_op_at, // '@', attributes
 };
 
 enum ezy_tkn_typ
@@ -2,7 +2,66 @@
 #define ezy_transpile_c_h
 
 #include <ezy_ast.h>
+#include <ezy_emit.h>
+#include <stddef.h>
 
+// dynamic arrays bounded by (or guided to) at most this many elements
+// keep them inline instead of on the heap
+#define ezytranspile_small_array_default 16
+
+// allocation sites in function bodies: local dynamic arrays and string
+// concatenations, and those whose value does not escape and lives on the
+// stack instead of the heap
+struct ezytranspile_stats {
+  size_t alloc_sites;
+  size_t stack_sites;
+  size_t index_sites;  // array indexing, with --checks=on|elide
+  size_t index_elided; // of those, proven in range and left unchecked
+};
+
+// bounds checks on array indexing
+enum ezytranspile_checks {
+  ezytranspile_checks_elide = 0, // check what is not proven in range
+  ezytranspile_checks_on,        // check every index
+  ezytranspile_checks_off,
+};
+
+struct ezytranspile_opts {
+  int jobs;               // code generation threads, the caller included
+  size_t small_array_max; // inline element limit for local dynamic arrays, 0 disables
+  enum ezytranspile_checks checks;
+  struct ezytranspile_stats *stats; // added to when not NULL
+};
+
+// Returns the generated C as a chunk chain, NULL on failure.
+// Release it with ezytranspile_c_free.
 ezy_multistr_t* ezytranspile_c(ezy_ast_node_t *node);
+void ezytranspile_c_free(ezy_multistr_t *code);
+
+// Same output as ezytranspile_c, with top-level nodes generated on up to
+// `threads` threads (the caller included). Sema must have run already.
+ezy_multistr_t* ezytranspile_c_parallel(ezy_ast_node_t *node, int threads);
+
+// Same, with every code generation option spelled out.
+ezy_multistr_t* ezytranspile_c_opts(ezy_ast_node_t *node, const struct ezytranspile_opts *opts);
+
+// ezytranspile_c_opts in pieces, for callers that schedule the work
+// themselves: the prologue of the whole program `node` first, then the
+// C of the top-level nodes [first, end) in any order, on any thread.
+// Spliced in program order they are what ezytranspile_c_opts returns.
+// Each gives its chain and last chunk (both NULL when empty), false
+// when an allocation failed.
+bool ezytranspile_c_prologue(ezy_ast_node_t *node, const struct ezytranspile_opts *opts, ezy_multistr_t **head,
+                             ezy_multistr_t **tail);
+bool ezytranspile_c_range(ezy_ast_node_t *first, ezy_ast_node_t *end, ezy_multistr_t **head, ezy_multistr_t **tail);
+
+// Human readable C layout of every struct (size, padding, field offsets),
+// as ezytranspile_c lays them out. Sema must have run already.
+// Release it with ezytranspile_c_free.
+ezy_multistr_t* ezytranspile_layout_report(ezy_ast_node_t *node);
+
+// Append the text print writes for a literal argument, formatted exactly
+// like the runtime writers. False for a literal print cannot write.
+bool ezytranspile_print_literal(ezy_ast_node_t *node, ezy_emit_t *raw);
 
 #endif // ezy_transpile_c_h
@@ -0,0 +1,156 @@
+#if !defined(ezy_vm_h)
+#define ezy_vm_h
+
+#include <ezy_ast.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Bytecode backend behind `ezc run`: ezyvm_compile turns a checked AST
+// into register machine code, ezyvm_run interprets it in process, no C
+// compiler involved. It covers what the native backend does (scalar
+// locals and parameters, arithmetic, calls, print) plus scalar globals,
+// string constants and a few libm functions.
+
+// Instructions are 32 bits: the opcode in the low byte, then the
+// operands A, B, C a byte each, or A and a 16-bit Bx. A, B and C name
+// registers of the current frame, Bx a constant, global, function or
+// extern.
+#define ezyvm_op(i) ((i) & 0xff)
+#define ezyvm_a(i) (((i) >> 8) & 0xff)
+#define ezyvm_b(i) (((i) >> 16) & 0xff)
+#define ezyvm_c(i) ((i) >> 24)
+#define ezyvm_bx(i) ((i) >> 16)
+
+#define ezyvm_abc(op, a, b, c) ((uint32_t)(op) | (uint32_t)(a) << 8 | (uint32_t)(b) << 16 | (uint32_t)(c) << 24)
+#define ezyvm_abx(op, a, bx) ((uint32_t)(op) | (uint32_t)(a) << 8 | (uint32_t)(bx) << 16)
+
+#define ezyvm_max_regs 256
+#define ezyvm_max_bx 65536
+
+// X(name): one per opcode, in encoding order
+#define ezyvm_opcodes(X) \
+  X(move)    /* R[A] = R[B] */ \
+  X(loadk)   /* R[A] = K[Bx] */ \
+  X(getg)    /* R[A] = G[Bx] */ \
+  X(setg)    /* G[Bx] = R[A] */ \
+  X(add)     /* R[A] = R[B] + R[C], 64-bit integers wrap */ \
+  X(sub) \
+  X(mul) \
+  X(div_i)   /* signed */ \
+  X(div_u) \
+  X(mod_i) \
+  X(mod_u) \
+  X(addf)    /* doubles, float32 is rounded by a conv after */ \
+  X(subf) \
+  X(mulf) \
+  X(divf) \
+  X(eq)      /* R[A] = R[B] == R[C] */ \
+  X(ne) \
+  X(eqf) \
+  X(nef) \
+  X(conv)    /* R[A] = R[B] converted, C is an ezyvm_conv */ \
+  X(call)    /* call function Bx, arguments from R[A], result in R[A] */ \
+  X(ccall)   /* call extern Bx the same way */ \
+  X(ret)     /* return R[A] */ \
+  X(ret0)    /* return nothing */ \
+  X(write_k) /* write the string constant K[Bx] */ \
+  X(write_i) /* write R[A] as a signed integer */ \
+  X(write_u) \
+  X(write_f) \
+  X(write_f32) /* write R[A], a float32 held as a double */ \
+  X(write_b) \
+  X(write_s) /* write the string R[A] */
+
+enum ezyvm_opcode {
+#define ezyvm_opcode_enum(name) ezyvm_op_##name,
+  ezyvm_opcodes(ezyvm_opcode_enum)
+#undef ezyvm_opcode_enum
+  ezyvm_op_count
+};
+
+// conversions between the representations of C types: integers are
+// held extended to 64 bits, floats as doubles
+enum ezyvm_conv {
+  ezyvm_conv_i8,
+  ezyvm_conv_u8,
+  ezyvm_conv_i16,
+  ezyvm_conv_u16,
+  ezyvm_conv_i32,
+  ezyvm_conv_u32,
+  ezyvm_conv_bool, // from an integer
+  ezyvm_conv_f32,  // round a double to float precision
+  ezyvm_conv_i2f,
+  ezyvm_conv_u2f,
+  ezyvm_conv_f2i,
+  ezyvm_conv_f2u,
+  ezyvm_conv_f2bool,
+};
+
+typedef union ezyvm_value {
+  int64_t i;
+  uint64_t u;
+  double f;
+} ezyvm_value;
+
+// a string constant in ezyvm_program.strings, as a value
+#define ezyvm_str(off, len) ((uint64_t)(off) << 32 | (uint32_t)(len))
+#define ezyvm_str_off(v) ((v) >> 32)
+#define ezyvm_str_len(v) ((uint32_t)(v))
+
+struct ezyvm_function {
+  ezy_cstr_t name;
+  uint32_t code; // index of the first instruction
+  uint32_t params;
+  uint32_t regs; // frame size, parameters first
+};
+
+struct ezyvm_program {
+  uint32_t *code;
+  size_t code_len;
+  size_t code_cap;
+
+  ezyvm_value *consts;
+  size_t const_count;
+  size_t const_cap;
+
+  char *strings; // bytes of the string constants
+  size_t strings_len;
+  size_t strings_cap;
+
+  struct ezyvm_function *funcs;
+  size_t func_count;
+  size_t entry; // main
+
+  // zero when the program starts, main sets their initial values first
+  size_t global_count;
+
+  bool failed;
+};
+
+// C functions bytecode can call, by signature
+enum ezyvm_sig {
+  ezyvm_sig_d_d,  // double f(double)
+  ezyvm_sig_d_dd, // double f(double, double)
+  ezyvm_sig_i_i,  // int f(int)
+  ezyvm_sig_l_l,  // long f(long)
+};
+
+struct ezyvm_extern {
+  const char *name;
+  enum ezyvm_sig sig;
+};
+
+// Index of the extern `name`, -1 when there is none.
+int ezyvm_extern_find(ezy_cstr_t name);
+const struct ezyvm_extern *ezyvm_extern_get(int index);
+
+// Compile every function of `root` (sema must have run). Unsupported
+// constructs are reported, the program is then unusable.
+bool ezyvm_compile(ezy_ast_node_t *root, struct ezyvm_program *prog);
+void ezyvm_free(struct ezyvm_program *prog);
+
+// Run main, returns its exit status.
+int ezyvm_run(const struct ezyvm_program *prog);
+
+#endif // ezy_vm_h
@@ -0,0 +1,18 @@
+#if !defined(ezy_x64_h)
+#define ezy_x64_h
+
+#include <ezy_ast.h>
+
+// Native backend: lowers a checked AST straight to x86-64 machine code
+// (System V ABI) in a relocatable ELF object, linked like the transpiled
+// C with obj/libezyrt.a. It covers scalar programs: functions, integer,
+// float and bool locals and parameters, literals, arithmetic, == and !=,
+// assignment, calls and print. Anything else is reported and fails, the
+// C backend handles the whole language.
+
+// Returns the object file as a chunk chain, NULL on failure. Sema must
+// have run already. Release it with ezyx64_free.
+ezy_multistr_t *ezyx64_object(ezy_ast_node_t *root);
+void ezyx64_free(ezy_multistr_t *obj);
+
+#endif // ezy_x64_h
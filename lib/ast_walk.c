@@ -0,0 +1,274 @@
+#include <ezy_ast_walk.h>
+#include <ezy_log.h>
+#include <stdlib.h>
+#include <string.h>
+
+// ================ Frame stack ================
+
+static bool ezywalk_push(struct ezywalk_t *w, ezy_ast_node_t *node)
+{
+  if (w->chunk == NULL)
+  {
+    w->inline_chunk = (struct ezywalk_chunk){.cap = ezywalk_inline_frames, .frames = w->inline_frames};
+    w->chunk = &w->inline_chunk;
+    w->used = 0;
+  }
+  if (w->used == w->chunk->cap)
+  {
+    struct ezywalk_chunk *next = w->chunk->next;
+    if (next == NULL)
+    {
+      next = malloc(sizeof(struct ezywalk_chunk) + ezywalk_chunk_frames * sizeof(struct ezywalk_frame));
+      if (next == NULL)
+      {
+        ezy_log_error("ezywalk: out of memory for walk stack");
+        return false;
+      }
+      next->prev = w->chunk;
+      next->next = NULL;
+      next->cap = ezywalk_chunk_frames;
+      next->frames = (struct ezywalk_frame *)(next + 1);
+      w->chunk->next = next;
+    }
+    w->chunk = next;
+    w->used = 0;
+  }
+  w->chunk->frames[w->used++] = (struct ezywalk_frame){.node = node};
+  return true;
+}
+
+static void ezywalk_pop(struct ezywalk_t *w)
+{
+  w->used--;
+  if (w->used == 0 && w->chunk->prev != NULL)
+  {
+    w->chunk = w->chunk->prev;
+    w->used = w->chunk->cap;
+  }
+}
+
+static inline struct ezywalk_frame *ezywalk_top(struct ezywalk_t *w)
+{
+  return &w->chunk->frames[w->used - 1];
+}
+
+// node of the frame below the top one, NULL at top level
+static ezy_ast_node_t *ezywalk_below(struct ezywalk_t *w)
+{
+  if (w->used >= 2)
+    return w->chunk->frames[w->used - 2].node;
+  if (w->chunk->prev != NULL)
+    return w->chunk->prev->frames[w->chunk->prev->cap - 1].node;
+  return NULL;
+}
+
+// ================ Children ================
+
+// Fetch the next child of the frame's node into *child (which may be NULL
+// for a missing operand). Returns false when there are no more children.
+static bool ezywalk_next_child(struct ezywalk_frame *f, ezy_ast_node_t **child)
+{
+  ezy_ast_node_t *node = f->node;
+  size_t i = f->child;
+
+  if (node == NULL)
+  {
+    // statement list: cursor starts at the head
+    if (i > 0)
+      f->cursor = f->cursor->next;
+    *child = f->cursor;
+    return f->cursor != NULL;
+  }
+
+  switch (node->type)
+  {
+  case ezy_ast_node_function:
+    f->cursor = i == 0 ? node->data.n_function->body : f->cursor->next;
+    *child = f->cursor;
+    return f->cursor != NULL;
+
+  case ezy_ast_node_call:
+    if (i >= node->data.n_call->arg_count)
+      return false;
+    *child = &node->data.n_call->args[i];
+    return true;
+
+  case ezy_ast_node_binop:
+    if (i >= 2)
+      return false;
+    *child = i == 0 ? node->data.n_binop.left : node->data.n_binop.right;
+    return true;
+
+  case ezy_ast_node_variable_decl:
+    if (i >= 1)
+      return false;
+    *child = node->data.n_variable.value;
+    return true;
+
+  case ezy_ast_node_return:
+    if (i >= 1)
+      return false;
+    *child = node->data.n_return.value;
+    return true;
+
+  case ezy_ast_node_array_lit:
+    if (i >= node->data.n_array_lit.count)
+      return false;
+    *child = &node->data.n_array_lit.elements[i];
+    return true;
+
+  case ezy_ast_node_struct_lit:
+    if (i >= node->data.n_struct_lit.count)
+      return false;
+    *child = &node->data.n_struct_lit.elements[i];
+    return true;
+
+  case ezy_ast_node_index:
+    if (i >= 2)
+      return false;
+    *child = i == 0 ? node->data.n_index.base : node->data.n_index.index;
+    return true;
+
+  case ezy_ast_node_member:
+    if (i >= 1)
+      return false;
+    *child = node->data.n_member.object;
+    return true;
+
+  default:
+    return false;
+  }
+}
+
+// ================ Walk ================
+
+static bool ezywalk_run(struct ezywalk_t *w, ezy_ast_node_t *list_head, ezy_ast_node_t *node)
+{
+  if (w->chunk == NULL)
+  {
+    // first walk: set up the bottom chunk so the base position is stable
+    if (!ezywalk_push(w, NULL))
+      return false;
+    w->used = 0;
+  }
+
+  struct ezywalk_chunk *base_chunk = w->chunk;
+  size_t base_used = w->used;
+  size_t base_depth = w->depth;
+
+  // list frames sit below the nodes they hold, so depth counts node frames only
+  bool is_list = list_head != NULL;
+  if (!ezywalk_push(w, is_list ? NULL : node))
+    return false;
+  if (is_list)
+    ezywalk_top(w)->cursor = list_head;
+
+  size_t depth = base_depth;
+  bool ok = true;
+
+  while (w->chunk != base_chunk || w->used != base_used)
+  {
+    struct ezywalk_frame *f = ezywalk_top(w);
+    ezy_ast_node_t *cur = f->node;
+
+    if (!f->entered)
+    {
+      f->entered = true;
+      if (cur != NULL && w->pre != NULL)
+      {
+        w->depth = depth;
+        w->parent = ezywalk_below(w);
+        enum ezywalk_action act = w->pre(w, cur);
+        if (act == ezywalk_stop)
+        {
+          ok = false;
+          break;
+        }
+        f->skip = act == ezywalk_skip;
+      }
+      if (cur != NULL)
+        depth++;
+    }
+
+    ezy_ast_node_t *child = NULL;
+    if (!f->skip && ezywalk_next_child(f, &child))
+    {
+      size_t idx = f->child++;
+      if (child == NULL)
+        continue;
+      if (cur != NULL && w->child != NULL)
+      {
+        w->depth = depth - 1;
+        w->parent = ezywalk_below(w);
+        enum ezywalk_action act = w->child(w, cur, idx);
+        if (act == ezywalk_stop)
+        {
+          ok = false;
+          break;
+        }
+        if (act == ezywalk_skip)
+          continue; // hook handled this child itself
+      }
+      if (!ezywalk_push(w, child))
+      {
+        ok = false;
+        break;
+      }
+      continue;
+    }
+
+    // all children done
+    if (cur != NULL)
+    {
+      depth--;
+      if (w->post != NULL)
+      {
+        w->depth = depth;
+        w->parent = ezywalk_below(w);
+        if (w->post(w, cur) == ezywalk_stop)
+        {
+          ok = false;
+          break;
+        }
+      }
+    }
+    ezywalk_pop(w);
+  }
+
+  // unwind whatever a stop left behind, keeping the chunks for reuse
+  while (w->chunk != base_chunk || w->used != base_used)
+  {
+    ezywalk_pop(w);
+  }
+  w->depth = base_depth;
+  return ok;
+}
+
+bool ezywalk_node(struct ezywalk_t *w, ezy_ast_node_t *node)
+{
+  if (node == NULL)
+    return true;
+  return ezywalk_run(w, NULL, node);
+}
+
+bool ezywalk_list(struct ezywalk_t *w, ezy_ast_node_t *head)
+{
+  if (head == NULL)
+    return true;
+  return ezywalk_run(w, head, NULL);
+}
+
+void ezywalk_release(struct ezywalk_t *w)
+{
+  if (w->chunk == NULL)
+    return; // never used
+  struct ezywalk_chunk *chunk = w->inline_chunk.next;
+  while (chunk != NULL)
+  {
+    struct ezywalk_chunk *next = chunk->next;
+    free(chunk);
+    chunk = next;
+  }
+  w->chunk = NULL;
+  w->used = 0;
+}
@@ -0,0 +1,1020 @@
+#include <ezy_ast_walk.h>
+#include <ezy_emit.h>
+#include <ezy_log.h>
+#include <ezy_symtab.h>
+#include <ezy_transpile_c.h>
+#include <ezy_vm.h>
+#include <stdlib.h>
+#include <string.h>
+
+// ================ Types ================
+// Every value has the representation C gives its type, so a program
+// prints the same run here as compiled: integers extended to 64 bits
+// from their width, floats as doubles (float32 rounded after every
+// operation), strings as a constant's offset and length.
+
+enum ezybc_type {
+  ezybc_bad = 0, // not compiled, an error was reported
+  ezybc_none,    // void
+  ezybc_i8,
+  ezybc_u8,
+  ezybc_i16,
+  ezybc_u16,
+  ezybc_i32,
+  ezybc_u32,
+  ezybc_i64,
+  ezybc_u64,
+  ezybc_bool,
+  ezybc_f32,
+  ezybc_f64,
+  ezybc_str,
+};
+
+static inline bool ezybc_is_float(enum ezybc_type t)
+{
+  return t == ezybc_f32 || t == ezybc_f64;
+}
+
+static inline bool ezybc_is_int(enum ezybc_type t)
+{
+  return t >= ezybc_i8 && t <= ezybc_bool;
+}
+
+static inline bool ezybc_is_signed(enum ezybc_type t)
+{
+  return t == ezybc_i8 || t == ezybc_i16 || t == ezybc_i32 || t == ezybc_i64;
+}
+
+static enum ezybc_type ezybc_type_of(const struct ezy_ast_datatype_t *dt)
+{
+  if (dt->nullable || dt->is_ptr)
+    return ezybc_bad;
+  switch (dt->typ)
+  {
+  case ezy_ast_dt_void: return ezybc_none;
+  case ezy_ast_dt_int8: return ezybc_i8;
+  case ezy_ast_dt_uint8: return ezybc_u8;
+  case ezy_ast_dt_int16: return ezybc_i16;
+  case ezy_ast_dt_uint16: return ezybc_u16;
+  case ezy_ast_dt_int32: return ezybc_i32;
+  case ezy_ast_dt_uint32: return ezybc_u32;
+  case ezy_ast_dt_int64: return ezybc_i64;
+  case ezy_ast_dt_uint64: return ezybc_u64;
+  case ezy_ast_dt_bool: return ezybc_bool;
+  case ezy_ast_dt_float32: return ezybc_f32;
+  case ezy_ast_dt_float64: return ezybc_f64;
+  case ezy_ast_dt_string: return ezybc_str;
+  default: return ezybc_bad;
+  }
+}
+
+// C's usual arithmetic conversions
+static enum ezybc_type ezybc_common(enum ezybc_type a, enum ezybc_type b)
+{
+  if (a == ezybc_f64 || b == ezybc_f64)
+    return ezybc_f64;
+  if (a == ezybc_f32 || b == ezybc_f32)
+    return ezybc_f32;
+  a = a < ezybc_i32 || a == ezybc_bool ? ezybc_i32 : a;
+  b = b < ezybc_i32 || b == ezybc_bool ? ezybc_i32 : b;
+  if (a == b)
+    return a;
+  if (a >= ezybc_i64 || b >= ezybc_i64)
+    return a == ezybc_u64 || b == ezybc_u64 ? ezybc_u64 : ezybc_i64;
+  return ezybc_u32;
+}
+
+// ================ Program buffers ================
+
+struct ezybc_local {
+  struct ezy_symbol_t *sym; // NULL for a parameter
+  enum ezybc_type typ;
+};
+
+// the record of an expression node while it is compiled, see Expressions
+struct ezybc_value {
+  uint32_t reg;        // where the node leaves its value
+  uint32_t top;        // c->top when the node starts, restored once it is done
+  enum ezybc_type typ; // ezybc_bad until computed
+};
+
+struct ezybc {
+  struct ezyvm_program *prog;
+  struct ezy_ast_function_t **decls; // parallel to prog->funcs
+  struct ezy_symbol_t **globals;     // global i is G[i]
+  ezy_ast_node_t *root;
+  struct ezy_ast_function_t *fn;
+
+  struct ezybc_local *locals; // local i lives in register i
+  size_t count;
+  size_t cap;
+  uint32_t top; // first free register, temporaries sit above the locals
+  uint32_t max;
+  uint32_t mark; // c->top before the current statement
+  bool failed;
+
+  uint32_t *slots; // hash of the constants
+  size_t slot_count;
+
+  struct ezywalk_t walk;
+  struct ezybc_value *vals;
+  size_t val_count;
+  size_t val_cap;
+};
+
+static bool ezybc_unsupported(struct ezybc *c, const char *what, int detail)
+{
+  ezy_log_error("bytecode: %s (%d) in function %.*s is not supported, compile it to C instead", what, detail,
+                (int)c->fn->name.len, c->fn->name.ptr);
+  c->failed = true;
+  return false;
+}
+
+static bool ezybc_grow(struct ezybc *c, void **items, size_t *cap, size_t need, size_t size)
+{
+  if (need <= *cap)
+    return true;
+  size_t n = *cap > 0 ? *cap * 2 : 64;
+  while (n < need)
+    n *= 2;
+  void *p = realloc(*items, n * size);
+  if (p == NULL)
+  {
+    ezy_log_error("bytecode: out of memory");
+    c->failed = c->prog->failed = true;
+    return false;
+  }
+  *items = p;
+  *cap = n;
+  return true;
+}
+
+static void ezybc_emit(struct ezybc *c, uint32_t ins)
+{
+  struct ezyvm_program *p = c->prog;
+  if (ezybc_grow(c, (void **)&p->code, &p->code_cap, p->code_len + 1, sizeof *p->code))
+    p->code[p->code_len++] = ins;
+}
+
+static inline size_t ezybc_hash(uint64_t bits, size_t mask)
+{
+  return (size_t)((bits * 0x9e3779b97f4a7c15u) >> 32) & mask;
+}
+
+// c->slots at twice the constants, holding each one's index + 1
+static bool ezybc_rehash(struct ezybc *c)
+{
+  struct ezyvm_program *p = c->prog;
+  size_t n = c->slot_count > 0 ? c->slot_count * 2 : 1024;
+  uint32_t *slots = calloc(n, sizeof *slots);
+  if (slots == NULL)
+  {
+    ezy_log_error("bytecode: out of memory");
+    c->failed = p->failed = true;
+    return false;
+  }
+  for (size_t k = 0; k < p->const_count; k++)
+  {
+    size_t i = ezybc_hash(p->consts[k].u, n - 1);
+    while (slots[i] != 0)
+      i = (i + 1) & (n - 1);
+    slots[i] = (uint32_t)k + 1;
+  }
+  free(c->slots);
+  c->slots = slots;
+  c->slot_count = n;
+  return true;
+}
+
+// Equal constants are stored once, a generated expression repeating the
+// same literal takes one slot.
+static uint32_t ezybc_const(struct ezybc *c, ezyvm_value v)
+{
+  struct ezyvm_program *p = c->prog;
+  if (p->const_count * 2 >= c->slot_count && !ezybc_rehash(c))
+    return 0;
+  size_t i = ezybc_hash(v.u, c->slot_count - 1);
+  for (; c->slots[i] != 0; i = (i + 1) & (c->slot_count - 1))
+  {
+    if (p->consts[c->slots[i] - 1].u == v.u)
+      return c->slots[i] - 1;
+  }
+  if (p->const_count == ezyvm_max_bx)
+    return ezybc_unsupported(c, "more constants than fit an instruction", ezyvm_max_bx), 0;
+  if (!ezybc_grow(c, (void **)&p->consts, &p->const_cap, p->const_count + 1, sizeof *p->consts))
+    return 0;
+  p->consts[p->const_count] = v;
+  c->slots[i] = (uint32_t)p->const_count + 1;
+  return (uint32_t)p->const_count++;
+}
+
+// the decoded bytes of `raw` as a string constant
+static uint32_t ezybc_string(struct ezybc *c, ezy_emit_t *raw)
+{
+  struct ezyvm_program *p = c->prog;
+  size_t off = p->strings_len, len = 0;
+  for (ezy_multistr_t *chunk = raw->head; chunk != NULL; chunk = chunk->next)
+  {
+    if (!ezybc_grow(c, (void **)&p->strings, &p->strings_cap, p->strings_len + chunk->str.len, 1))
+      return 0;
+    memcpy(p->strings + p->strings_len, chunk->str.ptr, chunk->str.len);
+    p->strings_len += chunk->str.len;
+    len += chunk->str.len;
+  }
+  if (off > UINT32_MAX || len > UINT32_MAX)
+    return ezybc_unsupported(c, "more string constants than 4 GiB", 0), 0;
+  return ezybc_const(c, (ezyvm_value){.u = ezyvm_str(off, len)});
+}
+
+static uint32_t ezybc_temp(struct ezybc *c)
+{
+  if (c->top == ezyvm_max_regs)
+  {
+    ezybc_unsupported(c, "an expression needing more registers than", ezyvm_max_regs);
+    return ezyvm_max_regs - 1;
+  }
+  uint32_t r = c->top++;
+  c->max = c->top > c->max ? c->top : c->max;
+  return r;
+}
+
+// ================ Conversions ================
+
+static void ezybc_conv(struct ezybc *c, uint32_t dst, uint32_t src, enum ezyvm_conv kind)
+{
+  ezybc_emit(c, ezyvm_abc(ezyvm_op_conv, dst, src, kind));
+}
+
+// the conversion that narrows a 64-bit integer to `t`, -1 for none
+static int ezybc_narrow(enum ezybc_type t)
+{
+  switch (t)
+  {
+  case ezybc_i8: return ezyvm_conv_i8;
+  case ezybc_u8: return ezyvm_conv_u8;
+  case ezybc_i16: return ezyvm_conv_i16;
+  case ezybc_u16: return ezyvm_conv_u16;
+  case ezybc_i32: return ezyvm_conv_i32;
+  case ezybc_u32: return ezyvm_conv_u32;
+  case ezybc_bool: return ezyvm_conv_bool;
+  default: return -1;
+  }
+}
+
+// R[dst] = R[src] converted from `from` to `to`
+static bool ezybc_convert(struct ezybc *c, uint32_t dst, uint32_t src, enum ezybc_type from, enum ezybc_type to)
+{
+  if (from == ezybc_bad || to == ezybc_bad || from == ezybc_none || to == ezybc_none)
+    return false;
+  if (from == to || (from == ezybc_str) != (to == ezybc_str))
+  {
+    if (from != to)
+      return false;
+    if (dst != src)
+      ezybc_emit(c, ezyvm_abc(ezyvm_op_move, dst, src, 0));
+    return true;
+  }
+  if (ezybc_is_int(from) && ezybc_is_int(to))
+  {
+    // every integer is already extended to 64 bits
+    int narrow = ezybc_narrow(to);
+    if (narrow >= 0)
+      ezybc_conv(c, dst, src, (enum ezyvm_conv)narrow);
+    else if (dst != src)
+      ezybc_emit(c, ezyvm_abc(ezyvm_op_move, dst, src, 0));
+    return true;
+  }
+  if (ezybc_is_int(from))
+  {
+    ezybc_conv(c, dst, src, from == ezybc_u64 ? ezyvm_conv_u2f : ezyvm_conv_i2f);
+    if (to == ezybc_f32)
+      ezybc_conv(c, dst, dst, ezyvm_conv_f32);
+    return true;
+  }
+  if (ezybc_is_float(to))
+  {
+    // float32 is a double already
+    if (to == ezybc_f32)
+      ezybc_conv(c, dst, src, ezyvm_conv_f32);
+    else if (dst != src)
+      ezybc_emit(c, ezyvm_abc(ezyvm_op_move, dst, src, 0));
+    return true;
+  }
+  if (to == ezybc_bool)
+  {
+    ezybc_conv(c, dst, src, ezyvm_conv_f2bool);
+    return true;
+  }
+  ezybc_conv(c, dst, src, to == ezybc_u64 ? ezyvm_conv_f2u : ezyvm_conv_f2i);
+  int narrow = ezybc_narrow(to);
+  if (narrow >= 0)
+    ezybc_conv(c, dst, dst, (enum ezyvm_conv)narrow);
+  return true;
+}
+
+// ================ Expressions ================
+// Function bodies are compiled by an ezywalk, so deep expressions only
+// grow heap buffers. Each expression node has a record on c->vals, pushed
+// by its parent's child hook (by ezybc_pre for a statement) with the
+// register the node leaves its value in. The node's post hook computes
+// it with its children's records on top of its own and takes those off.
+// A value is written last, so `x = x + 1` may target x's own register.
+
+static struct ezybc_local *ezybc_local(struct ezybc *c, struct ezy_symbol_t *sym, uint32_t *reg)
+{
+  size_t i = SIZE_MAX;
+  if (sym != NULL && sym->kind == ezy_sym_param && sym->decl.param >= c->fn->params &&
+      sym->decl.param < c->fn->params + c->fn->param_count)
+    i = (size_t)(sym->decl.param - c->fn->params);
+  else if (sym != NULL && sym->kind == ezy_sym_local && sym->slot < c->count && c->locals[sym->slot].sym == sym)
+    i = sym->slot;
+  if (i == SIZE_MAX)
+    return NULL;
+  *reg = (uint32_t)i;
+  return &c->locals[i];
+}
+
+// the slot of a global in G, -1 for anything else
+static int ezybc_global(struct ezybc *c, struct ezy_symbol_t *sym)
+{
+  if (sym == NULL || sym->kind != ezy_sym_global || sym->slot >= c->prog->global_count ||
+      c->globals[sym->slot] != sym)
+    return -1;
+  return (int)sym->slot;
+}
+
+static bool ezybc_push(struct ezybc *c, uint32_t reg, enum ezybc_type typ)
+{
+  if (!ezybc_grow(c, (void **)&c->vals, &c->val_cap, c->val_count + 1, sizeof *c->vals))
+    return false;
+  c->vals[c->val_count++] = (struct ezybc_value){.reg = reg, .top = c->top, .typ = typ};
+  return true;
+}
+
+// The record of an operand: a local's own register, which holds its value
+// already (the walk skips the node then), or a temporary.
+static enum ezywalk_action ezybc_operand(struct ezybc *c, ezy_ast_node_t *node)
+{
+  uint32_t reg;
+  struct ezybc_local *l;
+  if (node->type == ezy_ast_node_variable && (l = ezybc_local(c, node->data.n_variable.sym, &reg)) != NULL)
+    return ezybc_push(c, reg, l->typ) ? ezywalk_skip : ezywalk_stop;
+  return ezybc_push(c, ezybc_temp(c), ezybc_bad) ? ezywalk_continue : ezywalk_stop;
+}
+
+static enum ezybc_type ezybc_literal(struct ezybc *c, ezy_ast_node_t *node, uint32_t dst)
+{
+  struct ezy_ast_literal_t *lit = &node->data.n_literal;
+  ezyvm_value v;
+  enum ezybc_type t;
+  switch (lit->typ)
+  {
+  case ezy_ast_dt_int32:
+  case ezy_ast_dt_int64:
+    v.i = lit->value.t_int64;
+    t = lit->typ == ezy_ast_dt_int32 ? ezybc_i32 : ezybc_i64;
+    break;
+  case ezy_ast_dt_uint64:
+    v.u = lit->value.t_uint64;
+    t = ezybc_u64;
+    break;
+  case ezy_ast_dt_float64:
+    v.f = lit->value.t_float64;
+    t = ezybc_f64;
+    break;
+  case ezy_ast_dt_string:
+  {
+    ezy_emit_t raw;
+    ezyemit_init(&raw);
+    ezytranspile_print_literal(node, &raw);
+    ezybc_emit(c, ezyvm_abx(ezyvm_op_loadk, dst, ezybc_string(c, &raw)));
+    ezyemit_free(raw.head);
+    return ezybc_str;
+  }
+  default:
+    ezybc_unsupported(c, "a literal of this type", lit->typ);
+    return ezybc_bad;
+  }
+  ezybc_emit(c, ezyvm_abx(ezyvm_op_loadk, dst, ezybc_const(c, v)));
+  return t;
+}
+
+static enum ezybc_type ezybc_variable(struct ezybc *c, ezy_ast_node_t *node, uint32_t dst)
+{
+  uint32_t reg;
+  struct ezy_symbol_t *sym = node->data.n_variable.sym;
+  struct ezybc_local *l = ezybc_local(c, sym, &reg);
+  int global = ezybc_global(c, sym);
+  if (l == NULL && global < 0)
+    return ezybc_unsupported(c, "an unresolved variable or a global of this type", node->type), ezybc_bad;
+  if (l == NULL)
+  {
+    ezybc_emit(c, ezyvm_abx(ezyvm_op_getg, dst, global));
+    return ezybc_type_of(sym->typ);
+  }
+  if (reg != dst)
+    ezybc_emit(c, ezyvm_abc(ezyvm_op_move, dst, reg, 0));
+  return l->typ;
+}
+
+// v[1] is the right value, computed in the local's register or, for a
+// global, in the assignment's own
+static enum ezybc_type ezybc_assign(struct ezybc *c, struct ezy_ast_binop_t *binop, struct ezybc_value *v)
+{
+  struct ezy_symbol_t *sym = binop->left->data.n_variable.sym;
+  uint32_t reg = v[1].reg;
+  struct ezybc_local *l = ezybc_local(c, sym, &reg);
+  enum ezybc_type typ = l != NULL ? l->typ : ezybc_type_of(sym->typ);
+  if (!ezybc_convert(c, reg, reg, v[1].typ, typ))
+    return ezybc_unsupported(c, "assigning a value of this type", binop->right->eval_typ.typ), ezybc_bad;
+  if (l == NULL)
+    ezybc_emit(c, ezyvm_abx(ezyvm_op_setg, reg, ezybc_global(c, sym)));
+  if (reg != v[0].reg)
+    ezybc_emit(c, ezyvm_abc(ezyvm_op_move, v[0].reg, reg, 0));
+  return typ;
+}
+
+// v[1] and v[2] are the operands
+static enum ezybc_type ezybc_binop(struct ezybc *c, ezy_ast_node_t *node, struct ezybc_value *v)
+{
+  struct ezy_ast_binop_t *binop = &node->data.n_binop;
+  if (binop->operator == ezy_op_assign)
+    return ezybc_assign(c, binop, v);
+
+  uint32_t dst = v[0].reg, l = v[1].reg, r = v[2].reg;
+  enum ezybc_type lt = v[1].typ, rt = v[2].typ;
+  if (!ezybc_is_int(lt) && !ezybc_is_float(lt))
+    return ezybc_unsupported(c, "an operand of this type", binop->left->eval_typ.typ), ezybc_bad;
+  if (!ezybc_is_int(rt) && !ezybc_is_float(rt))
+    return ezybc_unsupported(c, "an operand of this type", binop->right->eval_typ.typ), ezybc_bad;
+
+  enum ezybc_type ot = ezybc_common(lt, rt);
+  // `10 / 3` is floating division unless the declaration asks for an integer
+  if (binop->operator == ezy_op_divide && ezybc_is_int(lt) && ezybc_is_int(rt) &&
+      ezybc_is_float(ezybc_type_of(&node->eval_typ)))
+    ot = ezybc_f64;
+  if (lt != ot)
+  {
+    uint32_t t = ezybc_temp(c);
+    ezybc_convert(c, t, l, lt, ot);
+    l = t;
+  }
+  if (rt != ot)
+  {
+    uint32_t t = ezybc_temp(c);
+    ezybc_convert(c, t, r, rt, ot);
+    r = t;
+  }
+
+  bool flt = ezybc_is_float(ot), sgn = ezybc_is_signed(ot);
+  enum ezyvm_opcode op;
+  switch (binop->operator)
+  {
+  case ezy_op_plus: op = flt ? ezyvm_op_addf : ezyvm_op_add; break;
+  case ezy_op_minus: op = flt ? ezyvm_op_subf : ezyvm_op_sub; break;
+  case ezy_op_asterisk: op = flt ? ezyvm_op_mulf : ezyvm_op_mul; break;
+  case ezy_op_divide: op = flt ? ezyvm_op_divf : sgn ? ezyvm_op_div_i : ezyvm_op_div_u; break;
+  case ezy_op_modulo:
+    if (flt)
+      return ezybc_unsupported(c, "% on floats", binop->operator), ezybc_bad;
+    op = sgn ? ezyvm_op_mod_i : ezyvm_op_mod_u;
+    break;
+  case ezy_op_cond_eq:
+    ezybc_emit(c, ezyvm_abc(flt ? ezyvm_op_eqf : ezyvm_op_eq, dst, l, r));
+    return ezybc_i32;
+  case ezy_op_cond_neq:
+    ezybc_emit(c, ezyvm_abc(flt ? ezyvm_op_nef : ezyvm_op_ne, dst, l, r));
+    return ezybc_i32;
+  default:
+    return ezybc_unsupported(c, "this operator", binop->operator), ezybc_bad;
+  }
+  ezybc_emit(c, ezyvm_abc(op, dst, l, r));
+  // 32-bit results wrap, float32 results round
+  if (ot == ezybc_i32 || ot == ezybc_u32 || ot == ezybc_f32)
+    ezybc_convert(c, dst, dst, ot == ezybc_f32 ? ezybc_f64 : ezybc_i64, ot);
+  return ot;
+}
+
+static inline bool ezybc_is_print(struct ezy_ast_call_t *call)
+{
+  return call->sym != NULL && call->sym->kind == ezy_sym_builtin && call->func_name.len == 5 &&
+         memcmp(call->func_name.ptr, "print", 5) == 0;
+}
+
+// index of a function in prog->funcs, cached in its symbol
+static int ezybc_function(struct ezybc *c, struct ezy_ast_call_t *call)
+{
+  if (call->sym == NULL || call->sym->kind != ezy_sym_function)
+    return -1;
+  struct ezy_ast_function_t *fn = call->sym->decl.function;
+  if (call->sym->slot < c->prog->func_count && c->decls[call->sym->slot] == fn)
+    return (int)call->sym->slot;
+  for (size_t i = 0; i < c->prog->func_count; i++)
+  {
+    if (c->decls[i] == fn)
+    {
+      call->sym->slot = (uint32_t)i;
+      return (int)i;
+    }
+  }
+  return -1;
+}
+
+// a function of the program, or a known C function
+struct ezybc_callee {
+  int index; // in prog->funcs, or of the extern
+  struct ezy_ast_function_t *fn;
+  const struct ezyvm_extern *ext;
+};
+
+static struct ezybc_callee ezybc_callee(struct ezybc *c, struct ezy_ast_call_t *call)
+{
+  int fi = ezybc_function(c, call);
+  if (fi >= 0)
+    return (struct ezybc_callee){.index = fi, .fn = c->decls[fi]};
+  int ext = call->sym == NULL ? ezyvm_extern_find(call->func_name) : -1;
+  return (struct ezybc_callee){.index = ext, .ext = ext >= 0 ? ezyvm_extern_get(ext) : NULL};
+}
+
+// a C function takes and returns one type
+static enum ezybc_type ezybc_extern_type(const struct ezyvm_extern *e)
+{
+  return e->sig == ezyvm_sig_i_i ? ezybc_i32 : e->sig == ezyvm_sig_l_l ? ezybc_i64 : ezybc_f64;
+}
+
+static bool ezybc_call_check(struct ezybc *c, struct ezy_ast_call_t *call)
+{
+  struct ezybc_callee f = ezybc_callee(c, call);
+  if (f.fn == NULL && f.ext == NULL)
+    return ezybc_unsupported(c, "calling a function without a body or this builtin", (int)call->arg_count);
+  size_t want = f.fn != NULL ? f.fn->param_count : f.ext->sig == ezyvm_sig_d_dd ? 2 : 1;
+  if (call->arg_count != want)
+    return ezybc_unsupported(c, "a call with the wrong argument count", (int)call->arg_count);
+  return true;
+}
+
+// v[1 + i] is argument i, the arguments are in consecutive registers
+// from v[0].top and become the callee's first
+static enum ezybc_type ezybc_call(struct ezybc *c, struct ezy_ast_call_t *call, struct ezybc_value *v)
+{
+  struct ezybc_callee f = ezybc_callee(c, call);
+  for (size_t i = 0; i < call->arg_count; i++)
+  {
+    enum ezybc_type pt = f.fn != NULL ? ezybc_type_of(&f.fn->params[i].typ) : ezybc_extern_type(f.ext);
+    if (!ezybc_convert(c, v[1 + i].reg, v[1 + i].reg, v[1 + i].typ, pt))
+      return ezybc_unsupported(c, "an argument of this type", call->args[i].eval_typ.typ), ezybc_bad;
+  }
+  uint32_t base = v[0].top;
+  c->top = base;
+  if (f.fn != NULL)
+    ezybc_emit(c, ezyvm_abx(ezyvm_op_call, base, f.index));
+  else
+    ezybc_emit(c, ezyvm_abx(ezyvm_op_ccall, base, f.index));
+  enum ezybc_type rt = f.fn != NULL ? ezybc_type_of(&f.fn->return_typ) : ezybc_extern_type(f.ext);
+  if (rt != ezybc_none && base != v[0].reg)
+    ezybc_emit(c, ezyvm_abc(ezyvm_op_move, v[0].reg, base, 0));
+  return rt;
+}
+
+// ================ print ================
+// As in the transpiled print: a run of literals and separators is one
+// constant, other arguments go through the writer of their static type.
+// Each argument is written as soon as it is computed.
+
+static void ezybc_print_run(struct ezybc *c, struct ezy_ast_call_t *call, size_t end)
+{
+  size_t begin = end;
+  while (begin > 0 && call->args[begin - 1].type == ezy_ast_node_literal)
+    begin--;
+  ezy_emit_t raw;
+  ezyemit_init(&raw);
+  for (size_t i = begin; i <= end; i++)
+  {
+    if (i >= 1 && i < call->arg_count)
+      ezyemit_char(&raw, ' ');
+    if (i < end && !ezytranspile_print_literal(&call->args[i], &raw))
+      ezybc_unsupported(c, "a literal of this type in print", call->args[i].data.n_literal.typ);
+  }
+  size_t len = 0;
+  for (ezy_multistr_t *chunk = raw.head; chunk != NULL; chunk = chunk->next)
+    len += chunk->str.len;
+  if (len > 0)
+    ezybc_emit(c, ezyvm_abx(ezyvm_op_write_k, 0, ezybc_string(c, &raw)));
+  ezyemit_free(raw.head);
+}
+
+static bool ezybc_print_value(struct ezybc *c, ezy_ast_node_t *arg, uint32_t reg, enum ezybc_type t)
+{
+  // evaluated for its side effects, prints nothing
+  if (t == ezybc_none)
+    return true;
+  enum ezybc_type want = ezybc_type_of(&arg->eval_typ);
+  enum ezyvm_opcode op;
+  enum ezybc_type as;
+  switch (want)
+  {
+  case ezybc_i8:
+  case ezybc_i16:
+  case ezybc_i32:
+  case ezybc_i64: op = ezyvm_op_write_i, as = ezybc_i64; break;
+  case ezybc_u8:
+  case ezybc_u16:
+  case ezybc_u32:
+  case ezybc_u64: op = ezyvm_op_write_u, as = ezybc_u64; break;
+  case ezybc_f32: op = ezyvm_op_write_f32, as = ezybc_f32; break;
+  case ezybc_f64: op = ezyvm_op_write_f, as = ezybc_f64; break;
+  case ezybc_bool: op = ezyvm_op_write_b, as = ezybc_bool; break;
+  case ezybc_str: op = ezyvm_op_write_s, as = ezybc_str; break;
+  default:
+    return ezybc_unsupported(c, "printing a value of this type", arg->eval_typ.typ);
+  }
+  if (t != as)
+  {
+    uint32_t tmp = ezybc_temp(c);
+    if (!ezybc_convert(c, tmp, reg, t, as))
+      return ezybc_unsupported(c, "printing a value of this type", arg->eval_typ.typ);
+    reg = tmp;
+  }
+  ezybc_emit(c, ezyvm_abc(op, reg, 0, 0));
+  return true;
+}
+
+// ================ Walk ================
+
+// Computes `node` into the register of its record. print writes the
+// value and a statement drops it, any other parent takes the record off
+// in its own post hook.
+static bool ezybc_value(struct ezybc *c, ezy_ast_node_t *parent, ezy_ast_node_t *node)
+{
+  size_t kids = 0;
+  if (node->type == ezy_ast_node_binop)
+    kids = node->data.n_binop.operator == ezy_op_assign ? 1 : 2;
+  else if (node->type == ezy_ast_node_call && !ezybc_is_print(node->data.n_call))
+    kids = node->data.n_call->arg_count;
+  struct ezybc_value *v = &c->vals[c->val_count - 1 - kids];
+  c->val_count -= kids;
+
+  enum ezybc_type t;
+  switch (node->type)
+  {
+  case ezy_ast_node_literal: t = ezybc_literal(c, node, v->reg); break;
+  case ezy_ast_node_variable: t = ezybc_variable(c, node, v->reg); break;
+  case ezy_ast_node_binop: t = ezybc_binop(c, node, v); break;
+  case ezy_ast_node_call:
+    if (ezybc_is_print(node->data.n_call))
+    {
+      c->top = v->top;
+      ezybc_print_run(c, node->data.n_call, node->data.n_call->arg_count);
+      t = ezybc_none;
+    }
+    else
+    {
+      t = ezybc_call(c, node->data.n_call, v);
+    }
+    break;
+  default:
+    ezybc_unsupported(c, "this kind of expression", node->type);
+    t = ezybc_bad;
+    break;
+  }
+  v->typ = t;
+  c->top = v->top;
+  if (t == ezybc_bad)
+    return false;
+  if (parent == NULL)
+  {
+    c->val_count--;
+    return true;
+  }
+  if (parent->type == ezy_ast_node_call && ezybc_is_print(parent->data.n_call))
+  {
+    c->val_count--;
+    return ezybc_print_value(c, node, v->reg, t);
+  }
+  return true;
+}
+
+static enum ezywalk_action ezybc_pre(struct ezywalk_t *w, ezy_ast_node_t *node)
+{
+  struct ezybc *c = w->ctx;
+  if (w->parent == NULL)
+    c->mark = c->top;
+  switch (node->type)
+  {
+  case ezy_ast_node_variable_decl:
+  {
+    struct ezy_ast_variable_t *var = &node->data.n_variable;
+    enum ezybc_type typ = ezybc_type_of(&var->typ);
+    if (typ == ezybc_bad || typ == ezybc_none || var->sym == NULL ||
+        (var->sym->kind != ezy_sym_local && ezybc_global(c, var->sym) < 0))
+      return ezybc_unsupported(c, "a variable of this type", var->typ.typ), ezywalk_stop;
+    if (var->value == NULL)
+      return ezybc_unsupported(c, "a variable without a value", var->typ.typ), ezywalk_stop;
+    return ezywalk_continue;
+  }
+  case ezy_ast_node_return:
+    return ezywalk_continue;
+  case ezy_ast_node_literal:
+  case ezy_ast_node_variable:
+    break;
+  case ezy_ast_node_binop:
+  {
+    ezy_ast_node_t *left = node->data.n_binop.left;
+    uint32_t reg;
+    if (node->data.n_binop.operator != ezy_op_assign)
+      break;
+    if (left->type != ezy_ast_node_variable)
+      return ezybc_unsupported(c, "assigning to this", left->type), ezywalk_stop;
+    if (ezybc_local(c, left->data.n_variable.sym, &reg) == NULL)
+    {
+      if (ezybc_global(c, left->data.n_variable.sym) < 0)
+        return ezybc_unsupported(c, "assigning to this", left->type), ezywalk_stop;
+      break;
+    }
+    // as a statement, the value stays in the local only
+    if (w->parent == NULL)
+      return ezybc_push(c, reg, ezybc_bad) ? ezywalk_continue : ezywalk_stop;
+    break;
+  }
+  case ezy_ast_node_call:
+    if (!ezybc_is_print(node->data.n_call) && !ezybc_call_check(c, node->data.n_call))
+      return ezywalk_stop;
+    break;
+  default:
+    return ezybc_unsupported(c, "this kind of expression", node->type), ezywalk_stop;
+  }
+  // a statement's value is dropped
+  if (w->parent == NULL && !ezybc_push(c, ezybc_temp(c), ezybc_bad))
+    return ezywalk_stop;
+  return ezywalk_continue;
+}
+
+static enum ezywalk_action ezybc_child(struct ezywalk_t *w, ezy_ast_node_t *node, size_t child)
+{
+  struct ezybc *c = w->ctx;
+  switch (node->type)
+  {
+  case ezy_ast_node_variable_decl:
+    // the register becomes the variable's
+    return ezybc_push(c, ezybc_temp(c), ezybc_bad) ? ezywalk_continue : ezywalk_stop;
+  case ezy_ast_node_return:
+    return ezybc_operand(c, node->data.n_return.value);
+  case ezy_ast_node_binop:
+  {
+    struct ezy_ast_binop_t *binop = &node->data.n_binop;
+    if (binop->operator == ezy_op_assign)
+    {
+      // a global is stored to from the assignment's own register
+      uint32_t reg = c->vals[c->val_count - 1].reg;
+      if (child == 0)
+        return ezywalk_skip; // stored to, not read
+      ezybc_local(c, binop->left->data.n_variable.sym, &reg);
+      return ezybc_push(c, reg, ezybc_bad) ? ezywalk_continue : ezywalk_stop;
+    }
+    // a left value that is not a local goes straight to the binop's own
+    // temporary, `a + b + c + ...` needs two registers however long
+    uint32_t dst = c->vals[c->val_count - 1].reg;
+    if (child == 0 && dst >= c->count && binop->left->type != ezy_ast_node_variable)
+      return ezybc_push(c, dst, ezybc_bad) ? ezywalk_continue : ezywalk_stop;
+    return ezybc_operand(c, child == 0 ? binop->left : binop->right);
+  }
+  case ezy_ast_node_call:
+  {
+    struct ezy_ast_call_t *call = node->data.n_call;
+    if (!ezybc_is_print(call))
+      return ezybc_push(c, ezybc_temp(c), ezybc_bad) ? ezywalk_continue : ezywalk_stop;
+    ezy_ast_node_t *arg = &call->args[child];
+    if (arg->type == ezy_ast_node_literal)
+      return ezywalk_skip; // folded into a constant run
+    // the previous argument is written, its temporaries are free
+    c->top = c->vals[c->val_count - 1].top;
+    ezybc_print_run(c, call, child);
+    enum ezywalk_action act = ezybc_operand(c, arg);
+    if (act == ezywalk_skip)
+    {
+      struct ezybc_value v = c->vals[--c->val_count];
+      if (!ezybc_print_value(c, arg, v.reg, v.typ))
+        return ezywalk_stop;
+    }
+    return act;
+  }
+  default:
+    return ezywalk_continue;
+  }
+}
+
+// ================ Statements ================
+
+static bool ezybc_declare(struct ezybc *c, ezy_ast_node_t *node)
+{
+  struct ezy_ast_variable_t *var = &node->data.n_variable;
+  enum ezybc_type typ = ezybc_type_of(&var->typ);
+  struct ezybc_value v = c->vals[--c->val_count];
+  if (!ezybc_convert(c, v.reg, v.reg, v.typ, typ))
+    return ezybc_unsupported(c, "initializing a variable with this type", var->value->eval_typ.typ);
+  if (var->sym->kind == ezy_sym_global)
+  {
+    ezybc_emit(c, ezyvm_abx(ezyvm_op_setg, v.reg, var->sym->slot));
+    c->top = c->mark;
+    return true;
+  }
+  if (!ezybc_grow(c, (void **)&c->locals, &c->cap, c->count + 1, sizeof *c->locals))
+    return false;
+  // locals are never freed, the register stays the variable's
+  c->top = v.top;
+  var->sym->slot = (uint32_t)c->count;
+  c->locals[c->count++] = (struct ezybc_local){.sym = var->sym, .typ = typ};
+  return true;
+}
+
+static bool ezybc_return(struct ezybc *c, ezy_ast_node_t *value)
+{
+  enum ezybc_type rt = ezybc_type_of(&c->fn->return_typ);
+  if (value == NULL)
+  {
+    ezybc_emit(c, ezyvm_abc(ezyvm_op_ret0, 0, 0, 0));
+    return true;
+  }
+  struct ezybc_value v = c->vals[--c->val_count];
+  uint32_t reg = v.reg;
+  if (v.typ != rt)
+  {
+    uint32_t tmp = ezybc_temp(c);
+    if (!ezybc_convert(c, tmp, reg, v.typ, rt))
+      return ezybc_unsupported(c, "returning a value of this type", value->eval_typ.typ);
+    reg = tmp;
+  }
+  ezybc_emit(c, ezyvm_abc(ezyvm_op_ret, reg, 0, 0));
+  return true;
+}
+
+static enum ezywalk_action ezybc_post(struct ezywalk_t *w, ezy_ast_node_t *node)
+{
+  struct ezybc *c = w->ctx;
+  bool ok;
+  if (node->type == ezy_ast_node_variable_decl)
+  {
+    ok = ezybc_declare(c, node);
+  }
+  else
+  {
+    if (node->type == ezy_ast_node_return)
+      ok = ezybc_return(c, node->data.n_return.value);
+    else
+      ok = ezybc_value(c, w->parent, node);
+    if (w->parent == NULL)
+      c->top = c->mark;
+  }
+  return ok && !c->failed ? ezywalk_continue : ezywalk_stop;
+}
+
+// main starts by giving the globals their values, in declaration order
+static bool ezybc_globals(struct ezybc *c)
+{
+  for (ezy_ast_node_t *node = c->root; node != NULL; node = node->next)
+  {
+    if (node->type != ezy_ast_node_variable_decl || ezybc_global(c, node->data.n_variable.sym) < 0)
+      continue;
+    if (!ezywalk_node(&c->walk, node))
+      return false;
+  }
+  return true;
+}
+
+static bool ezybc_body(struct ezybc *c, struct ezy_ast_function_t *fn, struct ezyvm_function *out)
+{
+  c->fn = fn;
+  c->count = 0;
+  c->top = c->max = 0;
+  c->val_count = 0;
+  c->failed = false;
+  if (ezybc_type_of(&fn->return_typ) == ezybc_bad || ezybc_type_of(&fn->return_typ) == ezybc_str)
+    return ezybc_unsupported(c, "a return of this type", fn->return_typ.typ);
+  if (fn->param_count > ezyvm_max_regs / 2)
+    return ezybc_unsupported(c, "this many parameters", (int)fn->param_count);
+  if (!ezybc_grow(c, (void **)&c->locals, &c->cap, fn->param_count, sizeof *c->locals))
+    return false;
+  for (size_t i = 0; i < fn->param_count; i++)
+  {
+    enum ezybc_type t = ezybc_type_of(&fn->params[i].typ);
+    if (t == ezybc_bad || t == ezybc_none)
+      return ezybc_unsupported(c, "a parameter of this type", fn->params[i].typ.typ);
+    c->locals[c->count++] = (struct ezybc_local){.typ = t};
+    ezybc_temp(c);
+  }
+
+  out->code = (uint32_t)c->prog->code_len;
+  out->params = (uint32_t)fn->param_count;
+  if (c->prog->entry < c->prog->func_count && c->decls[c->prog->entry] == fn && !ezybc_globals(c))
+    return false;
+  if (!ezywalk_list(&c->walk, fn->body))
+    return false;
+  bool returned = false;
+  for (ezy_ast_node_t *stmt = fn->body; stmt != NULL; stmt = stmt->next)
+    returned = stmt->type == ezy_ast_node_return;
+  if (!returned)
+    ezybc_emit(c, ezyvm_abc(ezyvm_op_ret0, 0, 0, 0));
+  out->regs = c->max;
+  return !c->failed;
+}
+
+bool ezyvm_compile(ezy_ast_node_t *root, struct ezyvm_program *prog)
+{
+  *prog = (struct ezyvm_program){.entry = SIZE_MAX};
+  struct ezybc c = {.prog = prog, .root = root, .walk = {.pre = ezybc_pre, .child = ezybc_child, .post = ezybc_post}};
+  c.walk.ctx = &c;
+  bool ok = true;
+
+  // number the functions and globals first, calls may come before their
+  // callee
+  size_t count = 0, globals = 0;
+  for (ezy_ast_node_t *node = root; node != NULL; node = node->next)
+  {
+    if (node->type == ezy_ast_node_function && node->data.n_function->body != NULL)
+      count++;
+    else if (node->type == ezy_ast_node_variable_decl)
+      globals++;
+    else if (node->type != ezy_ast_node_function)
+    {
+      ezy_log_error("bytecode: top level node %d is not supported, compile it to C instead", node->type);
+      ok = false;
+    }
+  }
+  if (count >= ezyvm_max_bx)
+  {
+    ezy_log_error("bytecode: more than %d functions", ezyvm_max_bx - 1);
+    return prog->failed = true, false;
+  }
+  if (globals > ezyvm_max_bx)
+  {
+    ezy_log_error("bytecode: more than %d globals", ezyvm_max_bx);
+    return prog->failed = true, false;
+  }
+  prog->funcs = calloc(count > 0 ? count : 1, sizeof *prog->funcs);
+  c.decls = calloc(count > 0 ? count : 1, sizeof *c.decls);
+  c.globals = calloc(globals > 0 ? globals : 1, sizeof *c.globals);
+  if (prog->funcs == NULL || c.decls == NULL || c.globals == NULL)
+  {
+    ezy_log_error("bytecode: out of memory");
+    free(c.decls);
+    free(c.globals);
+    return prog->failed = true, false;
+  }
+  for (ezy_ast_node_t *node = root; node != NULL; node = node->next)
+  {
+    if (node->type == ezy_ast_node_variable_decl)
+    {
+      struct ezy_ast_variable_t *var = &node->data.n_variable;
+      enum ezybc_type typ = ezybc_type_of(&var->typ);
+      if (var->value == NULL)
+      {
+        // it starts out null, which bytecode has no representation for
+        ezy_log_error("bytecode: global %.*s without a value is not supported, compile it to C instead",
+                      (int)var->name.len, var->name.ptr);
+        ok = false;
+        continue;
+      }
+      if (typ == ezybc_bad || typ == ezybc_none || var->sym == NULL || var->sym->kind != ezy_sym_global)
+      {
+        ezy_log_error("bytecode: global %.*s of type %d is not supported, compile it to C instead",
+                      (int)var->name.len, var->name.ptr, var->typ.typ);
+        ok = false;
+        continue;
+      }
+      var->sym->slot = (uint32_t)prog->global_count;
+      c.globals[prog->global_count++] = var->sym;
+      continue;
+    }
+    if (node->type != ezy_ast_node_function || node->data.n_function->body == NULL)
+      continue;
+    struct ezy_ast_function_t *fn = node->data.n_function;
+    if (fn->name.len == 4 && memcmp(fn->name.ptr, "main", 4) == 0)
+      prog->entry = prog->func_count;
+    prog->funcs[prog->func_count].name = fn->name;
+    c.decls[prog->func_count++] = fn;
+  }
+  for (size_t i = 0; i < prog->func_count; i++)
+    ok = ezybc_body(&c, c.decls[i], &prog->funcs[i]) && ok;
+  if (ok && prog->entry == SIZE_MAX)
+  {
+    ezy_log_error("bytecode: no main function");
+    ok = false;
+  }
+  ezywalk_release(&c.walk);
+  free(c.vals);
+  free(c.slots);
+  free(c.locals);
+  free(c.decls);
+  free(c.globals);
+  prog->failed = prog->failed || !ok;
+  return !prog->failed;
+}
+
+void ezyvm_free(struct ezyvm_program *prog)
+{
+  free(prog->code);
+  free(prog->consts);
+  free(prog->strings);
+  free(prog->funcs);
+  *prog = (struct ezyvm_program){0};
+}
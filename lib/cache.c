@@ -0,0 +1,443 @@
+#if !defined(_WIN32)
+#define _POSIX_C_SOURCE 200809L
+#endif
+
+#include <ezy_cache.h>
+#include <ezy_log.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(_WIN32)
+
+bool ezycache_open(struct ezycache *cache, const char *dir, uint64_t max_bytes)
+{
+  (void)dir;
+  (void)max_bytes;
+  *cache = (struct ezycache){0};
+  ezy_log_error("the object cache needs a POSIX system");
+  return false;
+}
+
+void ezycache_close(struct ezycache *cache)
+{
+  free(cache->dir);
+  cache->dir = NULL;
+}
+
+bool ezycache_fetch(struct ezycache *cache, const uint8_t key[ezysha256_size], const char *dest)
+{
+  (void)cache, (void)key, (void)dest;
+  return false;
+}
+
+bool ezycache_store(struct ezycache *cache, const uint8_t key[ezysha256_size], const char *src)
+{
+  (void)cache, (void)key, (void)src;
+  return false;
+}
+
+bool ezycache_stats(struct ezycache *cache, struct ezycache_stats *out)
+{
+  (void)cache;
+  *out = (struct ezycache_stats){0};
+  return false;
+}
+
+void ezycache_hash_file_id(struct ezysha256 *h, const char *path)
+{
+  ezysha256_update(h, path, strlen(path) + 1);
+}
+
+void ezycache_hash_dir_id(struct ezysha256 *h, const char *dir)
+{
+  ezysha256_update(h, dir, strlen(dir) + 1);
+}
+
+#else
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// eviction stops once the store is this far under its bound, so the
+// next few stores do not each pay for a full scan
+#define ezycache_low_water(max) ((max) / 10 * 9)
+
+static char *ezycache_join(const char *a, const char *b)
+{
+  size_t la = strlen(a), lb = strlen(b);
+  char *p = malloc(la + lb + 2);
+  if (p == NULL)
+    return NULL;
+  memcpy(p, a, la);
+  p[la] = '/';
+  memcpy(p + la + 1, b, lb + 1);
+  return p;
+}
+
+// mkdir -p
+static bool ezycache_mkdirs(char *path)
+{
+  for (char *p = path + 1; *p != '\0'; p++)
+  {
+    if (*p != '/')
+      continue;
+    *p = '\0';
+    bool ok = mkdir(path, 0777) == 0 || errno == EEXIST;
+    *p = '/';
+    if (!ok)
+      return false;
+  }
+  return mkdir(path, 0777) == 0 || errno == EEXIST;
+}
+
+bool ezycache_open(struct ezycache *cache, const char *dir, uint64_t max_bytes)
+{
+  *cache = (struct ezycache){.max_bytes = max_bytes > 0 ? max_bytes : ezycache_default_max};
+  const char *env;
+  if (dir != NULL)
+    cache->dir = strdup(dir);
+  else if ((env = getenv("EZY_CACHE_DIR")) != NULL && env[0] != '\0')
+    cache->dir = strdup(env);
+  else if ((env = getenv("XDG_CACHE_HOME")) != NULL && env[0] != '\0')
+    cache->dir = ezycache_join(env, "ezc");
+  else if ((env = getenv("HOME")) != NULL && env[0] != '\0')
+    cache->dir = ezycache_join(env, ".cache/ezc");
+  else
+  {
+    ezy_log_error("no cache directory: set EZY_CACHE_DIR or HOME");
+    return false;
+  }
+  if (cache->dir == NULL || !ezycache_mkdirs(cache->dir))
+  {
+    ezy_log_error("failed to create the cache directory %s: %s", cache->dir != NULL ? cache->dir : "",
+                  strerror(errno));
+    ezycache_close(cache);
+    return false;
+  }
+  return true;
+}
+
+void ezycache_close(struct ezycache *cache)
+{
+  free(cache->dir);
+  cache->dir = NULL;
+}
+
+// <dir>/ab/cdef..., *split is the index of the slash after "ab"
+static char *ezycache_entry(const struct ezycache *cache, const uint8_t key[ezysha256_size], size_t *split)
+{
+  char hex[2 * ezysha256_size + 1];
+  ezysha256_hex(key, hex);
+  char sub[2 * ezysha256_size + 2];
+  memcpy(sub, hex, 2);
+  sub[2] = '/';
+  memcpy(sub + 3, hex + 2, sizeof hex - 2);
+  char *path = ezycache_join(cache->dir, sub);
+  if (path != NULL && split != NULL)
+    *split = strlen(cache->dir) + 3;
+  return path;
+}
+
+// ================ Statistics ================
+// One small text file, read and rewritten under an fcntl lock so
+// concurrent builds do not lose counts.
+
+static void ezycache_parse_stats(const char *text, struct ezycache_stats *s)
+{
+  *s = (struct ezycache_stats){0};
+  unsigned long long v;
+  char name[16];
+  int used;
+  while (sscanf(text, "%15s %llu\n%n", name, &v, &used) == 2)
+  {
+    if (strcmp(name, "hits") == 0)
+      s->hits = v;
+    else if (strcmp(name, "misses") == 0)
+      s->misses = v;
+    else if (strcmp(name, "entries") == 0)
+      s->entries = v;
+    else if (strcmp(name, "bytes") == 0)
+      s->bytes = v;
+    else if (strcmp(name, "evicted") == 0)
+      s->evicted = v;
+    text += used;
+  }
+}
+
+// Add `add` to the counters, or take entries and bytes from `totals`
+// when it is not NULL. The result goes to `out` when not NULL.
+static bool ezycache_count(struct ezycache *cache, const struct ezycache_stats *add,
+                           const struct ezycache_stats *totals, struct ezycache_stats *out)
+{
+  char *path = ezycache_join(cache->dir, "stats");
+  int fd = path != NULL ? open(path, O_RDWR | O_CREAT, 0666) : -1;
+  free(path);
+  if (fd < 0)
+    return false;
+  struct flock lock = {.l_type = F_WRLCK, .l_whence = SEEK_SET};
+  while (fcntl(fd, F_SETLKW, &lock) != 0)
+  {
+    if (errno != EINTR)
+    {
+      close(fd);
+      return false;
+    }
+  }
+  char text[512];
+  ssize_t n = pread(fd, text, sizeof text - 1, 0);
+  text[n > 0 ? n : 0] = '\0';
+  struct ezycache_stats s;
+  ezycache_parse_stats(text, &s);
+  s.hits += add->hits;
+  s.misses += add->misses;
+  s.evicted += add->evicted;
+  s.entries = totals != NULL ? totals->entries : s.entries + add->entries;
+  s.bytes = totals != NULL ? totals->bytes : s.bytes + add->bytes;
+  int len = snprintf(text, sizeof text, "hits %llu\nmisses %llu\nentries %llu\nbytes %llu\nevicted %llu\n",
+                     (unsigned long long)s.hits, (unsigned long long)s.misses, (unsigned long long)s.entries,
+                     (unsigned long long)s.bytes, (unsigned long long)s.evicted);
+  bool ok = pwrite(fd, text, (size_t)len, 0) == len && ftruncate(fd, len) == 0;
+  close(fd); // releases the lock
+  if (out != NULL)
+    *out = s;
+  return ok;
+}
+
+bool ezycache_stats(struct ezycache *cache, struct ezycache_stats *out)
+{
+  return ezycache_count(cache, &(struct ezycache_stats){0}, NULL, out);
+}
+
+// ================ Entries ================
+
+// Copy `src` to `dest` through a temporary file next to it, renamed
+// over `dest` once complete: readers see the old file or the new one.
+static bool ezycache_copy(const char *src, const char *dest, mode_t mode, uint64_t *size)
+{
+  int in = open(src, O_RDONLY);
+  if (in < 0)
+    return false;
+  static const char suffix[] = ".XXXXXX";
+  size_t len = strlen(dest);
+  char *tmp = malloc(len + sizeof suffix);
+  int out = -1;
+  if (tmp != NULL)
+  {
+    memcpy(tmp, dest, len);
+    memcpy(tmp + len, suffix, sizeof suffix);
+    out = mkstemp(tmp);
+  }
+  if (out < 0)
+  {
+    close(in);
+    free(tmp);
+    return false;
+  }
+
+  mode_t mask = umask(0);
+  umask(mask);
+  bool ok = fchmod(out, mode & ~mask) == 0;
+  uint64_t total = 0;
+  char buf[1 << 16];
+  while (ok)
+  {
+    ssize_t n = read(in, buf, sizeof buf);
+    if (n < 0 && errno == EINTR)
+      continue;
+    if (n <= 0)
+    {
+      ok = n == 0;
+      break;
+    }
+    for (ssize_t done = 0; ok && done < n;)
+    {
+      ssize_t w = write(out, buf + done, (size_t)(n - done));
+      if (w < 0 && errno != EINTR)
+        ok = false;
+      done += w > 0 ? w : 0;
+    }
+    total += (uint64_t)n;
+  }
+  close(in);
+  ok = close(out) == 0 && ok;
+  ok = ok && rename(tmp, dest) == 0;
+  if (!ok)
+    unlink(tmp);
+  free(tmp);
+  if (size != NULL)
+    *size = total;
+  return ok;
+}
+
+bool ezycache_fetch(struct ezycache *cache, const uint8_t key[ezysha256_size], const char *dest)
+{
+  char *entry = ezycache_entry(cache, key, NULL);
+  bool hit = entry != NULL && ezycache_copy(entry, dest, 0777, NULL);
+  if (hit)
+    utimensat(AT_FDCWD, entry, NULL, 0); // most recently used
+  free(entry);
+  ezycache_count(cache, &(struct ezycache_stats){.hits = hit, .misses = !hit}, NULL, NULL);
+  return hit;
+}
+
+struct ezycache_file {
+  char *path;
+  uint64_t size;
+  struct timespec used;
+};
+
+static int ezycache_by_use(const void *a, const void *b)
+{
+  const struct timespec *x = &((const struct ezycache_file *)a)->used;
+  const struct timespec *y = &((const struct ezycache_file *)b)->used;
+  if (x->tv_sec != y->tv_sec)
+    return x->tv_sec < y->tv_sec ? -1 : 1;
+  return x->tv_nsec < y->tv_nsec ? -1 : x->tv_nsec > y->tv_nsec;
+}
+
+// Scan every entry, remove the least recently used until the store is
+// under the low water mark, and record the real totals.
+static void ezycache_evict(struct ezycache *cache)
+{
+  struct ezycache_file *files = NULL;
+  size_t count = 0, cap = 0;
+  uint64_t bytes = 0;
+  for (int b = 0; b < 256; b++)
+  {
+    char sub[3];
+    snprintf(sub, sizeof sub, "%02x", b);
+    char *dir_path = ezycache_join(cache->dir, sub);
+    DIR *dir = dir_path != NULL ? opendir(dir_path) : NULL;
+    for (struct dirent *e; dir != NULL && (e = readdir(dir)) != NULL;)
+    {
+      struct stat st;
+      char *path;
+      // temporaries of unfinished copies carry a '.'
+      if (strchr(e->d_name, '.') != NULL || (path = ezycache_join(dir_path, e->d_name)) == NULL)
+        continue;
+      if (stat(path, &st) != 0 || !S_ISREG(st.st_mode))
+      {
+        free(path);
+        continue;
+      }
+      if (count == cap)
+      {
+        cap = cap > 0 ? cap * 2 : 256;
+        struct ezycache_file *p = realloc(files, cap * sizeof *files);
+        if (p == NULL)
+        {
+          free(path);
+          break;
+        }
+        files = p;
+      }
+      files[count++] = (struct ezycache_file){.path = path, .size = (uint64_t)st.st_size, .used = st.st_mtim};
+      bytes += (uint64_t)st.st_size;
+    }
+    if (dir != NULL)
+      closedir(dir);
+    free(dir_path);
+  }
+
+  qsort(files, count, sizeof *files, ezycache_by_use);
+  uint64_t evicted = 0;
+  size_t kept = count;
+  for (size_t i = 0; i < count && bytes > ezycache_low_water(cache->max_bytes); i++)
+  {
+    if (unlink(files[i].path) == 0)
+    {
+      bytes -= files[i].size;
+      evicted++;
+      kept--;
+    }
+  }
+  for (size_t i = 0; i < count; i++)
+    free(files[i].path);
+  free(files);
+  ezycache_count(cache, &(struct ezycache_stats){.evicted = evicted},
+                 &(struct ezycache_stats){.entries = kept, .bytes = bytes}, NULL);
+}
+
+bool ezycache_store(struct ezycache *cache, const uint8_t key[ezysha256_size], const char *src)
+{
+  size_t split;
+  char *entry = ezycache_entry(cache, key, &split);
+  if (entry == NULL)
+    return false;
+  entry[split] = '\0';
+  bool ok = mkdir(entry, 0777) == 0 || errno == EEXIST;
+  entry[split] = '/';
+  struct stat old;
+  bool existed = stat(entry, &old) == 0;
+  uint64_t size = 0;
+  ok = ok && ezycache_copy(src, entry, 0666, &size);
+  free(entry);
+  if (!ok)
+    return false;
+
+  struct ezycache_stats now;
+  struct ezycache_stats add = {
+    .entries = existed ? 0 : 1,
+    .bytes = size - (existed ? (uint64_t)old.st_size : 0),
+  };
+  if (ezycache_count(cache, &add, NULL, &now) && now.bytes > cache->max_bytes)
+    ezycache_evict(cache);
+  return true;
+}
+
+void ezycache_hash_file_id(struct ezysha256 *h, const char *path)
+{
+  ezysha256_update(h, path, strlen(path) + 1);
+  struct stat st;
+  if (stat(path, &st) != 0)
+    return;
+  uint64_t id[4] = {(uint64_t)st.st_size, (uint64_t)st.st_mtim.tv_sec, (uint64_t)st.st_mtim.tv_nsec,
+                    (uint64_t)st.st_ino};
+  ezysha256_update(h, id, sizeof id);
+}
+
+static int ezycache_by_name(const void *a, const void *b)
+{
+  return strcmp(*(char *const *)a, *(char *const *)b);
+}
+
+void ezycache_hash_dir_id(struct ezysha256 *h, const char *dir)
+{
+  DIR *d = opendir(dir);
+  if (d == NULL)
+  {
+    ezysha256_update(h, dir, strlen(dir) + 1);
+    return;
+  }
+  char **names = NULL;
+  size_t count = 0, cap = 0;
+  for (struct dirent *e; (e = readdir(d)) != NULL;)
+  {
+    if (e->d_name[0] == '.')
+      continue;
+    if (count == cap)
+    {
+      cap = cap > 0 ? cap * 2 : 16;
+      char **p = realloc(names, cap * sizeof *names);
+      if (p == NULL)
+        break;
+      names = p;
+    }
+    if ((names[count] = ezycache_join(dir, e->d_name)) != NULL)
+      count++;
+  }
+  closedir(d);
+  qsort(names, count, sizeof *names, ezycache_by_name);
+  for (size_t i = 0; i < count; i++)
+  {
+    ezycache_hash_file_id(h, names[i]);
+    free(names[i]);
+  }
+  free(names);
+}
+
+#endif
@@ -0,0 +1,416 @@
+#if !defined(_WIN32)
+#define _POSIX_C_SOURCE 200809L
+#endif
+
+#include <ezy_cache.h>
+#include <ezy_compile.h>
+#include <ezy_lexer.h>
+#include <ezy_log.h>
+#include <ezy_output.h>
+#include <ezy_parser.h>
+#include <ezy_parser_arena.h>
+#include <ezy_project.h>
+#include <ezy_report.h>
+#include <ezy_sema.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#if defined(_WIN32)
+#define popen _popen
+#define pclose _pclose
+#else
+#include <signal.h>
+#include <spawn.h>
+#include <sys/wait.h>
+#include <unistd.h>
+extern char **environ;
+#endif
+
+static double ezyc_now_ms(void)
+{
+  struct timespec ts;
+  timespec_get(&ts, TIME_UTC);
+  return (double)ts.tv_sec * 1e3 + (double)ts.tv_nsec / 1e6;
+}
+
+static char *ezyc_read_file(const char *filename)
+{
+  FILE *f = fopen(filename, "rb");
+  if (f == NULL)
+  {
+    ezy_log_error("failed to open input file: %s", filename);
+    return NULL;
+  }
+  fseek(f, 0, SEEK_END);
+  long size = ftell(f);
+  rewind(f);
+  char *buffer = size >= 0 ? malloc((size_t)size + 1) : NULL;
+  if (buffer == NULL)
+  {
+    ezy_log_error("failed to allocate memory for file buffer");
+    fclose(f);
+    return NULL;
+  }
+  size_t got = fread(buffer, 1, (size_t)size, f);
+  buffer[got] = '\0';
+  fclose(f);
+  return buffer;
+}
+
+// ================ The C compiler ================
+// cc [flags] -I<runtime> -o <out> -x c - -x none <libezyrt.a> -lm
+// It is started before the front end runs, so its own startup overlaps
+// parsing and code generation, and reads the C from a pipe.
+
+#define ezyc_fixed_args 13
+
+static const char **ezyc_cc_argv(const struct ezycompile_opts *opts)
+{
+  const char **argv = malloc((opts->cc_flag_count + ezyc_fixed_args) * sizeof *argv);
+  if (argv == NULL)
+    return NULL;
+  const char *cc = opts->cc != NULL ? opts->cc : getenv("CC");
+  size_t n = 0;
+  argv[n++] = cc != NULL && cc[0] != '\0' ? cc : "cc";
+  for (size_t i = 0; i < opts->cc_flag_count; i++)
+    argv[n++] = opts->cc_flags[i];
+  argv[n++] = "-I";
+  argv[n++] = opts->runtime_include != NULL ? opts->runtime_include : "runtime/include";
+  argv[n++] = "-o";
+  argv[n++] = opts->output != NULL ? opts->output : "a.out";
+  argv[n++] = "-x";
+  argv[n++] = "c";
+  argv[n++] = "-";
+  argv[n++] = "-x";
+  argv[n++] = "none"; // by extension again, for the archive
+  argv[n++] = opts->runtime_lib != NULL ? opts->runtime_lib : "obj/libezyrt.a";
+  argv[n++] = "-lm";
+  argv[n] = NULL;
+  return argv;
+}
+
+#if defined(_WIN32)
+
+struct ezyc_child {
+  FILE *in;
+};
+
+static bool ezyc_start(const char **argv, struct ezyc_child *child)
+{
+  // one command line for the shell, every argument quoted
+  size_t len = 1;
+  for (size_t i = 0; argv[i] != NULL; i++)
+    len += strlen(argv[i]) + 3;
+  char *cmd = malloc(len);
+  if (cmd == NULL)
+    return false;
+  char *p = cmd;
+  for (size_t i = 0; argv[i] != NULL; i++)
+    p += sprintf(p, "\"%s\" ", argv[i]);
+  child->in = popen(cmd, "wb");
+  free(cmd);
+  return child->in != NULL;
+}
+
+static bool ezyc_feed(struct ezyc_child *child, const ezy_multistr_t *chain)
+{
+  for (; chain != NULL; chain = chain->next)
+  {
+    if (chain->str.len > 0 && fwrite(chain->str.ptr, 1, chain->str.len, child->in) != chain->str.len)
+      return false;
+  }
+  return true;
+}
+
+static int ezyc_finish(struct ezyc_child *child, bool abandon)
+{
+  (void)abandon; // the compiler fails on its truncated input
+  return pclose(child->in);
+}
+
+#else
+
+struct ezyc_child {
+  pid_t pid;
+  int in;
+};
+
+static bool ezyc_start(const char **argv, struct ezyc_child *child)
+{
+  int fds[2];
+  if (pipe(fds) != 0)
+  {
+    ezy_log_error("failed to create a pipe: %s", strerror(errno));
+    return false;
+  }
+  posix_spawn_file_actions_t actions;
+  posix_spawn_file_actions_init(&actions);
+  posix_spawn_file_actions_adddup2(&actions, fds[0], STDIN_FILENO);
+  posix_spawn_file_actions_addclose(&actions, fds[0]);
+  posix_spawn_file_actions_addclose(&actions, fds[1]);
+  int err = posix_spawnp(&child->pid, argv[0], &actions, NULL, (char *const *)argv, environ);
+  posix_spawn_file_actions_destroy(&actions);
+  close(fds[0]);
+  if (err != 0)
+  {
+    ezy_log_error("failed to start %s: %s", argv[0], strerror(err));
+    close(fds[1]);
+    return false;
+  }
+  child->in = fds[1];
+  return true;
+}
+
+static bool ezyc_feed(struct ezyc_child *child, const ezy_multistr_t *chain)
+{
+  // a compiler that dies early must not take us down with SIGPIPE
+  void (*previous)(int) = signal(SIGPIPE, SIG_IGN);
+  bool ok = ezyout_write_fd(child->in, chain);
+  signal(SIGPIPE, previous);
+  return ok;
+}
+
+// Close the compiler's input and wait for it, killing it first when the
+// front end failed and its input is incomplete.
+static int ezyc_finish(struct ezyc_child *child, bool abandon)
+{
+  if (abandon)
+    kill(child->pid, SIGTERM);
+  close(child->in);
+  int status;
+  while (waitpid(child->pid, &status, 0) < 0)
+  {
+    if (errno != EINTR)
+      return -1;
+  }
+  if (WIFEXITED(status))
+    return WEXITSTATUS(status);
+  return abandon ? 1 : 128 + WTERMSIG(status);
+}
+
+#endif
+
+// ================ Cache key ================
+// Everything that decides the executable: the C text, the compiler
+// binary, its command line without the output name, and the runtime.
+
+// bumped when the key's composition changes
+#define ezyc_cache_format "ezc cache 1"
+
+// argv[0] as posix_spawnp finds it
+static char *ezyc_which(const char *name)
+{
+#if defined(_WIN32)
+  return strdup(name);
+#else
+  const char *path = getenv("PATH");
+  if (strchr(name, '/') != NULL || path == NULL)
+    return strdup(name);
+  size_t len = strlen(name);
+  for (const char *dir = path;; dir++)
+  {
+    const char *end = strchr(dir, ':');
+    size_t dlen = end != NULL ? (size_t)(end - dir) : strlen(dir);
+    char *full = malloc(dlen + len + 3);
+    if (full == NULL)
+      return NULL;
+    snprintf(full, dlen + len + 3, "%.*s/%s", (int)dlen, dlen > 0 ? dir : ".", name);
+    if (access(full, X_OK) == 0)
+      return full;
+    free(full);
+    if (end == NULL)
+      return strdup(name);
+    dir = end;
+  }
+#endif
+}
+
+static void ezyc_cache_key(const char **argv, const struct ezycompile_opts *opts, const ezy_multistr_t *code,
+                           uint8_t key[ezysha256_size])
+{
+  struct ezysha256 h;
+  ezysha256_init(&h);
+  ezysha256_update(&h, ezyc_cache_format, sizeof ezyc_cache_format);
+  char *cc = ezyc_which(argv[0]);
+  ezycache_hash_file_id(&h, cc != NULL ? cc : argv[0]);
+  free(cc);
+  for (size_t i = 0; argv[i] != NULL; i++)
+  {
+    if (strcmp(argv[i], "-o") == 0 && argv[i + 1] != NULL)
+    {
+      i++;
+      continue;
+    }
+    ezysha256_update(&h, argv[i], strlen(argv[i]) + 1);
+  }
+  ezycache_hash_dir_id(&h, opts->runtime_include != NULL ? opts->runtime_include : "runtime/include");
+  ezycache_hash_file_id(&h, opts->runtime_lib != NULL ? opts->runtime_lib : "obj/libezyrt.a");
+  for (; code != NULL; code = code->next)
+    ezysha256_update(&h, code->str.ptr, code->str.len);
+  ezysha256_final(&h, key);
+}
+
+// ================ Driver ================
+
+static void ezyc_report(const struct ezycompile_times *t, bool cached)
+{
+  char cache[64] = "";
+  if (cached)
+    snprintf(cache, sizeof cache, ", cache %.2f ms (%s)", t->cache, t->cache_hit ? "hit" : "miss");
+  fprintf(stderr,
+          "ezc: read %.2f ms, parse %.2f ms, sema %.2f ms, transpile %.2f ms, pipe %.2f ms, cc %.2f ms%s, total %.2f ms\n",
+          t->read, t->parse, t->sema, t->transpile, t->pipe, t->cc, cache, t->total);
+}
+
+// the C of one file, or of several modules as a project
+static int ezyc_build(const char *const *paths, size_t count, const struct ezycompile_opts *opts)
+{
+  struct ezycompile_times t = {0};
+  struct ezyreport *report = opts->report;
+  double start = ezyc_now_ms(), mark = start, now;
+#define ezyc_stage(field) (now = ezyc_now_ms(), t.field = now - mark, mark = now)
+
+  bool project = count > 1;
+  char *buffer = project ? NULL : ezyc_read_file(paths[0]);
+  if (!project && buffer == NULL)
+    return 1;
+  ezyc_stage(read);
+  ezyreport_phase(report, "read");
+
+  struct ezycache cache;
+  bool cached = opts->cache && ezycache_open(&cache, opts->cache_dir, opts->cache_max);
+  const char *output = opts->output != NULL ? opts->output : "a.out";
+
+  // without the cache the compiler starts now and overlaps the front
+  // end; with it, only after a miss
+  const char **argv = ezyc_cc_argv(opts);
+  struct ezyc_child child;
+  bool started = argv != NULL && !cached && ezyc_start(argv, &child);
+  if (argv == NULL || (!cached && !started))
+  {
+    if (cached)
+      ezycache_close(&cache);
+    free(argv);
+    free(buffer);
+    return 1;
+  }
+  ezyreport_phase(report, "start cc");
+
+  struct ezyproject proj;
+  ezy_ast_node_t *root;
+  ezy_multistr_t *code = NULL;
+  if (project)
+  {
+    // modules are read, parsed and analysed as they unlock, one stage
+    bool loaded = ezyproject_load(&proj, paths, count, opts->transpile.jobs, report);
+    root = proj.program;
+    ezyc_stage(parse);
+    code = loaded ? ezyproject_transpile_c(&proj, &opts->transpile) : NULL;
+    ezyc_stage(transpile);
+    ezyreport_phase(report, "transpile");
+  }
+  else
+  {
+    if (report != NULL && report->on)
+    {
+      // the parser lexes on demand, lex once more alone to time it
+      ezylex_scan(buffer);
+      ezyreport_phase(report, "lex");
+      mark = ezyc_now_ms();
+    }
+    size_t tokens = ezylex_token_count();
+    root = ezyparse_parse(buffer);
+    bool front_ok = ezyparse_error_count() == 0;
+    ezyc_stage(parse);
+    ezyreport_phase(report, "parse");
+    front_ok &= ezysema_resolve(root); // resolved and typed anyway, for their errors too
+    ezyreport_phase(report, "resolve");
+    front_ok &= ezysema_infer_types(root);
+    ezyc_stage(sema);
+    ezyreport_phase(report, "infer types");
+    if (front_ok)
+      code = ezytranspile_c_opts(root, &opts->transpile);
+    else
+      ezy_log_error("%s has errors, nothing was compiled", paths[0]);
+    ezyc_stage(transpile);
+    ezyreport_phase(report, "transpile");
+    if (report != NULL && report->on)
+    {
+      report->modules++;
+      report->tokens += ezylex_token_count() - tokens;
+      ezyreport_arena(report, NULL);
+    }
+  }
+
+  uint8_t key[ezysha256_size];
+  if (cached && code != NULL)
+  {
+    ezyc_cache_key(argv, opts, code, key);
+    t.cache_hit = ezycache_fetch(&cache, key, output);
+    started = !t.cache_hit && ezyc_start(argv, &child);
+    ezyc_stage(cache);
+    ezyreport_phase(report, "cache");
+  }
+
+  bool fed = t.cache_hit || (started && code != NULL && ezyc_feed(&child, code));
+  if (started && code != NULL && !fed)
+    ezy_log_error("failed to write the C to %s: %s", argv[0], strerror(errno));
+  ezyc_stage(pipe);
+  ezyreport_phase(report, "write");
+  int status = started ? ezyc_finish(&child, code == NULL) : !t.cache_hit;
+  ezyc_stage(cc);
+  ezyreport_phase(report, "cc");
+  if (cached && started && code != NULL && fed && status == 0)
+  {
+    ezycache_store(&cache, key, output);
+    now = ezyc_now_ms(), t.cache += now - mark, mark = now;
+    ezyreport_phase(report, "cache");
+  }
+  t.total = mark - start;
+#undef ezyc_stage
+  if (report != NULL && report->on)
+  {
+    // after the last phase, so counting is not timed
+    report->nodes += ezyreport_count_nodes(root);
+    report->output_bytes += ezyreport_count_bytes(code);
+  }
+
+  if (started && code != NULL && status != 0)
+    ezy_log_error("%s failed with status %d", argv[0], status);
+  if (opts->timings)
+    ezyc_report(&t, cached);
+  if (opts->times != NULL)
+    *opts->times = t;
+
+  if (cached)
+    ezycache_close(&cache);
+  ezytranspile_c_free(code);
+  if (project)
+    ezyproject_free(&proj);
+  else
+    ezyparse_arena_clear();
+  free(argv);
+  free(buffer);
+  return code != NULL && fed && status == 0 ? 0 : 1;
+}
+
+int ezycompile_opts(const char *filename, const struct ezycompile_opts *opts)
+{
+  return ezyc_build(&filename, 1, opts);
+}
+
+int ezycompile_files(const char *const *paths, size_t count, const struct ezycompile_opts *opts)
+{
+  return ezyc_build(paths, count, opts);
+}
+
+int ezycompile(const char* filename)
+{
+  struct ezycompile_opts opts = {
+    .transpile = {.jobs = 1, .small_array_max = ezytranspile_small_array_default},
+  };
+  return ezycompile_opts(filename, &opts);
+}
@@ -0,0 +1,449 @@
+#if defined(__linux__)
+#define _GNU_SOURCE // struct ucred
+#elif !defined(_WIN32) && !defined(__APPLE__) && !defined(__FreeBSD__) && !defined(__OpenBSD__) && !defined(__NetBSD__)
+#define _POSIX_C_SOURCE 200809L
+#endif
+
+#include <ezy_daemon.h>
+#include <ezy_log.h>
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(_WIN32)
+
+bool ezydaemon_default_path(char *buf, size_t size)
+{
+  (void)buf, (void)size;
+  return false;
+}
+
+int ezydaemon_serve(const char *path, ezydaemon_job job)
+{
+  (void)path, (void)job;
+  ezy_log_error("the compile server needs Unix domain sockets");
+  return 1;
+}
+
+bool ezydaemon_forward(const char *path, int argc, const char **argv, int *status)
+{
+  (void)path, (void)argc, (void)argv, (void)status;
+  return false;
+}
+
+#else
+
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+// ================ Protocol ================
+// client: header, with stdin/stdout/stderr attached, then the body:
+//         cwd, argv[0..argc), then per forwarded variable "NAME=value",
+//         or "NAME" when it is unset, all NUL terminated
+// server: the exit status as an int32_t, once the request finished
+
+#define ezyd_magic 0x31637a65u // "ezc1" in memory
+#define ezyd_max_body (1u << 20)
+
+struct ezyd_header {
+  uint32_t magic;
+  uint32_t argc;
+  uint32_t envc;
+  uint32_t bytes; // of the body
+};
+
+// what ezc and the C compiler it starts read from the environment
+static const char *const ezyd_env[] = {"PATH", "CC", "HOME", "XDG_CACHE_HOME", "EZY_CACHE_DIR", "TMPDIR"};
+#define ezyd_env_count (sizeof ezyd_env / sizeof *ezyd_env)
+
+static bool ezyd_write_all(int fd, const void *data, size_t n)
+{
+  const char *p = data;
+  while (n > 0)
+  {
+    ssize_t w = write(fd, p, n);
+    if (w < 0 && errno == EINTR)
+      continue;
+    if (w <= 0)
+      return false;
+    p += w;
+    n -= (size_t)w;
+  }
+  return true;
+}
+
+static bool ezyd_read_all(int fd, void *data, size_t n)
+{
+  char *p = data;
+  while (n > 0)
+  {
+    ssize_t r = read(fd, p, n);
+    if (r < 0 && errno == EINTR)
+      continue;
+    if (r <= 0)
+      return false;
+    p += r;
+    n -= (size_t)r;
+  }
+  return true;
+}
+
+static bool ezyd_address(const char *path, struct sockaddr_un *addr)
+{
+  *addr = (struct sockaddr_un){.sun_family = AF_UNIX};
+  size_t len = strlen(path);
+  if (len >= sizeof addr->sun_path)
+    return false;
+  memcpy(addr->sun_path, path, len + 1);
+  return true;
+}
+
+// keep the server's own descriptors out of the compilers it starts
+static int ezyd_cloexec(int fd)
+{
+  if (fd >= 0)
+    fcntl(fd, F_SETFD, FD_CLOEXEC);
+  return fd;
+}
+
+// the peer runs as this user; whoever can reach the socket file is
+// checked again here, before anything is sent or run
+static bool ezyd_peer_is_me(int fd)
+{
+#if defined(__linux__)
+  struct ucred cred;
+  socklen_t len = sizeof cred;
+  return getsockopt(fd, SOL_SOCKET, SO_PEERCRED, &cred, &len) == 0 && len == sizeof cred && cred.uid == getuid();
+#else
+  uid_t uid;
+  gid_t gid;
+  return getpeereid(fd, &uid, &gid) == 0 && uid == getuid();
+#endif
+}
+
+// /tmp/ezc-<uid>, made if missing; anyone may create it first, so it must
+// turn out to be a real directory of this user that nobody else can enter
+static bool ezyd_private_dir(const char *dir)
+{
+  if (mkdir(dir, 0700) != 0 && errno != EEXIST)
+    return false;
+  struct stat st;
+  if (lstat(dir, &st) != 0 || !S_ISDIR(st.st_mode) || st.st_uid != getuid() || (st.st_mode & 077) != 0)
+  {
+    ezy_log_warn("%s is not a private directory of this user, no default socket", dir);
+    return false;
+  }
+  return true;
+}
+
+bool ezydaemon_default_path(char *buf, size_t size)
+{
+  const char *dir = getenv("XDG_RUNTIME_DIR");
+  if (dir != NULL && dir[0] != '\0')
+  {
+    int n = snprintf(buf, size, "%s/ezc.sock", dir);
+    return n > 0 && (size_t)n < size;
+  }
+  int n = snprintf(buf, size, "/tmp/ezc-%lu", (unsigned long)getuid());
+  if (n <= 0 || (size_t)n >= size || !ezyd_private_dir(buf))
+    return false;
+  size_t len = (size_t)n;
+  n = snprintf(buf + len, size - len, "/ezc.sock");
+  return n > 0 && (size_t)n < size - len;
+}
+
+// ================ Client ================
+
+bool ezydaemon_forward(const char *path, int argc, const char **argv, int *status)
+{
+  struct sockaddr_un addr;
+  if (!ezyd_address(path, &addr))
+    return false;
+  int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (fd < 0)
+    return false;
+  if (connect(fd, (struct sockaddr *)&addr, sizeof addr) != 0)
+  {
+    close(fd);
+    return false;
+  }
+  if (!ezyd_peer_is_me(fd))
+  {
+    ezy_log_warn("the compile server on %s runs as another user, not using it", path);
+    close(fd);
+    return false;
+  }
+
+  // the body, sized first
+  char cwd[4096];
+  if (getcwd(cwd, sizeof cwd) == NULL)
+  {
+    close(fd);
+    return false;
+  }
+  size_t bytes = strlen(cwd) + 1;
+  for (int i = 0; i < argc; i++)
+    bytes += strlen(argv[i]) + 1;
+  for (size_t i = 0; i < ezyd_env_count; i++)
+  {
+    const char *value = getenv(ezyd_env[i]);
+    bytes += strlen(ezyd_env[i]) + 1 + (value != NULL ? strlen(value) + 1 : 0);
+  }
+  char *body = bytes <= ezyd_max_body ? malloc(bytes) : NULL;
+  if (body == NULL)
+  {
+    close(fd);
+    return false;
+  }
+  char *p = body;
+#define ezyd_put(s) (p += strlen(strcpy(p, (s))) + 1)
+  ezyd_put(cwd);
+  for (int i = 0; i < argc; i++)
+    ezyd_put(argv[i]);
+  for (size_t i = 0; i < ezyd_env_count; i++)
+  {
+    const char *value = getenv(ezyd_env[i]);
+    p += strlen(strcpy(p, ezyd_env[i]));
+    if (value != NULL)
+    {
+      *p++ = '=';
+      p += strlen(strcpy(p, value));
+    }
+    p++;
+  }
+#undef ezyd_put
+
+  struct ezyd_header header = {
+    .magic = ezyd_magic, .argc = (uint32_t)argc, .envc = ezyd_env_count, .bytes = (uint32_t)bytes};
+  struct iovec iov = {.iov_base = &header, .iov_len = sizeof header};
+  union {
+    struct cmsghdr align;
+    char buf[CMSG_SPACE(3 * sizeof(int))];
+  } control = {0};
+  struct msghdr msg = {
+    .msg_iov = &iov, .msg_iovlen = 1, .msg_control = control.buf, .msg_controllen = sizeof control.buf};
+  struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+  cmsg->cmsg_level = SOL_SOCKET;
+  cmsg->cmsg_type = SCM_RIGHTS;
+  cmsg->cmsg_len = CMSG_LEN(3 * sizeof(int));
+  memcpy(CMSG_DATA(cmsg), (int[3]){STDIN_FILENO, STDOUT_FILENO, STDERR_FILENO}, 3 * sizeof(int));
+
+  ssize_t sent;
+  while ((sent = sendmsg(fd, &msg, 0)) < 0 && errno == EINTR)
+    ;
+  bool ok = sent == (ssize_t)sizeof header && ezyd_write_all(fd, body, bytes);
+  free(body);
+  if (!ok)
+  {
+    // nothing ran yet
+    close(fd);
+    return false;
+  }
+  int32_t result;
+  if (!ezyd_read_all(fd, &result, sizeof result))
+  {
+    ezy_log_error("the compile server on %s closed the connection", path);
+    result = 1;
+  }
+  close(fd);
+  *status = result;
+  return true;
+}
+
+// ================ Server ================
+
+static volatile sig_atomic_t ezyd_stop = 0;
+
+static void ezyd_on_signal(int sig)
+{
+  (void)sig;
+  ezyd_stop = 1;
+}
+
+// Receive the header and the client's three descriptors, then the body.
+static char *ezyd_receive(int conn, struct ezyd_header *header, int fds[3])
+{
+  struct iovec iov = {.iov_base = header, .iov_len = sizeof *header};
+  union {
+    struct cmsghdr align;
+    char buf[CMSG_SPACE(3 * sizeof(int))];
+  } control;
+  struct msghdr msg = {
+    .msg_iov = &iov, .msg_iovlen = 1, .msg_control = control.buf, .msg_controllen = sizeof control.buf};
+  ssize_t got;
+  while ((got = recvmsg(conn, &msg, 0)) < 0 && errno == EINTR)
+    ;
+  fds[0] = fds[1] = fds[2] = -1;
+  struct cmsghdr *cmsg = got > 0 ? CMSG_FIRSTHDR(&msg) : NULL;
+  if (cmsg != NULL && cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS &&
+      cmsg->cmsg_len == CMSG_LEN(3 * sizeof(int)))
+    memcpy(fds, CMSG_DATA(cmsg), 3 * sizeof(int));
+
+  // the rest of a header split across reads
+  bool ok = got > 0 && ezyd_read_all(conn, (char *)header + got, sizeof *header - (size_t)got);
+  ok = ok && fds[2] >= 0 && header->magic == ezyd_magic && header->bytes > 0 && header->bytes <= ezyd_max_body &&
+       header->argc > 0 && header->argc <= header->bytes && header->envc <= ezyd_env_count;
+  char *body = ok ? malloc(header->bytes) : NULL;
+  if (body == NULL || !ezyd_read_all(conn, body, header->bytes) || body[header->bytes - 1] != '\0')
+  {
+    free(body);
+    for (int i = 0; i < 3; i++)
+    {
+      if (fds[i] >= 0)
+        close(fds[i]);
+    }
+    return NULL;
+  }
+  return body;
+}
+
+// Run one request with the client's cwd, environment and descriptors,
+// then put the server's back.
+static int ezyd_run(ezydaemon_job job, int home, const struct ezyd_header *header, char *body, const int fds[3])
+{
+  const char *end = body + header->bytes;
+  const char *cwd = body;
+  const char **argv = malloc((header->argc + 1) * sizeof *argv);
+  if (argv == NULL)
+    return 1;
+  const char *p = cwd + strlen(cwd) + 1;
+  for (uint32_t i = 0; i < header->argc; i++)
+  {
+    argv[i] = p < end ? p : "";
+    p += p < end ? strlen(p) + 1 : 0;
+  }
+  argv[header->argc] = NULL;
+  for (uint32_t i = 0; i < header->envc && p < end; i++)
+  {
+    char *eq = strchr(p, '=');
+    size_t len = strlen(p);
+    if (eq != NULL)
+    {
+      *eq = '\0';
+      setenv(p, eq + 1, 1);
+    }
+    else
+      unsetenv(p);
+    p += len + 1;
+  }
+
+  fflush(stdout);
+  fflush(stderr);
+  int saved[3];
+  for (int i = 0; i < 3; i++)
+  {
+    saved[i] = ezyd_cloexec(dup(i));
+    dup2(fds[i], i);
+  }
+
+  int status = 1;
+  if (chdir(cwd) != 0)
+    ezy_log_error("failed to enter %s: %s", cwd, strerror(errno));
+  else
+    status = job((int)header->argc, argv);
+
+  fflush(stdout);
+  fflush(stderr);
+  for (int i = 0; i < 3; i++)
+  {
+    dup2(saved[i], i);
+    close(saved[i]);
+  }
+  if (fchdir(home) != 0)
+    ezy_log_warn("failed to return to the server's directory: %s", strerror(errno));
+  free(argv);
+  return status;
+}
+
+int ezydaemon_serve(const char *path, ezydaemon_job job)
+{
+  struct sockaddr_un addr;
+  if (!ezyd_address(path, &addr))
+  {
+    ezy_log_error("socket path too long: %s", path);
+    return 1;
+  }
+  int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (fd < 0)
+  {
+    ezy_log_error("failed to create a socket: %s", strerror(errno));
+    return 1;
+  }
+  // a socket file nobody answers on is left over from a server that died
+  if (connect(fd, (struct sockaddr *)&addr, sizeof addr) == 0)
+  {
+    ezy_log_error("a compile server is already running on %s", path);
+    close(fd);
+    return 1;
+  }
+  close(fd);
+  unlink(path);
+
+  fd = ezyd_cloexec(socket(AF_UNIX, SOCK_STREAM, 0));
+  mode_t mask = umask(077); // only this user may connect
+  bool bound = fd >= 0 && bind(fd, (struct sockaddr *)&addr, sizeof addr) == 0;
+  umask(mask);
+  if (!bound || listen(fd, 64) != 0)
+  {
+    ezy_log_error("failed to listen on %s: %s", path, strerror(errno));
+    if (fd >= 0)
+      close(fd);
+    return 1;
+  }
+  int home = ezyd_cloexec(open(".", O_RDONLY));
+
+  // a client that goes away mid-request must not take the server with it
+  signal(SIGPIPE, SIG_IGN);
+  struct sigaction stop = {.sa_handler = ezyd_on_signal}; // no SA_RESTART: interrupts accept
+  sigemptyset(&stop.sa_mask);
+  sigaction(SIGINT, &stop, NULL);
+  sigaction(SIGTERM, &stop, NULL);
+  ezy_log_raw("ezc: serving on %s\n", path);
+  fflush(stderr);
+
+  unsigned long served = 0;
+  while (!ezyd_stop)
+  {
+    int conn = ezyd_cloexec(accept(fd, NULL, NULL));
+    if (conn < 0)
+    {
+      if (errno != EINTR)
+        ezy_log_warn("accept failed: %s", strerror(errno));
+      continue;
+    }
+    if (!ezyd_peer_is_me(conn))
+    {
+      ezy_log_warn("refused a client of another user");
+      close(conn);
+      continue;
+    }
+    struct ezyd_header header;
+    int fds[3];
+    char *body = ezyd_receive(conn, &header, fds);
+    if (body != NULL)
+    {
+      int32_t status = ezyd_run(job, home, &header, body, fds);
+      for (int i = 0; i < 3; i++)
+        close(fds[i]);
+      ezyd_write_all(conn, &status, sizeof status);
+      free(body);
+      served++;
+    }
+    close(conn);
+  }
+
+  close(fd);
+  if (home >= 0)
+    close(home);
+  unlink(path);
+  ezy_log_raw("ezc: served %lu requests, stopped\n", served);
+  return 0;
+}
+
+#endif
@@ -0,0 +1,315 @@
+#include <ezy_elf.h>
+#include <ezy_emit.h>
+#include <ezy_log.h>
+#include <stdlib.h>
+#include <string.h>
+
+// section header indexes, in file order
+enum ezyelf_shdr {
+  ezyelf_sh_null,
+  ezyelf_sh_text,
+  ezyelf_sh_rodata,
+  ezyelf_sh_rela_text,
+  ezyelf_sh_symtab,
+  ezyelf_sh_strtab,
+  ezyelf_sh_shstrtab,
+  ezyelf_sh_note_stack, // empty .note.GNU-stack: the stack is not executable
+  ezyelf_sh_count,
+};
+
+static const char ezyelf_shstrtab[] = "\0.text\0.rodata\0.rela.text\0.symtab\0.strtab\0.shstrtab\0.note.GNU-stack";
+
+// offset of each section name in ezyelf_shstrtab
+static const uint32_t ezyelf_shname[ezyelf_sh_count] = {0, 1, 7, 15, 26, 34, 42, 52};
+
+#define ezyelf_stb_local 0
+#define ezyelf_stb_global 1
+#define ezyelf_stt_notype 0
+#define ezyelf_stt_func 2
+#define ezyelf_stt_section 3
+#define ezyelf_st_info(bind, type) ((uint8_t)(((bind) << 4) | (type)))
+
+static bool ezyelf_grow(struct ezyelf_obj *obj, void **items, size_t *cap, size_t need, size_t size)
+{
+  if (need <= *cap)
+    return true;
+  size_t n = *cap > 0 ? *cap * 2 : 64;
+  while (n < need)
+    n *= 2;
+  void *p = realloc(*items, n * size);
+  if (p == NULL)
+  {
+    ezy_log_error("ezyelf: out of memory growing to %zu entries", n);
+    obj->failed = true;
+    return false;
+  }
+  *items = p;
+  *cap = n;
+  return true;
+}
+
+void ezyelf_init(struct ezyelf_obj *obj)
+{
+  *obj = (struct ezyelf_obj){0};
+  // null symbol, then the section symbols relocations into them use
+  ezyelf_grow(obj, (void **)&obj->syms, &obj->sym_cap, 3, sizeof *obj->syms);
+  if (obj->failed)
+    return;
+  obj->syms[0] = (struct ezyelf_sym){0};
+  obj->syms[ezyelf_sym_text] = (struct ezyelf_sym){
+      .info = ezyelf_st_info(ezyelf_stb_local, ezyelf_stt_section), .shndx = ezyelf_sh_text};
+  obj->syms[ezyelf_sym_rodata] = (struct ezyelf_sym){
+      .info = ezyelf_st_info(ezyelf_stb_local, ezyelf_stt_section), .shndx = ezyelf_sh_rodata};
+  obj->sym_count = 3;
+}
+
+void ezyelf_free(struct ezyelf_obj *obj)
+{
+  free(obj->text.data);
+  free(obj->rodata.data);
+  free(obj->syms);
+  free(obj->map);
+  free(obj->relas);
+  *obj = (struct ezyelf_obj){0};
+}
+
+size_t ezyelf_append(struct ezyelf_obj *obj, struct ezyelf_buf *buf, const void *src, size_t n)
+{
+  size_t at = buf->len;
+  if (!ezyelf_grow(obj, (void **)&buf->data, &buf->cap, buf->len + n, 1))
+    return at;
+  if (src != NULL)
+    memcpy(buf->data + at, src, n);
+  else
+    memset(buf->data + at, 0, n);
+  buf->len += n;
+  return at;
+}
+
+size_t ezyelf_rodata(struct ezyelf_obj *obj, const void *src, size_t n, size_t align)
+{
+  size_t pad = (align - obj->rodata.len % align) % align;
+  ezyelf_append(obj, &obj->rodata, NULL, pad);
+  return ezyelf_append(obj, &obj->rodata, src, n);
+}
+
+// ================ Symbols ================
+
+static uint32_t ezyelf_hash(ezy_cstr_t name)
+{
+  uint32_t h = 2166136261u; // FNV-1a
+  for (size_t i = 0; i < name.len; i++)
+    h = (h ^ (uint8_t)name.ptr[i]) * 16777619u;
+  return h;
+}
+
+static uint32_t *ezyelf_slot(uint32_t *map, size_t cap, const struct ezyelf_sym *syms, ezy_cstr_t name)
+{
+  size_t mask = cap - 1;
+  for (size_t i = ezyelf_hash(name) & mask;; i = (i + 1) & mask)
+  {
+    const struct ezyelf_sym *sym = &syms[map[i]];
+    if (map[i] == 0 || (sym->name.len == name.len && memcmp(sym->name.ptr, name.ptr, name.len) == 0))
+      return &map[i];
+  }
+}
+
+static bool ezyelf_rehash(struct ezyelf_obj *obj)
+{
+  size_t cap = obj->map_cap > 0 ? obj->map_cap * 2 : 64;
+  uint32_t *map = calloc(cap, sizeof *map);
+  if (map == NULL)
+  {
+    ezy_log_error("ezyelf: out of memory growing the symbol map");
+    obj->failed = true;
+    return false;
+  }
+  for (size_t i = 0; i < obj->map_cap; i++)
+  {
+    if (obj->map[i] != 0)
+      *ezyelf_slot(map, cap, obj->syms, obj->syms[obj->map[i]].name) = obj->map[i];
+  }
+  free(obj->map);
+  obj->map = map;
+  obj->map_cap = cap;
+  return true;
+}
+
+uint32_t ezyelf_symbol(struct ezyelf_obj *obj, ezy_cstr_t name)
+{
+  if ((obj->sym_count + 1) * 2 > obj->map_cap && !ezyelf_rehash(obj))
+    return 0;
+  uint32_t *slot = ezyelf_slot(obj->map, obj->map_cap, obj->syms, name);
+  if (*slot != 0)
+    return *slot;
+  if (!ezyelf_grow(obj, (void **)&obj->syms, &obj->sym_cap, obj->sym_count + 1, sizeof *obj->syms))
+    return 0;
+  obj->syms[obj->sym_count] = (struct ezyelf_sym){
+      .name = name, .info = ezyelf_st_info(ezyelf_stb_global, ezyelf_stt_notype)};
+  *slot = (uint32_t)obj->sym_count;
+  return (uint32_t)obj->sym_count++;
+}
+
+void ezyelf_define(struct ezyelf_obj *obj, uint32_t sym, size_t offset, size_t size)
+{
+  if (sym == 0)
+    return;
+  struct ezyelf_sym *s = &obj->syms[sym];
+  s->info = ezyelf_st_info(ezyelf_stb_global, ezyelf_stt_func);
+  s->shndx = ezyelf_sh_text;
+  s->value = offset;
+  s->size = size;
+}
+
+void ezyelf_reloc(struct ezyelf_obj *obj, size_t offset, uint32_t sym, uint32_t type, int64_t addend)
+{
+  if (!ezyelf_grow(obj, (void **)&obj->relas, &obj->rela_cap, obj->rela_count + 1, sizeof *obj->relas))
+    return;
+  obj->relas[obj->rela_count++] = (struct ezyelf_rela){.offset = offset, .sym = sym, .type = type, .addend = addend};
+}
+
+// ================ File layout ================
+// header | .text | .rodata | .rela.text | .symtab | .strtab | .shstrtab | section headers
+
+static void ezyelf_le(ezy_emit_t *out, uint64_t v, size_t n)
+{
+  char b[8];
+  for (size_t i = 0; i < n; i++)
+    b[i] = (char)(v >> (8 * i));
+  ezyemit_bytes(out, b, n);
+}
+
+static void ezyelf_pad(ezy_emit_t *out, size_t *at, size_t align)
+{
+  static const char zeros[16] = {0};
+  size_t pad = (align - *at % align) % align;
+  ezyemit_bytes(out, zeros, pad);
+  *at += pad;
+}
+
+struct ezyelf_shdr_t {
+  uint32_t type;
+  uint64_t flags;
+  uint64_t offset;
+  uint64_t size;
+  uint32_t link;
+  uint32_t info;
+  uint64_t align;
+  uint64_t entsize;
+};
+
+ezy_multistr_t *ezyelf_finish(struct ezyelf_obj *obj)
+{
+  if (obj->failed)
+    return NULL;
+
+  size_t strtab_len = 1;
+  for (size_t i = 0; i < obj->sym_count; i++)
+  {
+    obj->syms[i].name_off = obj->syms[i].name.len > 0 ? (uint32_t)strtab_len : 0;
+    strtab_len += obj->syms[i].name.len > 0 ? obj->syms[i].name.len + 1 : 0;
+  }
+
+  struct ezyelf_shdr_t sh[ezyelf_sh_count] = {
+      [ezyelf_sh_text] = {.type = 1, .flags = 0x6, .size = obj->text.len, .align = 16},   // PROGBITS, ALLOC|EXECINSTR
+      [ezyelf_sh_rodata] = {.type = 1, .flags = 0x2, .size = obj->rodata.len, .align = 16}, // PROGBITS, ALLOC
+      [ezyelf_sh_rela_text] = {.type = 4, .flags = 0x40, .size = obj->rela_count * 24, .link = ezyelf_sh_symtab,
+                               .info = ezyelf_sh_text, .align = 8, .entsize = 24}, // RELA, INFO_LINK
+      // locals (the null and section symbols) come first, info is the first global
+      [ezyelf_sh_symtab] = {.type = 2, .size = obj->sym_count * 24, .link = ezyelf_sh_strtab, .info = 3, .align = 8,
+                            .entsize = 24},
+      [ezyelf_sh_strtab] = {.type = 3, .size = strtab_len, .align = 1},
+      [ezyelf_sh_shstrtab] = {.type = 3, .size = sizeof ezyelf_shstrtab, .align = 1},
+      [ezyelf_sh_note_stack] = {.type = 1, .align = 1},
+  };
+  size_t at = 64;
+  for (int i = 1; i < ezyelf_sh_count; i++)
+  {
+    at = (at + sh[i].align - 1) / sh[i].align * sh[i].align;
+    sh[i].offset = at;
+    at += sh[i].size;
+  }
+  size_t shoff = (at + 7) / 8 * 8;
+
+  ezy_emit_t out;
+  ezyemit_init(&out);
+  static const char ident[16] = {0x7f, 'E', 'L', 'F', 2 /* 64 bit */, 1 /* little endian */, 1 /* version */};
+  ezyemit_bytes(&out, ident, sizeof ident);
+  ezyelf_le(&out, 1, 2);  // ET_REL
+  ezyelf_le(&out, 62, 2); // EM_X86_64
+  ezyelf_le(&out, 1, 4);  // EV_CURRENT
+  ezyelf_le(&out, 0, 8);  // entry
+  ezyelf_le(&out, 0, 8);  // program headers
+  ezyelf_le(&out, shoff, 8);
+  ezyelf_le(&out, 0, 4);  // flags
+  ezyelf_le(&out, 64, 2); // header size
+  ezyelf_le(&out, 0, 2);  // program header size and count
+  ezyelf_le(&out, 0, 2);
+  ezyelf_le(&out, 64, 2); // section header size
+  ezyelf_le(&out, ezyelf_sh_count, 2);
+  ezyelf_le(&out, ezyelf_sh_shstrtab, 2);
+
+  at = 64;
+  ezyelf_pad(&out, &at, sh[ezyelf_sh_text].align);
+  ezyemit_bytes(&out, (const char *)obj->text.data, obj->text.len);
+  at += obj->text.len;
+  ezyelf_pad(&out, &at, sh[ezyelf_sh_rodata].align);
+  ezyemit_bytes(&out, (const char *)obj->rodata.data, obj->rodata.len);
+  at += obj->rodata.len;
+
+  ezyelf_pad(&out, &at, 8);
+  for (size_t i = 0; i < obj->rela_count; i++)
+  {
+    const struct ezyelf_rela *r = &obj->relas[i];
+    ezyelf_le(&out, r->offset, 8);
+    ezyelf_le(&out, ((uint64_t)r->sym << 32) | r->type, 8);
+    ezyelf_le(&out, (uint64_t)r->addend, 8);
+  }
+  at += sh[ezyelf_sh_rela_text].size;
+
+  for (size_t i = 0; i < obj->sym_count; i++)
+  {
+    const struct ezyelf_sym *s = &obj->syms[i];
+    ezyelf_le(&out, s->name_off, 4);
+    ezyelf_le(&out, s->info, 1);
+    ezyelf_le(&out, 0, 1); // default visibility
+    ezyelf_le(&out, s->shndx, 2);
+    ezyelf_le(&out, s->value, 8);
+    ezyelf_le(&out, s->size, 8);
+  }
+  at += sh[ezyelf_sh_symtab].size;
+
+  ezyemit_char(&out, '\0');
+  for (size_t i = 0; i < obj->sym_count; i++)
+  {
+    if (obj->syms[i].name.len == 0)
+      continue;
+    ezyemit_ident(&out, obj->syms[i].name);
+    ezyemit_char(&out, '\0');
+  }
+  at += strtab_len;
+  ezyemit_bytes(&out, ezyelf_shstrtab, sizeof ezyelf_shstrtab);
+  at += sizeof ezyelf_shstrtab;
+
+  ezyelf_pad(&out, &at, 8);
+  for (int i = 0; i < ezyelf_sh_count; i++)
+  {
+    ezyelf_le(&out, ezyelf_shname[i], 4);
+    ezyelf_le(&out, sh[i].type, 4);
+    ezyelf_le(&out, sh[i].flags, 8);
+    ezyelf_le(&out, 0, 8); // address
+    ezyelf_le(&out, sh[i].offset, 8);
+    ezyelf_le(&out, sh[i].size, 8);
+    ezyelf_le(&out, sh[i].link, 4);
+    ezyelf_le(&out, sh[i].info, 4);
+    ezyelf_le(&out, sh[i].align, 8);
+    ezyelf_le(&out, sh[i].entsize, 8);
+  }
+
+  if (out.failed)
+  {
+    ezyemit_free(out.head);
+    return NULL;
+  }
+  return out.head;
+}
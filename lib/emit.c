@@ -0,0 +1,174 @@
+#include <ezy_emit.h>
+#include <ezy_log.h>
+#include <ezyrt.h>
+#include <math.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+void ezyemit_init(ezy_emit_t *e)
+{
+  e->head = NULL;
+  e->tail = NULL;
+  e->cap = 0;
+  e->next_cap = ezyemit_initial_chunk;
+  e->failed = false;
+}
+
+void ezyemit_free(ezy_multistr_t *chain)
+{
+  while (chain != NULL)
+  {
+    ezy_multistr_t *next = chain->next;
+    free(chain); // bytes live in the same allocation
+    chain = next;
+  }
+}
+
+char *ezyemit_reserve_slow(ezy_emit_t *e, size_t n)
+{
+  if (e->failed)
+    return NULL;
+
+  size_t cap = e->next_cap;
+  if (cap < n)
+    cap = n;
+
+  ezy_multistr_t *chunk = malloc(sizeof(ezy_multistr_t) + cap);
+  if (chunk == NULL)
+  {
+    ezy_log_error("ezyemit: out of memory allocating %zu byte chunk", cap);
+    e->failed = true;
+    return NULL;
+  }
+  chunk->str.ptr = (const char *)(chunk + 1);
+  chunk->str.len = 0;
+  chunk->next = NULL;
+
+  if (e->tail != NULL)
+    e->tail->next = chunk;
+  else
+    e->head = chunk;
+  e->tail = chunk;
+  e->cap = cap;
+
+  if (e->next_cap < ezyemit_max_chunk)
+    e->next_cap *= 2;
+  return (char *)chunk->str.ptr;
+}
+
+// ================ Numbers ================
+
+static const char ezyemit_digits2[201] =
+    "00010203040506070809"
+    "10111213141516171819"
+    "20212223242526272829"
+    "30313233343536373839"
+    "40414243444546474849"
+    "50515253545556575859"
+    "60616263646566676869"
+    "70717273747576777879"
+    "80818283848586878889"
+    "90919293949596979899";
+
+// digits are produced back to front, two at a time
+static size_t ezyemit_utoa(char *end, uint64_t v)
+{
+  char *p = end;
+  while (v >= 100)
+  {
+    unsigned i = (unsigned)(v % 100) * 2;
+    v /= 100;
+    *--p = ezyemit_digits2[i + 1];
+    *--p = ezyemit_digits2[i];
+  }
+  if (v >= 10)
+  {
+    unsigned i = (unsigned)v * 2;
+    *--p = ezyemit_digits2[i + 1];
+    *--p = ezyemit_digits2[i];
+  }
+  else
+  {
+    *--p = (char)('0' + v);
+  }
+  return (size_t)(end - p);
+}
+
+void ezyemit_uint(ezy_emit_t *e, uint64_t v)
+{
+  char tmp[20];
+  size_t n = ezyemit_utoa(tmp + sizeof(tmp), v);
+  ezyemit_bytes(e, tmp + sizeof(tmp) - n, n);
+}
+
+void ezyemit_int(ezy_emit_t *e, int64_t v)
+{
+  char tmp[21];
+  // negate in unsigned space so INT64_MIN works
+  uint64_t mag = v < 0 ? 0 - (uint64_t)v : (uint64_t)v;
+  size_t n = ezyemit_utoa(tmp + sizeof(tmp), mag);
+  if (v < 0)
+    tmp[sizeof(tmp) - ++n] = '-';
+  ezyemit_bytes(e, tmp + sizeof(tmp) - n, n);
+}
+
+void ezyemit_float(ezy_emit_t *e, double v)
+{
+  if (isnan(v))
+  {
+    ezyemit_str(e, "(0.0 / 0.0)");
+    return;
+  }
+  if (isinf(v))
+  {
+    ezyemit_str(e, v < 0 ? "(-1.0 / 0.0)" : "(1.0 / 0.0)");
+    return;
+  }
+
+  // shortest digits that read back as v, same as the runtime prints
+  char tmp[ezyrt_fmt_f64_max + 2];
+  size_t n = ezyrt_fmt_f64(tmp, v);
+
+  // keep it a floating literal; tmp is not NUL terminated
+  if (memchr(tmp, '.', n) == NULL && memchr(tmp, 'e', n) == NULL)
+  {
+    tmp[n++] = '.';
+    tmp[n++] = '0';
+  }
+  ezyemit_bytes(e, tmp, n);
+}
+
+void ezyemit_fmt(ezy_emit_t *e, const char *fmt, ...)
+{
+  va_list ap;
+  va_start(ap, fmt);
+  va_list ap2;
+  va_copy(ap2, ap);
+
+  // try to format in place, retry once with the exact size
+  size_t avail = e->tail != NULL ? e->cap - e->tail->str.len : 0;
+  char *dst = avail > 0 ? (char *)e->tail->str.ptr + e->tail->str.len : NULL;
+  int n = vsnprintf(dst, avail, fmt, ap);
+  va_end(ap);
+
+  if (n < 0)
+  {
+    ezy_log_warn("ezyemit: formatting error");
+  }
+  else if ((size_t)n < avail)
+  {
+    ezyemit_commit(e, (size_t)n);
+  }
+  else
+  {
+    // vsnprintf needs room for the terminator
+    dst = ezyemit_reserve(e, (size_t)n + 1);
+    if (dst != NULL)
+    {
+      vsnprintf(dst, (size_t)n + 1, fmt, ap2);
+      ezyemit_commit(e, (size_t)n);
+    }
+  }
+  va_end(ap2);
+}
@@ -10,16 +10,19 @@
 #define ezylex_blank_tok(t) ((ezy_tkn_t){.type = t, .data = ezylex_null_data})
 #define ezylex_tknbuf_limit 16
 
-static ezy_tkn_t ezylex_tknbuf[ezylex_tknbuf_limit];
-static ezy_tkn_t ezylex_last_tok;
-static const char *ezylex_tknbuf_headptr = NULL;
-static size_t ezylex_tknbuf_head = 0;
-static size_t ezylex_tknbuf_tail = 0;
-static size_t ezylex_tknbuf_count = 0;
+// Lexer state is per thread, so modules can be lexed in parallel
+static _Thread_local ezy_tkn_t ezylex_tknbuf[ezylex_tknbuf_limit];
+static _Thread_local ezy_tkn_t ezylex_last_tok;
+static _Thread_local const char *ezylex_tknbuf_headptr = NULL;
+static _Thread_local size_t ezylex_tknbuf_head = 0;
+static _Thread_local size_t ezylex_tknbuf_tail = 0;
+static _Thread_local size_t ezylex_tknbuf_count = 0;
+
+static _Thread_local size_t ezylex_produced = 0; // tokens lexed for the parser, eof aside
 
 /* Line/column state */
-static uint32_t ezylex_line = 1;
-static uint32_t ezylex_col = 1;
+static _Thread_local uint32_t ezylex_line = 1;
+static _Thread_local uint32_t ezylex_col = 1;
 
 /* Advance line/col state from start..end (end not included) */
 static void ezylex_advance_pos(const char *start, const char *end)
@@ -257,7 +260,7 @@ ezy_tkn_t ezylex_number(const char **ptr)
   return tkn;
 }
 
-#define ezylex_is_kw(str, len, kw) (strncmp((str), (kw), (len)) == 0)
+#define ezylex_is_kw(str, len, kw) ((len) == strlen(kw) && strncmp((str), (kw), (len)) == 0)
 
 ezy_tkn_t ezylex_identifier_or_kw(const char **ptr)
 {
@@ -541,6 +544,7 @@ ezy_tkn_t ezylex_operator(const char **ptr)
       {"~", ezy_op_bw_not},
       {"?", ezy_op_qn},
       {".", ezy_op_dot},
+      {"@", ezy_op_at},
   };
 
   // match operators serially with the help of the table
@@ -585,7 +589,7 @@ ezy_tkn_t ezylex_next_tkn()
   ezy_tkn_t tkn = ezylex_blank_tok(ezy_tkn_invalid);
 
   char c = *p;
-  char c1 = *(p + 1);
+  char c1 = c != 0 ? *(p + 1) : 0; // never read past the terminator
 
   if (c == 0)
     return ezylex_blank_tok(ezy_tkn_eof);
@@ -663,7 +667,9 @@ ezy_tkn_t ezylex_peek_tkn(size_t pos)
 {
   while (pos >= ezylex_tknbuf_count)
   {
-    ezylex_push_tkn(ezylex_next_tkn());
+    ezy_tkn_t tkn = ezylex_next_tkn();
+    ezylex_produced += tkn.type != ezy_tkn_eof;
+    ezylex_push_tkn(tkn);
   }
   size_t index = (ezylex_tknbuf_tail + pos) % ezylex_tknbuf_limit;
   return ezylex_tknbuf[index];
@@ -689,4 +695,24 @@ void ezylex_consume_all_tkn()
   ezylex_tknbuf_head = 0;
   ezylex_tknbuf_tail = 0;
   ezylex_tknbuf_count = 0;
-}
\ No newline at end of file
+}
+
+size_t ezylex_token_count()
+{
+  return ezylex_produced;
+}
+
+// lex all of src without a parser, for timing
+void ezylex_scan(const char *src)
+{
+  ezy_tkn_t last = ezylex_last_tok; // leave the parse that follows unaffected
+  ezylex_start(src);
+  while (true)
+  {
+    ezy_tkn_t tkn = ezylex_next_tkn();
+    if (tkn.type == ezy_tkn_eof || tkn.type == ezy_tkn_invalid)
+      break;
+  }
+  ezylex_consume_all_tkn();
+  ezylex_last_tok = last;
+}
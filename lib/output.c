@@ -0,0 +1,241 @@
+#if !defined(_WIN32)
+#define _POSIX_C_SOURCE 200809L
+#endif
+
+#include <ezy_output.h>
+#include <ezy_log.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(_WIN32)
+
+#include <windows.h>
+
+// ================ stdio fallback ================
+
+static bool ezyout_write_stream(FILE *f, const ezy_multistr_t *chain)
+{
+  for (; chain != NULL; chain = chain->next)
+  {
+    if (chain->str.len > 0 && fwrite(chain->str.ptr, 1, chain->str.len, f) != chain->str.len)
+      return false;
+  }
+  return fflush(f) == 0;
+}
+
+bool ezyout_write_file(const char *path, const ezy_multistr_t *chain, unsigned flags)
+{
+  if (strcmp(path, "-") == 0)
+  {
+    if (!ezyout_write_stream(stdout, chain))
+    {
+      ezy_log_error("failed to write output to stdout");
+      return false;
+    }
+    return true;
+  }
+
+  bool atomic = (flags & ezyout_flag_atomic) != 0;
+  char *tmp_path = NULL;
+  const char *target = path;
+  if (atomic)
+  {
+    size_t len = strlen(path);
+    tmp_path = malloc(len + sizeof(".tmp"));
+    if (tmp_path == NULL)
+    {
+      ezy_log_error("failed to allocate temporary output path");
+      return false;
+    }
+    memcpy(tmp_path, path, len);
+    memcpy(tmp_path + len, ".tmp", sizeof(".tmp"));
+    target = tmp_path;
+  }
+
+  FILE *f = fopen(target, "wb");
+  if (f == NULL)
+  {
+    ezy_log_error("failed to open output file: %s", target);
+    free(tmp_path);
+    return false;
+  }
+  bool ok = ezyout_write_stream(f, chain);
+  ok = fclose(f) == 0 && ok;
+  if (!ok)
+  {
+    ezy_log_error("failed to write output file: %s", target);
+  }
+  else if (atomic && !MoveFileExA(tmp_path, path, MOVEFILE_REPLACE_EXISTING))
+  {
+    ezy_log_error("failed to move %s over %s", tmp_path, path);
+    ok = false;
+  }
+  if (atomic && !ok)
+  {
+    remove(tmp_path);
+  }
+  free(tmp_path);
+  return ok;
+}
+
+#else
+
+#include <fcntl.h>
+#include <limits.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#if !defined(IOV_MAX)
+#define IOV_MAX 1024
+#endif
+
+// ================ writev ================
+
+// Write the whole chain to `fd`, IOV_MAX chunks per writev call. Short
+// writes resume mid-chunk.
+bool ezyout_write_fd(int fd, const ezy_multistr_t *chain)
+{
+  struct iovec iov[IOV_MAX < 1024 ? IOV_MAX : 1024];
+  const size_t iov_cap = sizeof(iov) / sizeof(iov[0]);
+  size_t skip = 0; // bytes of the first chunk already written
+
+  while (chain != NULL)
+  {
+    size_t count = 0;
+    size_t total = 0;
+    const ezy_multistr_t *c = chain;
+    for (; c != NULL && count < iov_cap; c = c->next)
+    {
+      size_t off = c == chain ? skip : 0;
+      if (c->str.len == off)
+        continue;
+      iov[count].iov_base = (void *)(c->str.ptr + off);
+      iov[count].iov_len = c->str.len - off;
+      total += iov[count].iov_len;
+      count++;
+    }
+    if (count == 0)
+      return true;
+
+    ssize_t n = writev(fd, iov, (int)count);
+    if (n < 0)
+    {
+      if (errno == EINTR)
+        continue;
+      return false;
+    }
+
+    if ((size_t)n == total)
+    {
+      chain = c;
+      skip = 0;
+      continue;
+    }
+
+    // advance past what was written
+    size_t left = (size_t)n;
+    while (chain != NULL)
+    {
+      size_t avail = chain->str.len - skip;
+      if (left < avail)
+      {
+        skip += left;
+        break;
+      }
+      left -= avail;
+      chain = chain->next;
+      skip = 0;
+    }
+  }
+  return true;
+}
+
+static bool ezyout_write_atomic(const char *path, const ezy_multistr_t *chain)
+{
+  size_t len = strlen(path);
+  static const char suffix[] = ".XXXXXX";
+  char *tmp_path = malloc(len + sizeof(suffix));
+  if (tmp_path == NULL)
+  {
+    ezy_log_error("failed to allocate temporary output path");
+    return false;
+  }
+  memcpy(tmp_path, path, len);
+  memcpy(tmp_path + len, suffix, sizeof(suffix));
+
+  // same directory as the target, so rename stays on one filesystem
+  int fd = mkstemp(tmp_path);
+  if (fd < 0)
+  {
+    ezy_log_error("failed to create temporary file %s: %s", tmp_path, strerror(errno));
+    free(tmp_path);
+    return false;
+  }
+
+  // mkstemp creates 0600, give the result the usual permissions
+  mode_t mask = umask(0);
+  umask(mask);
+  bool ok = fchmod(fd, 0666 & ~mask) == 0;
+
+  ok = ok && ezyout_write_fd(fd, chain);
+  if (!ok)
+  {
+    ezy_log_error("failed to write %s: %s", tmp_path, strerror(errno));
+  }
+  if (close(fd) != 0 && ok)
+  {
+    ezy_log_error("failed to close %s: %s", tmp_path, strerror(errno));
+    ok = false;
+  }
+  if (ok && rename(tmp_path, path) != 0)
+  {
+    ezy_log_error("failed to rename %s to %s: %s", tmp_path, path, strerror(errno));
+    ok = false;
+  }
+  if (!ok)
+  {
+    unlink(tmp_path);
+  }
+  free(tmp_path);
+  return ok;
+}
+
+bool ezyout_write_file(const char *path, const ezy_multistr_t *chain, unsigned flags)
+{
+  if (strcmp(path, "-") == 0)
+  {
+    fflush(stdout); // keep ordering with anything already printed
+    if (!ezyout_write_fd(STDOUT_FILENO, chain))
+    {
+      ezy_log_error("failed to write output to stdout: %s", strerror(errno));
+      return false;
+    }
+    return true;
+  }
+
+  if (flags & ezyout_flag_atomic)
+    return ezyout_write_atomic(path, chain);
+
+  int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+  if (fd < 0)
+  {
+    ezy_log_error("failed to open output file %s: %s", path, strerror(errno));
+    return false;
+  }
+  bool ok = ezyout_write_fd(fd, chain);
+  if (!ok)
+  {
+    ezy_log_error("failed to write output file %s: %s", path, strerror(errno));
+  }
+  if (close(fd) != 0 && ok)
+  {
+    ezy_log_error("failed to close output file %s: %s", path, strerror(errno));
+    ok = false;
+  }
+  return ok;
+}
+
+#endif
@@ -17,12 +17,31 @@ static inline bool ezyparse_match(ezy_tkn_t tkn, enum ezy_tkn_typ type);
 
 // Declarations of parsing functions
 static struct ezyparse_error ezyparse_parse_datatype(struct ezy_ast_datatype_t *dest);
+static struct ezyparse_error ezyparse_parse_array_suffix(struct ezy_ast_datatype_t *dest);
 static struct ezyparse_error ezyparse_parse_parameter_list(struct ezy_ast_args_t **dest_params, size_t *dest_count);
 static struct ezyparse_error ezyparse_parse_expression(ezy_ast_node_t **dest);
 static struct ezyparse_error ezyparse_parse_decl(ezy_ast_node_t **dest);
 static struct ezyparse_error ezyparse_parse_statement(struct ezy_ast_function_t *func_node, ezy_ast_node_t **dest);
 static struct ezyparse_error ezyparse_parse_function(ezy_ast_node_t **dest);
 static ezy_ast_node_t* ezyparse_parse_pratt_expr(int min_prec);
+static struct ezyparse_error ezyparse_parse_struct_lit(struct ezy_ast_struct_lit_t *dest);
+
+// unions and structs declared so far, newest first; each is usable as a
+// type after its declaration. Per thread, like the lexer state.
+static _Thread_local struct ezy_ast_union_t *ezyparse_unions = NULL;
+static _Thread_local struct ezy_ast_struct_t *ezyparse_structs = NULL;
+
+// Errors reported by the last ezyparse_parse on this thread; the parse
+// goes on past one so that the rest get reported too.
+static _Thread_local size_t ezyparse_errors = 0;
+#define ezyparse_error(...) (ezyparse_errors++, ezy_log_error(__VA_ARGS__))
+
+// Expressions are parsed recursively, two calls deep per parenthesis or
+// call argument: past the limit the parse stops instead of the stack
+// overflowing. Chains of binary operators (1 + 1 + ...) stay flat.
+#define ezyparse_max_depth 4096
+static _Thread_local int ezyparse_depth = 0;
+static _Thread_local bool ezyparse_too_deep = false;
 
 // helper macros for token handling
 #define tok(n) ezylex_peek_tkn(n)
@@ -43,6 +62,38 @@ static inline bool ezyparse_match(ezy_tkn_t tkn, enum ezy_tkn_typ type)
   return tkn.type == type;
 }
 
+static struct ezy_ast_union_t *ezyparse_find_union(ezy_cstr_t name)
+{
+  for (struct ezy_ast_union_t *u = ezyparse_unions; u != NULL; u = u->prev)
+  {
+    if (u->name.len == name.len && memcmp(u->name.ptr, name.ptr, name.len) == 0)
+      return u;
+  }
+  return NULL;
+}
+
+// `@name` at the start of a declaration, consumed if it is there
+static bool ezyparse_attribute(const char *name)
+{
+  ezy_tkn_t at = tok(0), ident = tok(1);
+  size_t len = strlen(name);
+  if (!ezyparse_match(at, ezy_tkn_operator) || at.data.t_operator != ezy_op_at || !ezyparse_match(ident, ezy_tkn_identifier) ||
+      ident.data.t_identifier.len != len || memcmp(ident.data.t_identifier.ptr, name, len) != 0)
+    return false;
+  consume(2); // consume '@' and the name
+  return true;
+}
+
+static struct ezy_ast_struct_t *ezyparse_find_struct(ezy_cstr_t name)
+{
+  for (struct ezy_ast_struct_t *s = ezyparse_structs; s != NULL; s = s->prev)
+  {
+    if (s->name.len == name.len && memcmp(s->name.ptr, name.ptr, name.len) == 0)
+      return s;
+  }
+  return NULL;
+}
+
 // ========== Parsing functions ===========
 
 static struct ezyparse_error ezyparse_parse_datatype(struct ezy_ast_datatype_t *dest)
@@ -81,6 +132,7 @@ static struct ezyparse_error ezyparse_parse_datatype(struct ezy_ast_datatype_t *
       {"bool", ezy_ast_dt_bool},
       {"char", ezy_ast_dt_char},
       {"void", ezy_ast_dt_void},
+      {"var", ezy_ast_dt_var},
   };
 
   bool matched = false;
@@ -97,6 +149,22 @@ static struct ezyparse_error ezyparse_parse_datatype(struct ezy_ast_datatype_t *
     }
   }
 
+  struct ezy_ast_union_t *union_t = matched ? NULL : ezyparse_find_union(tkn.data.t_identifier);
+  if (union_t != NULL)
+  {
+    *dest = (struct ezy_ast_datatype_t){.typ = ezy_ast_dt_union, .ext.union_t = union_t};
+    consume(1); // consume union name
+    matched = true;
+  }
+
+  struct ezy_ast_struct_t *struct_t = matched ? NULL : ezyparse_find_struct(tkn.data.t_identifier);
+  if (struct_t != NULL)
+  {
+    *dest = (struct ezy_ast_datatype_t){.typ = ezy_ast_dt_struct, .ext.struct_t = struct_t};
+    consume(1); // consume struct name
+    matched = true;
+  }
+
   if (!matched)
   {
     return (struct ezyparse_error){.msg = "Unrecognized datatype identifier", .last_tkn = tkn};
@@ -115,6 +183,95 @@ static struct ezyparse_error ezyparse_parse_datatype(struct ezy_ast_datatype_t *
     consume(1); // consume '*'
   }
 
+  return ezyparse_parse_array_suffix(dest);
+}
+
+// array length inside `[...]`, a plain non-negative integer literal
+static inline bool ezyparse_match_length(ezy_tkn_t tkn, size_t *dest)
+{
+  if (tkn.type == ezy_tkn_uint64)
+  {
+    *dest = (size_t)tkn.data.t_uint64;
+    return true;
+  }
+  if (tkn.type == ezy_tkn_int64 && tkn.data.t_int64 >= 0)
+  {
+    *dest = (size_t)tkn.data.t_int64;
+    return true;
+  }
+  return false;
+}
+
+// Array suffixes after a type or a declared name, each one wraps *dest:
+//   T[n]   fixed length n
+//   T[]    dynamic
+//   T[n?]  dynamic, guide length n (initial capacity)
+//   T[?m]  dynamic, at most m elements
+//   T[n?m] dynamic, both
+// `int[3][]` is a dynamic array of int[3]. A `?` after `]` makes the array
+// optional: `int?[4]` holds optional ints, `int[]?` is an optional array.
+static struct ezyparse_error ezyparse_parse_array_suffix(struct ezy_ast_datatype_t *dest)
+{
+  ezy_tkn_t tkn = tok(0);
+  while (ezyparse_match(tkn, ezy_tkn_operator) && tkn.data.t_operator == ezy_op_brac_big_l)
+  {
+    consume(1); // consume '['
+
+    struct ezy_ast_array_t *arr = ezyparse_arena_alloc(sizeof(struct ezy_ast_array_t));
+    arr->typ = *dest;
+    arr->dynamic = false;
+    arr->length = 0;
+    arr->max_length = 0;
+    arr->inline_cap = 0;
+
+    tkn = tok(0);
+    bool has_length = ezyparse_match_length(tkn, &arr->length);
+    if (has_length)
+    {
+      consume(1); // consume length
+      tkn = tok(0);
+    }
+
+    if (ezyparse_match(tkn, ezy_tkn_operator) && tkn.data.t_operator == ezy_op_qn)
+    {
+      arr->dynamic = true;
+      consume(1); // consume '?'
+      tkn = tok(0);
+      if (ezyparse_match_length(tkn, &arr->max_length))
+      {
+        consume(1); // consume max length
+        tkn = tok(0);
+      }
+    }
+    else if (!has_length)
+    {
+      arr->dynamic = true; // `[]`
+    }
+
+    if (!ezyparse_match(tkn, ezy_tkn_operator) || tkn.data.t_operator != ezy_op_brac_big_r)
+    {
+      return (struct ezyparse_error){.msg = "Expected ']' after array length", .last_tkn = tkn};
+    }
+    if (!arr->dynamic && arr->length == 0)
+    {
+      return (struct ezyparse_error){.msg = "Fixed array length must be positive", .last_tkn = tkn};
+    }
+    if (arr->max_length != 0 && arr->length > arr->max_length)
+    {
+      return (struct ezyparse_error){.msg = "Array guide length exceeds its max length", .last_tkn = tkn};
+    }
+    consume(1); // consume ']'
+
+    *dest = (struct ezy_ast_datatype_t){.typ = ezy_ast_dt_array, .ext.array_t = arr};
+    tkn = tok(0);
+    if (ezyparse_match(tkn, ezy_tkn_operator) && tkn.data.t_operator == ezy_op_qn)
+    {
+      dest->nullable = true; // `T[]?`, the array itself may be null
+      consume(1); // consume '?'
+      tkn = tok(0);
+    }
+  }
+
   return (struct ezyparse_error){.msg = NULL, .last_tkn = tkn};
 }
 
@@ -206,28 +363,22 @@ static struct ezyparse_error ezyparse_parse_parameter_list(struct ezy_ast_args_t
   return (struct ezyparse_error){.msg = NULL, .last_tkn = tkn};
 }
 
-static struct ezyparse_error ezyparse_parse_call_args(struct ezy_ast_node_t **dest, size_t *dest_count) {
+// Comma separated expressions up to (and including) the `close` bracket,
+// the opening bracket is already consumed. Nodes are stored by value.
+static struct ezyparse_error ezyparse_parse_expr_list(enum ezy_op_typ close, const char *sep_msg, struct ezy_ast_node_t **dest, size_t *dest_count) {
   size_t alloc_count = 8; // max 8 args to start with
   size_t arg_count = 0;
 
   ezy_ast_node_t *args = ezyparse_arena_alloc(sizeof(ezy_ast_node_t) * alloc_count);
 
   ezy_tkn_t tkn = tok(0);
-  if (!ezyparse_expect(tkn, ezy_tkn_operator) || tkn.data.t_operator != ezy_op_brac_small_l)
-  {
-    return (struct ezyparse_error){.msg = "Expected '(' at start of call argument list", .last_tkn = tkn};
-  }
-  consume(1); // consume '('
-
-  
-  tkn = tok(0);
-  while (!(ezyparse_match(tkn, ezy_tkn_operator) && tkn.data.t_operator == ezy_op_brac_small_r))
+  while (!(ezyparse_match(tkn, ezy_tkn_operator) && tkn.data.t_operator == close))
   {
     if (arg_count > 0)
     {
       if (!ezyparse_expect(tkn, ezy_tkn_operator) || tkn.data.t_operator != ezy_op_comma)
       {
-        return (struct ezyparse_error){.msg = "Expected ',' between call arguments", .last_tkn = tkn};
+        return (struct ezyparse_error){.msg = sep_msg, .last_tkn = tkn};
       }
       consume(1); // consume ','
     }
@@ -236,12 +387,11 @@ static struct ezyparse_error ezyparse_parse_call_args(struct ezy_ast_node_t **de
     
     // ezy_log("Call args -> expression: token type %d", tkn.type);
     struct ezyparse_error err = ezyparse_parse_expression(&node);
-
-    args[arg_count] = *node;
     if (err.msg != NULL)
     {
       return err;
     }
+    args[arg_count] = *node;
 
     arg_count++;
 
@@ -272,7 +422,71 @@ static struct ezyparse_error ezyparse_parse_call_args(struct ezy_ast_node_t **de
 
   *dest = args;
   *dest_count = arg_count;
-  consume(1); // consume ')'
+  consume(1); // consume closing bracket
+  return (struct ezyparse_error){.msg = NULL, .last_tkn = tkn};
+}
+
+static struct ezyparse_error ezyparse_parse_call_args(struct ezy_ast_node_t **dest, size_t *dest_count) {
+  ezy_tkn_t tkn = tok(0);
+  if (!ezyparse_expect(tkn, ezy_tkn_operator) || tkn.data.t_operator != ezy_op_brac_small_l)
+  {
+    return (struct ezyparse_error){.msg = "Expected '(' at start of call argument list", .last_tkn = tkn};
+  }
+  consume(1); // consume '('
+  return ezyparse_parse_expr_list(ezy_op_brac_small_r, "Expected ',' between call arguments", dest, dest_count);
+}
+
+// Elements of a struct literal up to (and including) the '}', the '{' is
+// already consumed: `a, b` or `name = a, ...`, both may be mixed.
+static struct ezyparse_error ezyparse_parse_struct_lit(struct ezy_ast_struct_lit_t *dest)
+{
+  size_t cap = 8;
+  dest->count = 0;
+  dest->elements = ezyparse_arena_alloc(sizeof(ezy_ast_node_t) * cap);
+  dest->names = ezyparse_arena_alloc(sizeof(ezy_cstr_t) * cap);
+  dest->fields = NULL;
+
+  ezy_tkn_t tkn = tok(0);
+  while (!(ezyparse_match(tkn, ezy_tkn_operator) && tkn.data.t_operator == ezy_op_brac_curly_r))
+  {
+    if (dest->count > 0)
+    {
+      if (!ezyparse_match(tkn, ezy_tkn_operator) || tkn.data.t_operator != ezy_op_comma)
+        return (struct ezyparse_error){.msg = "Expected ',' between struct literal elements", .last_tkn = tkn};
+      consume(1); // consume ','
+      tkn = tok(0);
+    }
+
+    ezy_cstr_t name = {.ptr = NULL, .len = 0};
+    ezy_tkn_t tkn1 = tok(1);
+    if (ezyparse_match(tkn, ezy_tkn_identifier) && ezyparse_match(tkn1, ezy_tkn_operator) && tkn1.data.t_operator == ezy_op_assign)
+    {
+      name = tkn.data.t_identifier;
+      consume(2); // consume field name and '='
+    }
+
+    ezy_ast_node_t *value;
+    struct ezyparse_error err = ezyparse_parse_expression(&value);
+    if (err.msg != NULL)
+      return err;
+
+    if (dest->count == cap)
+    {
+      // the arena cannot grow an allocation in place
+      ezy_ast_node_t *elements = ezyparse_arena_alloc(sizeof(ezy_ast_node_t) * cap * 2);
+      ezy_cstr_t *names = ezyparse_arena_alloc(sizeof(ezy_cstr_t) * cap * 2);
+      memcpy(elements, dest->elements, sizeof(ezy_ast_node_t) * cap);
+      memcpy(names, dest->names, sizeof(ezy_cstr_t) * cap);
+      dest->elements = elements;
+      dest->names = names;
+      cap *= 2;
+    }
+    dest->elements[dest->count] = *value;
+    dest->names[dest->count] = name;
+    dest->count++;
+    tkn = tok(0);
+  }
+  consume(1); // consume '}'
   return (struct ezyparse_error){.msg = NULL, .last_tkn = tkn};
 }
 
@@ -281,10 +495,11 @@ static enum ezy_pratt_prec {
   ezy_pratt_prec_lowest,
   ezy_pratt_prec_assignment,    // =
   ezy_pratt_prec_conditional,   // ?:
+  ezy_pratt_prec_equality,      // == !=
   ezy_pratt_prec_sum,           // + -
-  ezy_pratt_prec_product,       // * /
+  ezy_pratt_prec_product,       // * / %
   ezy_pratt_prec_prefix,        // -X !X
-  ezy_pratt_prec_call,          // myFunction(X)
+  ezy_pratt_prec_call,          // myFunction(X) a[X] a.b
 };
 
 static enum ezy_pratt_prec ezyparse_get_token_prec(ezy_tkn_t tkn)
@@ -298,10 +513,16 @@ static enum ezy_pratt_prec ezyparse_get_token_prec(ezy_tkn_t tkn)
     case ezy_op_plus:
     case ezy_op_minus:
       return ezy_pratt_prec_sum;
+    case ezy_op_cond_eq:
+    case ezy_op_cond_neq:
+      return ezy_pratt_prec_equality;
     case ezy_op_asterisk:
     case ezy_op_divide:
+    case ezy_op_modulo:
       return ezy_pratt_prec_product;
     case ezy_op_brac_small_l:
+    case ezy_op_brac_big_l:
+    case ezy_op_dot:
       return ezy_pratt_prec_call;
     default:
       return ezy_pratt_prec_lowest - 1;
@@ -329,8 +550,10 @@ static ezy_ast_node_t* ezyparse_parse_pratt_prefix()
   if ( tkn.type == ezy_tkn_uint64 ) {
     ezy_ast_node_t *lit_node = ezyparse_arena_alloc(sizeof(ezy_ast_node_t));
 
+    // unsuffixed literals are plain integers (like C), unsigned only when
+    // they do not fit, so `1 - 2` does not wrap around
     uint64_t v = tkn.data.t_uint64;
-    enum ezy_ast_datatype_typ typ = v > UINT32_MAX ? ezy_ast_dt_uint64 : ezy_ast_dt_uint32;
+    enum ezy_ast_datatype_typ typ = v > INT64_MAX ? ezy_ast_dt_uint64 : v > INT32_MAX ? ezy_ast_dt_int64 : ezy_ast_dt_int32;
 
     lit_node->type = ezy_ast_node_literal;
     lit_node->data.n_literal.typ = typ;
@@ -366,6 +589,33 @@ static ezy_ast_node_t* ezyparse_parse_pratt_prefix()
   //   return lit_node;
   // }
 
+  if ( tkn.type == ezy_tkn_identifier && tkn.data.t_identifier.len == 4 && memcmp(tkn.data.t_identifier.ptr, "null", 4) == 0 ) {
+    ezy_ast_node_t *lit_node = ezyparse_arena_alloc(sizeof(ezy_ast_node_t));
+    lit_node->type = ezy_ast_node_literal;
+    lit_node->data.n_literal.typ = ezy_ast_dt_null;
+    lit_node->data.n_literal.value.t_uint64 = 0;
+    consume(1); // consume 'null'
+    return lit_node;
+  }
+
+  if ( tkn.type == ezy_tkn_identifier && !(tok(1).type == ezy_tkn_operator && tok(1).data.t_operator == ezy_op_brac_small_l) ) {
+    // a type name used as a value, as in typeof(x) == typeof(int)
+    struct ezy_ast_datatype_t dt = {.typ = ezy_ast_dt_infer};
+    struct ezyparse_error err = ezyparse_parse_datatype(&dt);
+    if (dt.typ != ezy_ast_dt_infer)
+    {
+      if (err.msg != NULL)
+      {
+        ezyparse_error("Error parsing type name: %s", err.msg);
+        return NULL;
+      }
+      ezy_ast_node_t *typ_node = ezyparse_arena_alloc(sizeof(ezy_ast_node_t));
+      typ_node->type = ezy_ast_node_datatype;
+      typ_node->data.n_datatype = dt;
+      return typ_node;
+    }
+  }
+
   if ( tkn.type == ezy_tkn_identifier ) {
     ezy_ast_node_t *var_node = ezyparse_arena_alloc(sizeof(ezy_ast_node_t));
     ezy_tkn_t tkn1 = tok(1);
@@ -374,29 +624,62 @@ static ezy_ast_node_t* ezyparse_parse_pratt_prefix()
     if ( isFuncCall ) {
       struct ezy_ast_call_t *call_data = ezyparse_arena_alloc(sizeof(struct ezy_ast_call_t));
       call_data->func_name = tkn.data.t_identifier;
+      call_data->sym = NULL;
       var_node->type = ezy_ast_node_call;
       var_node->data.n_call = call_data;
     } else {
       var_node->type = ezy_ast_node_variable;
       var_node->data.n_variable.name = tkn.data.t_identifier;
+      var_node->data.n_variable.value = NULL;
+      var_node->data.n_variable.sym = NULL;
     }
     consume(1); // consume identifier token
     return var_node;
   }
 
+  if ( tkn.type == ezy_tkn_operator && tkn.data.t_operator == ezy_op_brac_big_l ) {
+    consume(1); // consume '['
+    ezy_ast_node_t *arr_node = ezyparse_arena_alloc(sizeof(ezy_ast_node_t));
+    arr_node->type = ezy_ast_node_array_lit;
+    struct ezy_ast_array_lit_t *lit = &arr_node->data.n_array_lit;
+    struct ezyparse_error err = ezyparse_parse_expr_list(ezy_op_brac_big_r, "Expected ',' between array elements", &lit->elements, &lit->count);
+    if (err.msg != NULL)
+    {
+      ezyparse_error("Error parsing array literal: %s", err.msg);
+      return NULL;
+    }
+    return arr_node;
+  }
+
+  if ( tkn.type == ezy_tkn_operator && tkn.data.t_operator == ezy_op_brac_curly_l ) {
+    consume(1); // consume '{'
+    ezy_ast_node_t *lit_node = ezyparse_arena_alloc(sizeof(ezy_ast_node_t));
+    lit_node->type = ezy_ast_node_struct_lit;
+    struct ezyparse_error err = ezyparse_parse_struct_lit(&lit_node->data.n_struct_lit);
+    if (err.msg != NULL)
+    {
+      ezyparse_error("Error parsing struct literal: %s", err.msg);
+      return NULL;
+    }
+    return lit_node;
+  }
+
   if ( tkn.type == ezy_tkn_operator && tkn.data.t_operator == ezy_op_brac_small_l ) {
     consume(1); // consume '('
     ezy_ast_node_t *expr = ezyparse_parse_pratt_expr(ezy_pratt_prec_lowest);
+    if ( expr == NULL && ezyparse_too_deep ) {
+      return NULL; // reported once
+    }
     tkn = tok(0);
     if ( !ezyparse_expect(tkn, ezy_tkn_operator) || tkn.data.t_operator != ezy_op_brac_small_r ) {
-      ezy_log_warn("Expected ')' after expression");
+      ezyparse_error("Expected ')' after expression");
       return NULL;
     }
     consume(1); // consume ')'
     return expr;
   }
 
-  ezy_log_warn("Unsupported prefix token type %d, %d", tkn.type, tkn.data.t_operator);
+  ezyparse_error("Unsupported prefix token type %d, %d at line %u, col %u", tkn.type, tkn.data.t_operator, tkn.line, tkn.col);
   return NULL;
 }
 
@@ -432,28 +715,85 @@ static ezy_ast_node_t* ezyparse_parse_pratt_postfix(ezy_ast_node_t* left, int pr
     ezy_log_raw(")\n");
     if (err.msg != NULL)
     {
-      ezy_log_warn("Error parsing function call arguments: %s", err.msg);
+      ezyparse_error("Error parsing function call arguments: %s", err.msg);
       return NULL;
     }      
 
     return call_node;
   }
 
+  if ( tkn.type == ezy_tkn_operator && tkn.data.t_operator == ezy_op_brac_big_l ) {
+    consume(1); // consume '['
+    ezy_ast_node_t *index_node = ezyparse_arena_alloc(sizeof(ezy_ast_node_t));
+    index_node->type = ezy_ast_node_index;
+    index_node->data.n_index.base = left;
+    index_node->data.n_index.checked = false;
+    struct ezyparse_error err = ezyparse_parse_expression(&index_node->data.n_index.index);
+    if (err.msg != NULL)
+    {
+      ezyparse_error("Error parsing index expression: %s", err.msg);
+      return NULL;
+    }
+    tkn = tok(0);
+    if ( !ezyparse_expect(tkn, ezy_tkn_operator) || tkn.data.t_operator != ezy_op_brac_big_r ) {
+      ezyparse_error("Expected ']' after index expression");
+      return NULL;
+    }
+    consume(1); // consume ']'
+    return index_node;
+  }
+
+  if ( tkn.type == ezy_tkn_operator && tkn.data.t_operator == ezy_op_dot ) {
+    consume(1); // consume '.'
+    tkn = tok(0);
+    if ( !ezyparse_expect(tkn, ezy_tkn_identifier) ) {
+      ezyparse_error("Expected member name after '.'");
+      return NULL;
+    }
+    ezy_ast_node_t *member_node = ezyparse_arena_alloc(sizeof(ezy_ast_node_t));
+    member_node->type = ezy_ast_node_member;
+    member_node->data.n_member.object = left;
+    member_node->data.n_member.name = tkn.data.t_identifier;
+    consume(1); // consume member name
+    return member_node;
+  }
+
   // binary operator
   
   ezy_ast_node_t *node = ezyparse_arena_alloc(sizeof(ezy_ast_node_t));
   node->type = ezy_ast_node_binop;
   node->data.n_binop.operator = tkn.data.t_operator;
   node->data.n_binop.left = left;
+  node->data.n_binop.stack_buf = 0;
   
   consume(1); // consume operator token
 
   ezy_ast_node_t *right = ezyparse_parse_pratt_expr(prec + 1);
+  if (right == NULL && !ezyparse_too_deep)
+    ezyparse_error("Binary operator %d is missing an operand at line %u, col %u", tkn.data.t_operator, tkn.line, tkn.col);
   node->data.n_binop.right = right;
   return node;
 }
 
+static ezy_ast_node_t* ezyparse_parse_pratt(int min_prec);
+
 static ezy_ast_node_t* ezyparse_parse_pratt_expr(int min_prec)
+{
+  if ( ezyparse_depth == ezyparse_max_depth ) {
+    if ( !ezyparse_too_deep ) {
+      ezy_tkn_t tkn = tok(0);
+      ezyparse_error("Expression nested deeper than %d at line %u, col %u", ezyparse_max_depth, tkn.line, tkn.col);
+    }
+    ezyparse_too_deep = true;
+    return NULL;
+  }
+  ezyparse_depth++;
+  ezy_ast_node_t* node = ezyparse_parse_pratt(min_prec);
+  ezyparse_depth--;
+  return node;
+}
+
+static ezy_ast_node_t* ezyparse_parse_pratt(int min_prec)
 {
   ezy_tkn_t tkn = tok(0);
   if ( tkn.type == ezy_tkn_operator && (tkn.data.t_operator == ezy_op_semicolon || tkn.data.t_operator == ezy_op_comma ) ) {
@@ -475,6 +815,8 @@ static ezy_ast_node_t* ezyparse_parse_pratt_expr(int min_prec)
     ezy_log("Float64 literal token: %f", tkn.data.t_float64);
   }
   ezy_ast_node_t* left = ezyparse_parse_pratt_prefix();
+  if (left == NULL)
+    return NULL; // reported by the prefix parse
   tkn = tok(0);
   while (true)
   {
@@ -497,6 +839,8 @@ static ezy_ast_node_t* ezyparse_parse_pratt_expr(int min_prec)
       ezy_log("Float64 literal token: %f", tkn.data.t_float64);
     }
     left = ezyparse_parse_pratt_postfix(left, prec);
+    if (left == NULL || ezyparse_too_deep)
+      return NULL; // reported already
     tkn = tok(0);
   }
 
@@ -532,10 +876,17 @@ static struct ezyparse_error ezyparse_parse_decl(ezy_ast_node_t **dest)
   ezy_ast_node_t *dest_node = ezyparse_arena_alloc(sizeof(ezy_ast_node_t));
   *dest = dest_node;
 
-  dest_node->data.n_variable.typ.typ = ezy_ast_dt_infer; // default to infer
+  dest_node->data.n_variable.typ = (struct ezy_ast_datatype_t){.typ = ezy_ast_dt_infer}; // default to infer
+  dest_node->data.n_variable.value = NULL;
+  dest_node->data.n_variable.sym = NULL;
   
   ezy_log("before parsing datatype, tok type=%d (%.*s)", tkn.type, tkn.data.t_identifier.len, tkn.data.t_identifier.ptr);
-  ezyparse_parse_datatype(&dest_node->data.n_variable.typ);
+  // the type is optional, but a malformed one (`int[0]`) is an error
+  struct ezyparse_error typ_err = ezyparse_parse_datatype(&dest_node->data.n_variable.typ);
+  if (typ_err.msg != NULL && dest_node->data.n_variable.typ.typ != ezy_ast_dt_infer)
+  {
+    return typ_err;
+  }
   ezy_log("Parsed datatype for declaration, type=%d", dest_node->data.n_variable.typ.typ);
 
   tkn = tok(0);
@@ -550,7 +901,16 @@ static struct ezyparse_error ezyparse_parse_decl(ezy_ast_node_t **dest)
   dest_node->data.n_variable.name = tkn.data.t_identifier;
   ezy_log("Decl -> identifier: token type %d, name: %.*s", tkn.type, tkn.data.t_identifier.len, tkn.data.t_identifier.ptr);
   
-  tkn = tok(1); // lookahead for '='
+  consume(1); // consume identifier
+
+  // `let int x[10]`, `let x[] = ...`: array suffix on the name
+  struct ezyparse_error suffix_err = ezyparse_parse_array_suffix(&dest_node->data.n_variable.typ);
+  if (suffix_err.msg != NULL)
+  {
+    return suffix_err;
+  }
+
+  tkn = tok(0); // lookahead for '='
 
   bool assign = tkn.type == ezy_tkn_operator && tkn.data.t_operator == ezy_op_assign;
 
@@ -559,8 +919,6 @@ static struct ezyparse_error ezyparse_parse_decl(ezy_ast_node_t **dest)
     return (struct ezyparse_error){.msg = "Const declarations must be immediately assigned", .last_tkn = tkn};
   }
 
-  consume(1); // consume identifier
-
   // check for immediate assignment
   if (assign)
   {
@@ -573,8 +931,10 @@ static struct ezyparse_error ezyparse_parse_decl(ezy_ast_node_t **dest)
     {
       return err;
     }
-  } else {
-    // mark as nullable if not assigned
+  } else if (dest_node->data.n_variable.typ.typ != ezy_ast_dt_array && dest_node->data.n_variable.typ.typ != ezy_ast_dt_union &&
+             dest_node->data.n_variable.typ.typ != ezy_ast_dt_struct) {
+    // mark as nullable if not assigned, arrays start empty instead,
+    // unions start null only if null is a member and structs hold defaults
     dest_node->data.n_variable.typ.nullable = true;
   }
 
@@ -612,7 +972,22 @@ static struct ezyparse_error ezyparse_parse_statement(struct ezy_ast_function_t
 
   else if (ezyparse_match(tkn, ezy_tkn_keyword) && tkn.data.t_keyword == ezy_kw_return)
   {
-    // To do : parse return statement
+    consume(1); // consume 'return'
+    cur_node = ezyparse_arena_alloc(sizeof(ezy_ast_node_t));
+    cur_node->type = ezy_ast_node_return;
+    cur_node->data.n_return.value = NULL;
+    cur_node->next = NULL;
+
+    tkn = tok(0);
+    if (!(ezyparse_match(tkn, ezy_tkn_operator) && tkn.data.t_operator == ezy_op_semicolon))
+    {
+      struct ezyparse_error err = ezyparse_parse_expression(&cur_node->data.n_return.value);
+      if (err.msg != NULL)
+      {
+        return err;
+      }
+    }
+    first_node = cur_node;
   }
 
   else
@@ -680,13 +1055,20 @@ static struct ezyparse_error ezyparse_parse_block(struct ezy_ast_function_t *fun
 
   consume(1); // consume '}'
 
+  if (curr_stmt != NULL)
+  {
+    curr_stmt->next = NULL; // statements are walked as a `next` list
+  }
   *dest = block_node;
   return (struct ezyparse_error){.msg = NULL, .last_tkn = tkn};
 }
 
+// [@region] fn [type] name(params) { ... }
+// `@region` allocates the call's temporaries from the thread's region,
+// released when it returns (ezyrt_region.h).
 static struct ezyparse_error ezyparse_parse_function(ezy_ast_node_t **dest)
 {
-
+  bool region = ezyparse_attribute("region");
   ezy_tkn_t tkn = tok(0);
 
   if (tkn.type != ezy_tkn_keyword || tkn.data.t_keyword != ezy_kw_fn)
@@ -699,6 +1081,9 @@ static struct ezyparse_error ezyparse_parse_function(ezy_ast_node_t **dest)
   func_node->type = ezy_ast_node_function;
   
   func_data->return_typ.typ = ezy_ast_dt_infer;
+  func_data->sema_state = 0;
+  func_data->region = region;
+  func_data->escapes = 0;
   
   consume(1); // consume 'fn' keyword
 
@@ -743,26 +1128,182 @@ static struct ezyparse_error ezyparse_parse_function(ezy_ast_node_t **dest)
   return ezyparse_parse_block(func_data, &func_data->body);
 }
 
+// [@abi] struct Name { T field; ... }
+// Field types are any declarable type, a struct used as a field must be
+// declared first. `@abi` keeps the declaration order in C (see the
+// transpiler's Structs section). The `;` after `}` is optional.
 static struct ezyparse_error ezyparse_parse_struct(ezy_ast_node_t **dest)
 {
-  ezy_tkn_t tkn = ezylex_peek_tkn(0);
-  struct ezyparse_error err = {NULL, 0, 0};
+  bool abi = ezyparse_attribute("abi");
+  ezy_tkn_t tkn = tok(0);
   if (tkn.type != ezy_tkn_keyword || tkn.data.t_keyword != ezy_kw_struct)
   {
     return (struct ezyparse_error){.msg = "Expected 'struct' keyword", .last_tkn = tkn};
   }
-  // To do : parse structs
+  consume(1); // consume 'struct'
+
+  ezy_ast_node_t *node = ezyparse_arena_alloc(sizeof(ezy_ast_node_t));
+  struct ezy_ast_struct_t *s = ezyparse_arena_alloc(sizeof(struct ezy_ast_struct_t));
+  node->type = ezy_ast_node_struct;
+  node->data.n_struct = s;
+  node->next = NULL;
+  *dest = node;
+  s->abi = abi;
+
+  tkn = tok(0);
+  if (!ezyparse_match(tkn, ezy_tkn_identifier))
+    return (struct ezyparse_error){.msg = "Expected struct name identifier", .last_tkn = tkn};
+  if (ezyparse_find_struct(tkn.data.t_identifier) != NULL || ezyparse_find_union(tkn.data.t_identifier) != NULL)
+    return (struct ezyparse_error){.msg = "Redefinition of struct", .last_tkn = tkn};
+  s->name = tkn.data.t_identifier;
+  consume(1); // consume name
+
+  tkn = tok(0);
+  if (!ezyparse_match(tkn, ezy_tkn_operator) || tkn.data.t_operator != ezy_op_brac_curly_l)
+    return (struct ezyparse_error){.msg = "Expected '{' after struct name", .last_tkn = tkn};
+  consume(1); // consume '{'
+
+  size_t cap = 8;
+  s->count = 0;
+  s->members = ezyparse_arena_alloc(sizeof(struct ezy_ast_args_t) * cap);
+  tkn = tok(0);
+  while (!(ezyparse_match(tkn, ezy_tkn_operator) && tkn.data.t_operator == ezy_op_brac_curly_r))
+  {
+    struct ezy_ast_args_t field = {.typ = {.typ = ezy_ast_dt_infer}};
+    struct ezyparse_error err = ezyparse_parse_datatype(&field.typ);
+    if (err.msg != NULL)
+      return err;
+    if (field.typ.typ == ezy_ast_dt_void)
+      return (struct ezyparse_error){.msg = "A struct field cannot be void", .last_tkn = tkn};
+
+    tkn = tok(0);
+    if (!ezyparse_match(tkn, ezy_tkn_identifier))
+      return (struct ezyparse_error){.msg = "Expected field name identifier", .last_tkn = tkn};
+    field.name = tkn.data.t_identifier;
+    for (size_t i = 0; i < s->count; i++)
+    {
+      if (s->members[i].name.len == field.name.len && memcmp(s->members[i].name.ptr, field.name.ptr, field.name.len) == 0)
+        return (struct ezyparse_error){.msg = "Duplicate struct field", .last_tkn = tkn};
+    }
+    consume(1); // consume field name
+
+    // `int xs[4];`: array suffix on the name
+    err = ezyparse_parse_array_suffix(&field.typ);
+    if (err.msg != NULL)
+      return err;
+
+    tkn = tok(0);
+    if (!ezyparse_match(tkn, ezy_tkn_operator) || tkn.data.t_operator != ezy_op_semicolon)
+      return (struct ezyparse_error){.msg = "Expected ';' after struct field", .last_tkn = tkn};
+    consume(1); // consume ';'
+
+    if (s->count == cap)
+    {
+      // the arena cannot grow an allocation in place
+      struct ezy_ast_args_t *grown = ezyparse_arena_alloc(sizeof(struct ezy_ast_args_t) * cap * 2);
+      memcpy(grown, s->members, sizeof(struct ezy_ast_args_t) * cap);
+      s->members = grown;
+      cap *= 2;
+    }
+    s->members[s->count++] = field;
+    tkn = tok(0);
+  }
+  if (s->count == 0)
+    return (struct ezyparse_error){.msg = "A struct needs at least one field", .last_tkn = tkn};
+  consume(1); // consume '}'
+
+  tkn = tok(0);
+  if (ezyparse_match(tkn, ezy_tkn_operator) && tkn.data.t_operator == ezy_op_semicolon)
+    consume(1); // consume ';'
+
+  s->prev = ezyparse_structs;
+  ezyparse_structs = s;
+  return (struct ezyparse_error){.msg = NULL, .last_tkn = tkn};
 }
 
+// union Name = T1 | T2 | null;
+// Members are scalar types, string or null, each at most once. The `;`
+// is optional.
 static struct ezyparse_error ezyparse_parse_union(ezy_ast_node_t **dest)
 {
   ezy_tkn_t tkn = ezylex_peek_tkn(0);
-  struct ezyparse_error err = {NULL, 0, 0};
   if (tkn.type != ezy_tkn_keyword || tkn.data.t_keyword != ezy_kw_union)
   {
     return (struct ezyparse_error){.msg = "Expected 'union' keyword", .last_tkn = tkn};
   }
-  // To do : parse unions
+  consume(1); // consume 'union'
+
+  ezy_ast_node_t *node = ezyparse_arena_alloc(sizeof(ezy_ast_node_t));
+  struct ezy_ast_union_t *u = ezyparse_arena_alloc(sizeof(struct ezy_ast_union_t));
+  node->type = ezy_ast_node_union;
+  node->data.n_union = u;
+  node->next = NULL;
+  *dest = node;
+
+  tkn = tok(0);
+  if (!ezyparse_match(tkn, ezy_tkn_identifier))
+    return (struct ezyparse_error){.msg = "Expected union name identifier", .last_tkn = tkn};
+  if (ezyparse_find_union(tkn.data.t_identifier) != NULL)
+    return (struct ezyparse_error){.msg = "Redefinition of union", .last_tkn = tkn};
+  u->name = tkn.data.t_identifier;
+  consume(1); // consume name
+
+  tkn = tok(0);
+  if (!ezyparse_match(tkn, ezy_tkn_operator) || tkn.data.t_operator != ezy_op_assign)
+    return (struct ezyparse_error){.msg = "Expected '=' after union name", .last_tkn = tkn};
+  consume(1); // consume '='
+
+  size_t cap = 8;
+  bool has_value = false;
+  u->count = 0;
+  u->mem_typlist = ezyparse_arena_alloc(sizeof(struct ezy_ast_datatype_t) * cap);
+  while (true)
+  {
+    tkn = tok(0);
+    struct ezy_ast_datatype_t member = {.typ = ezy_ast_dt_null};
+    if (ezyparse_match(tkn, ezy_tkn_identifier) && tkn.data.t_identifier.len == 4 && memcmp(tkn.data.t_identifier.ptr, "null", 4) == 0)
+    {
+      consume(1); // consume 'null'
+    }
+    else
+    {
+      struct ezyparse_error err = ezyparse_parse_datatype(&member);
+      if (err.msg != NULL)
+        return err;
+      if (member.typ < ezy_ast_dt_int8 || member.typ > ezy_ast_dt_string || member.nullable || member.is_ptr)
+        return (struct ezyparse_error){.msg = "Union members must be scalar types, string or null", .last_tkn = tkn};
+      has_value = true;
+    }
+
+    for (size_t i = 0; i < u->count; i++)
+    {
+      if (u->mem_typlist[i].typ == member.typ)
+        return (struct ezyparse_error){.msg = "Duplicate union member type", .last_tkn = tkn};
+    }
+    if (u->count == cap)
+    {
+      // the arena cannot grow an allocation in place
+      struct ezy_ast_datatype_t *grown = ezyparse_arena_alloc(sizeof(struct ezy_ast_datatype_t) * cap * 2);
+      memcpy(grown, u->mem_typlist, sizeof(struct ezy_ast_datatype_t) * cap);
+      u->mem_typlist = grown;
+      cap *= 2;
+    }
+    u->mem_typlist[u->count++] = member;
+
+    tkn = tok(0);
+    if (!ezyparse_match(tkn, ezy_tkn_operator) || tkn.data.t_operator != ezy_op_bw_or)
+      break;
+    consume(1); // consume '|'
+  }
+  if (!has_value)
+    return (struct ezyparse_error){.msg = "A union needs a member other than null", .last_tkn = tkn};
+
+  if (ezyparse_match(tkn, ezy_tkn_operator) && tkn.data.t_operator == ezy_op_semicolon)
+    consume(1); // consume ';'
+
+  u->prev = ezyparse_unions;
+  ezyparse_unions = u;
+  return (struct ezyparse_error){.msg = NULL, .last_tkn = tkn};
 }
 
 static struct ezyparse_error ezyparse_parse_global_decl(ezy_ast_node_t **dest)
@@ -773,13 +1314,32 @@ static struct ezyparse_error ezyparse_parse_global_decl(ezy_ast_node_t **dest)
   {
     return (struct ezyparse_error){.msg = "Expected 'let' or 'const' keyword", .last_tkn = tkn};
   }
-  // To do : parse global declarations
+
+  err = ezyparse_parse_decl(dest);
+  if (err.msg != NULL)
+  {
+    return err;
+  }
+  consume(1); // consume ';'
+  return err;
 }
 
 static struct ezyparse_error ezyparse_parse_program(ezy_ast_node_t **dest)
 {
   ezy_tkn_t tkn = ezylex_peek_tkn(0);
 
+  if (tkn.type == ezy_tkn_operator && tkn.data.t_operator == ezy_op_at)
+  {
+    // attributes: @abi struct, @region fn
+    ezy_tkn_t name = tok(1);
+    if (ezyparse_match(name, ezy_tkn_identifier) && name.data.t_identifier.len == 6 &&
+        memcmp(name.data.t_identifier.ptr, "region", 6) == 0)
+      return ezyparse_parse_function(dest);
+    if (ezyparse_match(name, ezy_tkn_identifier) && name.data.t_identifier.len == 3 &&
+        memcmp(name.data.t_identifier.ptr, "abi", 3) == 0)
+      return ezyparse_parse_struct(dest);
+    return (struct ezyparse_error){.msg = "Unknown attribute, expected @abi or @region", .last_tkn = name};
+  }
   if (tkn.type != ezy_tkn_keyword)
   {
     return (struct ezyparse_error){.msg = "Unexpected token, expected keyword", .last_tkn = tkn};
@@ -805,6 +1365,11 @@ ezy_ast_node_t *ezyparse_parse(const char *src)
 {
   ezy_ast_node_t *root = NULL;
   ezy_ast_node_t *curr = root;
+  ezyparse_unions = NULL;
+  ezyparse_structs = NULL;
+  ezyparse_errors = 0;
+  ezyparse_depth = 0;
+  ezyparse_too_deep = false;
   ezylex_start(src);
   while (true)
   {
@@ -815,7 +1380,7 @@ ezy_ast_node_t *ezyparse_parse(const char *src)
     }
     if (tkn.type == ezy_tkn_invalid)
     {
-      ezy_log_error("lexer error: %s\n\t at line %u, col %u", tkn.data.t_string.ptr, tkn.line, tkn.col);
+      ezyparse_error("lexer error: %s\n\t at line %u, col %u", tkn.data.t_string.ptr, tkn.line, tkn.col);
       break;
     }
     if (tkn.type == ezy_tkn_eof)
@@ -834,15 +1399,26 @@ ezy_ast_node_t *ezyparse_parse(const char *src)
     }
     if (err.msg != NULL)
     {
-      ezy_log_error("parser error: %s\n\t at line %u, col %u", err.msg, err.last_tkn.line, err.last_tkn.col);
+      ezyparse_error("parser error: %s\n\t at line %u, col %u", err.msg, err.last_tkn.line, err.last_tkn.col);
       ezylex_consume_tkn(1); // consume the problematic token
       curr->type = ezy_ast_node_error;
       curr->data.n_error.msg = err.msg;
       curr->data.n_error.err_token = err.last_tkn;
+      if (ezyparse_too_deep)
+        break; // the rest would be one error per token
     }
   }
+  if (curr != NULL)
+  {
+    curr->next = NULL;
+  }
   return root;
 }
 
+size_t ezyparse_error_count(void)
+{
+  return ezyparse_errors;
+}
+
 #undef tok
 #undef consume
\ No newline at end of file
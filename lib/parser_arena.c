@@ -1,5 +1,6 @@
 
 #include <stdlib.h>
+#include <string.h>
 #include <ezy_log.h>
 #include <ezy_parser_arena.h>
 
@@ -9,26 +10,57 @@ static struct ezyparse_arena arena_head = {
   .size = ezyparse_arena_size,
   .used = 0,
   .next = NULL,
+  .cur = NULL,
 };
 
+// the arena of this thread, NULL for arena_head
+static _Thread_local struct ezyparse_arena* arena_local = NULL;
+
+static inline struct ezyparse_arena* ezyparse_arena_current(void)
+{
+  return arena_local != NULL ? arena_local : &arena_head;
+}
+
+static struct ezyparse_arena* ezyparse_arena_block(size_t size)
+{
+  struct ezyparse_arena* block = (struct ezyparse_arena*)malloc(sizeof(struct ezyparse_arena));
+  if ( block == NULL )
+    return NULL;
+  block->mainbuf = (uint8_t*)malloc(size);
+  if ( block->mainbuf == NULL )
+  {
+    free(block);
+    return NULL;
+  }
+  block->size = size;
+  block->used = 0;
+  block->next = NULL;
+  block->cur = NULL;
+  return block;
+}
+
 /* Allocate memory from parser arena */
 void* ezyparse_arena_alloc(size_t size)
 {
-  struct ezyparse_arena* arena = &arena_head;
+  struct ezyparse_arena* head = ezyparse_arena_current();
+  // blocks before cur are full, start at cur: O(1) no matter how many
+  // blocks the arena has grown to
+  struct ezyparse_arena* arena = head->cur != NULL ? head->cur : head;
   while ( arena->used + size > arena->size )
   {
     if ( arena->next == NULL )
     {
       ezy_log_warn("ezyparse_arena_alloc: arena out of memory, allocating new arena block.");
-      struct ezyparse_arena* new_arena = (struct ezyparse_arena*)malloc(sizeof(struct ezyparse_arena));
-      new_arena->mainbuf = (uint8_t*)malloc(ezyparse_arena_size);
-      new_arena->size = ezyparse_arena_size;
-      new_arena->used = 0;
-      new_arena->next = NULL;
-      arena->next = new_arena;
+      arena->next = ezyparse_arena_block(size > ezyparse_arena_size ? size : ezyparse_arena_size);
+      if ( arena->next == NULL )
+      {
+        ezy_log_error("ezyparse_arena_alloc: failed to allocate an arena block");
+        return NULL;
+      }
     }
     arena = arena->next;
   }
+  head->cur = arena;
   void* ptr = arena->mainbuf + arena->used;
   arena->used += size;
   return ptr;
@@ -36,22 +68,37 @@ void* ezyparse_arena_alloc(size_t size)
 
 bool ezyparse_arena_backtrack(size_t size, void* final_ptr)
 {
-  struct ezyparse_arena* arena = &arena_head;
-  while ( arena != NULL )
+  struct ezyparse_arena* head = ezyparse_arena_current();
+  struct ezyparse_arena* arena = head->cur != NULL ? head->cur : head;
+  if ((uint8_t*)final_ptr + size == (uint8_t*)arena->mainbuf + arena->used ) {
+    arena->used -= size;
+    return true;
+  }
+  for ( arena = head; arena != NULL; arena = arena->next )
   {
     if ((uint8_t*)final_ptr + size == (uint8_t*)arena->mainbuf + arena->used ) {
       arena->used -= size;
       return true;
     }
-    arena = arena->next;
   }
   return false;
 }
 
-/* Reset parser arena */
-void ezyparse_arena_clear()
+static bool arena_retain = false;
+
+/* Keep blocks across clears, for a process that parses many inputs */
+void ezyparse_arena_retain(bool retain)
+{
+  arena_retain = retain;
+  if ( retain )
+  {
+    // fault every page of the static block in now, not during a parse
+    memset(ezyparse_arena, 0, sizeof ezyparse_arena);
+  }
+}
+
+static void ezyparse_arena_free_blocks(struct ezyparse_arena* arena)
 {
-  struct ezyparse_arena* arena = arena_head.next;
   while ( arena != NULL )
   {
     struct ezyparse_arena* next = arena->next;
@@ -59,6 +106,52 @@ void ezyparse_arena_clear()
     free(arena);
     arena = next;
   }
-  arena_head.used = 0;
-  arena_head.next = NULL;
-}
\ No newline at end of file
+}
+
+/* Reset parser arena */
+void ezyparse_arena_clear()
+{
+  struct ezyparse_arena* head = ezyparse_arena_current();
+  head->cur = NULL;
+  if ( arena_retain )
+  {
+    for ( struct ezyparse_arena* arena = head; arena != NULL; arena = arena->next )
+      arena->used = 0;
+    return;
+  }
+  ezyparse_arena_free_blocks(head->next);
+  head->used = 0;
+  head->next = NULL;
+}
+
+/* A separate arena, for a worker thread */
+struct ezyparse_arena* ezyparse_arena_create(void)
+{
+  return ezyparse_arena_block(ezyparse_arena_size);
+}
+
+void ezyparse_arena_destroy(struct ezyparse_arena* arena)
+{
+  if ( arena_local == arena )
+    arena_local = NULL;
+  ezyparse_arena_free_blocks(arena);
+}
+
+struct ezyparse_arena* ezyparse_arena_use(struct ezyparse_arena* arena)
+{
+  struct ezyparse_arena* previous = arena_local;
+  arena_local = arena;
+  return previous;
+}
+
+/* Bytes in use and allocated, and blocks, of `arena` (NULL: this thread's) */
+void ezyparse_arena_usage(const struct ezyparse_arena* arena, size_t* used, size_t* reserved, size_t* blocks)
+{
+  *used = *reserved = *blocks = 0;
+  for ( arena = arena != NULL ? arena : ezyparse_arena_current(); arena != NULL; arena = arena->next )
+  {
+    *used += arena->used;
+    *reserved += arena->size;
+    (*blocks)++;
+  }
+}
@@ -0,0 +1,263 @@
+#include <ezy_pool.h>
+#include <ezy_log.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if !defined(_WIN32)
+#include <pthread.h>
+#include <stdatomic.h>
+#endif
+
+struct ezypool_task {
+  ezypool_fn fn;
+  void *arg;
+};
+
+// ring of tasks [top, bottom): the owner pushes and pops at the bottom,
+// thieves take from the top
+struct ezypool_deque {
+  struct ezypool_task *tasks;
+  size_t cap; // power of two
+  size_t top;
+  size_t bottom;
+#if !defined(_WIN32)
+  pthread_mutex_t lock;
+#endif
+};
+
+struct ezypool {
+  int workers;
+  struct ezypool_deque *deques;
+  size_t spread; // next deque for tasks submitted outside a run
+#if !defined(_WIN32)
+  atomic_size_t pending; // queued or running
+  atomic_size_t queued;
+  pthread_mutex_t lock; // with wake: idle workers sleep until a task is queued or all are done
+  pthread_cond_t wake;
+#else
+  size_t pending;
+  size_t queued;
+#endif
+};
+
+static _Thread_local struct ezypool *ezypool_current = NULL;
+static _Thread_local int ezypool_self = -1;
+
+#if !defined(_WIN32)
+#define ezypool_lock(m) pthread_mutex_lock(m)
+#define ezypool_unlock(m) pthread_mutex_unlock(m)
+#else
+#define ezypool_lock(m) ((void)0)
+#define ezypool_unlock(m) ((void)0)
+#endif
+
+// ================ Deques ================
+
+static bool ezypool_push(struct ezypool_deque *d, struct ezypool_task task)
+{
+  ezypool_lock(&d->lock);
+  if (d->bottom - d->top == d->cap)
+  {
+    size_t cap = d->cap > 0 ? d->cap * 2 : 64;
+    struct ezypool_task *tasks = malloc(cap * sizeof *tasks);
+    if (tasks == NULL)
+    {
+      ezypool_unlock(&d->lock);
+      return false;
+    }
+    for (size_t i = d->top; i < d->bottom; i++)
+      tasks[i & (cap - 1)] = d->tasks[i & (d->cap - 1)];
+    free(d->tasks);
+    d->tasks = tasks;
+    d->cap = cap;
+  }
+  d->tasks[d->bottom++ & (d->cap - 1)] = task;
+  ezypool_unlock(&d->lock);
+  return true;
+}
+
+static bool ezypool_pop(struct ezypool_deque *d, struct ezypool_task *task)
+{
+  ezypool_lock(&d->lock);
+  bool got = d->bottom > d->top;
+  if (got)
+    *task = d->tasks[--d->bottom & (d->cap - 1)];
+  ezypool_unlock(&d->lock);
+  return got;
+}
+
+static bool ezypool_steal(struct ezypool_deque *d, struct ezypool_task *task)
+{
+  ezypool_lock(&d->lock);
+  bool got = d->bottom > d->top;
+  if (got)
+    *task = d->tasks[d->top++ & (d->cap - 1)];
+  ezypool_unlock(&d->lock);
+  return got;
+}
+
+// ================ Pool ================
+
+struct ezypool *ezypool_create(int workers)
+{
+  if (workers < 1)
+    workers = 1;
+  struct ezypool *pool = calloc(1, sizeof *pool);
+  if (pool == NULL)
+    return NULL;
+  pool->workers = workers;
+  pool->deques = calloc((size_t)workers, sizeof *pool->deques);
+  if (pool->deques == NULL)
+  {
+    free(pool);
+    return NULL;
+  }
+#if !defined(_WIN32)
+  for (int i = 0; i < workers; i++)
+    pthread_mutex_init(&pool->deques[i].lock, NULL);
+  pthread_mutex_init(&pool->lock, NULL);
+  pthread_cond_init(&pool->wake, NULL);
+  atomic_init(&pool->pending, 0);
+  atomic_init(&pool->queued, 0);
+#endif
+  return pool;
+}
+
+void ezypool_destroy(struct ezypool *pool)
+{
+  if (pool == NULL)
+    return;
+  for (int i = 0; i < pool->workers; i++)
+  {
+    free(pool->deques[i].tasks);
+#if !defined(_WIN32)
+    pthread_mutex_destroy(&pool->deques[i].lock);
+#endif
+  }
+#if !defined(_WIN32)
+  pthread_mutex_destroy(&pool->lock);
+  pthread_cond_destroy(&pool->wake);
+#endif
+  free(pool->deques);
+  free(pool);
+}
+
+int ezypool_worker(void)
+{
+  return ezypool_self;
+}
+
+int ezypool_workers(const struct ezypool *pool)
+{
+  return pool->workers;
+}
+
+bool ezypool_submit(struct ezypool *pool, ezypool_fn fn, void *arg)
+{
+  size_t w = ezypool_current == pool ? (size_t)ezypool_self : pool->spread++ % (size_t)pool->workers;
+  pool->pending++; // before it is visible, so nobody sees the run as done
+  if (!ezypool_push(&pool->deques[w], (struct ezypool_task){fn, arg}))
+  {
+    pool->pending--;
+    ezy_log_error("failed to queue a task");
+    return false;
+  }
+  pool->queued++;
+#if !defined(_WIN32)
+  pthread_mutex_lock(&pool->lock);
+  pthread_cond_signal(&pool->wake);
+  pthread_mutex_unlock(&pool->lock);
+#endif
+  return true;
+}
+
+// own deque first, then the others from the next worker on
+static bool ezypool_take(struct ezypool *pool, int self, struct ezypool_task *task)
+{
+  if (ezypool_pop(&pool->deques[self], task))
+    return true;
+  for (int i = 1; i < pool->workers; i++)
+  {
+    if (ezypool_steal(&pool->deques[(self + i) % pool->workers], task))
+      return true;
+  }
+  return false;
+}
+
+static void ezypool_loop(struct ezypool *pool, int self)
+{
+  ezypool_current = pool;
+  ezypool_self = self;
+  while (true)
+  {
+    struct ezypool_task task;
+    if (ezypool_take(pool, self, &task))
+    {
+      pool->queued--;
+      task.fn(task.arg);
+      if (--pool->pending == 0)
+      {
+#if !defined(_WIN32)
+        pthread_mutex_lock(&pool->lock);
+        pthread_cond_broadcast(&pool->wake);
+        pthread_mutex_unlock(&pool->lock);
+#endif
+      }
+      continue;
+    }
+#if !defined(_WIN32)
+    // nothing to take: wait for a submit, or for the last task to finish
+    pthread_mutex_lock(&pool->lock);
+    while (pool->pending > 0 && pool->queued == 0)
+      pthread_cond_wait(&pool->wake, &pool->lock);
+    bool done = pool->pending == 0;
+    pthread_mutex_unlock(&pool->lock);
+    if (done)
+      break;
+#else
+    break;
+#endif
+  }
+  ezypool_current = NULL;
+  ezypool_self = -1;
+}
+
+#if !defined(_WIN32)
+struct ezypool_thread {
+  struct ezypool *pool;
+  int self;
+};
+
+static void *ezypool_thread_main(void *arg)
+{
+  struct ezypool_thread *t = arg;
+  ezypool_loop(t->pool, t->self);
+  return NULL;
+}
+#endif
+
+void ezypool_run(struct ezypool *pool)
+{
+#if !defined(_WIN32)
+  int extra = pool->workers - 1;
+  pthread_t *threads = extra > 0 ? malloc((size_t)extra * sizeof *threads) : NULL;
+  struct ezypool_thread *args = extra > 0 ? malloc((size_t)extra * sizeof *args) : NULL;
+  int started = 0;
+  if (threads != NULL && args != NULL)
+  {
+    for (; started < extra; started++)
+    {
+      args[started] = (struct ezypool_thread){pool, started + 1};
+      if (pthread_create(&threads[started], NULL, ezypool_thread_main, &args[started]) != 0)
+        break; // fewer workers, the deques of the missing ones are stolen from
+    }
+  }
+  ezypool_loop(pool, 0);
+  for (int i = 0; i < started; i++)
+    pthread_join(threads[i], NULL);
+  free(threads);
+  free(args);
+#else
+  ezypool_loop(pool, 0); // no threads on this platform, same result
+#endif
+}
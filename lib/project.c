@@ -0,0 +1,690 @@
+#include <ezy_project.h>
+#include <ezy_ast_walk.h>
+#include <ezy_lexer.h>
+#include <ezy_log.h>
+#include <ezy_parser.h>
+#include <ezy_parser_arena.h>
+#include <ezy_pool.h>
+#include <ezy_report.h>
+#include <ezy_sema.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if !defined(_WIN32)
+#include <stdatomic.h>
+#endif
+
+struct ezyproj_unit;
+
+struct ezyproj_module {
+  struct ezyproject *proj;
+  const char *path;
+  char *source; // the AST points into it
+  ezy_ast_node_t *root;
+  ezy_ast_node_t *last; // last top-level node
+  ezy_ast_node_t *end;  // node after `last` in the program
+  size_t tokens;
+  bool ok;
+
+  ezy_cstr_t *refs; // names used, from the parse
+  size_t ref_count;
+  size_t *deps; // modules declaring some of them
+  size_t dep_count;
+
+  // Tarjan's strongly connected components
+  size_t index;
+  size_t low;
+  bool on_stack;
+  size_t unit;
+
+  ezy_multistr_t *code;
+  ezy_multistr_t *code_tail;
+};
+
+// modules analysed together: a dependency cycle, usually just one
+struct ezyproj_unit {
+  struct ezyproject *proj;
+  size_t *members; // in command line order
+  size_t member_count;
+  ezy_ast_node_t *root; // the members' nodes, linked
+  ezy_ast_node_t *last;
+  size_t *deps; // units, analysed before this one
+  size_t dep_count;
+  size_t *users; // units waiting for this one
+  size_t user_count;
+#if !defined(_WIN32)
+  atomic_size_t waiting; // deps not analysed yet
+#else
+  size_t waiting;
+#endif
+  bool ok;
+};
+
+static bool ezyproj_append(void **items, size_t *count, size_t *cap, size_t size, const void *item)
+{
+  if (*count == *cap)
+  {
+    size_t n = *cap > 0 ? *cap * 2 : 8;
+    void *p = realloc(*items, n * size);
+    if (p == NULL)
+      return false;
+    *items = p;
+    *cap = n;
+  }
+  memcpy((char *)*items + *count * size, item, size);
+  (*count)++;
+  return true;
+}
+
+// ================ Manifest ================
+
+static char *ezyproj_read(const char *path)
+{
+  FILE *f = fopen(path, "rb");
+  if (f == NULL)
+    return NULL;
+  fseek(f, 0, SEEK_END);
+  long size = ftell(f);
+  rewind(f);
+  char *buffer = size >= 0 ? malloc((size_t)size + 1) : NULL;
+  if (buffer != NULL)
+    buffer[fread(buffer, 1, (size_t)size, f)] = '\0';
+  fclose(f);
+  return buffer;
+}
+
+bool ezyproject_manifest(const char *path, char ***paths, size_t *count)
+{
+  *paths = NULL;
+  *count = 0;
+  char *text = ezyproj_read(path);
+  if (text == NULL)
+  {
+    ezy_log_error("failed to read the manifest %s", path);
+    return false;
+  }
+  const char *slash = strrchr(path, '/');
+  size_t dir = slash != NULL ? (size_t)(slash - path) + 1 : 0;
+  size_t cap = 0;
+  bool ok = true;
+  for (char *line = text; ok && *line != '\0';)
+  {
+    char *eol = strchr(line, '\n');
+    char *next = eol != NULL ? eol + 1 : line + strlen(line);
+    while (line < next && (*line == ' ' || *line == '\t'))
+      line++;
+    char *stop = eol != NULL ? eol : next;
+    while (stop > line && (stop[-1] == '\r' || stop[-1] == ' ' || stop[-1] == '\t'))
+      stop--;
+    if (stop > line && *line != '#')
+    {
+      size_t len = (size_t)(stop - line);
+      size_t prefix = *line == '/' ? 0 : dir;
+      char *module = malloc(prefix + len + 1);
+      if (module != NULL)
+      {
+        memcpy(module, path, prefix);
+        memcpy(module + prefix, line, len);
+        module[prefix + len] = '\0';
+      }
+      ok = module != NULL && ezyproj_append((void **)paths, count, &cap, sizeof module, &module);
+      if (!ok)
+        free(module);
+    }
+    line = next;
+  }
+  free(text);
+  if (ok && *count == 0)
+  {
+    ezy_log_error("the manifest %s lists no modules", path);
+    ok = false;
+  }
+  if (!ok)
+  {
+    ezyproject_manifest_free(*paths, *count);
+    *paths = NULL;
+    *count = 0;
+  }
+  return ok;
+}
+
+void ezyproject_manifest_free(char **paths, size_t count)
+{
+  for (size_t i = 0; i < count; i++)
+    free(paths[i]);
+  free(paths);
+}
+
+// ================ Tasks ================
+// Every task allocates from the parser arena of the worker running it.
+
+static struct ezyparse_arena *ezyproj_enter(struct ezyproject *proj)
+{
+  return ezyparse_arena_use(proj->arenas[ezypool_worker()]);
+}
+
+struct ezyproj_refs {
+  ezy_cstr_t *names;
+  size_t count;
+  size_t cap;
+  bool ok;
+};
+
+static enum ezywalk_action ezyproj_ref_pre(struct ezywalk_t *w, ezy_ast_node_t *node)
+{
+  struct ezyproj_refs *refs = w->ctx;
+  const ezy_cstr_t *name = NULL;
+  if (node->type == ezy_ast_node_variable)
+    name = &node->data.n_variable.name;
+  else if (node->type == ezy_ast_node_call)
+    name = &node->data.n_call->func_name;
+  if (name != NULL)
+    refs->ok &= ezyproj_append((void **)&refs->names, &refs->count, &refs->cap, sizeof *name, name);
+  return ezywalk_continue;
+}
+
+// read, lex and parse one module, and note the names it uses
+static void ezyproj_parse_task(void *arg)
+{
+  struct ezyproj_module *m = arg;
+  m->source = ezyproj_read(m->path);
+  if (m->source == NULL)
+  {
+    ezy_log_error("failed to open input file: %s", m->path);
+    return;
+  }
+  struct ezyparse_arena *previous = ezyproj_enter(m->proj);
+  size_t tokens = ezylex_token_count();
+  m->root = ezyparse_parse(m->source);
+  m->tokens = ezylex_token_count() - tokens;
+  bool parsed = ezyparse_error_count() == 0;
+  for (ezy_ast_node_t *node = m->root; node != NULL; node = node->next)
+    m->last = node;
+
+  struct ezyproj_refs refs = {.ok = true};
+  struct ezywalk_t w = {.pre = ezyproj_ref_pre, .ctx = &refs};
+  for (ezy_ast_node_t *node = m->root; node != NULL; node = node->next)
+  {
+    if (node->type == ezy_ast_node_function)
+      ezywalk_list(&w, node->data.n_function->body);
+    else if (node->type == ezy_ast_node_variable_decl)
+      ezywalk_node(&w, node);
+  }
+  ezywalk_release(&w);
+  m->refs = refs.names;
+  m->ref_count = refs.count;
+  m->ok = parsed && refs.ok;
+  if (!parsed)
+    ezy_log_error("%s has errors, nothing was compiled", m->path);
+  else if (!refs.ok)
+    ezy_log_error("out of memory while reading %s", m->path);
+  ezyparse_arena_use(previous);
+}
+
+// analyse a unit once everything it uses is, then release its users
+static void ezyproj_sema_task(void *arg)
+{
+  struct ezyproj_unit *u = arg;
+  struct ezyproject *proj = u->proj;
+  struct ezyparse_arena *previous = ezyproj_enter(proj);
+  ezy_ast_node_t **imports = u->dep_count > 0 ? malloc(u->dep_count * sizeof *imports) : NULL;
+  u->ok = imports != NULL || u->dep_count == 0;
+  if (u->ok)
+  {
+    for (size_t i = 0; i < u->dep_count; i++)
+      imports[i] = proj->units[u->deps[i]].root;
+    u->ok = ezysema_resolve_module(u->root, imports, u->dep_count);
+    u->ok &= ezysema_infer_types(u->root);
+  }
+  else
+    ezy_log_error("out of memory while analysing %s", proj->modules[u->members[0]].path);
+  free(imports);
+  ezyparse_arena_use(previous);
+
+  for (size_t i = 0; i < u->user_count; i++)
+  {
+    struct ezyproj_unit *user = &proj->units[u->users[i]];
+    if (--user->waiting == 0)
+      ezypool_submit(proj->pool, ezyproj_sema_task, user);
+  }
+}
+
+static void ezyproj_transpile_task(void *arg)
+{
+  struct ezyproj_module *m = arg;
+  m->ok = ezytranspile_c_range(m->root, m->end, &m->code, &m->code_tail);
+}
+
+// ================ Module graph ================
+
+// top-level name -> index of the module declaring it, open addressing
+struct ezyproj_names {
+  ezy_cstr_t *keys;
+  size_t *modules;
+  size_t cap; // power of two
+};
+
+static uint64_t ezyproj_hash(ezy_cstr_t name)
+{
+  uint64_t h = 14695981039346656037ull; // FNV-1a
+  for (size_t i = 0; i < name.len; i++)
+    h = (h ^ (uint8_t)name.ptr[i]) * 1099511628211ull;
+  return h;
+}
+
+static size_t ezyproj_slot(const struct ezyproj_names *names, ezy_cstr_t name)
+{
+  size_t i = (size_t)ezyproj_hash(name) & (names->cap - 1);
+  while (names->keys[i].ptr != NULL &&
+         !(names->keys[i].len == name.len && memcmp(names->keys[i].ptr, name.ptr, name.len) == 0))
+    i = (i + 1) & (names->cap - 1);
+  return i;
+}
+
+static bool ezyproj_top_name(const ezy_ast_node_t *node, ezy_cstr_t *name)
+{
+  switch (node->type)
+  {
+  case ezy_ast_node_function:
+    *name = node->data.n_function->name;
+    return true;
+  case ezy_ast_node_variable_decl:
+    *name = node->data.n_variable.name;
+    return true;
+  case ezy_ast_node_struct:
+    *name = node->data.n_struct->name;
+    return true;
+  case ezy_ast_node_union:
+    *name = node->data.n_union->name;
+    return true;
+  default:
+    return false;
+  }
+}
+
+// every top-level name of the program, with the module declaring it; the
+// C of all modules shares one namespace, so a name is declared once
+static bool ezyproj_declare(struct ezyproject *proj, struct ezyproj_names *names)
+{
+  size_t total = 0;
+  for (size_t i = 0; i < proj->module_count; i++)
+  {
+    for (ezy_ast_node_t *node = proj->modules[i].root; node != NULL; node = node->next)
+      total++;
+  }
+  names->cap = 16;
+  while (names->cap < total * 2)
+    names->cap *= 2;
+  names->keys = calloc(names->cap, sizeof *names->keys);
+  names->modules = malloc(names->cap * sizeof *names->modules);
+  if (names->keys == NULL || names->modules == NULL)
+  {
+    ezy_log_error("out of memory while linking modules");
+    return false;
+  }
+
+  bool ok = true;
+  for (size_t i = 0; i < proj->module_count; i++)
+  {
+    for (ezy_ast_node_t *node = proj->modules[i].root; node != NULL; node = node->next)
+    {
+      ezy_cstr_t name;
+      if (!ezyproj_top_name(node, &name))
+        continue;
+      size_t slot = ezyproj_slot(names, name);
+      if (names->keys[slot].ptr == NULL)
+      {
+        names->keys[slot] = name;
+        names->modules[slot] = i;
+      }
+      else if (names->modules[slot] != i)
+      {
+        // duplicates inside a module are left to sema
+        ezy_log_error("'%.*s' is declared in both %s and %s", (int)name.len, name.ptr,
+                      proj->modules[names->modules[slot]].path, proj->modules[i].path);
+        ok = false;
+      }
+    }
+  }
+  return ok;
+}
+
+// module dependencies: the modules declaring the names each one uses
+static bool ezyproj_link(struct ezyproject *proj, const struct ezyproj_names *names)
+{
+  size_t *stamp = malloc(proj->module_count * sizeof *stamp);
+  if (stamp == NULL)
+    return false;
+  for (size_t i = 0; i < proj->module_count; i++)
+    stamp[i] = SIZE_MAX;
+
+  bool ok = true;
+  for (size_t i = 0; ok && i < proj->module_count; i++)
+  {
+    struct ezyproj_module *m = &proj->modules[i];
+    size_t cap = 0;
+    for (size_t r = 0; ok && r < m->ref_count; r++)
+    {
+      size_t slot = ezyproj_slot(names, m->refs[r]);
+      if (names->keys[slot].ptr == NULL)
+        continue; // a local, a builtin, or undeclared (sema reports it)
+      size_t dep = names->modules[slot];
+      if (dep == i || stamp[dep] == i)
+        continue;
+      stamp[dep] = i;
+      ok = ezyproj_append((void **)&m->deps, &m->dep_count, &cap, sizeof dep, &dep);
+    }
+  }
+  free(stamp);
+  return ok;
+}
+
+struct ezyproj_tarjan {
+  struct ezyproject *proj;
+  size_t *stack;
+  size_t depth;
+  size_t counter;
+  size_t unit_cap;
+  bool ok;
+};
+
+// explicit stack of (module, next dep) pairs, so long dependency chains do
+// not recurse
+struct ezyproj_visit {
+  size_t module;
+  size_t dep;
+};
+
+static void ezyproj_unit_close(struct ezyproj_tarjan *t, size_t root)
+{
+  struct ezyproject *proj = t->proj;
+  struct ezyproj_unit unit = {.proj = proj};
+  size_t cap = 0;
+  size_t member;
+  do
+  {
+    member = t->stack[--t->depth];
+    proj->modules[member].on_stack = false;
+    proj->modules[member].unit = proj->unit_count;
+    t->ok &= ezyproj_append((void **)&unit.members, &unit.member_count, &cap, sizeof member, &member);
+  } while (member != root);
+
+  // members in command line order, so a cycle's code order is stable
+  for (size_t i = 1; i < unit.member_count; i++)
+  {
+    size_t m = unit.members[i];
+    size_t j = i;
+    for (; j > 0 && unit.members[j - 1] > m; j--)
+      unit.members[j] = unit.members[j - 1];
+    unit.members[j] = m;
+  }
+  t->ok &= ezyproj_append((void **)&proj->units, &proj->unit_count, &t->unit_cap, sizeof unit, &unit);
+}
+
+// Tarjan's algorithm: units come out after the units they depend on
+static bool ezyproj_units(struct ezyproject *proj)
+{
+  struct ezyproj_tarjan t = {.proj = proj, .ok = true};
+  t.stack = malloc(proj->module_count * sizeof *t.stack);
+  struct ezyproj_visit *visits = malloc(proj->module_count * sizeof *visits);
+  if (t.stack == NULL || visits == NULL)
+  {
+    free(t.stack);
+    free(visits);
+    return false;
+  }
+  for (size_t i = 0; i < proj->module_count; i++)
+    proj->modules[i].index = SIZE_MAX;
+
+  for (size_t start = 0; t.ok && start < proj->module_count; start++)
+  {
+    if (proj->modules[start].index != SIZE_MAX)
+      continue;
+    size_t top = 0;
+    visits[top++] = (struct ezyproj_visit){start, 0};
+    proj->modules[start].index = proj->modules[start].low = t.counter++;
+    proj->modules[start].on_stack = true;
+    t.stack[t.depth++] = start;
+    while (top > 0)
+    {
+      struct ezyproj_visit *v = &visits[top - 1];
+      struct ezyproj_module *m = &proj->modules[v->module];
+      if (v->dep < m->dep_count)
+      {
+        size_t dep = m->deps[v->dep++];
+        struct ezyproj_module *d = &proj->modules[dep];
+        if (d->index == SIZE_MAX)
+        {
+          d->index = d->low = t.counter++;
+          d->on_stack = true;
+          t.stack[t.depth++] = dep;
+          visits[top++] = (struct ezyproj_visit){dep, 0};
+        }
+        else if (d->on_stack && d->index < m->low)
+          m->low = d->index;
+        continue;
+      }
+      if (m->low == m->index)
+        ezyproj_unit_close(&t, v->module);
+      top--;
+      if (top > 0 && m->low < proj->modules[visits[top - 1].module].low)
+        proj->modules[visits[top - 1].module].low = m->low;
+    }
+  }
+  free(t.stack);
+  free(visits);
+  return t.ok;
+}
+
+// link each unit's nodes, and the unit graph the analysis is scheduled on
+static bool ezyproj_unit_graph(struct ezyproject *proj)
+{
+  size_t *stamp = malloc(proj->unit_count * sizeof *stamp);
+  size_t *user_cap = calloc(proj->unit_count, sizeof *user_cap);
+  bool ok = stamp != NULL && user_cap != NULL;
+  for (size_t u = 0; ok && u < proj->unit_count; u++)
+    stamp[u] = SIZE_MAX;
+
+  for (size_t u = 0; ok && u < proj->unit_count; u++)
+  {
+    struct ezyproj_unit *unit = &proj->units[u];
+    size_t cap = 0;
+    for (size_t i = 0; i < unit->member_count; i++)
+    {
+      struct ezyproj_module *m = &proj->modules[unit->members[i]];
+      if (m->root == NULL)
+        continue;
+      if (unit->last != NULL)
+        unit->last->next = m->root;
+      else
+        unit->root = m->root;
+      unit->last = m->last;
+
+      for (size_t d = 0; ok && d < m->dep_count; d++)
+      {
+        size_t dep = proj->modules[m->deps[d]].unit;
+        if (dep == u || stamp[dep] == u)
+          continue;
+        stamp[dep] = u;
+        ok = ezyproj_append((void **)&unit->deps, &unit->dep_count, &cap, sizeof dep, &dep) &&
+             ezyproj_append((void **)&proj->units[dep].users, &proj->units[dep].user_count, &user_cap[dep],
+                            sizeof u, &u);
+      }
+    }
+    unit->waiting = unit->dep_count;
+  }
+  free(stamp);
+  free(user_cap);
+  return ok;
+}
+
+// ================ Project ================
+
+bool ezyproject_load(struct ezyproject *proj, const char *const *paths, size_t count, int jobs,
+                     struct ezyreport *report)
+{
+  memset(proj, 0, sizeof *proj);
+  if (jobs < 1)
+    jobs = 1;
+  if ((size_t)jobs > count)
+    jobs = (int)count; // a worker per module at most
+  proj->pool = ezypool_create(jobs);
+  proj->arenas = calloc((size_t)jobs, sizeof *proj->arenas);
+  proj->modules = calloc(count, sizeof *proj->modules);
+  bool ok = proj->pool != NULL && proj->arenas != NULL && proj->modules != NULL;
+  for (int i = 0; ok && i < jobs; i++)
+    ok = (proj->arenas[i] = ezyparse_arena_create()) != NULL;
+  if (!ok)
+  {
+    ezy_log_error("out of memory while loading the project");
+    return false;
+  }
+  proj->module_count = count;
+
+  for (size_t i = 0; i < count; i++)
+  {
+    proj->modules[i].proj = proj;
+    proj->modules[i].path = paths[i];
+    ok &= ezypool_submit(proj->pool, ezyproj_parse_task, &proj->modules[i]);
+  }
+  ezypool_run(proj->pool);
+  ezyreport_phase(report, "parse");
+  for (size_t i = 0; i < count; i++)
+    ok &= proj->modules[i].ok;
+  if (!ok)
+    return false;
+
+  struct ezyproj_names names = {0};
+  ok = ezyproj_declare(proj, &names) && ezyproj_link(proj, &names);
+  free(names.keys);
+  free(names.modules);
+  if (!ok)
+    return false;
+  if (!ezyproj_units(proj) || !ezyproj_unit_graph(proj))
+  {
+    ezy_log_error("out of memory while ordering modules");
+    return false;
+  }
+  ezyreport_phase(report, "link");
+
+  // a unit is analysed once its dependencies are: those with none start
+  for (size_t u = 0; u < proj->unit_count; u++)
+  {
+    if (proj->units[u].dep_count == 0)
+      ok &= ezypool_submit(proj->pool, ezyproj_sema_task, &proj->units[u]);
+  }
+  ezypool_run(proj->pool);
+  ezyreport_phase(report, "analysis");
+  for (size_t u = 0; u < proj->unit_count; u++)
+    ok &= proj->units[u].ok;
+
+  // program order is unit order, dependencies first
+  ezy_ast_node_t *last = NULL;
+  for (size_t u = 0; u < proj->unit_count; u++)
+  {
+    struct ezyproj_unit *unit = &proj->units[u];
+    if (unit->root == NULL)
+      continue;
+    if (last != NULL)
+      last->next = unit->root;
+    else
+      proj->program = unit->root;
+    last = unit->last;
+  }
+  for (size_t u = 0; u < proj->unit_count; u++)
+  {
+    const struct ezyproj_unit *unit = &proj->units[u];
+    for (size_t i = 0; i < unit->member_count; i++)
+    {
+      struct ezyproj_module *m = &proj->modules[unit->members[i]];
+      if (m->last != NULL)
+        m->end = m->last->next;
+    }
+  }
+
+  if (report != NULL && report->on)
+  {
+    report->modules += count;
+    for (size_t i = 0; i < count; i++)
+      report->tokens += proj->modules[i].tokens;
+    for (int i = 0; i < jobs; i++)
+      ezyreport_arena(report, proj->arenas[i]);
+  }
+  return ok;
+}
+
+ezy_multistr_t *ezyproject_transpile_c(struct ezyproject *proj, const struct ezytranspile_opts *opts)
+{
+  ezy_multistr_t *head = NULL;
+  ezy_multistr_t *tail = NULL;
+  if (!ezytranspile_c_prologue(proj->program, opts, &head, &tail))
+    return NULL;
+
+  bool ok = true;
+  for (size_t i = 0; i < proj->module_count; i++)
+  {
+    struct ezyproj_module *m = &proj->modules[i];
+    m->code = m->code_tail = NULL;
+    if (m->root != NULL)
+      ok &= ezypool_submit(proj->pool, ezyproj_transpile_task, m);
+  }
+  ezypool_run(proj->pool);
+
+  // splice in program order: unit by unit
+  for (size_t u = 0; u < proj->unit_count; u++)
+  {
+    const struct ezyproj_unit *unit = &proj->units[u];
+    for (size_t i = 0; i < unit->member_count; i++)
+    {
+      struct ezyproj_module *m = &proj->modules[unit->members[i]];
+      if (m->root == NULL)
+        continue;
+      ok &= m->ok;
+      if (m->code == NULL)
+        continue;
+      if (tail != NULL)
+        tail->next = m->code;
+      else
+        head = m->code;
+      tail = m->code_tail;
+      m->code = m->code_tail = NULL;
+    }
+  }
+  for (size_t i = 0; i < proj->module_count; i++)
+    ezytranspile_c_free(proj->modules[i].code); // left over when a task failed
+  if (!ok)
+  {
+    ezytranspile_c_free(head);
+    return NULL;
+  }
+  return head;
+}
+
+void ezyproject_free(struct ezyproject *proj)
+{
+  for (size_t i = 0; proj->modules != NULL && i < proj->module_count; i++)
+  {
+    free(proj->modules[i].source);
+    free(proj->modules[i].refs);
+    free(proj->modules[i].deps);
+  }
+  for (size_t u = 0; u < proj->unit_count; u++)
+  {
+    free(proj->units[u].members);
+    free(proj->units[u].deps);
+    free(proj->units[u].users);
+  }
+  int workers = proj->pool != NULL ? ezypool_workers(proj->pool) : 0;
+  for (int i = 0; proj->arenas != NULL && i < workers; i++)
+  {
+    if (proj->arenas[i] != NULL)
+      ezyparse_arena_destroy(proj->arenas[i]);
+  }
+  free(proj->arenas);
+  free(proj->modules);
+  free(proj->units);
+  ezypool_destroy(proj->pool);
+  memset(proj, 0, sizeof *proj);
+}
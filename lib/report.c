@@ -0,0 +1,123 @@
+#include <ezy_report.h>
+#include <ezy_ast_walk.h>
+#include <ezy_parser_arena.h>
+#include <string.h>
+#include <time.h>
+
+static double ezyreport_wall_ms(void)
+{
+  struct timespec ts;
+  timespec_get(&ts, TIME_UTC);
+  return (double)ts.tv_sec * 1e3 + (double)ts.tv_nsec / 1e6;
+}
+
+static double ezyreport_cpu_ms(void)
+{
+  return (double)clock() * 1e3 / CLOCKS_PER_SEC;
+}
+
+void ezyreport_start(struct ezyreport *r)
+{
+  r->wall_start = r->wall_mark = ezyreport_wall_ms();
+  r->cpu_start = r->cpu_mark = ezyreport_cpu_ms();
+}
+
+void ezyreport_mark(struct ezyreport *r, const char *name)
+{
+  double wall = ezyreport_wall_ms();
+  double cpu = ezyreport_cpu_ms();
+  struct ezyreport_phase *phase = NULL;
+  for (size_t i = 0; i < r->phase_count && phase == NULL; i++)
+  {
+    if (strcmp(r->phases[i].name, name) == 0)
+      phase = &r->phases[i];
+  }
+  if (phase == NULL && r->phase_count < ezyreport_max_phases)
+  {
+    phase = &r->phases[r->phase_count++];
+    *phase = (struct ezyreport_phase){.name = name};
+  }
+  if (phase != NULL)
+  {
+    phase->wall_ms += wall - r->wall_mark;
+    phase->cpu_ms += cpu - r->cpu_mark;
+  }
+  r->wall_mark = wall;
+  r->cpu_mark = cpu;
+}
+
+void ezyreport_arena(struct ezyreport *r, const struct ezyparse_arena *arena)
+{
+  size_t used, reserved, blocks;
+  ezyparse_arena_usage(arena, &used, &reserved, &blocks);
+  r->arena_bytes += used;
+  r->arena_reserved += reserved;
+  r->arena_blocks += blocks;
+}
+
+static enum ezywalk_action ezyreport_count_pre(struct ezywalk_t *w, ezy_ast_node_t *node)
+{
+  (void)node;
+  (*(size_t *)w->ctx)++;
+  return ezywalk_continue;
+}
+
+size_t ezyreport_count_nodes(ezy_ast_node_t *root)
+{
+  size_t count = 0;
+  struct ezywalk_t w = {.pre = ezyreport_count_pre, .ctx = &count};
+  ezywalk_list(&w, root);
+  ezywalk_release(&w);
+  return count;
+}
+
+size_t ezyreport_count_bytes(const ezy_multistr_t *chunks)
+{
+  size_t bytes = 0;
+  for (; chunks != NULL; chunks = chunks->next)
+    bytes += chunks->str.len;
+  return bytes;
+}
+
+// ================ Output ================
+
+static void ezyreport_table(const struct ezyreport *r, FILE *f)
+{
+  fprintf(f, "%-24s %12s %12s\n", "phase", "wall ms", "cpu ms");
+  for (size_t i = 0; i < r->phase_count; i++)
+    fprintf(f, "  %-22s %12.3f %12.3f\n", r->phases[i].name, r->phases[i].wall_ms, r->phases[i].cpu_ms);
+  fprintf(f, "  %-22s %12.3f %12.3f\n", "total", r->wall_mark - r->wall_start, r->cpu_mark - r->cpu_start);
+  fprintf(f, "%-24s %12zu\n", "modules", r->modules);
+  fprintf(f, "%-24s %12zu\n", "tokens", r->tokens);
+  fprintf(f, "%-24s %12zu\n", "ast nodes", r->nodes);
+  fprintf(f, "%-24s %12zu\n", "arena peak bytes", r->arena_bytes);
+  fprintf(f, "%-24s %12zu\n", "arena reserved bytes", r->arena_reserved);
+  fprintf(f, "%-24s %12zu\n", "arena blocks", r->arena_blocks);
+  fprintf(f, "%-24s %12zu\n", "output bytes", r->output_bytes);
+}
+
+// phase names are identifiers, nothing to escape
+static void ezyreport_json(const struct ezyreport *r, FILE *f)
+{
+  fprintf(f, "{\"phases\":[");
+  for (size_t i = 0; i < r->phase_count; i++)
+  {
+    fprintf(f, "%s{\"name\":\"%s\",\"wall_ms\":%.3f,\"cpu_ms\":%.3f}", i > 0 ? "," : "", r->phases[i].name,
+            r->phases[i].wall_ms, r->phases[i].cpu_ms);
+  }
+  fprintf(f, "],\"total\":{\"wall_ms\":%.3f,\"cpu_ms\":%.3f}", r->wall_mark - r->wall_start,
+          r->cpu_mark - r->cpu_start);
+  fprintf(f, ",\"modules\":%zu,\"tokens\":%zu,\"ast_nodes\":%zu", r->modules, r->tokens, r->nodes);
+  fprintf(f, ",\"arena\":{\"peak_bytes\":%zu,\"reserved_bytes\":%zu,\"blocks\":%zu}", r->arena_bytes,
+          r->arena_reserved, r->arena_blocks);
+  fprintf(f, ",\"output_bytes\":%zu}\n", r->output_bytes);
+}
+
+void ezyreport_print(const struct ezyreport *r, FILE *f)
+{
+  if (r->json)
+    ezyreport_json(r, f);
+  else
+    ezyreport_table(r, f);
+  fflush(f);
+}
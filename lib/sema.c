@@ -0,0 +1,1154 @@
+#include <ezy_sema.h>
+#include <ezy_ast_walk.h>
+#include <ezy_symtab.h>
+#include <ezy_vm.h>
+#include <ezy_log.h>
+#include <ezy_parser_arena.h>
+#include <string.h>
+
+// built-in functions visible from every scope
+static const char *ezysema_builtins[] = {
+    "print",
+    "push", // push(arr, value) appends to a dynamic array
+    "typeof",    // type id of a value, the tag of a var
+    "type_repr", // same, but char and uint8 share theirs
+};
+
+// errors reported on this thread so far: a pass fails when it adds any
+static _Thread_local size_t ezysema_errors = 0;
+
+#define ezysema_error(...) (ezysema_errors++, ezy_log_error(__VA_ARGS__))
+
+// ================ Name resolution ================
+
+struct ezysema_resolve_ctx {
+  struct ezysym_table *tab;
+  enum ezy_sym_kind decl_kind; // kind given to declarations found by the walk
+  bool ok;
+};
+
+static bool ezysema_declare_var(struct ezysym_table *tab, ezy_ast_node_t *node, enum ezy_sym_kind kind)
+{
+  struct ezy_ast_variable_t *var = &node->data.n_variable;
+  bool ok = true;
+
+  struct ezy_symbol_t *prev = ezysym_lookup(tab, var->name);
+  if (prev != NULL && prev->depth == tab->depth)
+  {
+    ezysema_error("Redeclaration of '%.*s' in the same scope", (int)var->name.len, var->name.ptr);
+    ok = false;
+  }
+
+  struct ezy_symbol_t *sym = ezysym_declare(tab, kind, var->name);
+  if (sym == NULL)
+  {
+    return false;
+  }
+  sym->typ = &var->typ;
+  sym->decl.variable = node;
+  var->sym = sym;
+  return ok;
+}
+
+static enum ezywalk_action ezysema_resolve_pre(struct ezywalk_t *w, ezy_ast_node_t *node)
+{
+  struct ezysema_resolve_ctx *ctx = w->ctx;
+
+  if (node->type == ezy_ast_node_variable)
+  {
+    struct ezy_ast_variable_t *var = &node->data.n_variable;
+    var->sym = ezysym_lookup(ctx->tab, var->name);
+    if (var->sym == NULL)
+    {
+      ezysema_error("Unresolved identifier '%.*s'", (int)var->name.len, var->name.ptr);
+      ctx->ok = false;
+    }
+  }
+  else if (node->type == ezy_ast_node_call)
+  {
+    struct ezy_ast_call_t *call = node->data.n_call;
+    call->sym = ezysym_lookup(ctx->tab, call->func_name);
+    if (call->sym == NULL)
+    {
+      // a C function (sqrt, pow, ...), the C compiler checks the others
+      if (ezyvm_extern_find(call->func_name) < 0)
+        ezy_log_warn("Unresolved function '%.*s'", (int)call->func_name.len, call->func_name.ptr);
+    }
+    else if (call->sym->kind != ezy_sym_function && call->sym->kind != ezy_sym_builtin)
+    {
+      ezysema_error("'%.*s' is not a function", (int)call->func_name.len, call->func_name.ptr);
+      call->sym = NULL;
+      ctx->ok = false;
+    }
+  }
+  return ezywalk_continue;
+}
+
+// declarations are added after their initializer has been walked:
+// `let x = x;` refers to an outer x
+static enum ezywalk_action ezysema_resolve_post(struct ezywalk_t *w, ezy_ast_node_t *node)
+{
+  struct ezysema_resolve_ctx *ctx = w->ctx;
+
+  if (node->type == ezy_ast_node_variable_decl)
+  {
+    ctx->ok &= ezysema_declare_var(ctx->tab, node, ctx->decl_kind);
+  }
+  return ezywalk_continue;
+}
+
+static bool ezysema_resolve_function(struct ezywalk_t *w, struct ezysym_table *tab, struct ezy_ast_function_t *fn)
+{
+  bool ok = true;
+  ezysym_push_scope(tab);
+
+  for (size_t i = 0; i < fn->param_count; i++)
+  {
+    struct ezy_ast_args_t *param = &fn->params[i];
+    struct ezy_symbol_t *prev = ezysym_lookup(tab, param->name);
+    if (prev != NULL && prev->depth == tab->depth)
+    {
+      ezysema_error("Duplicate parameter '%.*s' in function %.*s", (int)param->name.len, param->name.ptr, (int)fn->name.len, fn->name.ptr);
+      ok = false;
+    }
+    struct ezy_symbol_t *sym = ezysym_declare(tab, ezy_sym_param, param->name);
+    if (sym != NULL)
+    {
+      sym->typ = &param->typ;
+      sym->decl.param = param;
+    }
+  }
+
+  // params and body locals share a scope, like C
+  struct ezysema_resolve_ctx ctx = {.tab = tab, .decl_kind = ezy_sym_local, .ok = true};
+  w->ctx = &ctx;
+  ezywalk_list(w, fn->body);
+
+  ezysym_pop_scope(tab);
+  return ok && ctx.ok;
+}
+
+// the functions and globals of another module, without touching its
+// nodes: that module may be read by other threads
+static void ezysema_import(struct ezysym_table *tab, ezy_ast_node_t *root)
+{
+  for (ezy_ast_node_t *node = root; node != NULL; node = node->next)
+  {
+    struct ezy_symbol_t *sym;
+    if (node->type == ezy_ast_node_function)
+    {
+      struct ezy_ast_function_t *fn = node->data.n_function;
+      if ((sym = ezysym_declare(tab, ezy_sym_function, fn->name)) != NULL)
+      {
+        sym->typ = &fn->return_typ;
+        sym->decl.function = fn;
+      }
+    }
+    else if (node->type == ezy_ast_node_variable_decl)
+    {
+      struct ezy_ast_variable_t *var = &node->data.n_variable;
+      if ((sym = ezysym_declare(tab, ezy_sym_global, var->name)) != NULL)
+      {
+        sym->typ = &var->typ;
+        sym->decl.variable = node;
+      }
+    }
+  }
+}
+
+bool ezysema_resolve(ezy_ast_node_t *root)
+{
+  return ezysema_resolve_module(root, NULL, 0);
+}
+
+bool ezysema_resolve_module(ezy_ast_node_t *root, ezy_ast_node_t *const *imports, size_t import_count)
+{
+  struct ezysym_table tab;
+  bool ok = true;
+  ezysym_init(&tab);
+
+  // builtin scope
+  ezysym_push_scope(&tab);
+  for (size_t i = 0; i < sizeof(ezysema_builtins) / sizeof(ezysema_builtins[0]); i++)
+  {
+    ezy_cstr_t name = {.ptr = ezysema_builtins[i], .len = strlen(ezysema_builtins[i])};
+    ezysym_declare(&tab, ezy_sym_builtin, name);
+  }
+
+  // other modules, all of their declarations visible at once
+  if (import_count > 0)
+  {
+    ezysym_push_scope(&tab);
+    for (size_t i = 0; i < import_count; i++)
+      ezysema_import(&tab, imports[i]);
+  }
+
+  // global scope: functions are visible everywhere, so declare them up front
+  ezysym_push_scope(&tab);
+  for (ezy_ast_node_t *node = root; node != NULL; node = node->next)
+  {
+    if (node->type != ezy_ast_node_function)
+      continue;
+
+    struct ezy_ast_function_t *fn = node->data.n_function;
+    struct ezy_symbol_t *prev = ezysym_lookup(&tab, fn->name);
+    if (prev != NULL && prev->depth == tab.depth)
+    {
+      ezysema_error("Redefinition of function '%.*s'", (int)fn->name.len, fn->name.ptr);
+      ok = false;
+    }
+    struct ezy_symbol_t *sym = ezysym_declare(&tab, ezy_sym_function, fn->name);
+    if (sym != NULL)
+    {
+      sym->typ = &fn->return_typ;
+      sym->decl.function = fn;
+    }
+  }
+
+  // globals become visible in declaration order
+  struct ezywalk_t w = {.pre = ezysema_resolve_pre, .post = ezysema_resolve_post};
+  struct ezysema_resolve_ctx global_ctx = {.tab = &tab, .decl_kind = ezy_sym_global, .ok = true};
+  for (ezy_ast_node_t *node = root; node != NULL; node = node->next)
+  {
+    if (node->type == ezy_ast_node_variable_decl)
+    {
+      w.ctx = &global_ctx;
+      ezywalk_node(&w, node);
+    }
+    else if (node->type == ezy_ast_node_function)
+    {
+      ok &= ezysema_resolve_function(&w, &tab, node->data.n_function);
+    }
+  }
+  ok &= global_ctx.ok;
+
+  ezywalk_release(&w);
+  ezysym_free(&tab);
+  return ok;
+}
+
+// ================ Type inference ================
+
+enum ezysema_fn_state {
+  ezysema_fn_unvisited = 0,
+  ezysema_fn_visiting,
+  ezysema_fn_done,
+};
+
+struct ezysema_fn_ctx {
+  struct ezy_ast_function_t *fn;
+  bool has_returns;
+  bool has_bare_return;
+  struct ezy_ast_datatype_t ret; // unified type of returned values so far
+};
+
+static bool ezysema_infer_function(struct ezy_ast_function_t *fn);
+
+static inline struct ezy_ast_datatype_t ezysema_dt(enum ezy_ast_datatype_typ typ)
+{
+  return (struct ezy_ast_datatype_t){.typ = typ};
+}
+
+static inline bool ezysema_is_int(enum ezy_ast_datatype_typ typ)
+{
+  return typ >= ezy_ast_dt_int8 && typ <= ezy_ast_dt_uint64;
+}
+
+static inline bool ezysema_is_float(enum ezy_ast_datatype_typ typ)
+{
+  return typ == ezy_ast_dt_float32 || typ == ezy_ast_dt_float64;
+}
+
+static inline bool ezysema_is_numeric(enum ezy_ast_datatype_typ typ)
+{
+  return ezysema_is_int(typ) || ezysema_is_float(typ) || typ == ezy_ast_dt_char || typ == ezy_ast_dt_bool;
+}
+
+// integer rank: byte width, char/bool behave like uint8
+static inline int ezysema_int_width(enum ezy_ast_datatype_typ typ)
+{
+  switch (typ)
+  {
+  case ezy_ast_dt_int8:
+  case ezy_ast_dt_uint8:
+  case ezy_ast_dt_char:
+  case ezy_ast_dt_bool:
+    return 1;
+  case ezy_ast_dt_int16:
+  case ezy_ast_dt_uint16:
+    return 2;
+  case ezy_ast_dt_int32:
+  case ezy_ast_dt_uint32:
+    return 4;
+  default:
+    return 8;
+  }
+}
+
+static inline bool ezysema_is_signed(enum ezy_ast_datatype_typ typ)
+{
+  return typ == ezy_ast_dt_int8 || typ == ezy_ast_dt_int16 || typ == ezy_ast_dt_int32 || typ == ezy_ast_dt_int64;
+}
+
+// Usual arithmetic conversions (C rules): floats win, then the wider
+// integer, and unsigned wins ties. Everything narrower than int32 is
+// promoted to int32 first.
+static enum ezy_ast_datatype_typ ezysema_promote(enum ezy_ast_datatype_typ a, enum ezy_ast_datatype_typ b)
+{
+  if (a == ezy_ast_dt_unknown || b == ezy_ast_dt_unknown)
+    return ezy_ast_dt_unknown; // C decides
+  if (!ezysema_is_numeric(a) || !ezysema_is_numeric(b))
+    return ezy_ast_dt_var;
+
+  if (a == ezy_ast_dt_float64 || b == ezy_ast_dt_float64)
+    return ezy_ast_dt_float64;
+  if (a == ezy_ast_dt_float32 || b == ezy_ast_dt_float32)
+    return ezy_ast_dt_float32;
+
+  int wa = ezysema_int_width(a) < 4 ? 4 : ezysema_int_width(a);
+  int wb = ezysema_int_width(b) < 4 ? 4 : ezysema_int_width(b);
+  bool sa = ezysema_int_width(a) < 4 || ezysema_is_signed(a);
+  bool sb = ezysema_int_width(b) < 4 || ezysema_is_signed(b);
+
+  int width = wa > wb ? wa : wb;
+  bool is_signed;
+  if (sa == sb)
+    is_signed = sa;
+  else
+    is_signed = sa ? wa > wb : wb > wa;
+
+  if (width == 8)
+    return is_signed ? ezy_ast_dt_int64 : ezy_ast_dt_uint64;
+  return is_signed ? ezy_ast_dt_int32 : ezy_ast_dt_uint32;
+}
+
+// unify two returned types into one function return type
+static struct ezy_ast_datatype_t ezysema_unify(struct ezy_ast_datatype_t a, struct ezy_ast_datatype_t b)
+{
+  // null and T make T?
+  if (a.typ == ezy_ast_dt_null && b.typ != ezy_ast_dt_null)
+  {
+    b.nullable = true;
+    return b;
+  }
+  if (b.typ == ezy_ast_dt_null && a.typ != ezy_ast_dt_null)
+  {
+    a.nullable = true;
+    return a;
+  }
+  bool nullable = a.nullable || b.nullable;
+  if (a.typ == ezy_ast_dt_union && b.typ == ezy_ast_dt_union && a.ext.union_t != b.ext.union_t)
+    return ezysema_dt(ezy_ast_dt_var);
+  if (a.typ == ezy_ast_dt_struct && b.typ == ezy_ast_dt_struct && a.ext.struct_t != b.ext.struct_t)
+    return ezysema_dt(ezy_ast_dt_var);
+  if (a.typ == b.typ || b.typ == ezy_ast_dt_unknown)
+  {
+    a.nullable = nullable;
+    return a;
+  }
+  if (a.typ == ezy_ast_dt_unknown)
+    return b;
+  if (ezysema_is_numeric(a.typ) && ezysema_is_numeric(b.typ))
+  {
+    struct ezy_ast_datatype_t dt = ezysema_dt(ezysema_promote(a.typ, b.typ));
+    dt.nullable = nullable;
+    return dt;
+  }
+  // different types would need an anonymous union, `var` holds them all
+  return ezysema_dt(ezy_ast_dt_var);
+}
+
+static struct ezy_ast_datatype_t ezysema_call_typ(struct ezy_ast_call_t *call)
+{
+  if (call->sym == NULL)
+  {
+    // the C functions every backend can call have their C type, other
+    // external ones are left to the C compiler
+    int ext = ezyvm_extern_find(call->func_name);
+    if (ext < 0)
+      return ezysema_dt(ezy_ast_dt_unknown);
+    switch (ezyvm_extern_get(ext)->sig)
+    {
+    case ezyvm_sig_i_i:
+      return ezysema_dt(ezy_ast_dt_int32);
+    case ezyvm_sig_l_l:
+      return ezysema_dt(ezy_ast_dt_int64);
+    default:
+      return ezysema_dt(ezy_ast_dt_float64);
+    }
+  }
+  if (call->sym->kind == ezy_sym_builtin)
+  {
+    // type ids are small integers, compared with == and !=
+    bool is_type_id = (call->func_name.len == 6 && memcmp(call->func_name.ptr, "typeof", 6) == 0) ||
+                      (call->func_name.len == 9 && memcmp(call->func_name.ptr, "type_repr", 9) == 0);
+    return ezysema_dt(is_type_id ? ezy_ast_dt_uint8 : ezy_ast_dt_void);
+  }
+
+  struct ezy_ast_function_t *fn = call->sym->decl.function;
+  if (fn->return_typ.typ == ezy_ast_dt_infer && !ezysema_infer_function(fn))
+    return ezysema_dt(ezy_ast_dt_unknown); // recursive call while the callee's type is still being inferred
+  struct ezy_ast_datatype_t dt = fn->return_typ;
+  dt.is_const = false;
+  return dt;
+}
+
+// [a, b, c] is a fixed array of the unified element type
+static struct ezy_ast_datatype_t ezysema_array_lit_typ(struct ezy_ast_array_lit_t *lit)
+{
+  struct ezy_ast_array_t *arr = ezyparse_arena_alloc(sizeof(struct ezy_ast_array_t));
+  arr->dynamic = false;
+  arr->length = lit->count;
+  arr->max_length = 0;
+  arr->inline_cap = 0;
+  arr->typ = ezysema_dt(lit->count > 0 ? ezy_ast_dt_infer : ezy_ast_dt_var);
+  for (size_t i = 0; i < lit->count; i++)
+  {
+    struct ezy_ast_datatype_t elem = lit->elements[i].eval_typ;
+    elem.is_const = false;
+    arr->typ = i == 0 ? elem : ezysema_unify(arr->typ, elem);
+  }
+  return (struct ezy_ast_datatype_t){.typ = ezy_ast_dt_array, .ext.array_t = arr};
+}
+
+// Complete a declared array type from its initializer: `let x[] = [1, 2]`
+// takes the element type, and a dynamic array without a guide length
+// starts with room for the initial elements.
+static void ezysema_array_decl(struct ezy_ast_variable_t *var)
+{
+  struct ezy_ast_array_t *arr = var->typ.ext.array_t;
+  ezy_ast_node_t *value = var->value;
+  if (value == NULL || value->eval_typ.typ != ezy_ast_dt_array)
+  {
+    if (value != NULL && !(value->eval_typ.typ == ezy_ast_dt_null && var->typ.nullable))
+      ezy_log_warn("Array '%.*s' initialized with a non-array value", (int)var->name.len, var->name.ptr);
+    if (arr->typ.typ == ezy_ast_dt_infer)
+      arr->typ = ezysema_dt(ezy_ast_dt_var); // `let x[];` holds anything
+    return;
+  }
+
+  struct ezy_ast_array_t *init = value->eval_typ.ext.array_t;
+  if (arr->typ.typ == ezy_ast_dt_infer)
+    arr->typ = init->typ;
+
+  if (arr->dynamic)
+  {
+    if (arr->length == 0)
+      arr->length = init->length;
+    if (arr->max_length != 0 && init->length > arr->max_length)
+    {
+      ezysema_error("Array '%.*s' is initialized with %zu elements but holds at most %zu", (int)var->name.len, var->name.ptr,
+                    init->length, arr->max_length);
+    }
+  }
+  else if (init->length > arr->length)
+  {
+    ezysema_error("Array '%.*s' is initialized with %zu elements but has length %zu", (int)var->name.len, var->name.ptr,
+                  init->length, arr->length);
+  }
+}
+
+static bool ezysema_union_has_null(const struct ezy_ast_union_t *u)
+{
+  for (size_t i = 0; i < u->count; i++)
+  {
+    if (u->mem_typlist[i].typ == ezy_ast_dt_null)
+      return true;
+  }
+  return false;
+}
+
+// ================ Structs ================
+
+// index of field `name`, s->count if there is none
+static size_t ezysema_struct_field(const struct ezy_ast_struct_t *s, ezy_cstr_t name)
+{
+  for (size_t i = 0; i < s->count; i++)
+  {
+    if (s->members[i].name.len == name.len && memcmp(s->members[i].name.ptr, name.ptr, name.len) == 0)
+      return i;
+  }
+  return s->count;
+}
+
+// a field a struct literal may leave out: optional fields start null,
+// arrays start empty, a struct if all of its fields may be left out
+static bool ezysema_field_optional(const struct ezy_ast_datatype_t *dt)
+{
+  if (dt->typ == ezy_ast_dt_struct)
+  {
+    for (size_t i = 0; i < dt->ext.struct_t->count; i++)
+    {
+      if (!ezysema_field_optional(&dt->ext.struct_t->members[i].typ))
+        return false;
+    }
+    return true;
+  }
+  return dt->nullable || dt->typ == ezy_ast_dt_array || (dt->typ == ezy_ast_dt_union && ezysema_union_has_null(dt->ext.union_t));
+}
+
+// type of the field a struct literal element sets, infer if not known
+static struct ezy_ast_datatype_t ezysema_field_hint(ezy_ast_node_t *lit, ezy_ast_node_t *elem)
+{
+  if (lit->eval_typ.typ != ezy_ast_dt_struct || lit->data.n_struct_lit.fields == NULL)
+    return ezysema_dt(ezy_ast_dt_infer);
+  size_t i = (size_t)(elem - lit->data.n_struct_lit.elements);
+  return lit->eval_typ.ext.struct_t->members[lit->data.n_struct_lit.fields[i]].typ;
+}
+
+// A struct literal takes its type from where it is stored: a declaration,
+// a field, an array element, the left side of `=`, a return or a
+// parameter.
+static struct ezy_ast_datatype_t ezysema_struct_lit_typ(struct ezywalk_t *w, ezy_ast_node_t *node)
+{
+  struct ezysema_fn_ctx *ctx = w->ctx;
+  ezy_ast_node_t *parent = w->parent;
+  struct ezy_ast_datatype_t dt = ezysema_dt(ezy_ast_dt_infer);
+  if (parent == NULL)
+    return dt;
+  switch (parent->type)
+  {
+  case ezy_ast_node_variable_decl:
+    dt = parent->data.n_variable.typ;
+    break;
+  case ezy_ast_node_struct_lit:
+    dt = ezysema_field_hint(parent, node);
+    break;
+  case ezy_ast_node_array_lit:
+    if (parent->eval_typ.typ == ezy_ast_dt_array)
+      dt = parent->eval_typ.ext.array_t->typ;
+    break;
+  case ezy_ast_node_binop:
+    if (parent->data.n_binop.operator == ezy_op_assign && parent->data.n_binop.right == node && parent->data.n_binop.left != NULL)
+      dt = parent->data.n_binop.left->eval_typ;
+    break;
+  case ezy_ast_node_return:
+    if (ctx->fn != NULL)
+      dt = ctx->fn->return_typ;
+    break;
+  case ezy_ast_node_call:
+  {
+    struct ezy_ast_call_t *call = parent->data.n_call;
+    size_t i = (size_t)(node - call->args);
+    if (call->sym != NULL && call->sym->kind == ezy_sym_function && i < call->sym->decl.function->param_count)
+      dt = call->sym->decl.function->params[i].typ;
+    break;
+  }
+  default:
+    break;
+  }
+  dt.is_const = false;
+  return dt;
+}
+
+// Match the elements of a typed struct literal to fields: positional ones
+// in declaration order, named ones by name. Every field is set at most
+// once and every required field is set.
+static bool ezysema_struct_lit(ezy_ast_node_t *node)
+{
+  struct ezy_ast_struct_lit_t *lit = &node->data.n_struct_lit;
+  const struct ezy_ast_struct_t *s = node->eval_typ.ext.struct_t;
+  size_t *fields = ezyparse_arena_alloc(sizeof(size_t) * (lit->count > 0 ? lit->count : 1));
+  bool *set = ezyparse_arena_alloc(sizeof(bool) * s->count);
+  memset(set, 0, sizeof(bool) * s->count);
+  bool ok = true;
+
+  for (size_t i = 0; i < lit->count; i++)
+  {
+    ezy_cstr_t name = lit->names[i];
+    size_t f = name.len > 0 ? ezysema_struct_field(s, name) : i;
+    if (f >= s->count)
+    {
+      if (name.len > 0)
+        ezysema_error("Struct %.*s has no field '%.*s'", (int)s->name.len, s->name.ptr, (int)name.len, name.ptr);
+      else
+        ezysema_error("Struct %.*s has %zu fields, the literal has more values", (int)s->name.len, s->name.ptr, s->count);
+      ok = false;
+      continue;
+    }
+    if (set[f])
+    {
+      ezysema_error("Field '%.*s' of struct %.*s is set twice", (int)s->members[f].name.len, s->members[f].name.ptr,
+                    (int)s->name.len, s->name.ptr);
+      ok = false;
+    }
+    set[f] = true;
+    fields[i] = f;
+  }
+  for (size_t f = 0; f < s->count && ok; f++)
+  {
+    if (!set[f] && !ezysema_field_optional(&s->members[f].typ))
+    {
+      ezysema_error("Struct literal leaves out required field '%.*s' of %.*s", (int)s->members[f].name.len,
+                    s->members[f].name.ptr, (int)s->name.len, s->name.ptr);
+      ok = false;
+    }
+  }
+  lit->fields = ok ? fields : NULL;
+  return ok;
+}
+
+static struct ezy_ast_datatype_t ezysema_binop_typ(ezy_ast_node_t *node, struct ezy_ast_datatype_t hint)
+{
+  struct ezy_ast_binop_t *binop = &node->data.n_binop;
+  struct ezy_ast_datatype_t l = binop->left ? binop->left->eval_typ : ezysema_dt(ezy_ast_dt_var);
+  struct ezy_ast_datatype_t r = binop->right ? binop->right->eval_typ : ezysema_dt(ezy_ast_dt_var);
+
+  switch (binop->operator)
+  {
+  case ezy_op_assign:
+    return l;
+  case ezy_op_cond_eq:
+  case ezy_op_cond_neq:
+    return ezysema_dt(ezy_ast_dt_bool);
+  case ezy_op_divide:
+    // `let x = 10 / 3` is floating division, `let int x = 10 / 3` is not
+    if (ezysema_is_int(l.typ) && ezysema_is_int(r.typ) && !ezysema_is_int(hint.typ))
+      return ezysema_dt(ezy_ast_dt_float64);
+    return ezysema_dt(ezysema_promote(l.typ, r.typ));
+  case ezy_op_plus:
+    // string + string concatenates, string? operands are unwrapped
+    if (l.typ == ezy_ast_dt_string && r.typ == ezy_ast_dt_string)
+      return ezysema_dt(ezy_ast_dt_string);
+    return ezysema_dt(ezysema_promote(l.typ, r.typ));
+  default:
+    return ezysema_dt(ezysema_promote(l.typ, r.typ));
+  }
+}
+
+// The hint is the type the surrounding declaration expects, it decides
+// between integer and floating division (see Architecture.md). A binop
+// keeps its hint in eval_typ until its post hook replaces it. A struct
+// literal is typed before its elements, which are hinted by their fields.
+static enum ezywalk_action ezysema_infer_pre(struct ezywalk_t *w, ezy_ast_node_t *node)
+{
+  struct ezysema_fn_ctx *ctx = w->ctx;
+  if (node->type == ezy_ast_node_struct_lit)
+  {
+    node->eval_typ = ezysema_struct_lit_typ(w, node);
+    if (node->eval_typ.typ != ezy_ast_dt_struct || node->eval_typ.nullable)
+    {
+      ezysema_error("A struct literal needs a declared struct type to initialize");
+      node->eval_typ = ezysema_dt(ezy_ast_dt_var);
+    }
+    else if (!ezysema_struct_lit(node))
+    {
+      node->eval_typ = ezysema_dt(ezy_ast_dt_var);
+    }
+    return ezywalk_continue;
+  }
+  if (node->type == ezy_ast_node_array_lit)
+  {
+    // hinted like a binop, the declared element type types struct literals
+    ezy_ast_node_t *parent = w->parent;
+    node->eval_typ = ezysema_dt(ezy_ast_dt_infer);
+    if (parent != NULL && parent->type == ezy_ast_node_variable_decl && parent->data.n_variable.typ.typ == ezy_ast_dt_array)
+      node->eval_typ = parent->data.n_variable.typ;
+    else if (parent != NULL && parent->type == ezy_ast_node_array_lit && parent->eval_typ.typ == ezy_ast_dt_array)
+      node->eval_typ = parent->eval_typ.ext.array_t->typ;
+    else if (parent != NULL && parent->type == ezy_ast_node_struct_lit)
+      node->eval_typ = ezysema_field_hint(parent, node);
+    if (node->eval_typ.typ != ezy_ast_dt_array)
+      node->eval_typ = ezysema_dt(ezy_ast_dt_infer);
+    return ezywalk_continue;
+  }
+  if (node->type != ezy_ast_node_binop)
+    return ezywalk_continue;
+
+  struct ezy_ast_datatype_t hint = ezysema_dt(ezy_ast_dt_infer);
+  ezy_ast_node_t *parent = w->parent;
+  if (parent != NULL)
+  {
+    if (parent->type == ezy_ast_node_variable_decl)
+      hint = parent->data.n_variable.typ;
+    else if (parent->type == ezy_ast_node_binop)
+      hint = parent->eval_typ;
+    else if (parent->type == ezy_ast_node_return && ctx->fn != NULL)
+      hint = ctx->fn->return_typ;
+    else if (parent->type == ezy_ast_node_struct_lit)
+      hint = ezysema_field_hint(parent, node);
+  }
+  node->eval_typ = hint;
+  return ezywalk_continue;
+}
+
+static enum ezywalk_action ezysema_infer_post(struct ezywalk_t *w, ezy_ast_node_t *node)
+{
+  struct ezysema_fn_ctx *ctx = w->ctx;
+
+  switch (node->type)
+  {
+  case ezy_ast_node_literal:
+    node->eval_typ = ezysema_dt(node->data.n_literal.typ);
+    break;
+
+  case ezy_ast_node_variable:
+  {
+    // an unresolved name has failed ezysema_resolve already, var only
+    // keeps the walk going
+    struct ezy_symbol_t *sym = node->data.n_variable.sym;
+    node->eval_typ = ezysema_dt(ezy_ast_dt_var);
+    if (sym != NULL && sym->typ != NULL && sym->kind != ezy_sym_function && sym->typ->typ != ezy_ast_dt_infer)
+    {
+      node->eval_typ = *sym->typ;
+      node->eval_typ.is_const = false;
+    }
+    break;
+  }
+
+  case ezy_ast_node_call:
+    node->eval_typ = ezysema_call_typ(node->data.n_call);
+    break;
+
+  case ezy_ast_node_datatype:
+    node->eval_typ = node->data.n_datatype; // only meaningful to typeof
+    break;
+
+  case ezy_ast_node_binop:
+    node->eval_typ = ezysema_binop_typ(node, node->eval_typ);
+    break;
+
+  case ezy_ast_node_array_lit:
+    node->eval_typ = ezysema_array_lit_typ(&node->data.n_array_lit);
+    break;
+
+  case ezy_ast_node_struct_lit:
+    break; // typed by ezysema_infer_pre
+
+  case ezy_ast_node_index:
+  {
+    struct ezy_ast_datatype_t base = node->data.n_index.base->eval_typ;
+    node->eval_typ = ezysema_dt(ezy_ast_dt_var);
+    if (base.typ == ezy_ast_dt_array)
+      node->eval_typ = base.ext.array_t->typ;
+    else
+      ezy_log_warn("Indexing a value of type %d, which is not an array", base.typ);
+    break;
+  }
+
+  case ezy_ast_node_member:
+  {
+    struct ezy_ast_member_t *member = &node->data.n_member;
+    node->eval_typ = ezysema_dt(ezy_ast_dt_var);
+    struct ezy_ast_datatype_t *obj = &member->object->eval_typ;
+    if (obj->typ == ezy_ast_dt_array && member->name.len == 6 && memcmp(member->name.ptr, "length", 6) == 0)
+    {
+      node->eval_typ = ezysema_dt(ezy_ast_dt_int64);
+    }
+    else if (obj->typ == ezy_ast_dt_struct && ezysema_struct_field(obj->ext.struct_t, member->name) < obj->ext.struct_t->count)
+    {
+      node->eval_typ = obj->ext.struct_t->members[ezysema_struct_field(obj->ext.struct_t, member->name)].typ;
+      node->eval_typ.is_const = false;
+    }
+    else
+      ezy_log_warn("Unknown member '%.*s'", (int)member->name.len, member->name.ptr);
+    break;
+  }
+
+  case ezy_ast_node_variable_decl:
+  {
+    struct ezy_ast_variable_t *var = &node->data.n_variable;
+    if (var->typ.typ == ezy_ast_dt_infer)
+    {
+      // `let z;` and `let z = null;` hold anything
+      var->typ.typ = var->value != NULL ? var->value->eval_typ.typ : ezy_ast_dt_var;
+      if (var->typ.typ == ezy_ast_dt_null)
+        var->typ.typ = ezy_ast_dt_var;
+      if (var->value != NULL)
+      {
+        var->typ.ext = var->value->eval_typ.ext; // `let x = [1, 2]` is an int[2]
+        var->typ.nullable = var->value->eval_typ.nullable;
+      }
+      if (var->typ.typ == ezy_ast_dt_unknown)
+      {
+        // what a C function returns is not known, print takes it as a double too
+        ezy_log_warn("Type of '%.*s' is the result of a C function, declare it; float64 is assumed",
+                     (int)var->name.len, var->name.ptr);
+        var->typ = ezysema_dt(ezy_ast_dt_float64);
+      }
+    }
+    else if (var->typ.typ == ezy_ast_dt_array)
+    {
+      ezysema_array_decl(var);
+    }
+    else if (var->typ.typ == ezy_ast_dt_union && var->value == NULL && !var->typ.nullable && !ezysema_union_has_null(var->typ.ext.union_t))
+    {
+      struct ezy_ast_union_t *u = var->typ.ext.union_t;
+      ezysema_error("Union '%.*s' must be initialized, %.*s cannot hold null", (int)var->name.len, var->name.ptr,
+                    (int)u->name.len, u->name.ptr);
+    }
+    node->eval_typ = var->typ;
+    break;
+  }
+
+  case ezy_ast_node_return:
+  {
+    ezy_ast_node_t *value = node->data.n_return.value;
+    if (value == NULL)
+    {
+      ctx->has_bare_return = true;
+      node->eval_typ = ezysema_dt(ezy_ast_dt_void);
+      break;
+    }
+    ctx->ret = ctx->has_returns ? ezysema_unify(ctx->ret, value->eval_typ) : value->eval_typ;
+    ctx->has_returns = true;
+    node->eval_typ = value->eval_typ;
+    break;
+  }
+
+  default:
+    node->eval_typ = ezysema_dt(ezy_ast_dt_var);
+    break;
+  }
+  return ezywalk_continue;
+}
+
+// returns false if the function is already being inferred (recursion)
+static bool ezysema_infer_function(struct ezy_ast_function_t *fn)
+{
+  if (fn->sema_state == ezysema_fn_done)
+    return true;
+  if (fn->sema_state == ezysema_fn_visiting)
+    return fn->return_typ.typ != ezy_ast_dt_infer;
+
+  fn->sema_state = ezysema_fn_visiting;
+  struct ezysema_fn_ctx ctx = {.fn = fn};
+  struct ezywalk_t w = {.pre = ezysema_infer_pre, .post = ezysema_infer_post, .ctx = &ctx};
+  ezywalk_list(&w, fn->body);
+  ezywalk_release(&w);
+
+  if (fn->return_typ.typ == ezy_ast_dt_infer)
+  {
+    // void if nothing is returned, a value return mixed with bare
+    // returns makes the result optional
+    if (!ctx.has_returns)
+    {
+      fn->return_typ = ezysema_dt(ezy_ast_dt_void);
+    }
+    else
+    {
+      fn->return_typ = ctx.ret;
+      fn->return_typ.nullable |= ctx.has_bare_return;
+      if (fn->return_typ.typ == ezy_ast_dt_null)
+        fn->return_typ.typ = ezy_ast_dt_var; // only ever returns null
+    }
+  }
+
+  fn->sema_state = ezysema_fn_done;
+  return true;
+}
+
+// ================ Regions ================
+// A @region function allocates everything from the thread's region and
+// releases it when it returns (ezyrt_region.h), so no value holding heap
+// memory may outlive the call: it must not return one, and neither it
+// nor anything it calls may store one into a global or into one of its
+// parameters (pushing grows the array in place). Function escapes are
+// computed for every function up to a fixed point over the call graph.
+
+// a value of this type may point to heap memory
+static bool ezysema_owns_heap(const struct ezy_ast_datatype_t *dt)
+{
+  switch (dt->typ)
+  {
+  case ezy_ast_dt_string:
+  case ezy_ast_dt_var:
+    return true;
+  case ezy_ast_dt_array:
+    return dt->ext.array_t->dynamic || ezysema_owns_heap(&dt->ext.array_t->typ);
+  case ezy_ast_dt_union:
+    for (size_t i = 0; i < dt->ext.union_t->count; i++)
+    {
+      if (ezysema_owns_heap(&dt->ext.union_t->mem_typlist[i]))
+        return true;
+    }
+    return false;
+  case ezy_ast_dt_struct:
+    for (size_t i = 0; i < dt->ext.struct_t->count; i++)
+    {
+      if (ezysema_owns_heap(&dt->ext.struct_t->members[i].typ))
+        return true;
+    }
+    return false;
+  default:
+    return false;
+  }
+}
+
+// escape bit for storing into `target`: by the kind of the variable the
+// element or field is part of
+static unsigned ezysema_store_escape(ezy_ast_node_t *target)
+{
+  while (target != NULL && (target->type == ezy_ast_node_index || target->type == ezy_ast_node_member))
+    target = target->type == ezy_ast_node_index ? target->data.n_index.base : target->data.n_member.object;
+  if (target == NULL || target->type != ezy_ast_node_variable || target->data.n_variable.sym == NULL)
+    return 0;
+  switch (target->data.n_variable.sym->kind)
+  {
+  case ezy_sym_global:
+    return ezysema_escape_global;
+  case ezy_sym_param:
+    return ezysema_escape_param;
+  default:
+    return 0;
+  }
+}
+
+static enum ezywalk_action ezysema_escape_pre(struct ezywalk_t *w, ezy_ast_node_t *node)
+{
+  unsigned *escapes = w->ctx;
+  if (node->type == ezy_ast_node_binop && node->data.n_binop.operator == ezy_op_assign && node->data.n_binop.left != NULL &&
+      ezysema_owns_heap(&node->data.n_binop.left->eval_typ))
+  {
+    *escapes |= ezysema_store_escape(node->data.n_binop.left);
+    return ezywalk_continue;
+  }
+  if (node->type != ezy_ast_node_call)
+    return ezywalk_continue;
+  struct ezy_ast_call_t *call = node->data.n_call;
+  if (call->sym != NULL && call->sym->kind == ezy_sym_builtin && call->arg_count > 0 && call->func_name.len == 4 &&
+      memcmp(call->func_name.ptr, "push", 4) == 0)
+  {
+    *escapes |= ezysema_store_escape(&call->args[0]);
+    return ezywalk_continue;
+  }
+  if (call->sym != NULL && call->sym->kind != ezy_sym_function)
+    return ezywalk_continue; // print and the type ids only read
+  struct ezy_ast_function_t *callee = call->sym != NULL ? call->sym->decl.function : NULL;
+  if (callee == NULL || callee->body == NULL)
+  {
+    // C may keep whatever it is handed
+    for (size_t i = 0; i < call->arg_count; i++)
+    {
+      if (ezysema_owns_heap(&call->args[i].eval_typ))
+        *escapes |= ezysema_escape_extern;
+    }
+    return ezywalk_continue;
+  }
+  // the callee's escapes, its parameters become our arguments' roots
+  *escapes |= callee->escapes & (ezysema_escape_global | ezysema_escape_extern);
+  if (callee->escapes & ezysema_escape_param)
+  {
+    for (size_t i = 0; i < call->arg_count; i++)
+    {
+      if (ezysema_owns_heap(&call->args[i].eval_typ))
+        *escapes |= ezysema_store_escape(&call->args[i]);
+    }
+  }
+  return ezywalk_continue;
+}
+
+static void ezysema_check_regions(ezy_ast_node_t *root)
+{
+  struct ezywalk_t w = {.pre = ezysema_escape_pre};
+  for (bool changed = true; changed;)
+  {
+    changed = false;
+    for (ezy_ast_node_t *node = root; node != NULL; node = node->next)
+    {
+      if (node->type != ezy_ast_node_function)
+        continue;
+      struct ezy_ast_function_t *fn = node->data.n_function;
+      unsigned escapes = fn->escapes;
+      w.ctx = &escapes;
+      ezywalk_list(&w, fn->body);
+      changed |= escapes != fn->escapes;
+      fn->escapes = escapes;
+    }
+  }
+  ezywalk_release(&w);
+
+  for (ezy_ast_node_t *node = root; node != NULL; node = node->next)
+  {
+    if (node->type != ezy_ast_node_function || !node->data.n_function->region)
+      continue;
+    struct ezy_ast_function_t *fn = node->data.n_function;
+    if (ezysema_owns_heap(&fn->return_typ))
+      ezysema_error("@region function '%.*s' cannot return a string, array or var, it would be released on return",
+                    (int)fn->name.len, fn->name.ptr);
+    if (fn->escapes & ezysema_escape_global)
+      ezysema_error("@region function '%.*s' stores region memory into a global (directly or through a call)", (int)fn->name.len,
+                    fn->name.ptr);
+    if (fn->escapes & ezysema_escape_param)
+      ezysema_error("@region function '%.*s' stores region memory into a parameter", (int)fn->name.len, fn->name.ptr);
+  }
+}
+
+// ================ Local escapes ================
+// A local string or dynamic array escapes when its value may outlive the
+// function: it is returned, copied into another variable, stored into a
+// global, a parameter, an element or a field, boxed into a var, or handed
+// to a function that may keep it. Every other use reads it in place.
+// The transpiler keeps what does not escape on the stack: a local array's
+// elements inline, a concatenation's result in a buffer of the function.
+
+static inline bool ezysema_is_builtin(struct ezy_ast_call_t *call, const char *name)
+{
+  size_t len = strlen(name);
+  return call->sym != NULL && call->sym->kind == ezy_sym_builtin && call->func_name.len == len &&
+         memcmp(call->func_name.ptr, name, len) == 0;
+}
+
+static inline bool ezysema_is_str_concat(ezy_ast_node_t *node)
+{
+  return node != NULL && node->type == ezy_ast_node_binop && node->data.n_binop.operator == ezy_op_plus &&
+         node->eval_typ.typ == ezy_ast_dt_string && node->data.n_binop.left != NULL && node->data.n_binop.right != NULL &&
+         node->data.n_binop.left->eval_typ.typ == ezy_ast_dt_string &&
+         node->data.n_binop.right->eval_typ.typ == ezy_ast_dt_string;
+}
+
+static inline bool ezysema_is_arg(struct ezy_ast_call_t *call, ezy_ast_node_t *node, size_t *index)
+{
+  if (node < call->args || node >= call->args + call->arg_count)
+    return false;
+  *index = (size_t)(node - call->args);
+  return true;
+}
+
+// a string `node` whose value `parent` only reads: printed, compared,
+// copied into a concatenation or passed to a function that keeps nothing
+static bool ezysema_str_read(ezy_ast_node_t *parent, ezy_ast_node_t *node)
+{
+  if (parent == NULL)
+    return true; // an expression statement
+  switch (parent->type)
+  {
+  case ezy_ast_node_binop:
+    switch (parent->data.n_binop.operator)
+    {
+    case ezy_op_cond_eq:
+    case ezy_op_cond_neq:
+      return true;
+    case ezy_op_plus:
+      return ezysema_is_str_concat(parent);
+    default:
+      return false;
+    }
+  case ezy_ast_node_index:
+    return parent->data.n_index.base == node;
+  case ezy_ast_node_member:
+    return parent->data.n_member.object == node;
+  case ezy_ast_node_call:
+  {
+    struct ezy_ast_call_t *call = parent->data.n_call;
+    size_t index;
+    if (!ezysema_is_arg(call, node, &index))
+      return false;
+    if (call->sym != NULL && call->sym->kind == ezy_sym_builtin)
+      return !ezysema_is_builtin(call, "push");
+    if (call->sym == NULL || call->sym->kind != ezy_sym_function)
+      return false;
+    const struct ezy_ast_function_t *callee = call->sym->decl.function;
+    return callee->body != NULL && callee->escapes == 0 && !ezysema_owns_heap(&callee->return_typ);
+  }
+  default:
+    return false;
+  }
+}
+
+// a dynamic array `node` used in place: indexed, measured or pushed to;
+// anything else needs the heap array type shared with other functions
+static bool ezysema_array_read(ezy_ast_node_t *parent, ezy_ast_node_t *node)
+{
+  size_t index;
+  return parent != NULL &&
+         ((parent->type == ezy_ast_node_index && parent->data.n_index.base == node) ||
+          (parent->type == ezy_ast_node_member && parent->data.n_member.object == node) ||
+          (parent->type == ezy_ast_node_call && ezysema_is_builtin(parent->data.n_call, "push") &&
+           ezysema_is_arg(parent->data.n_call, node, &index) && index == 0));
+}
+
+static inline bool ezysema_is_local_str(const struct ezy_symbol_t *sym)
+{
+  return sym != NULL && sym->kind == ezy_sym_local && sym->typ != NULL && sym->typ->typ == ezy_ast_dt_string;
+}
+
+static enum ezywalk_action ezysema_local_escape_pre(struct ezywalk_t *w, ezy_ast_node_t *node)
+{
+  if (node->type != ezy_ast_node_variable)
+    return ezywalk_continue;
+  struct ezy_symbol_t *sym = node->data.n_variable.sym;
+  if (sym == NULL || sym->kind != ezy_sym_local || sym->typ == NULL)
+    return ezywalk_continue;
+  ezy_ast_node_t *parent = w->parent;
+  if (sym->typ->typ == ezy_ast_dt_string)
+  {
+    // assigning replaces the value, the old one is not kept
+    bool assigned = parent != NULL && parent->type == ezy_ast_node_binop && parent->data.n_binop.operator == ezy_op_assign &&
+                    parent->data.n_binop.left == node;
+    if (!assigned && !ezysema_str_read(parent, node))
+      sym->escapes = true;
+  }
+  else if (sym->typ->typ == ezy_ast_dt_array && sym->typ->ext.array_t->dynamic && !ezysema_array_read(parent, node))
+  {
+    sym->escapes = true;
+  }
+  return ezywalk_continue;
+}
+
+// an outermost concatenation whose result stays in the function: read
+// in place, or stored into a local string that does not escape
+static enum ezywalk_action ezysema_concat_escape_pre(struct ezywalk_t *w, ezy_ast_node_t *node)
+{
+  ezy_ast_node_t *parent = w->parent;
+  if (!ezysema_is_str_concat(node) || ezysema_is_str_concat(parent))
+    return ezywalk_continue;
+  bool stays;
+  if (parent != NULL && parent->type == ezy_ast_node_variable_decl)
+  {
+    struct ezy_symbol_t *sym = parent->data.n_variable.sym;
+    stays = ezysema_is_local_str(sym) && !sym->typ->nullable && !sym->escapes;
+  }
+  else if (parent != NULL && parent->type == ezy_ast_node_binop && parent->data.n_binop.operator == ezy_op_assign)
+  {
+    ezy_ast_node_t *target = parent->data.n_binop.left;
+    struct ezy_symbol_t *sym = target->type == ezy_ast_node_variable ? target->data.n_variable.sym : NULL;
+    stays = parent->data.n_binop.right == node && ezysema_is_local_str(sym) && !sym->typ->nullable && !sym->escapes;
+  }
+  else
+  {
+    stays = ezysema_str_read(parent, node);
+  }
+  node->data.n_binop.stack_buf = stays ? 1 : 0;
+  return ezywalk_continue;
+}
+
+// needs the function escapes of ezysema_check_regions
+static void ezysema_local_escapes(ezy_ast_node_t *root)
+{
+  struct ezywalk_t locals = {.pre = ezysema_local_escape_pre};
+  struct ezywalk_t concats = {.pre = ezysema_concat_escape_pre};
+  for (ezy_ast_node_t *node = root; node != NULL; node = node->next)
+  {
+    if (node->type != ezy_ast_node_function)
+      continue;
+    // every use of a local is seen before any concatenation is decided
+    ezywalk_list(&locals, node->data.n_function->body);
+    ezywalk_list(&concats, node->data.n_function->body);
+  }
+  ezywalk_release(&locals);
+  ezywalk_release(&concats);
+}
+
+bool ezysema_infer_types(ezy_ast_node_t *root)
+{
+  size_t errors = ezysema_errors;
+  // globals first so function bodies see their types, callees are
+  // inferred on demand
+  struct ezysema_fn_ctx global_ctx = {.fn = NULL};
+  struct ezywalk_t w = {.pre = ezysema_infer_pre, .post = ezysema_infer_post, .ctx = &global_ctx};
+  for (ezy_ast_node_t *node = root; node != NULL; node = node->next)
+  {
+    if (node->type == ezy_ast_node_variable_decl)
+      ezywalk_node(&w, node);
+  }
+  ezywalk_release(&w);
+  for (ezy_ast_node_t *node = root; node != NULL; node = node->next)
+  {
+    if (node->type == ezy_ast_node_function)
+      ezysema_infer_function(node->data.n_function);
+  }
+  ezysema_check_regions(root);
+  ezysema_local_escapes(root);
+  return ezysema_errors == errors;
+}
@@ -0,0 +1,160 @@
+#include <ezy_symtab.h>
+#include <ezy_log.h>
+#include <ezy_parser_arena.h>
+#include <string.h>
+
+#define ezysym_initial_cap 64
+
+// ================ Helper functions ================
+
+// FNV-1a, good enough for identifiers
+static inline uint32_t ezysym_hash(ezy_cstr_t name)
+{
+  uint32_t h = 2166136261u;
+  for (size_t i = 0; i < name.len; i++)
+  {
+    h ^= (uint8_t)name.ptr[i];
+    h *= 16777619u;
+  }
+  return h;
+}
+
+static inline bool ezysym_name_eq(const struct ezy_symbol_t *sym, uint32_t hash, ezy_cstr_t name)
+{
+  return sym->hash == hash && sym->name.len == name.len && memcmp(sym->name.ptr, name.ptr, name.len) == 0;
+}
+
+// find the slot holding `name`, or the empty slot where it would go
+static size_t ezysym_probe(struct ezy_symbol_t *const *slots, size_t cap, uint32_t hash, ezy_cstr_t name)
+{
+  size_t mask = cap - 1;
+  size_t i = hash & mask;
+  while (slots[i] != NULL && !ezysym_name_eq(slots[i], hash, name))
+  {
+    i = (i + 1) & mask;
+  }
+  return i;
+}
+
+static void ezysym_place(struct ezy_symbol_t **slots, size_t cap, struct ezy_symbol_t *sym)
+{
+  slots[ezysym_probe(slots, cap, sym->hash, sym->name)] = sym;
+}
+
+// Rebuild the map by replaying the declaration log in order. Replaying keeps
+// every name in the slot its first declaration probed to, which is what makes
+// LIFO removal in ezysym_pop_scope safe without tombstones.
+static bool ezysym_grow(struct ezysym_table *tab)
+{
+  size_t cap = tab->cap * 2;
+  struct ezy_symbol_t **slots = calloc(cap, sizeof(*slots));
+  if (slots == NULL)
+  {
+    ezy_log_error("ezysym_grow: out of memory");
+    return false;
+  }
+  for (size_t i = 0; i < tab->log_len; i++)
+  {
+    ezysym_place(slots, cap, tab->log[i]);
+  }
+  free(tab->slots);
+  tab->slots = slots;
+  tab->cap = cap;
+  return true;
+}
+
+// ================ Table functions ================
+
+void ezysym_init(struct ezysym_table *tab)
+{
+  memset(tab, 0, sizeof(*tab));
+  tab->cap = ezysym_initial_cap;
+  tab->slots = calloc(tab->cap, sizeof(*tab->slots));
+}
+
+void ezysym_free(struct ezysym_table *tab)
+{
+  free(tab->slots);
+  free(tab->log);
+  free(tab->marks);
+  memset(tab, 0, sizeof(*tab));
+}
+
+void ezysym_push_scope(struct ezysym_table *tab)
+{
+  if (tab->depth >= tab->marks_cap)
+  {
+    size_t cap = tab->marks_cap ? tab->marks_cap * 2 : 16;
+    size_t *marks = realloc(tab->marks, cap * sizeof(*marks));
+    if (marks == NULL)
+    {
+      ezy_log_error("ezysym_push_scope: out of memory");
+      return;
+    }
+    tab->marks = marks;
+    tab->marks_cap = cap;
+  }
+  tab->marks[tab->depth++] = tab->log_len;
+}
+
+void ezysym_pop_scope(struct ezysym_table *tab)
+{
+  if (tab->depth == 0)
+  {
+    ezy_log_warn("ezysym_pop_scope: no scope to pop");
+    return;
+  }
+  size_t mark = tab->marks[--tab->depth];
+  while (tab->log_len > mark)
+  {
+    struct ezy_symbol_t *sym = tab->log[--tab->log_len];
+    size_t i = ezysym_probe(tab->slots, tab->cap, sym->hash, sym->name);
+    tab->slots[i] = sym->shadowed;
+    if (sym->shadowed == NULL)
+    {
+      tab->used--;
+    }
+  }
+}
+
+struct ezy_symbol_t *ezysym_declare(struct ezysym_table *tab, enum ezy_sym_kind kind, ezy_cstr_t name)
+{
+  if ((tab->used + 1) * 2 > tab->cap && !ezysym_grow(tab))
+  {
+    return NULL;
+  }
+  if (tab->log_len >= tab->log_cap)
+  {
+    size_t cap = tab->log_cap ? tab->log_cap * 2 : ezysym_initial_cap;
+    struct ezy_symbol_t **log = realloc(tab->log, cap * sizeof(*log));
+    if (log == NULL)
+    {
+      ezy_log_error("ezysym_declare: out of memory");
+      return NULL;
+    }
+    tab->log = log;
+    tab->log_cap = cap;
+  }
+
+  struct ezy_symbol_t *sym = ezyparse_arena_alloc(sizeof(struct ezy_symbol_t));
+  memset(sym, 0, sizeof(*sym));
+  sym->kind = kind;
+  sym->name = name;
+  sym->hash = ezysym_hash(name);
+  sym->depth = (uint32_t)tab->depth;
+
+  size_t i = ezysym_probe(tab->slots, tab->cap, sym->hash, name);
+  sym->shadowed = tab->slots[i];
+  if (sym->shadowed == NULL)
+  {
+    tab->used++;
+  }
+  tab->slots[i] = sym;
+  tab->log[tab->log_len++] = sym;
+  return sym;
+}
+
+struct ezy_symbol_t *ezysym_lookup(const struct ezysym_table *tab, ezy_cstr_t name)
+{
+  return tab->slots[ezysym_probe(tab->slots, tab->cap, ezysym_hash(name), name)];
+}
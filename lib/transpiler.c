@@ -1,580 +1,3327 @@
 #include <ezy_ast.h>
+#include <ezy_ast_walk.h>
+#include <ezy_emit.h>
 #include <ezy_lexer.h>
 #include <ezy_log.h>
-#include <ezy_parser_arena.h>
+#include <ezy_symtab.h>
+#include <ezy_transpile_c.h>
+#include <ezyrt.h>
 #include <string.h>
 #include <inttypes.h>
+#include <stdlib.h>
 
-// Declare main transpilation function
-ezy_multistr_t *ezytranspile_c(ezy_ast_node_t *node);
+#if !defined(_WIN32)
+#include <pthread.h>
+#include <stdatomic.h>
+#endif
+
+// Per-invocation state. Nothing in the transpiler is global, so separate
+// contexts can generate code on separate threads.
+struct ezyt_ctx
+{
+  ezy_emit_t out;
+  struct ezywalk_t expr_walk; // reused by every expression, see ezytranspile_expression
+  bool expr_ok;
+  bool array_init; // the expression being emitted initializes an array declaration
+  // conversions to and from var, see ezyt_expected
+  const struct ezy_ast_datatype_t *want;       // type the root expression is stored as
+  ezy_ast_node_t *array_root;                  // literal initializing a declared array
+  const struct ezy_ast_datatype_t *array_elem; // element type of that array
+  struct ezy_ast_function_t *fn;               // function being generated
+  ezy_ast_node_t *struct_root;                 // struct literal initializing a declaration
+  ezy_ast_node_t *stmt;                        // body statement being generated, see ezyt_exit_code
+  bool failed;                                 // a statement or top-level node was not transpiled
+};
 
 // helper functions
-void ezytranspile_top_level(ezy_ast_node_t *node, ezy_multistr_t **out);
-static inline void ezyt_append_buf(ezy_multistr_t **out, const char *src, size_t n);
+void ezytranspile_top_level(ezy_ast_node_t *node, struct ezyt_ctx *t);
 
 // Transpilation functions for specific node types
-bool ezytranspile_function(ezy_ast_node_t *node, ezy_multistr_t **out);
-bool ezytranspile_variable_decl(ezy_ast_node_t *node, ezy_multistr_t **out);
-bool ezytranspile_literal(ezy_ast_node_t *node, ezy_multistr_t **out);
-bool ezytranspile_call(ezy_ast_node_t *node, ezy_multistr_t **out);
-bool ezytranspile_stmt(ezy_ast_node_t *node, ezy_multistr_t **out);
-bool ezytranspile_expression(ezy_ast_node_t *node, ezy_multistr_t **out);
-bool ezytranspile_binop(ezy_ast_node_t *node, ezy_multistr_t **out);
-bool ezytranspile_datatype(struct ezy_ast_datatype_t *datatype, ezy_multistr_t **out);
-
-static char ezyt_tmp_buf[1024];
-#define ezyt_max_cstr_size 65536
+bool ezytranspile_function(ezy_ast_node_t *node, struct ezyt_ctx *t);
+bool ezytranspile_function_signature(struct ezy_ast_function_t *fn, ezy_emit_t *out);
+bool ezytranspile_variable_decl(ezy_ast_node_t *node, struct ezyt_ctx *t);
+bool ezytranspile_literal(ezy_ast_node_t *node, ezy_emit_t *out);
+bool ezytranspile_stmt(ezy_ast_node_t *node, struct ezyt_ctx *t);
+bool ezytranspile_return(ezy_ast_node_t *node, struct ezyt_ctx *t);
+bool ezytranspile_expression(ezy_ast_node_t *node, struct ezyt_ctx *t);
+static bool ezyt_expression_as(ezy_ast_node_t *node, const struct ezy_ast_datatype_t *want, struct ezyt_ctx *t);
+const char *ezytranspile_binop_cop(enum ezy_op_typ op);
+bool ezytranspile_datatype(struct ezy_ast_datatype_t *datatype, ezy_emit_t *out);
 
 // ================ Helper functions to append buffer ================
 
-static inline void ezyt_append_buf(ezy_multistr_t **out, const char *src, size_t n)
+static inline void ezyt_append_hex_escape(ezy_emit_t *out, unsigned char c)
 {
-  ezy_multistr_t *buf = *out;
-  if (n > ezyt_max_cstr_size)
-  {
-    ezy_log_warn("append too large for chunk, rejected");
+  static const char hex[] = "0123456789abcdef";
+  char *dst = ezyemit_reserve(out, 4);
+  if (dst == NULL)
     return;
+  dst[0] = '\\';
+  dst[1] = 'x';
+  dst[2] = hex[c >> 4];
+  dst[3] = hex[c & 0xf];
+  ezyemit_commit(out, 4);
+}
+
+// ================ Optionals ================
+// T? stores null in a bit pattern T never uses where there is one
+// (ezyrt_opt.h), so it costs nothing:
+//   string? -> ezyrt_str (NULL slice)  bool? -> ezyrt_opt_bool (2)
+//   var?    -> ezyrt_var       T[]?  -> the vector of T[] (len SIZE_MAX)
+// Numbers and char have no spare value and become {value, has} structs,
+// int32? -> ezyrt_opt_i32. A fixed array of those keeps the flags in a
+// bitmap instead, int32?[8] -> ezy_optarr_i32_8. Values are wrapped and
+// unwrapped (checked) where they flow between T and T?, see ezyt_conv.
+
+// T? with a representation of its own, var holds null anyway
+static inline bool ezyt_is_opt(const struct ezy_ast_datatype_t *dt)
+{
+  if (!dt->nullable)
+    return false;
+  if (dt->typ == ezy_ast_dt_array)
+    return dt->ext.array_t->dynamic;
+  return dt->typ >= ezy_ast_dt_int8 && dt->typ <= ezy_ast_dt_string;
+}
+
+// T? that needs a has flag next to the value
+static inline bool ezyt_opt_flagged(const struct ezy_ast_datatype_t *dt)
+{
+  return ezyt_is_opt(dt) && dt->typ != ezy_ast_dt_bool && dt->typ != ezy_ast_dt_string && dt->typ != ezy_ast_dt_array;
+}
+
+// fixed array of flagged optionals, stored with a presence bitmap
+static inline bool ezyt_is_optarr(const struct ezy_ast_datatype_t *dt)
+{
+  return dt->typ == ezy_ast_dt_array && !dt->ext.array_t->dynamic && ezyt_opt_flagged(&dt->ext.array_t->typ);
+}
+
+// ================ Unions ================
+// `union Num = int | string | null` is a payload union and a tag:
+//   typedef struct ezy_union_Num { union { ezyrt_str str; int32_t i32; } as; uint8_t tag; } ezy_union_Num;
+// Tags number the members in declaration order (null included), so a
+// dispatch on them is a dense switch that C compilers turn into a jump
+// table. The tag is the smallest unsigned type holding every tag, and
+// `Num?` without a null member stores null in the spare tag after the
+// last one. The payload comes first, members by decreasing alignment,
+// and the expected size is checked with a _Static_assert. Per union:
+//   ezy_union_Num_ids[tag]        runtime tag of the member, typeof(u)
+//   ezy_union_Num_as_<m>(u)       checked read of member m
+//   ezy_union_Num_to_var/from_var conversions, a switch on the tag
+// Storing a member is a compound literal, `typeof(u) == typeof(int)` a
+// tag compare.
+
+static const char *ezyt_var_ctor(enum ezy_ast_datatype_typ typ);
+static const char *ezyt_tag_name(enum ezy_ast_datatype_typ typ, bool repr);
+
+#define ezyt_union_fmt "ezy_union_%.*s"
+#define ezyt_union_arg(u) (int)(u)->name.len, (u)->name.ptr
+
+static inline bool ezyt_is_union(const struct ezy_ast_datatype_t *dt)
+{
+  return dt->typ == ezy_ast_dt_union;
+}
+
+// payload field and tag suffix of a member, bool and char are C keywords
+static const char *ezyt_union_field(enum ezy_ast_datatype_typ typ)
+{
+  switch (typ)
+  {
+  case ezy_ast_dt_null: return "null";
+  case ezy_ast_dt_bool: return "b";
+  case ezy_ast_dt_char: return "c";
+  default: return ezyt_var_ctor(typ);
+  }
+}
+
+// size of a member (LP64 targets), a string is a 16 byte ezyrt_str
+static size_t ezyt_scalar_size(enum ezy_ast_datatype_typ typ)
+{
+  switch (typ)
+  {
+  case ezy_ast_dt_string:
+    return 16;
+  case ezy_ast_dt_int8:
+  case ezy_ast_dt_uint8:
+  case ezy_ast_dt_bool:
+  case ezy_ast_dt_char:
+    return 1;
+  case ezy_ast_dt_int16:
+  case ezy_ast_dt_uint16:
+    return 2;
+  case ezy_ast_dt_int32:
+  case ezy_ast_dt_uint32:
+  case ezy_ast_dt_float32:
+    return 4;
+  default:
+    return 8;
   }
-  if (buf->str.len + n >= ezyt_max_cstr_size)
+}
+
+// alignment of a member, its size up to 8
+static inline size_t ezyt_scalar_align(enum ezy_ast_datatype_typ typ)
+{
+  size_t size = ezyt_scalar_size(typ);
+  return size < 8 ? size : 8;
+}
+
+// tag of the member of type `typ`
+static bool ezyt_union_member(const struct ezy_ast_union_t *u, enum ezy_ast_datatype_typ typ, size_t *tag)
+{
+  for (size_t i = 0; i < u->count; i++)
   {
-    ezy_multistr_t *newbuf = ezyparse_arena_alloc(sizeof(ezy_multistr_t));
-    char *ptr = ezyparse_arena_alloc(ezyt_max_cstr_size);
-    if (newbuf == NULL || ptr == NULL)
+    if (u->mem_typlist[i].typ == typ)
     {
-      ezy_log_warn("Memory allocation failed");
-      return;
+      *tag = i;
+      return true;
     }
-    newbuf->str.ptr = ptr;
-    newbuf->str.len = 0;
-    newbuf->next = NULL;
-    buf->next = newbuf;
-    *out = newbuf;
-    buf = newbuf;
-  }
-  memcpy(buf->str.ptr + buf->str.len, src, n);
-  buf->str.len += n;
-}
-
-// helper macro to append formatted string to output buffer
-#define ezyt_append(out, ...)                                          \
-  do                                                                   \
-  {                                                                    \
-    int n = snprintf(ezyt_tmp_buf, sizeof(ezyt_tmp_buf), __VA_ARGS__); \
-    if (n >= sizeof(ezyt_tmp_buf))                                     \
-    {                                                                  \
-      n = sizeof(ezyt_tmp_buf) - 1;                                    \
-      ezy_log_warn("Formatted string truncated in ezyt_append");       \
-    }                                                                  \
-    if (n > 0)                                                         \
-    {                                                                  \
-      ezyt_append_buf(out, ezyt_tmp_buf, (size_t)n);                   \
-    }                                                                  \
-    else                                                               \
-    {                                                                  \
-      ezy_log_warn("Formatting error in ezyt_append");                 \
-    }                                                                  \
-  } while (0)
+  }
+  return false;
+}
 
-// =============== Transpilation functions for specific nodes ================
+// the null member, or the spare value after the last member
+static size_t ezyt_union_null_tag(const struct ezy_ast_union_t *u)
+{
+  size_t tag;
+  return ezyt_union_member(u, ezy_ast_dt_null, &tag) ? tag : u->count;
+}
 
-// Transpile a datatype to C type and append to output buffer
-bool ezytranspile_datatype(struct ezy_ast_datatype_t *datatype, ezy_multistr_t **out)
+static inline bool ezyt_union_nullable(const struct ezy_ast_datatype_t *dt)
+{
+  return ezyt_is_union(dt) && (dt->nullable || ezyt_union_null_tag(dt->ext.union_t) < dt->ext.union_t->count);
+}
+
+// member a plain value of type `typ` is stored as: its own type, or the
+// only integer (float) member for an integer (float) value, so literals fit
+static bool ezyt_union_store_member(const struct ezy_ast_union_t *u, enum ezy_ast_datatype_typ typ, size_t *tag)
+{
+  if (ezyt_union_member(u, typ, tag))
+    return true;
+  bool is_int = typ >= ezy_ast_dt_int8 && typ <= ezy_ast_dt_uint64;
+  bool is_float = typ == ezy_ast_dt_float32 || typ == ezy_ast_dt_float64;
+  size_t found = u->count;
+  for (size_t i = 0; i < u->count && (is_int || is_float); i++)
+  {
+    enum ezy_ast_datatype_typ m = u->mem_typlist[i].typ;
+    bool same_kind = is_int ? m >= ezy_ast_dt_int8 && m <= ezy_ast_dt_uint64 : m == ezy_ast_dt_float32 || m == ezy_ast_dt_float64;
+    if (!same_kind)
+      continue;
+    if (found != u->count)
+      return false; // ambiguous
+    found = i;
+  }
+  *tag = found;
+  return found != u->count;
+}
+
+// ezy_union_<Name>_<fn>(
+static void ezyt_union_call(const struct ezy_ast_union_t *u, const char *fn, ezy_emit_t *out)
+{
+  ezyemit_fmt(out, ezyt_union_fmt "_%s(", ezyt_union_arg(u), fn);
+}
+
+// the union holding member `tag`, around the member value:
+//   ((ezy_union_Num){.as.i32 = <value>, .tag = ezy_union_Num_tag_i32})
+static void ezyt_union_store(const struct ezy_ast_union_t *u, size_t tag, bool open, ezy_emit_t *out)
+{
+  const char *field = ezyt_union_field(u->mem_typlist[tag].typ);
+  if (open)
+    ezyemit_fmt(out, "((" ezyt_union_fmt "){.as.%s = ", ezyt_union_arg(u), field);
+  else
+    ezyemit_fmt(out, ", .tag = " ezyt_union_fmt "_tag_%s})", ezyt_union_arg(u), field);
+}
+
+// size of the C union, its payload and tag sizes and its alignment
+static size_t ezyt_union_layout(const struct ezy_ast_union_t *u, size_t *payload, size_t *tag_size, size_t *align)
+{
+  size_t tags = ezyt_union_null_tag(u) < u->count ? u->count : u->count + 1;
+  *tag_size = tags <= 256 ? 1 : 2;
+  *payload = 0;
+  for (size_t i = 0; i < u->count; i++)
+  {
+    enum ezy_ast_datatype_typ typ = u->mem_typlist[i].typ;
+    if (typ != ezy_ast_dt_null && ezyt_scalar_size(typ) > *payload)
+      *payload = ezyt_scalar_size(typ);
+  }
+  *align = *payload < 8 ? *payload : 8;
+  *align = *align > *tag_size ? *align : *tag_size;
+  return (*payload + *tag_size + *align - 1) / *align * *align;
+}
+
+// typedef, tag constants and functions of one union, emitted once in the prologue
+static void ezyt_union_define(const struct ezy_ast_union_t *u, ezy_emit_t *out)
+{
+  size_t null_tag = ezyt_union_null_tag(u);
+  size_t tags = null_tag < u->count ? u->count : u->count + 1;
+  size_t payload, tag_size, align;
+  size_t size = ezyt_union_layout(u, &payload, &tag_size, &align);
+
+  // payload members by decreasing size, so alignment decreases too; the
+  // parser allows each scalar type once, so there are at most 14
+  size_t order[16];
+  size_t n = 0;
+  for (size_t member_size = 16; member_size > 0; member_size /= 2)
+  {
+    for (size_t i = 0; i < u->count; i++)
+    {
+      enum ezy_ast_datatype_typ typ = u->mem_typlist[i].typ;
+      if (typ != ezy_ast_dt_null && ezyt_scalar_size(typ) == member_size && n < sizeof(order) / sizeof(order[0]))
+        order[n++] = i;
+    }
+  }
+
+  ezyemit_fmt(out, "// union %.*s: %zu byte payload, %zu byte tag\n", ezyt_union_arg(u), payload, tag_size);
+  ezyemit_fmt(out, "typedef struct " ezyt_union_fmt "\n{\n  union\n  {\n", ezyt_union_arg(u));
+  for (size_t i = 0; i < n; i++)
+  {
+    struct ezy_ast_datatype_t member = u->mem_typlist[order[i]];
+    ezyemit_str(out, "    ");
+    ezytranspile_datatype(&member, out);
+    ezyemit_fmt(out, " %s;\n", ezyt_union_field(member.typ));
+  }
+  ezyemit_fmt(out, "  } as;\n  %s tag;\n} " ezyt_union_fmt ";\n", tag_size == 1 ? "uint8_t" : "uint16_t", ezyt_union_arg(u));
+  ezyemit_fmt(out, "_Static_assert(sizeof(" ezyt_union_fmt ") == %zu, \"layout of union %.*s\");\n", ezyt_union_arg(u), size,
+              ezyt_union_arg(u));
+
+  ezyemit_str(out, "enum\n{\n");
+  for (size_t i = 0; i < tags; i++)
+  {
+    const char *field = i < u->count ? ezyt_union_field(u->mem_typlist[i].typ) : "null";
+    ezyemit_fmt(out, "  " ezyt_union_fmt "_tag_%s = %zu,\n", ezyt_union_arg(u), field, i);
+  }
+  ezyemit_str(out, "};\n");
+  ezyemit_fmt(out, "static const uint8_t " ezyt_union_fmt "_ids[] = {", ezyt_union_arg(u));
+  for (size_t i = 0; i < tags; i++)
+  {
+    ezyemit_str(out, i > 0 ? ", " : "");
+    ezyemit_str(out, ezyt_tag_name(i < u->count ? u->mem_typlist[i].typ : ezy_ast_dt_null, false));
+  }
+  ezyemit_str(out, "};\n");
+
+  for (size_t i = 0; i < u->count; i++)
+  {
+    struct ezy_ast_datatype_t member = u->mem_typlist[i];
+    if (member.typ == ezy_ast_dt_null)
+      continue;
+    const char *field = ezyt_union_field(member.typ);
+    ezyemit_str(out, "static inline ");
+    ezytranspile_datatype(&member, out);
+    ezyemit_fmt(out, " " ezyt_union_fmt "_as_%s(" ezyt_union_fmt " u)\n{\n", ezyt_union_arg(u), field, ezyt_union_arg(u));
+    ezyemit_fmt(out, "  if (u.tag != " ezyt_union_fmt "_tag_%s)\n", ezyt_union_arg(u), field);
+    ezyemit_fmt(out, "    ezyrt_union_fail(\"%.*s\", %s, " ezyt_union_fmt "_ids[u.tag]);\n", ezyt_union_arg(u),
+                ezyt_tag_name(member.typ, false), ezyt_union_arg(u));
+    ezyemit_fmt(out, "  return u.as.%s;\n}\n", field);
+  }
+
+  ezyemit_fmt(out, "static inline ezyrt_var " ezyt_union_fmt "_to_var(" ezyt_union_fmt " u)\n{\n  switch (u.tag)\n  {\n",
+              ezyt_union_arg(u), ezyt_union_arg(u));
+  for (size_t i = 0; i < u->count; i++)
+  {
+    enum ezy_ast_datatype_typ typ = u->mem_typlist[i].typ;
+    if (typ == ezy_ast_dt_null)
+      continue;
+    ezyemit_fmt(out, "  case " ezyt_union_fmt "_tag_%s:\n    return ezyrt_var_%s(u.as.%s);\n", ezyt_union_arg(u),
+                ezyt_union_field(typ), ezyt_var_ctor(typ), ezyt_union_field(typ));
+  }
+  ezyemit_str(out, "  default:\n    return ezyrt_var_null();\n  }\n}\n");
+
+  // a var converts only if it holds exactly a member type
+  ezyemit_fmt(out, "static inline " ezyt_union_fmt " " ezyt_union_fmt "_from_var(ezyrt_var v)\n{\n  switch (v.tag)\n  {\n",
+              ezyt_union_arg(u), ezyt_union_arg(u));
+  for (size_t i = 0; i < u->count; i++)
+  {
+    struct ezy_ast_datatype_t member = u->mem_typlist[i];
+    const char *field = ezyt_union_field(member.typ);
+    ezyemit_fmt(out, "  case %s:\n    return (" ezyt_union_fmt "){", ezyt_tag_name(member.typ, false), ezyt_union_arg(u));
+    if (member.typ != ezy_ast_dt_null)
+    {
+      const char *payload_field = ".as.u";
+      if (member.typ == ezy_ast_dt_int8 || member.typ == ezy_ast_dt_int16 || member.typ == ezy_ast_dt_int32 ||
+          member.typ == ezy_ast_dt_int64)
+        payload_field = ".as.i";
+      else if (member.typ == ezy_ast_dt_float32 || member.typ == ezy_ast_dt_float64)
+        payload_field = ".as.f";
+      if (member.typ == ezy_ast_dt_string)
+      {
+        ezyemit_str(out, ".as.str = ezyrt_var_as_str(v), ");
+      }
+      else
+      {
+        ezyemit_fmt(out, ".as.%s = (", field);
+        ezytranspile_datatype(&member, out);
+        ezyemit_fmt(out, ")v%s, ", payload_field);
+      }
+    }
+    ezyemit_fmt(out, ".tag = " ezyt_union_fmt "_tag_%s};\n", ezyt_union_arg(u), field);
+  }
+  ezyemit_fmt(out, "  default:\n    ezyrt_var_fail(\"union %.*s cannot hold\", v);\n  }\n}\n\n", ezyt_union_arg(u));
+}
+
+// ================ Structs ================
+// `struct Rec { ... }` is a C struct, ezy_struct_Rec. Its fields are laid
+// out by decreasing alignment, then size: every field then starts aligned
+// and only the tail can be padding. Declaration order only matters to
+// positional elements of a literal, which become designated initializers:
+//   let Rec r = {1, "a"};  ->  ezy_struct_Rec r = {.id = 1, .name = ezyrt_str_lit_init("a")}
+// `@abi struct` keeps the declaration order, for structs shared with C.
+// The expected size is checked with a _Static_assert, and --dump-layout
+// reports both layouts (ezytranspile_layout_report).
+
+#define ezyt_struct_fmt "ezy_struct_%.*s"
+#define ezyt_struct_arg(s) (int)(s)->name.len, (s)->name.ptr
+
+static inline bool ezyt_is_vec(const struct ezy_ast_datatype_t *dt);
+static bool ezyt_vec_name(const struct ezy_ast_datatype_t *dt, ezy_emit_t *out);
+static void ezyt_array_suffix(const struct ezy_ast_datatype_t *dt, ezy_emit_t *out);
+static bool ezyt_null_value(const struct ezy_ast_datatype_t *dt, bool init, ezy_emit_t *out);
+static bool ezyt_struct_size(const struct ezy_ast_struct_t *s, size_t *size, size_t *align);
+
+static inline size_t ezyt_align_up(size_t n, size_t align)
+{
+  return (n + align - 1) / align * align;
+}
+
+// size and alignment of a value of type `dt` in C (LP64 targets), false
+// if it has no layout of its own
+static bool ezyt_dt_layout(const struct ezy_ast_datatype_t *dt, size_t *size, size_t *align)
+{
+  if (dt->typ == ezy_ast_dt_array)
+  {
+    struct ezy_ast_array_t *arr = dt->ext.array_t;
+    if (arr->dynamic)
+    {
+      // ezyrt_vec_define: data, len, cap, guide and max
+      *size = 40;
+      *align = 8;
+      if (arr->inline_cap == 0)
+        return true;
+      // ezyrt_svec_define: len, cap, max, heap, then the inline elements
+      struct ezy_ast_datatype_t elem = arr->typ;
+      size_t elem_size, elem_align;
+      if (!ezyt_dt_layout(&elem, &elem_size, &elem_align))
+        return false;
+      *align = elem_align > 8 ? elem_align : 8;
+      *size = ezyt_align_up(32 + elem_size * arr->inline_cap, *align);
+      return true;
+    }
+    // bitmap arrays hold plain values and a presence bit each
+    struct ezy_ast_datatype_t elem = arr->typ;
+    elem.nullable = elem.nullable && !ezyt_is_optarr(dt);
+    if (!ezyt_dt_layout(&elem, size, align))
+      return false;
+    *size *= arr->length;
+    if (ezyt_is_optarr(dt))
+      *size = ezyt_align_up(*size + (arr->length + 7) / 8, *align);
+    return true;
+  }
+  if (dt->typ == ezy_ast_dt_struct)
+    return !dt->nullable && ezyt_struct_size(dt->ext.struct_t, size, align);
+  if (ezyt_is_union(dt))
+  {
+    size_t payload, tag_size;
+    *size = ezyt_union_layout(dt->ext.union_t, &payload, &tag_size, align);
+    return true;
+  }
+  if (dt->typ == ezy_ast_dt_var)
+  {
+    *size = 16;
+    *align = 8;
+    return true;
+  }
+  if (dt->typ < ezy_ast_dt_int8 || dt->typ > ezy_ast_dt_string)
+    return false;
+  *size = ezyt_scalar_size(dt->typ);
+  *align = ezyt_scalar_align(dt->typ);
+  if (ezyt_opt_flagged(dt))
+    *size = ezyt_align_up(*size + 1, *align); // {value, has}
+  return true;
+}
+
+// C field order of `s` into order[s->count]: declaration order for @abi,
+// otherwise by decreasing alignment then size, ties in declaration order
+static bool ezyt_struct_order(const struct ezy_ast_struct_t *s, size_t *order)
+{
+  size_t *keys = malloc(sizeof(size_t) * s->count);
+  if (keys == NULL)
+    return false;
+  bool ok = true;
+  for (size_t i = 0; i < s->count; i++)
+  {
+    size_t size, align;
+    if (!ezyt_dt_layout(&s->members[i].typ, &size, &align))
+    {
+      ezy_log_warn("Field '%.*s' of struct %.*s has no C layout", (int)s->members[i].name.len, s->members[i].name.ptr,
+                   ezyt_struct_arg(s));
+      ok = false;
+      size = align = 0;
+    }
+    // alignment is at most 8 and sizes are multiples of it
+    keys[i] = s->abi ? 0 : align << 56 | (size > ((size_t)1 << 56) - 1 ? ((size_t)1 << 56) - 1 : size);
+
+    // insertion sort, stable
+    size_t j = i;
+    for (; j > 0 && keys[order[j - 1]] < keys[i]; j--)
+      order[j] = order[j - 1];
+    order[j] = i;
+  }
+  free(keys);
+  return ok;
+}
+
+// size, alignment and padding of `s` with its fields in `order`, and the
+// offset of each order[i] into offsets[i] unless NULL
+static bool ezyt_struct_measure(const struct ezy_ast_struct_t *s, const size_t *order, size_t *offsets, size_t *size, size_t *align,
+                                size_t *padding)
+{
+  size_t at = 0, used = 0;
+  *align = 1;
+  for (size_t i = 0; i < s->count; i++)
+  {
+    size_t field_size, field_align;
+    if (!ezyt_dt_layout(&s->members[order[i]].typ, &field_size, &field_align))
+      return false;
+    at = ezyt_align_up(at, field_align);
+    if (offsets != NULL)
+      offsets[i] = at;
+    at += field_size;
+    used += field_size;
+    *align = field_align > *align ? field_align : *align;
+  }
+  *size = ezyt_align_up(at, *align);
+  *padding = *size - used;
+  return true;
+}
+
+// size and alignment of `s` as it is laid out in C
+static bool ezyt_struct_size(const struct ezy_ast_struct_t *s, size_t *size, size_t *align)
+{
+  size_t *order = malloc(sizeof(size_t) * s->count);
+  size_t padding;
+  bool ok = order != NULL && ezyt_struct_order(s, order) && ezyt_struct_measure(s, order, NULL, size, align, &padding);
+  free(order);
+  return ok;
+}
+
+// typedef of one struct, emitted in the prologue after its field types
+static bool ezyt_struct_define(const struct ezy_ast_struct_t *s, ezy_emit_t *out)
+{
+  size_t *order = malloc(sizeof(size_t) * s->count * 2);
+  if (order == NULL)
+    return false;
+  size_t *decl_order = order + s->count;
+  for (size_t i = 0; i < s->count; i++)
+    decl_order[i] = i;
+  size_t size, align, padding, decl_size, decl_padding;
+  bool ok = ezyt_struct_order(s, order) && ezyt_struct_measure(s, order, NULL, &size, &align, &padding) &&
+            ezyt_struct_measure(s, decl_order, NULL, &decl_size, &align, &decl_padding);
+  if (!ok)
+  {
+    ezy_log_warn("Cannot lay out struct %.*s", ezyt_struct_arg(s));
+    free(order);
+    return false;
+  }
+
+  if (s->abi)
+    ezyemit_fmt(out, "// struct %.*s: %zu bytes, declaration order (@abi)\n", ezyt_struct_arg(s), size);
+  else
+    ezyemit_fmt(out, "// struct %.*s: %zu bytes, %zu in declaration order\n", ezyt_struct_arg(s), size, decl_size);
+  ezyemit_fmt(out, "typedef struct " ezyt_struct_fmt "\n{\n", ezyt_struct_arg(s));
+  for (size_t i = 0; i < s->count; i++)
+  {
+    struct ezy_ast_args_t *field = &s->members[order[i]];
+    ezyemit_str(out, "  ");
+    ok &= ezytranspile_datatype(&field->typ, out);
+    ezyemit_char(out, ' ');
+    ezyemit_ident(out, field->name);
+    ezyt_array_suffix(&field->typ, out);
+    ezyemit_str(out, ";\n");
+  }
+  ezyemit_fmt(out, "} " ezyt_struct_fmt ";\n", ezyt_struct_arg(s));
+  ezyemit_fmt(out, "_Static_assert(sizeof(" ezyt_struct_fmt ") == %zu, \"layout of struct %.*s\");\n\n", ezyt_struct_arg(s), size,
+              ezyt_struct_arg(s));
+  free(order);
+  return ok;
+}
+
+// a field that is not all zero bits when it is left out
+static bool ezyt_field_needs_init(const struct ezy_ast_datatype_t *dt)
+{
+  if (ezyt_is_vec(dt))
+    return dt->nullable || dt->ext.array_t->length != 0 || dt->ext.array_t->max_length != 0;
+  if (dt->typ == ezy_ast_dt_struct)
+  {
+    const struct ezy_ast_struct_t *s = dt->ext.struct_t;
+    for (size_t i = 0; i < s->count; i++)
+    {
+      if (ezyt_field_needs_init(&s->members[i].typ))
+        return true;
+    }
+    return false;
+  }
+  // bool? and string? have a null that is not zero, union tags may not
+  return ezyt_union_nullable(dt) || (ezyt_is_opt(dt) && !ezyt_opt_flagged(dt));
+}
+
+static bool ezyt_struct_defaults(const struct ezy_ast_struct_t *s, const struct ezy_ast_struct_lit_t *lit, bool comma, ezy_emit_t *out);
+
+// constant initializer of a field left out: null, or an empty array
+static void ezyt_field_init(const struct ezy_ast_datatype_t *dt, ezy_emit_t *out)
+{
+  if (ezyt_is_vec(dt))
+  {
+    ezyemit_str(out, dt->nullable ? "{.len = SIZE_MAX, .guide = " : "{.guide = ");
+    ezyemit_uint(out, dt->ext.array_t->length);
+    ezyemit_str(out, ", .max = ");
+    ezyemit_uint(out, dt->ext.array_t->max_length);
+    ezyemit_char(out, '}');
+  }
+  else if (dt->typ == ezy_ast_dt_struct)
+  {
+    ezyemit_char(out, '{');
+    if (!ezyt_struct_defaults(dt->ext.struct_t, NULL, false, out))
+      ezyemit_char(out, '0');
+    ezyemit_char(out, '}');
+  }
+  else
+  {
+    ezyt_null_value(dt, true, out);
+  }
+}
+
+// Designated initializers of the fields a literal leaves out (all of them
+// for a NULL lit) that do not start as zero bits. Returns whether any
+// was emitted.
+static bool ezyt_struct_defaults(const struct ezy_ast_struct_t *s, const struct ezy_ast_struct_lit_t *lit, bool comma, ezy_emit_t *out)
+{
+  bool emitted = false;
+  for (size_t f = 0; f < s->count; f++)
+  {
+    bool given = false;
+    for (size_t i = 0; lit != NULL && i < lit->count && !given; i++)
+      given = lit->fields[i] == f;
+    if (given || !ezyt_field_needs_init(&s->members[f].typ))
+      continue;
+    ezyemit_str(out, comma || emitted ? ", ." : ".");
+    ezyemit_ident(out, s->members[f].name);
+    ezyemit_str(out, " = ");
+    ezyt_field_init(&s->members[f].typ, out);
+    emitted = true;
+  }
+  return emitted;
+}
+
+// ================ Arrays ================
+// Dynamic arrays are monomorphized: every element type T used by the
+// program gets its own vector type from ezyrt_vec_define (ezyrt_vec.h),
+// named after T, e.g. int32[] -> ezy_vec_i32, int32[][] -> ezy_vec_vi32.
+// Small vectors (ezyrt_svec_define) also carry their inline capacity:
+// int32[4?] kept inline -> ezy_svec_i32_4. Optional elements are marked
+// with 'o': int32?[] -> ezy_vec_oi32, unions with 'u': Num[] -> ezy_vec_uNum,
+// structs with 'S': Rec[] -> ezy_vec_SRec.
+
+#define ezyt_mangle_max 64
+#define ezyt_vec_name_max (ezyt_mangle_max + 32)
+
+// short name of a vector element type, false if it cannot be an element
+static bool ezyt_mangle(const struct ezy_ast_datatype_t *dt, char *buf, size_t *len)
 {
-  // make a static table mapping
   static const struct
   {
     enum ezy_ast_datatype_typ typ;
-    const char *c_type;
-  } type_mapping[] = {
-      {ezy_ast_dt_int8, "int8_t"},
-      {ezy_ast_dt_uint8, "uint8_t"},
-      {ezy_ast_dt_int16, "int16_t"},
-      {ezy_ast_dt_uint16, "uint16_t"},
-      {ezy_ast_dt_int32, "int32_t"},
-      {ezy_ast_dt_uint32, "uint32_t"},
-      {ezy_ast_dt_int64, "int64_t"},
-      {ezy_ast_dt_uint64, "uint64_t"},
-      {ezy_ast_dt_float32, "float"},
-      {ezy_ast_dt_float64, "double"},
-      {ezy_ast_dt_bool, "bool"},
-      {ezy_ast_dt_char, "char"},
-      {ezy_ast_dt_string, "char*"},
-      {ezy_ast_dt_void, "void"},
+    const char *name;
+  } names[] = {
+      {ezy_ast_dt_int8, "i8"},
+      {ezy_ast_dt_uint8, "u8"},
+      {ezy_ast_dt_int16, "i16"},
+      {ezy_ast_dt_uint16, "u16"},
+      {ezy_ast_dt_int32, "i32"},
+      {ezy_ast_dt_uint32, "u32"},
+      {ezy_ast_dt_int64, "i64"},
+      {ezy_ast_dt_uint64, "u64"},
+      {ezy_ast_dt_float32, "f32"},
+      {ezy_ast_dt_float64, "f64"},
+      {ezy_ast_dt_bool, "b"},
+      {ezy_ast_dt_char, "c"},
+      {ezy_ast_dt_string, "s"},
+      {ezy_ast_dt_var, "var"},
   };
 
-  if ( datatype->is_const ) {
-    ezyt_append(out, "const ");
+  // vector of vectors: one 'v' per level
+  while (dt->typ == ezy_ast_dt_array && dt->ext.array_t->dynamic)
+  {
+    if (*len + 1 >= ezyt_mangle_max)
+      return false;
+    buf[(*len)++] = 'v';
+    dt = &dt->ext.array_t->typ;
+  }
+  if (ezyt_is_opt(dt))
+  {
+    if (*len + 1 >= ezyt_mangle_max)
+      return false;
+    buf[(*len)++] = 'o';
+  }
+
+  for (size_t i = 0; i < sizeof(names) / sizeof(names[0]); i++)
+  {
+    if (dt->typ != names[i].typ)
+      continue;
+    size_t n = strlen(names[i].name);
+    if (*len + n >= ezyt_mangle_max)
+      return false;
+    memcpy(buf + *len, names[i].name, n);
+    *len += n;
+    return true;
+  }
+  if (ezyt_is_union(dt))
+  {
+    // 'u' and the union name, the same for U and U?
+    size_t n = dt->ext.union_t->name.len;
+    if (*len + 1 + n >= ezyt_mangle_max)
+      return false;
+    buf[(*len)++] = 'u';
+    memcpy(buf + *len, dt->ext.union_t->name.ptr, n);
+    *len += n;
+    return true;
+  }
+  if (dt->typ == ezy_ast_dt_struct)
+  {
+    size_t n = dt->ext.struct_t->name.len;
+    if (*len + 1 + n >= ezyt_mangle_max)
+      return false;
+    buf[(*len)++] = 'S';
+    memcpy(buf + *len, dt->ext.struct_t->name.ptr, n);
+    *len += n;
+    return true;
+  }
+  return false; // fixed arrays
+}
+
+// NUL terminated name of the vector type for the dynamic array type `dt`
+static bool ezyt_vec_type_name(const struct ezy_ast_datatype_t *dt, char *buf, size_t *len)
+{
+  struct ezy_ast_array_t *arr = dt->ext.array_t;
+  const char *prefix = arr->inline_cap > 0 ? "ezy_svec_" : "ezy_vec_";
+  *len = strlen(prefix);
+  memcpy(buf, prefix, *len);
+  if (!ezyt_mangle(&arr->typ, buf, len))
+    return false;
+  int n = 0;
+  if (arr->inline_cap > 0)
+    n = snprintf(buf + *len, ezyt_vec_name_max - *len, "_%zu", arr->inline_cap);
+  *len += (size_t)n;
+  buf[*len] = '\0';
+  return true;
+}
+
+// NUL terminated name of the bitmap array type for `dt`, see ezyt_is_optarr
+static bool ezyt_optarr_type_name(const struct ezy_ast_datatype_t *dt, char *buf, size_t *len)
+{
+  struct ezy_ast_datatype_t elem = dt->ext.array_t->typ;
+  elem.nullable = false; // the name says it already
+  *len = strlen("ezy_optarr_");
+  memcpy(buf, "ezy_optarr_", *len);
+  if (!ezyt_mangle(&elem, buf, len))
+    return false;
+  *len += (size_t)snprintf(buf + *len, ezyt_vec_name_max - *len, "_%zu", dt->ext.array_t->length);
+  return true;
+}
+
+static bool ezyt_optarr_name(const struct ezy_ast_datatype_t *dt, ezy_emit_t *out)
+{
+  char buf[ezyt_vec_name_max];
+  size_t len = 0;
+  if (!ezyt_optarr_type_name(dt, buf, &len))
+  {
+    ezy_log_warn("Unsupported optional array element type %d", dt->ext.array_t->typ.typ);
+    return false;
+  }
+  ezyemit_bytes(out, buf, len);
+  return true;
+}
+
+static bool ezyt_vec_name(const struct ezy_ast_datatype_t *dt, ezy_emit_t *out)
+{
+  char buf[ezyt_vec_name_max];
+  size_t len = 0;
+  if (!ezyt_vec_type_name(dt, buf, &len))
+  {
+    ezy_log_warn("Unsupported dynamic array element type %d", dt->ext.array_t->typ.typ);
+    return false;
+  }
+  ezyemit_bytes(out, buf, len);
+  return true;
+}
+
+// `[n]` declarator suffixes of a fixed array, outermost first, down to
+// an element type that is a struct of its own (bitmap arrays)
+static void ezyt_array_suffix(const struct ezy_ast_datatype_t *dt, ezy_emit_t *out)
+{
+  while (dt->typ == ezy_ast_dt_array && !dt->ext.array_t->dynamic && !ezyt_is_optarr(dt))
+  {
+    ezyemit_char(out, '[');
+    ezyemit_uint(out, dt->ext.array_t->length);
+    ezyemit_char(out, ']');
+    dt = &dt->ext.array_t->typ;
+  }
+}
+
+static inline bool ezyt_is_vec(const struct ezy_ast_datatype_t *dt)
+{
+  return dt->typ == ezy_ast_dt_array && dt->ext.array_t->dynamic;
+}
+
+// Vector, bitmap array and struct types used by a program, in the order
+// C needs them: member types first. A struct entry has an empty name.
+struct ezyt_vec_set
+{
+  char (*names)[ezyt_vec_name_max];
+  struct ezy_ast_datatype_t *types;
+  size_t count;
+  size_t cap;
+};
+
+static void ezyt_vec_set_add(struct ezyt_vec_set *set, const struct ezy_ast_datatype_t *dt)
+{
+  char buf[ezyt_vec_name_max] = {0};
+  if (dt->typ == ezy_ast_dt_struct)
+  {
+    for (size_t i = 0; i < set->count; i++)
+    {
+      if (set->types[i].typ == ezy_ast_dt_struct && set->types[i].ext.struct_t == dt->ext.struct_t)
+        return;
+    }
+    // fields first, a struct field is defined by value
+    const struct ezy_ast_struct_t *s = dt->ext.struct_t;
+    for (size_t i = 0; i < s->count; i++)
+      ezyt_vec_set_add(set, &s->members[i].typ);
+  }
+  else
+  {
+    if (dt->typ != ezy_ast_dt_array)
+      return;
+    // register the element type first, its vector is a member of this one
+    ezyt_vec_set_add(set, &dt->ext.array_t->typ);
+    if (!dt->ext.array_t->dynamic && !ezyt_is_optarr(dt))
+      return;
+
+    size_t len = 0;
+    bool named = dt->ext.array_t->dynamic ? ezyt_vec_type_name(dt, buf, &len) : ezyt_optarr_type_name(dt, buf, &len);
+    if (!named)
+      return; // reported where the type is emitted
+    for (size_t i = 0; i < set->count; i++)
+    {
+      if (strcmp(set->names[i], buf) == 0)
+        return;
+    }
+  }
+  if (set->count == set->cap)
+  {
+    size_t cap = set->cap != 0 ? set->cap * 2 : 8;
+    char (*names)[ezyt_vec_name_max] = realloc(set->names, cap * sizeof(*names));
+    if (names == NULL)
+      return;
+    set->names = names;
+    struct ezy_ast_datatype_t *types = realloc(set->types, cap * sizeof(*types));
+    if (types == NULL)
+      return;
+    set->types = types;
+    set->cap = cap;
+  }
+  memcpy(set->names[set->count], buf, sizeof(buf));
+  set->types[set->count] = *dt;
+  set->count++;
+}
+
+// every declared type in the program (bodies are flat statement lists)
+static void ezyt_vec_set_collect(struct ezyt_vec_set *set, ezy_ast_node_t *root)
+{
+  for (ezy_ast_node_t *node = root; node != NULL; node = node->next)
+  {
+    if (node->type == ezy_ast_node_variable_decl)
+    {
+      ezyt_vec_set_add(set, &node->data.n_variable.typ);
+      continue;
+    }
+    if (node->type == ezy_ast_node_struct)
+    {
+      // defined even when unused, --dump-layout lists it
+      ezyt_vec_set_add(set, &(struct ezy_ast_datatype_t){.typ = ezy_ast_dt_struct, .ext.struct_t = node->data.n_struct});
+      continue;
+    }
+    if (node->type != ezy_ast_node_function)
+      continue;
+    struct ezy_ast_function_t *fn = node->data.n_function;
+    ezyt_vec_set_add(set, &fn->return_typ);
+    for (size_t i = 0; i < fn->param_count; i++)
+      ezyt_vec_set_add(set, &fn->params[i].typ);
+    for (ezy_ast_node_t *stmt = fn->body; stmt != NULL; stmt = stmt->next)
+    {
+      if (stmt->type == ezy_ast_node_variable_decl)
+        ezyt_vec_set_add(set, &stmt->data.n_variable.typ);
+    }
+  }
+}
+
+// ================ Stack allocation ================
+// What ezysema found not to escape its function lives on the stack:
+//  - a local dynamic array keeps its elements inline (ezyrt_svec_define):
+//    up to its max length, or else its guide length, when that is at most
+//    opts->small_array_max; an array with neither keeps the first
+//    ezyt_stack_array_min elements, the capacity a heap vector starts
+//    with. One that outgrows them moves to the heap and is freed on
+//    every return (ezyt_exit_code).
+//  - a string concatenation is built in a buffer of ezyrt_str_stack_size
+//    bytes, one per concatenation for the first ezyt_stack_str_max of
+//    them in a function; longer results are allocated as before. With no
+//    loops a concatenation runs once per call, so its buffer never holds
+//    one of its own operands.
+
+#define ezyt_stack_array_min 8
+#define ezyt_stack_str_max 32
+
+static bool ezyt_is_builtin(struct ezy_ast_call_t *call, const char *name);
+static inline bool ezyt_is_str_concat(ezy_ast_node_t *node);
+static inline bool ezyt_str_concat_inner(struct ezywalk_t *w, ezy_ast_node_t *node);
+
+struct ezyt_stack_sel
+{
+  struct ezytranspile_stats *stats;
+  unsigned bufs; // string buffers numbered in the function so far
+};
+
+static enum ezywalk_action ezyt_stack_str_pre(struct ezywalk_t *w, ezy_ast_node_t *node)
+{
+  struct ezyt_stack_sel *sel = w->ctx;
+  if (!ezyt_is_str_concat(node) || ezyt_str_concat_inner(w, node))
+    return ezywalk_continue;
+  sel->stats->alloc_sites++;
+  if (node->data.n_binop.stack_buf == 0)
+    return ezywalk_continue;
+  if (sel->bufs == ezyt_stack_str_max)
+  {
+    node->data.n_binop.stack_buf = 0;
+    return ezywalk_continue;
+  }
+  node->data.n_binop.stack_buf = ++sel->bufs;
+  sel->stats->stack_sites++;
+  return ezywalk_continue;
+}
+
+// inline elements of a local array that does not escape, 0 for the heap
+static size_t ezyt_stack_array_cap(struct ezy_ast_variable_t *var, size_t limit)
+{
+  struct ezy_ast_array_t *arr = var->typ.ext.array_t;
+  if (var->sym == NULL || var->sym->escapes)
+    return 0;
+  if (arr->max_length != 0)
+    return arr->max_length <= limit ? arr->max_length : 0; // never spills
+  if (arr->length != 0)
+    return arr->length <= limit ? arr->length : 0;
+  size_t count = var->value != NULL ? var->value->data.n_array_lit.count : 0;
+  size_t cap = count > ezyt_stack_array_min ? count : ezyt_stack_array_min;
+  if (cap > limit)
+    cap = count <= limit ? limit : 0;
+  return cap;
+}
+
+// Decide inline_cap for every local dynamic array and number the string
+// buffers. Runs once before code generation, the vector types it picks
+// are defined in the prologue.
+static void ezyt_stack_select(ezy_ast_node_t *root, size_t limit, struct ezytranspile_stats *stats)
+{
+  struct ezytranspile_stats unused = {0};
+  struct ezyt_stack_sel sel = {.stats = stats != NULL ? stats : &unused};
+  struct ezywalk_t w = {.pre = ezyt_stack_str_pre, .ctx = &sel};
+  for (ezy_ast_node_t *node = root; node != NULL; node = node->next)
+  {
+    if (node->type != ezy_ast_node_function)
+      continue;
+    struct ezy_ast_function_t *fn = node->data.n_function;
+    for (ezy_ast_node_t *stmt = fn->body; stmt != NULL; stmt = stmt->next)
+    {
+      if (stmt->type != ezy_ast_node_variable_decl || !ezyt_is_vec(&stmt->data.n_variable.typ))
+        continue;
+      struct ezy_ast_variable_t *var = &stmt->data.n_variable;
+      struct ezy_ast_array_t *arr = var->typ.ext.array_t;
+      arr->inline_cap = 0;
+      if (var->value != NULL && var->value->type != ezy_ast_node_array_lit)
+        continue; // shares another array's storage
+      sel.stats->alloc_sites++;
+      arr->inline_cap = ezyt_stack_array_cap(var, limit);
+      if (arr->inline_cap > 0)
+        sel.stats->stack_sites++;
+    }
+    sel.bufs = 0;
+    ezywalk_list(&w, fn->body);
+  }
+  ezywalk_release(&w);
+}
+
+static enum ezywalk_action ezyt_stack_bufs_pre(struct ezywalk_t *w, ezy_ast_node_t *node)
+{
+  unsigned *bufs = w->ctx;
+  if (node->type == ezy_ast_node_binop && node->data.n_binop.stack_buf > *bufs)
+    *bufs = node->data.n_binop.stack_buf;
+  return ezywalk_continue;
+}
+
+// string buffers ezyt_stack_select gave a function body
+static unsigned ezyt_stack_bufs(ezy_ast_node_t *body)
+{
+  unsigned bufs = 0;
+  struct ezywalk_t w = {.pre = ezyt_stack_bufs_pre, .ctx = &bufs};
+  ezywalk_list(&w, body);
+  ezywalk_release(&w);
+  return bufs;
+}
+
+// a stack array that may have moved to the heap
+static inline bool ezyt_svec_spills(const struct ezy_ast_datatype_t *dt)
+{
+  const struct ezy_ast_array_t *arr = dt->ext.array_t;
+  return arr->inline_cap > 0 && (arr->max_length == 0 || arr->max_length > arr->inline_cap);
+}
+
+// `fn main()` is C's int main(void), returning 0 like the other backends;
+// parameters it declares start at zero, nothing is bound to them
+static inline bool ezyt_void_main(const struct ezy_ast_function_t *fn)
+{
+  return fn != NULL && fn->name.len == 4 && memcmp(fn->name.ptr, "main", 4) == 0 &&
+         fn->return_typ.typ == ezy_ast_dt_void;
+}
+
+// What a return does before leaving the function: free the stack arrays
+// declared before t->stmt (every one at the end of the body) that moved
+// to the heap, then release the region. With `out` NULL only reports
+// whether there is anything to do.
+static bool ezyt_exit_code(struct ezyt_ctx *t, ezy_emit_t *out)
+{
+  if (t->fn == NULL)
+    return false;
+  bool any = t->fn->region;
+  for (ezy_ast_node_t *stmt = t->fn->body; stmt != NULL && stmt != t->stmt; stmt = stmt->next)
+  {
+    if (stmt->type != ezy_ast_node_variable_decl || !ezyt_is_vec(&stmt->data.n_variable.typ) ||
+        !ezyt_svec_spills(&stmt->data.n_variable.typ))
+      continue;
+    any = true;
+    if (out == NULL)
+      break;
+    ezyt_vec_name(&stmt->data.n_variable.typ, out);
+    ezyemit_str(out, "_free(&");
+    ezyemit_ident(out, stmt->data.n_variable.name);
+    ezyemit_str(out, ");\n");
+  }
+  if (out != NULL && t->fn->region)
+    ezyemit_str(out, "ezyrt_region_leave(ezy_region);\n");
+  return any;
+}
+
+// ================ Bounds checks ================
+// Array indexing is checked at run time (ezyrt_index, name_at) unless a
+// value range analysis proves the index in range. It walks each function
+// body in evaluation order; with no branches or loops in the language
+// a local's range after a statement is that of the value last stored:
+//  - integer locals, ranged by their initializer and assignments and
+//    clamped to their type; any other integer by its type (a uint8
+//    index fits a T[256]), 64 bit ones are not ranged by type
+//  - the least length of a local dynamic array: its literal, plus one
+//    for every push
+//  - + - * on ranges, `i % n` and `i / n` for a constant n and a
+//    non-negative i, `.length` of fixed arrays
+// An index is in range when its whole range is within [0, length).
+
+#define ezyt_range_max ((int64_t)1 << 40) // bounds beyond are not combined
+
+// the range of an expression is that of its binop tree, folded bottom up
+// on a walk: every node leaves its range on `spans`, a binop takes its
+// operands' off first
+struct ezyt_span
+{
+  int64_t lo, hi;
+  bool known;
+};
+
+struct ezyt_ranger
+{
+  struct ezywalk_t walk;
+  struct ezyt_span *spans;
+  size_t count;
+  size_t cap;
+};
+
+struct ezyt_bounds_sel
+{
+  enum ezytranspile_checks mode;
+  struct ezytranspile_stats *stats;
+  struct ezyt_ranger ranger;
+};
+
+// the values an integer of this type holds
+static bool ezyt_type_range(const struct ezy_ast_datatype_t *dt, int64_t *lo, int64_t *hi)
+{
+  if (dt->nullable)
+    return false;
+  switch (dt->typ)
+  {
+  case ezy_ast_dt_bool: *lo = 0, *hi = 1; return true;
+  case ezy_ast_dt_int8: *lo = INT8_MIN, *hi = INT8_MAX; return true;
+  case ezy_ast_dt_int16: *lo = INT16_MIN, *hi = INT16_MAX; return true;
+  case ezy_ast_dt_int32: *lo = INT32_MIN, *hi = INT32_MAX; return true;
+  case ezy_ast_dt_uint8:
+  case ezy_ast_dt_char: *lo = 0, *hi = UINT8_MAX; return true;
+  case ezy_ast_dt_uint16: *lo = 0, *hi = UINT16_MAX; return true;
+  case ezy_ast_dt_uint32: *lo = 0, *hi = UINT32_MAX; return true;
+  default: return false; // 64 bits: anything
+  }
+}
+
+static inline bool ezyt_range_small(int64_t lo, int64_t hi)
+{
+  return lo >= -ezyt_range_max && hi <= ezyt_range_max;
+}
+
+static inline bool ezyt_is_int_dt(enum ezy_ast_datatype_typ typ);
+
+static bool ezyt_range_binop(ezy_ast_node_t *node, const struct ezyt_span operands[2], int64_t *lo, int64_t *hi)
+{
+  struct ezy_ast_binop_t *binop = &node->data.n_binop;
+  int64_t llo = operands[0].lo, lhi = operands[0].hi, rlo = operands[1].lo, rhi = operands[1].hi;
+  bool left = operands[0].known, right = operands[1].known;
+  switch (binop->operator)
+  {
+  case ezy_op_modulo:
+    if (!left || !right || llo < 0 || rlo != rhi || rlo <= 0)
+      return false;
+    *lo = 0, *hi = lhi < rlo - 1 ? lhi : rlo - 1;
+    return true;
+  case ezy_op_divide:
+    if (!left || !right || llo < 0 || rlo != rhi || rlo <= 0)
+      return false;
+    *lo = llo / rlo, *hi = lhi / rlo;
+    return true;
+  case ezy_op_plus:
+  case ezy_op_minus:
+  case ezy_op_asterisk:
+    if (!left || !right || !ezyt_range_small(llo, lhi) || !ezyt_range_small(rlo, rhi))
+      return false;
+    if (binop->operator == ezy_op_plus)
+      *lo = llo + rlo, *hi = lhi + rhi;
+    else if (binop->operator == ezy_op_minus)
+      *lo = llo - rhi, *hi = lhi - rlo;
+    else
+    {
+      // products of 40 bit bounds overflow, keep them at 31
+      if (!(llo >= INT32_MIN && lhi <= INT32_MAX && rlo >= INT32_MIN && rhi <= INT32_MAX))
+        return false;
+      int64_t p[4] = {llo * rlo, llo * rhi, lhi * rlo, lhi * rhi};
+      *lo = *hi = p[0];
+      for (int i = 1; i < 4; i++)
+      {
+        *lo = p[i] < *lo ? p[i] : *lo;
+        *hi = p[i] > *hi ? p[i] : *hi;
+      }
+    }
+    return true;
+  default:
+    return false;
+  }
+}
+
+// the values `node` may evaluate to, false when nothing is known; a
+// binop's operands are ranged already
+static bool ezyt_range_node(ezy_ast_node_t *node, const struct ezyt_span operands[2], int64_t *lo, int64_t *hi)
+{
+  int64_t tlo, thi;
+  bool typed = ezyt_type_range(&node->eval_typ, &tlo, &thi);
+  switch (node->type)
+  {
+  case ezy_ast_node_literal:
+  {
+    struct ezy_ast_literal_t *lit = &node->data.n_literal;
+    if (lit->typ == ezy_ast_dt_char)
+      return *lo = *hi = lit->value.t_char, true;
+    if (lit->typ == ezy_ast_dt_uint64)
+      return lit->value.t_uint64 <= INT64_MAX && (*lo = *hi = (int64_t)lit->value.t_uint64, true);
+    if (ezyt_is_int_dt(lit->typ))
+      return *lo = *hi = lit->value.t_int64, true;
+    return false;
+  }
+  case ezy_ast_node_variable:
+  {
+    struct ezy_symbol_t *sym = node->data.n_variable.sym;
+    if (sym != NULL && sym->kind == ezy_sym_local && sym->ranged && sym->typ->typ != ezy_ast_dt_array)
+      return *lo = sym->range_lo, *hi = sym->range_hi, true;
+    break;
+  }
+  case ezy_ast_node_member:
+  {
+    struct ezy_ast_datatype_t *obj = &node->data.n_member.object->eval_typ;
+    if (obj->typ == ezy_ast_dt_array && !obj->ext.array_t->dynamic)
+      return *lo = *hi = (int64_t)obj->ext.array_t->length, true;
+    break;
+  }
+  case ezy_ast_node_binop:
+    if (ezyt_range_binop(node, operands, lo, hi))
+    {
+      // C computes in the result's type, a range beyond it may wrap
+      if (typed && (*lo < tlo || *hi > thi))
+        return *lo = tlo, *hi = thi, true;
+      // a uint64 below zero wraps
+      return typed || node->eval_typ.typ == ezy_ast_dt_int64 || (node->eval_typ.typ == ezy_ast_dt_uint64 && *lo >= 0);
+    }
+    break;
+  default:
+    break;
+  }
+  if (!typed)
+    return false;
+  *lo = tlo, *hi = thi;
+  return true;
+}
+
+// only binops are descended into, anything else is ranged whole
+static enum ezywalk_action ezyt_range_pre(struct ezywalk_t *w, ezy_ast_node_t *node)
+{
+  (void)w;
+  return node->type == ezy_ast_node_binop ? ezywalk_continue : ezywalk_skip;
+}
+
+static enum ezywalk_action ezyt_range_post(struct ezywalk_t *w, ezy_ast_node_t *node)
+{
+  struct ezyt_ranger *r = w->ctx;
+  struct ezyt_span operands[2] = {{0}}; // a missing operand is unknown
+  if (node->type == ezy_ast_node_binop)
+  {
+    if (node->data.n_binop.right != NULL)
+      operands[1] = r->spans[--r->count];
+    if (node->data.n_binop.left != NULL)
+      operands[0] = r->spans[--r->count];
+  }
+  if (r->count == r->cap)
+  {
+    size_t cap = r->cap > 0 ? r->cap * 2 : 16;
+    struct ezyt_span *spans = realloc(r->spans, cap * sizeof *spans);
+    if (spans == NULL)
+      return ezywalk_stop;
+    r->spans = spans;
+    r->cap = cap;
+  }
+  struct ezyt_span *span = &r->spans[r->count++];
+  span->known = ezyt_range_node(node, operands, &span->lo, &span->hi);
+  return ezywalk_continue;
+}
+
+// the values `node` may evaluate to, false when nothing is known
+static bool ezyt_range(struct ezyt_ranger *r, ezy_ast_node_t *node, int64_t *lo, int64_t *hi)
+{
+  r->count = 0;
+  if (!ezywalk_node(&r->walk, node) || r->count != 1 || !r->spans[0].known)
+    return false;
+  *lo = r->spans[0].lo, *hi = r->spans[0].hi;
+  return true;
+}
+
+// a local whose range the walk follows, NULL for anything else
+static struct ezy_symbol_t *ezyt_ranged_local(ezy_ast_node_t *node)
+{
+  if (node == NULL || node->type != ezy_ast_node_variable)
+    return NULL;
+  struct ezy_symbol_t *sym = node->data.n_variable.sym;
+  return sym != NULL && sym->kind == ezy_sym_local && sym->ranged ? sym : NULL;
+}
+
+// an integer local, ranged again by the next value stored even while
+// nothing is known of it (an int64 set from a parameter)
+static struct ezy_symbol_t *ezyt_int_local(ezy_ast_node_t *node)
+{
+  if (node == NULL || node->type != ezy_ast_node_variable)
+    return NULL;
+  struct ezy_symbol_t *sym = node->data.n_variable.sym;
+  return sym != NULL && sym->kind == ezy_sym_local && !sym->typ->nullable && ezyt_is_int_dt(sym->typ->typ) ? sym : NULL;
+}
+
+// a local's range after it is set to `value` (NULL: to anything of its type)
+static void ezyt_range_store(struct ezyt_ranger *r, struct ezy_symbol_t *sym, ezy_ast_node_t *value)
+{
+  int64_t lo, hi;
+  if (sym->typ->typ == ezy_ast_dt_array)
+  {
+    // the least length
+    lo = value != NULL && value->type == ezy_ast_node_array_lit ? (int64_t)value->data.n_array_lit.count : 0;
+    sym->range_lo = lo;
+    return;
+  }
+  if (value == NULL || !ezyt_range(r, value, &lo, &hi))
+  {
+    sym->ranged = ezyt_type_range(sym->typ, &sym->range_lo, &sym->range_hi);
+    return;
+  }
+  int64_t tlo, thi;
+  if (ezyt_type_range(sym->typ, &tlo, &thi) && (lo < tlo || hi > thi))
+    lo = tlo, hi = thi; // converted on the way in
+  else if (sym->typ->typ == ezy_ast_dt_uint64 && lo < 0)
+  {
+    sym->ranged = false; // wraps to beyond INT64_MAX
+    return;
+  }
+  sym->ranged = true;
+  sym->range_lo = lo;
+  sym->range_hi = hi;
+}
+
+static enum ezywalk_action ezyt_bounds_post(struct ezywalk_t *w, ezy_ast_node_t *node)
+{
+  struct ezyt_bounds_sel *sel = w->ctx;
+  switch (node->type)
+  {
+  case ezy_ast_node_index:
+  {
+    struct ezy_ast_index_t *index = &node->data.n_index;
+    const struct ezy_ast_datatype_t *base = &index->base->eval_typ;
+    if (base->typ != ezy_ast_dt_array || sel->mode == ezytranspile_checks_off)
+      break;
+    sel->stats->index_sites++;
+    index->checked = true;
+    if (sel->mode == ezytranspile_checks_on)
+      break;
+    int64_t length = -1, lo, hi;
+    if (!base->ext.array_t->dynamic)
+      length = (int64_t)base->ext.array_t->length;
+    else if (ezyt_ranged_local(index->base) != NULL)
+      length = ezyt_ranged_local(index->base)->range_lo;
+    if (length > 0 && ezyt_range(&sel->ranger, index->index, &lo, &hi) && lo >= 0 && hi < length)
+    {
+      index->checked = false;
+      sel->stats->index_elided++;
+    }
+    break;
+  }
+  case ezy_ast_node_variable_decl:
+  {
+    struct ezy_ast_variable_t *var = &node->data.n_variable;
+    struct ezy_symbol_t *sym = var->sym;
+    if (sym == NULL || sym->kind != ezy_sym_local)
+      break;
+    int64_t lo, hi;
+    if (ezyt_is_vec(&var->typ) && !var->typ.nullable)
+      sym->ranged = true;
+    else if (!ezyt_type_range(&var->typ, &lo, &hi) && (var->typ.nullable || !ezyt_is_int_dt(var->typ.typ)))
+      break;
+    ezyt_range_store(&sel->ranger, sym, var->value);
+    if (var->value == NULL && sym->typ->typ != ezy_ast_dt_array)
+      sym->ranged = true, sym->range_lo = sym->range_hi = 0; // zeroed
+    break;
+  }
+  case ezy_ast_node_binop:
+  {
+    struct ezy_ast_binop_t *binop = &node->data.n_binop;
+    struct ezy_symbol_t *sym = ezyt_ranged_local(binop->left);
+    if (sym == NULL)
+      sym = ezyt_int_local(binop->left);
+    if (sym != NULL && binop->operator == ezy_op_assign)
+      ezyt_range_store(&sel->ranger, sym, binop->right);
+    break;
+  }
+  case ezy_ast_node_call:
+  {
+    // a push adds one element
+    struct ezy_ast_call_t *call = node->data.n_call;
+    struct ezy_symbol_t *sym = call->arg_count > 0 ? ezyt_ranged_local(&call->args[0]) : NULL;
+    if (sym != NULL && ezyt_is_builtin(call, "push"))
+      sym->range_lo++;
+    break;
+  }
+  default:
+    break;
+  }
+  return ezywalk_continue;
+}
+
+// Decide which index expressions are checked, once before code generation
+static void ezyt_bounds_select(ezy_ast_node_t *root, enum ezytranspile_checks mode, struct ezytranspile_stats *stats)
+{
+  struct ezytranspile_stats unused = {0};
+  struct ezyt_bounds_sel sel = {.mode = mode, .stats = stats != NULL ? stats : &unused};
+  sel.ranger.walk = (struct ezywalk_t){.pre = ezyt_range_pre, .post = ezyt_range_post, .ctx = &sel.ranger};
+  struct ezywalk_t w = {.post = ezyt_bounds_post, .ctx = &sel};
+  for (ezy_ast_node_t *node = root; node != NULL; node = node->next)
+  {
+    if (node->type == ezy_ast_node_function)
+      ezywalk_list(&w, node->data.n_function->body);
+    else if (node->type == ezy_ast_node_variable_decl)
+      ezywalk_node(&w, node); // globals are ranged by type only
+  }
+  ezywalk_release(&w);
+  ezywalk_release(&sel.ranger.walk);
+  free(sel.ranger.spans);
+}
+
+// ================ var ================
+// A var is an ezyrt_var (ezyrt_var.h). Values flow in and out of it
+// through conversions wrapped around an expression wherever its type
+// differs from the type it is stored as (ezyt_expected):
+//   let var v = n;       ->  ezyrt_var v = ezyrt_var_i32(n)
+//   let int64 m = v + 1; ->  int64_t m = ((int64_t)ezyrt_var_as_i64(ezyrt_var_add(v, ezyrt_var_i32(1))))
+//
+// The same mechanism moves values in and out of optionals:
+//   let int? o = n;      ->  ezyrt_opt_i32 o = ezyrt_opt_i32_some(n)
+//   let int m = o * 2;   ->  int32_t m = ezyrt_opt_i32_get(o) * 2
+
+enum ezyt_conv
+{
+  ezyt_conv_none = 0,
+  ezyt_conv_to_var,
+  ezyt_conv_from_var,
+  ezyt_conv_null,     // the null literal stored in a var or T?, emitted whole
+  ezyt_conv_bad_null, // the null literal stored in a plain T
+  ezyt_conv_wrap,     // T -> T?
+  ezyt_conv_unwrap,   // T? -> T, fatal at run time if null
+  ezyt_conv_to_union,   // a member value, or a T? through var
+  ezyt_conv_from_union, // the member read back, or anything else through var
+  ezyt_conv_to_cstr,    // string (or string?) passed to C, NUL terminated
+  ezyt_conv_from_cstr,  // a char* returned by C stored as a string
+};
+
+static const struct ezy_ast_datatype_t ezyt_dt_var = {.typ = ezy_ast_dt_var};
+static const struct ezy_ast_datatype_t ezyt_dt_int64 = {.typ = ezy_ast_dt_int64};
+// operands that need a plain value, a T? is unwrapped and anything else kept
+static const struct ezy_ast_datatype_t ezyt_dt_plain = {.typ = ezy_ast_dt_infer};
+// arguments of C functions, plain values except strings which become char*
+static const struct ezy_ast_datatype_t ezyt_dt_c = {.typ = ezy_ast_dt_unknown};
+
+// runtime tag of a static type, type_repr folds char into uint8
+static const char *ezyt_tag_name(enum ezy_ast_datatype_typ typ, bool repr)
+{
+  switch (typ)
+  {
+  case ezy_ast_dt_null: return "ezyrt_tag_null";
+  case ezy_ast_dt_bool: return "ezyrt_tag_bool";
+  case ezy_ast_dt_int8: return "ezyrt_tag_i8";
+  case ezy_ast_dt_uint8: return "ezyrt_tag_u8";
+  case ezy_ast_dt_int16: return "ezyrt_tag_i16";
+  case ezy_ast_dt_uint16: return "ezyrt_tag_u16";
+  case ezy_ast_dt_int32: return "ezyrt_tag_i32";
+  case ezy_ast_dt_uint32: return "ezyrt_tag_u32";
+  case ezy_ast_dt_int64: return "ezyrt_tag_i64";
+  case ezy_ast_dt_uint64: return "ezyrt_tag_u64";
+  case ezy_ast_dt_float32: return "ezyrt_tag_f32";
+  case ezy_ast_dt_float64: return "ezyrt_tag_f64";
+  case ezy_ast_dt_string: return "ezyrt_tag_string";
+  case ezy_ast_dt_array: return "ezyrt_tag_array";
+  case ezy_ast_dt_char: return repr ? "ezyrt_tag_u8" : "ezyrt_tag_char";
+  default: return NULL;
+  }
+}
+
+// suffix of the ezyrt_var_<suffix> constructor of a scalar type
+static const char *ezyt_var_ctor(enum ezy_ast_datatype_typ typ)
+{
+  switch (typ)
+  {
+  case ezy_ast_dt_int8: return "i8";
+  case ezy_ast_dt_uint8: return "u8";
+  case ezy_ast_dt_int16: return "i16";
+  case ezy_ast_dt_uint16: return "u16";
+  case ezy_ast_dt_int32: return "i32";
+  case ezy_ast_dt_uint32: return "u32";
+  case ezy_ast_dt_int64: return "i64";
+  case ezy_ast_dt_uint64: return "u64";
+  case ezy_ast_dt_float32: return "f32";
+  case ezy_ast_dt_float64: return "f64";
+  case ezy_ast_dt_bool: return "bool";
+  case ezy_ast_dt_char: return "char";
+  case ezy_ast_dt_string: return "str";
+  default: return NULL;
+  }
+}
+
+static enum ezyt_conv ezyt_conv_kind(const struct ezy_ast_datatype_t *from, const struct ezy_ast_datatype_t *to)
+{
+  if (to == NULL)
+    return ezyt_conv_none;
+  if (to == &ezyt_dt_plain)
+    return ezyt_is_opt(from) ? ezyt_conv_unwrap : ezyt_conv_none;
+  if (to == &ezyt_dt_c)
+    return from->typ == ezy_ast_dt_string ? ezyt_conv_to_cstr : ezyt_is_opt(from) ? ezyt_conv_unwrap : ezyt_conv_none;
+  if (from->typ == ezy_ast_dt_unknown && to->typ == ezy_ast_dt_string)
+    return ezyt_conv_from_cstr;
+  if (from->typ == ezy_ast_dt_null)
+    return to->typ == ezy_ast_dt_var || ezyt_is_opt(to) || ezyt_union_nullable(to) ? ezyt_conv_null : ezyt_conv_bad_null;
+  if (to->typ == ezy_ast_dt_var)
+    return from->typ == ezy_ast_dt_var ? ezyt_conv_none : ezyt_conv_to_var;
+  if (from->typ == ezy_ast_dt_var)
+    return ezyt_conv_from_var;
+  if (ezyt_is_union(from) && ezyt_is_union(to) && from->ext.union_t == to->ext.union_t)
+    return ezyt_conv_none;
+  if (ezyt_is_union(from))
+    return ezyt_conv_from_union;
+  if (ezyt_is_union(to))
+    return ezyt_conv_to_union;
+  if (ezyt_is_opt(from) && !ezyt_is_opt(to))
+    return ezyt_conv_unwrap;
+  if (!ezyt_is_opt(from) && ezyt_is_opt(to))
+    return ezyt_conv_wrap;
+  return ezyt_conv_none;
+}
+
+// ezyrt_opt_<T>_<fn>( for a scalar T?
+static void ezyt_opt_call(const struct ezy_ast_datatype_t *dt, const char *fn, ezy_emit_t *out)
+{
+  ezyemit_str(out, "ezyrt_opt_");
+  ezyemit_str(out, ezyt_var_ctor(dt->typ));
+  ezyemit_char(out, '_');
+  ezyemit_str(out, fn);
+  ezyemit_char(out, '(');
+}
+
+// null of a var or T?, `init` for the constant form of a declaration
+static bool ezyt_null_value(const struct ezy_ast_datatype_t *dt, bool init, ezy_emit_t *out)
+{
+  if (dt->typ == ezy_ast_dt_var)
+  {
+    ezyemit_str(out, init ? "{.tag = ezyrt_tag_null}" : "ezyrt_var_null()");
+    return true;
+  }
+  if (ezyt_is_union(dt))
+  {
+    const struct ezy_ast_union_t *u = dt->ext.union_t;
+    if (!init)
+      ezyemit_fmt(out, "(" ezyt_union_fmt ")", ezyt_union_arg(u));
+    ezyemit_fmt(out, "{.tag = " ezyt_union_fmt "_tag_null}", ezyt_union_arg(u));
+    return true;
+  }
+  if (ezyt_is_vec(dt))
+  {
+    ezyemit_char(out, '(');
+    if (!ezyt_vec_name(dt, out))
+      return false;
+    ezyemit_str(out, "){.len = SIZE_MAX}");
+    return true;
+  }
+  if (dt->typ == ezy_ast_dt_string)
+  {
+    ezyemit_str(out, init ? "ezyrt_str_null_init" : "ezyrt_str_null");
+    return true;
+  }
+  if (dt->typ == ezy_ast_dt_bool)
+  {
+    ezyemit_str(out, "ezyrt_opt_bool_null");
+    return true;
+  }
+  if (!init)
+  {
+    ezyemit_char(out, '(');
+    ezytranspile_datatype((struct ezy_ast_datatype_t *)dt, out);
+    ezyemit_char(out, ')');
+  }
+  ezyemit_str(out, "{0}");
+  return true;
+}
+
+// read a var as `to`, ezyt_from_var_close ends it
+static bool ezyt_from_var_open(const struct ezy_ast_datatype_t *to, ezy_emit_t *out)
+{
+  if (ezyt_is_union(to))
+  {
+    ezyt_union_call(to->ext.union_t, "from_var", out);
+    return true;
+  }
+  if (ezyt_is_opt(to) && to->typ != ezy_ast_dt_array)
+  {
+    ezyt_opt_call(to, "from_var", out);
+    return true;
+  }
+  static const struct
+  {
+    enum ezy_ast_datatype_typ typ;
+    const char *read;
+  } reads[] = {
+      {ezy_ast_dt_int8, "((int8_t)ezyrt_var_as_i64("},
+      {ezy_ast_dt_int16, "((int16_t)ezyrt_var_as_i64("},
+      {ezy_ast_dt_int32, "((int32_t)ezyrt_var_as_i64("},
+      {ezy_ast_dt_int64, "((int64_t)ezyrt_var_as_i64("},
+      {ezy_ast_dt_uint8, "((uint8_t)ezyrt_var_as_u64("},
+      {ezy_ast_dt_uint16, "((uint16_t)ezyrt_var_as_u64("},
+      {ezy_ast_dt_uint32, "((uint32_t)ezyrt_var_as_u64("},
+      {ezy_ast_dt_uint64, "((uint64_t)ezyrt_var_as_u64("},
+      {ezy_ast_dt_float32, "((float)ezyrt_var_as_f64("},
+      {ezy_ast_dt_float64, "((double)ezyrt_var_as_f64("},
+      {ezy_ast_dt_bool, "((bool)ezyrt_var_as_bool("},
+      {ezy_ast_dt_char, "((char)ezyrt_var_as_char("},
+      {ezy_ast_dt_string, "(ezyrt_var_as_str("},
+  };
+  for (size_t i = 0; i < sizeof(reads) / sizeof(reads[0]); i++)
+  {
+    if (reads[i].typ == to->typ)
+    {
+      ezyemit_str(out, reads[i].read);
+      return true;
+    }
+  }
+  ezy_log_warn("Cannot read a value of type %d out of a var", to->typ);
+  return false;
+}
+
+static void ezyt_from_var_close(const struct ezy_ast_datatype_t *to, ezy_emit_t *out)
+{
+  ezyemit_str(out, ezyt_is_opt(to) || ezyt_is_union(to) ? ")" : "))");
+}
+
+// Open the conversion of `node` to `to`, ezyt_conv_close ends it.
+static bool ezyt_conv_open(ezy_ast_node_t *node, const struct ezy_ast_datatype_t *to, ezy_emit_t *out)
+{
+  const struct ezy_ast_datatype_t *from = &node->eval_typ;
+  switch (ezyt_conv_kind(from, to))
+  {
+  case ezyt_conv_none:
+    if (to != NULL && ezyt_opt_flagged(from) && ezyt_opt_flagged(to) && from->typ != to->typ)
+    {
+      ezy_log_warn("Cannot convert an optional of type %d to an optional of type %d", from->typ, to->typ);
+      return false;
+    }
+    return true;
+  case ezyt_conv_null:
+    return ezyt_null_value(to, false, out);
+  case ezyt_conv_bad_null:
+    ezy_log_warn("Cannot store null in a value of type %d, it is not optional", to->typ);
+    return false;
+  case ezyt_conv_wrap:
+    if (ezyt_opt_flagged(to) || to->typ == ezy_ast_dt_bool)
+      ezyt_opt_call(to, "some", out);
+    return true;
+  case ezyt_conv_unwrap:
+    if (ezyt_is_vec(from))
+    {
+      // stays an lvalue, it may be pushed to or assigned through
+      ezyemit_str(out, "(*");
+      if (!ezyt_vec_name(from, out))
+        return false;
+      ezyemit_str(out, "_get(&(");
+      return true;
+    }
+    ezyt_opt_call(from, "get", out);
+    return true;
+  case ezyt_conv_to_var:
+  {
+    const char *ctor = ezyt_var_ctor(from->typ);
+    if (ctor != NULL && ezyt_is_opt(from))
+    {
+      ezyt_opt_call(from, "to_var", out);
+      return true;
+    }
+    if (ctor != NULL)
+    {
+      ezyemit_str(out, "ezyrt_var_");
+      ezyemit_str(out, ctor);
+      ezyemit_char(out, '(');
+      return true;
+    }
+    if (ezyt_is_union(from))
+    {
+      ezyt_union_call(from->ext.union_t, "to_var", out);
+      return true;
+    }
+    if (ezyt_is_vec(from))
+    {
+      // boxed, the var shares the elements
+      if (!ezyt_vec_name(from, out))
+        return false;
+      ezyemit_str(out, "_to_var(");
+      return true;
+    }
+    if (from->typ == ezy_ast_dt_array && node->type == ezy_ast_node_variable)
+    {
+      ezyemit_str(out, "ezyrt_var_of_array(");
+      return true;
+    }
+    ezy_log_warn("Cannot store a value of type %d in a var", from->typ);
+    return false;
+  }
+  case ezyt_conv_from_var:
+    return ezyt_from_var_open(to, out);
+  case ezyt_conv_to_union:
+  {
+    const struct ezy_ast_union_t *u = to->ext.union_t;
+    size_t tag;
+    if (!ezyt_is_opt(from) && ezyt_union_store_member(u, from->typ, &tag))
+    {
+      ezyt_union_store(u, tag, true, out);
+      return true;
+    }
+    if (ezyt_is_opt(from) && from->typ != ezy_ast_dt_array && ezyt_union_member(u, from->typ, &tag))
+    {
+      // the value or null, checked by from_var
+      ezyt_union_call(u, "from_var", out);
+      ezyt_opt_call(from, "to_var", out);
+      return true;
+    }
+    ezy_log_warn("Union %.*s has no member for a value of type %d", ezyt_union_arg(u), from->typ);
+    return false;
+  }
+  case ezyt_conv_from_union:
+  {
+    const struct ezy_ast_union_t *u = from->ext.union_t;
+    size_t tag;
+    if (!ezyt_is_opt(to) && ezyt_union_member(u, to->typ, &tag))
+    {
+      ezyemit_fmt(out, ezyt_union_fmt "_as_%s(", ezyt_union_arg(u), ezyt_union_field(to->typ));
+      return true;
+    }
+    if (!ezyt_from_var_open(to, out))
+      return false;
+    ezyt_union_call(u, "to_var", out);
+    return true;
+  }
+  case ezyt_conv_to_cstr:
+    // a null string? passes NULL
+    ezyemit_str(out, "ezyrt_str_cstr((ezyrt_str[1]){");
+    return true;
+  case ezyt_conv_from_cstr:
+    ezyemit_str(out, "ezyrt_str_c(");
+    return true;
+  }
+  return false;
+}
+
+static void ezyt_conv_close(ezy_ast_node_t *node, const struct ezy_ast_datatype_t *to, ezy_emit_t *out)
+{
+  const struct ezy_ast_datatype_t *from = &node->eval_typ;
+  switch (ezyt_conv_kind(from, to))
+  {
+  case ezyt_conv_to_var:
+  case ezyt_conv_from_cstr:
+    ezyemit_char(out, ')');
+    break;
+  case ezyt_conv_to_cstr:
+    ezyemit_str(out, "})");
+    break;
+  case ezyt_conv_from_var:
+    ezyt_from_var_close(to, out);
+    break;
+  case ezyt_conv_to_union:
+  {
+    size_t tag;
+    if (!ezyt_is_opt(from) && ezyt_union_store_member(to->ext.union_t, from->typ, &tag))
+      ezyt_union_store(to->ext.union_t, tag, false, out);
+    else
+      ezyemit_str(out, "))");
+    break;
+  }
+  case ezyt_conv_from_union:
+  {
+    size_t tag;
+    ezyemit_char(out, ')');
+    if (ezyt_is_opt(to) || !ezyt_union_member(from->ext.union_t, to->typ, &tag))
+      ezyt_from_var_close(to, out);
+    break;
+  }
+  case ezyt_conv_wrap:
+    if (ezyt_opt_flagged(to) || to->typ == ezy_ast_dt_bool)
+      ezyemit_char(out, ')');
+    break;
+  case ezyt_conv_unwrap:
+    ezyemit_str(out, ezyt_is_vec(from) ? ")))" : ")");
+    break;
+  default:
+    break;
+  }
+}
+
+static inline bool ezyt_is_null_lit(ezy_ast_node_t *node)
+{
+  return node->type == ezy_ast_node_literal && node->data.n_literal.typ == ezy_ast_dt_null;
+}
+
+// runtime function of an operator on vars, NULL if the binop is typed
+static const char *ezyt_var_binop(ezy_ast_node_t *node)
+{
+  struct ezy_ast_binop_t *binop = &node->data.n_binop;
+  if (binop->left == NULL || binop->right == NULL)
+    return NULL;
+  switch (binop->operator)
+  {
+  case ezy_op_cond_eq:
+  case ezy_op_cond_neq:
+  {
+    const struct ezy_ast_datatype_t *l = &binop->left->eval_typ, *r = &binop->right->eval_typ;
+    // unions compare as vars, except against null (ezyt_null_test)
+    bool unions = (ezyt_is_union(l) || ezyt_is_union(r)) && !ezyt_is_null_lit(binop->left) && !ezyt_is_null_lit(binop->right);
+    if (l->typ != ezy_ast_dt_var && r->typ != ezy_ast_dt_var && !unions)
+      return NULL;
+    return binop->operator == ezy_op_cond_eq ? "ezyrt_var_eq(" : "!ezyrt_var_eq(";
+  }
+  case ezy_op_plus:
+    return node->eval_typ.typ == ezy_ast_dt_var ? "ezyrt_var_add(" : NULL;
+  case ezy_op_minus:
+    return node->eval_typ.typ == ezy_ast_dt_var ? "ezyrt_var_sub(" : NULL;
+  case ezy_op_asterisk:
+    return node->eval_typ.typ == ezy_ast_dt_var ? "ezyrt_var_mul(" : NULL;
+  case ezy_op_divide:
+    return node->eval_typ.typ == ezy_ast_dt_var ? "ezyrt_var_div(" : NULL;
+  case ezy_op_modulo:
+    return node->eval_typ.typ == ezy_ast_dt_var ? "ezyrt_var_mod(" : NULL;
+  default:
+    return NULL;
+  }
+}
+
+// runtime function of an operator on two typed strings, NULL for any
+// other binop: == and != compare the contents, and a chain of + is one
+// call on all of its operands, see ezyt_str_concat_count
+//   a + b + c  ->  ezyrt_str_concat((ezyrt_str[]){a, b, c}, 3)
+static const char *ezyt_str_binop(ezy_ast_node_t *node)
+{
+  if (node == NULL || node->type != ezy_ast_node_binop)
+    return NULL;
+  struct ezy_ast_binop_t *binop = &node->data.n_binop;
+  if (binop->left == NULL || binop->right == NULL || binop->left->eval_typ.typ != ezy_ast_dt_string ||
+      binop->right->eval_typ.typ != ezy_ast_dt_string)
+    return NULL;
+  switch (binop->operator)
+  {
+  case ezy_op_cond_eq:
+    return "ezyrt_str_eq(";
+  case ezy_op_cond_neq:
+    return "!ezyrt_str_eq(";
+  case ezy_op_plus:
+    return node->eval_typ.typ == ezy_ast_dt_string ? "ezyrt_str_concat((ezyrt_str[]){" : NULL;
+  default:
+    return NULL;
+  }
+}
+
+static inline bool ezyt_is_str_concat(ezy_ast_node_t *node)
+{
+  return ezyt_str_binop(node) != NULL && node->data.n_binop.operator == ezy_op_plus;
+}
+
+// an operand of a concatenation that is one itself, its operands join the outer list
+static inline bool ezyt_str_concat_inner(struct ezywalk_t *w, ezy_ast_node_t *node)
+{
+  return ezyt_is_str_concat(node) && ezyt_is_str_concat(w->parent);
+}
+
+// operands of the flattened chain; recurses as deep as the parser did
+static size_t ezyt_str_concat_count(ezy_ast_node_t *node)
+{
+  size_t count = 0;
+  for (; ezyt_is_str_concat(node); node = node->data.n_binop.left)
+    count += ezyt_str_concat_count(node->data.n_binop.right);
+  return count + 1;
+}
+
+// typeof(x) / type_repr(x): the tag of a var, a constant otherwise
+static inline bool ezyt_is_type_id(struct ezy_ast_call_t *call, bool *repr)
+{
+  *repr = ezyt_is_builtin(call, "type_repr");
+  return *repr || ezyt_is_builtin(call, "typeof");
+}
+
+// `x == null` or `x != null` on a typed x: the operand x, which is tested
+// without unwrapping; NULL for any other binop
+static ezy_ast_node_t *ezyt_null_test(ezy_ast_node_t *node)
+{
+  struct ezy_ast_binop_t *binop = &node->data.n_binop;
+  if ((binop->operator != ezy_op_cond_eq && binop->operator != ezy_op_cond_neq) || ezyt_var_binop(node) != NULL ||
+      binop->left == NULL || binop->right == NULL)
+    return NULL;
+  if (ezyt_is_null_lit(binop->left) && !ezyt_is_null_lit(binop->right))
+    return binop->right;
+  if (ezyt_is_null_lit(binop->right) && !ezyt_is_null_lit(binop->left))
+    return binop->left;
+  return NULL;
+}
+
+// the test around the operand, on the niche or the flag; a type that is
+// not optional is never null
+static void ezyt_null_test_emit(ezy_ast_node_t *node, bool open, ezy_emit_t *out)
+{
+  const struct ezy_ast_datatype_t *dt = &ezyt_null_test(node)->eval_typ;
+  bool eq = node->data.n_binop.operator == ezy_op_cond_eq;
+  if (ezyt_union_nullable(dt))
+  {
+    if (open)
+      ezyemit_str(out, "((");
+    else
+      ezyemit_fmt(out, ").tag %s " ezyt_union_fmt "_tag_null)", eq ? "==" : "!=", ezyt_union_arg(dt->ext.union_t));
+  }
+  else if (!ezyt_is_opt(dt))
+    ezyemit_str(out, open ? "((void)(" : eq ? "), false)" : "), true)");
+  else if (ezyt_opt_flagged(dt))
+    ezyemit_str(out, open ? (eq ? "(!(" : "((") : ").has)");
+  else if (dt->typ == ezy_ast_dt_string)
+    ezyemit_str(out, open ? (eq ? "ezyrt_str_is_null((" : "!ezyrt_str_is_null((") : "))");
+  else if (open)
+    ezyemit_str(out, "((");
+  else if (ezyt_is_vec(dt))
+    ezyemit_str(out, eq ? ").len == SIZE_MAX)" : ").len != SIZE_MAX)");
+  else
+    ezyemit_str(out, eq ? ") == ezyrt_opt_bool_null)" : ") != ezyrt_opt_bool_null)");
+}
+
+// `a[i] = v` on a bitmap array: name_set(&(a), i, v)
+static inline bool ezyt_optarr_store(ezy_ast_node_t *node)
+{
+  struct ezy_ast_binop_t *binop = &node->data.n_binop;
+  return binop->operator == ezy_op_assign && binop->left != NULL && binop->left->type == ezy_ast_node_index &&
+         ezyt_is_optarr(&binop->left->data.n_index.base->eval_typ);
+}
+
+// the `a[i]` of such a store
+static inline bool ezyt_optarr_stored(struct ezywalk_t *w, ezy_ast_node_t *index)
+{
+  return w->parent != NULL && w->parent->type == ezy_ast_node_binop && ezyt_optarr_store(w->parent) &&
+         w->parent->data.n_binop.left == index;
+}
+
+// =============== Transpilation functions for specific nodes ================
+
+// Transpile a datatype to C type and append to output buffer
+bool ezytranspile_datatype(struct ezy_ast_datatype_t *datatype, ezy_emit_t *out)
+{
+  // make a static table mapping
+  static const struct
+  {
+    enum ezy_ast_datatype_typ typ;
+    const char *c_type;
+  } type_mapping[] = {
+      {ezy_ast_dt_int8, "int8_t"},
+      {ezy_ast_dt_uint8, "uint8_t"},
+      {ezy_ast_dt_int16, "int16_t"},
+      {ezy_ast_dt_uint16, "uint16_t"},
+      {ezy_ast_dt_int32, "int32_t"},
+      {ezy_ast_dt_uint32, "uint32_t"},
+      {ezy_ast_dt_int64, "int64_t"},
+      {ezy_ast_dt_uint64, "uint64_t"},
+      {ezy_ast_dt_float32, "float"},
+      {ezy_ast_dt_float64, "double"},
+      {ezy_ast_dt_bool, "bool"},
+      {ezy_ast_dt_char, "char"},
+      {ezy_ast_dt_string, "ezyrt_str"},
+      {ezy_ast_dt_void, "void"},
+      {ezy_ast_dt_var, "ezyrt_var"},
+  };
+
+  if ( datatype->is_const ) {
+    ezyemit_str(out, "const ");
+  }
+
+  if (datatype->typ == ezy_ast_dt_array)
+  {
+    // fixed arrays are the element type plus a declarator suffix (see
+    // ezyt_array_suffix), dynamic arrays are a vector per element type
+    struct ezy_ast_array_t *arr = datatype->ext.array_t;
+    if (!arr->dynamic && datatype->nullable)
+    {
+      ezy_log_warn("Optional fixed arrays are not supported, use optional elements or a dynamic array");
+      return false;
+    }
+    if (ezyt_is_optarr(datatype))
+      return ezyt_optarr_name(datatype, out);
+    if (!arr->dynamic)
+      return ezytranspile_datatype(&arr->typ, out);
+    return ezyt_vec_name(datatype, out);
+  }
+
+  if (ezyt_is_union(datatype))
+  {
+    ezyemit_fmt(out, ezyt_union_fmt, ezyt_union_arg(datatype->ext.union_t));
+    return true;
+  }
+
+  if (datatype->typ == ezy_ast_dt_struct)
+  {
+    if (datatype->nullable)
+    {
+      ezy_log_warn("Optional structs are not supported, make the fields optional");
+      return false;
+    }
+    ezyemit_fmt(out, ezyt_struct_fmt, ezyt_struct_arg(datatype->ext.struct_t));
+    return true;
+  }
+
+  if (ezyt_is_opt(datatype) && datatype->typ != ezy_ast_dt_string)
+  {
+    // string? is the same ezyrt_str, see Optionals
+    ezyemit_str(out, "ezyrt_opt_");
+    ezyemit_str(out, ezyt_var_ctor(datatype->typ));
+    return true;
+  }
+
+  for (size_t i = 0; i < sizeof(type_mapping) / sizeof(type_mapping[0]); i++)
+  {
+    if (datatype->typ == type_mapping[i].typ)
+    {
+      ezyemit_str(out, type_mapping[i].c_type);
+      return true;
+    }
+  }
+
+  if ( datatype->is_ptr ) {
+    ezyemit_str(out, " *");
+  }
+
+  return false;
+}
+
+void ezyt_append_char_literal(char c, ezy_emit_t *out)
+{
+  ezyemit_char(out, '\'');
+  switch (c)
+  {
+  case '\n':
+    ezyemit_str(out, "\\n");
+    break;
+  case '\t':
+    ezyemit_str(out, "\\t");
+    break;
+  case '\\':
+    ezyemit_str(out, "\\\\");
+    break;
+  case '\'':
+    ezyemit_str(out, "\\\'");
+    break;
+  default:
+    if (c >= 32 && c <= 126)
+    {
+      ezyemit_char(out, c);
+    }
+    else
+    {
+      ezyt_append_hex_escape(out, (unsigned char)c);
+    }
+    break;
+  }
+  ezyemit_char(out, '\'');
+}
+
+void ezyt_append_str_literal(ezy_cstr_t str, ezy_emit_t *out)
+{
+  // handle escaping
+  ezyemit_char(out, '"');
+  bool has_escape = false;
+  for (size_t i = 0; i < str.len; i++)
+  {
+    char c = str.ptr[i];
+    if (has_escape)
+    {
+      has_escape = false;
+      switch (c)
+      {
+      case 'n':
+        ezyemit_str(out, "\\n");
+        break;
+      case 't':
+        ezyemit_str(out, "\\t");
+        break;
+      case '\\':
+        ezyemit_str(out, "\\\\");
+        break;
+      case '"':
+        ezyemit_str(out, "\\\"");
+        break;
+      case '\'':
+        ezyemit_str(out, "\\\'");
+        break;
+      default:
+        ezy_log_warn("Unsupported escape sequence \\%c in string literal", c);
+        if (c >= 32 && c <= 126)
+          ezyemit_fmt(out, "<?\\%c>", c);
+        else
+          ezyemit_fmt(out, "<?\\x%02x>", (unsigned char)c);
+        break;
+      }
+      continue;
+    }
+    if (c == '\\')
+    {
+      has_escape = true;
+      continue;
+    }
+    if (c >= 32 && c <= 126)
+    {
+      ezyemit_char(out, c);
+    }
+    else
+    {
+      ezyt_append_hex_escape(out, (unsigned char)c);
+    }
+  }
+  if (has_escape) {
+    ezy_log_warn("String ends with trailing backslash");
+    ezyemit_str(out, "<?\\>");
+  }
+  ezyemit_char(out, '"');
+}
+
+// a string literal is a slice of the C literal, its length known here:
+//   "hi"  ->  ezyrt_str_lit("hi"), `init` for the brace form of initializers
+static void ezyt_str_lit(ezy_cstr_t str, bool init, ezy_emit_t *out)
+{
+  ezyemit_str(out, init ? "ezyrt_str_lit_init(" : "ezyrt_str_lit(");
+  ezyt_append_str_literal(str, out);
+  ezyemit_char(out, ')');
+}
+
+static inline bool ezyt_is_int_dt(enum ezy_ast_datatype_typ typ)
+{
+  return typ >= ezy_ast_dt_int8 && typ <= ezy_ast_dt_uint64;
+}
+
+const char *ezytranspile_binop_cop(enum ezy_op_typ op)
+{
+  static const struct {
+    enum ezy_op_typ op;
+    const char *c_op;
+  } op_mapping[] = {
+      {ezy_op_plus, "+"},
+      {ezy_op_minus, "-"},
+      {ezy_op_asterisk, "*"},
+      {ezy_op_divide, "/"},
+      {ezy_op_modulo, "%"},
+      {ezy_op_assign, "="},
+      {ezy_op_cond_eq, "=="},
+      {ezy_op_cond_neq, "!="},
+  };
+
+  for (size_t i = 0; i < sizeof(op_mapping) / sizeof(op_mapping[0]); i++)
+  {
+    if (op == op_mapping[i].op)
+      return op_mapping[i].c_op;
+  }
+  return NULL;
+}
+
+// the brace list of an array literal initializer, elements become `elem`
+static bool ezyt_array_lit(ezy_ast_node_t *lit, const struct ezy_ast_datatype_t *elem, struct ezyt_ctx *t)
+{
+  t->array_init = true;
+  t->array_root = lit;
+  t->array_elem = elem;
+  bool ok = ezytranspile_expression(lit, t);
+  t->array_init = false;
+  t->array_root = NULL;
+  t->array_elem = NULL;
+  return ok;
+}
+
+// small vector initializer, the declaration has passed ezyt_stack_select
+//   let int[?4] x = [1];  ->  ezy_svec_i32_4 x = ezy_svec_i32_4_from(4, (int32_t[]){1}, 1)
+static bool ezyt_svec_init(struct ezy_ast_variable_t *var, struct ezyt_ctx *t)
+{
+  ezy_emit_t *out = &t->out;
+  struct ezy_ast_array_t *arr = var->typ.ext.array_t;
+  ezy_ast_node_t *value = var->value;
+  if (value == NULL || value->data.n_array_lit.count == 0)
+  {
+    ezyemit_str(out, value == NULL && var->typ.nullable ? "{.len = SIZE_MAX, .cap = " : "{.cap = ");
+    ezyemit_uint(out, arr->inline_cap);
+    ezyemit_str(out, ", .max = ");
+    ezyemit_uint(out, arr->max_length);
+    ezyemit_char(out, '}');
+    return true;
+  }
+  if (arr->typ.typ == ezy_ast_dt_array)
+  {
+    ezy_log_warn("Nested array literals are not supported for dynamic array '%.*s'", (int)var->name.len, var->name.ptr);
+    return false;
+  }
+  if (!ezyt_vec_name(&var->typ, out))
+    return false;
+  ezyemit_str(out, "_from(");
+  ezyemit_uint(out, arr->max_length);
+  ezyemit_str(out, ", (");
+  ezytranspile_datatype(&arr->typ, out);
+  ezyemit_str(out, "[])");
+  if (!ezyt_array_lit(value, &arr->typ, t))
+    return false;
+  ezyemit_str(out, ", ");
+  ezyemit_uint(out, value->data.n_array_lit.count);
+  ezyemit_char(out, ')');
+  return true;
+}
+
+// bitmap array initializer, the values then the presence bits
+//   let int?[4] a = [1, null, 3];  ->  ezy_optarr_i32_4 a = {{1, 0, 3}, {0x05}}
+static bool ezyt_optarr_init(struct ezy_ast_variable_t *var, struct ezyt_ctx *t)
+{
+  ezy_emit_t *out = &t->out;
+  struct ezy_ast_array_lit_t *lit = &var->value->data.n_array_lit;
+  ezyemit_str(out, "{{");
+  for (size_t i = 0; i < lit->count; i++)
+  {
+    if (i > 0)
+      ezyemit_str(out, ", ");
+    if (ezyt_is_null_lit(&lit->elements[i]))
+      ezyemit_char(out, '0');
+    else if (!ezyt_expression_as(&lit->elements[i], &ezyt_dt_plain, t))
+      return false;
+  }
+  ezyemit_str(out, "}, {");
+  size_t bytes = (var->typ.ext.array_t->length + 7) / 8;
+  for (size_t b = 0; b < bytes; b++)
+  {
+    unsigned bits = 0;
+    for (size_t i = b * 8; i < b * 8 + 8 && i < lit->count; i++)
+    {
+      if (!ezyt_is_null_lit(&lit->elements[i]))
+        bits |= 1u << (i & 7);
+    }
+    if (b > 0)
+      ezyemit_str(out, ", ");
+    ezyemit_fmt(out, "0x%02x", bits);
+  }
+  ezyemit_str(out, "}}");
+  return true;
+}
+
+// The rest of an array declaration after its name. A dynamic array with
+// no initial elements owns no storage until the first push:
+//   let int[8?] x;          ->  ezy_vec_i32 x = {.guide = 8, .max = 0}
+//   let x[?16] = [1, 2];    ->  ezy_vec_i32 x = ezy_vec_i32_from(2, 16, (int32_t[]){1, 2}, 2)
+//   let int[3] y = [1, 2];  ->  int32_t y[3] = {1, 2}
+//   let int[]? z;           ->  ezy_vec_i32 z = {.len = SIZE_MAX, .guide = 0, .max = 0}
+static bool ezyt_array_init(struct ezy_ast_variable_t *var, struct ezyt_ctx *t)
+{
+  ezy_emit_t *out = &t->out;
+  struct ezy_ast_array_t *arr = var->typ.ext.array_t;
+  ezy_ast_node_t *value = var->value;
+  bool is_lit = value != NULL && value->type == ezy_ast_node_array_lit;
+
+  if (!arr->dynamic)
+  {
+    ezyt_array_suffix(&var->typ, out);
+    if (value == NULL)
+    {
+      ezyemit_str(out, " = {0}");
+      return true;
+    }
+    if (!is_lit)
+    {
+      ezy_log_warn("Fixed array '%.*s' must be initialized with an array literal", (int)var->name.len, var->name.ptr);
+      return false;
+    }
+    ezyemit_str(out, " = ");
+    if (ezyt_is_optarr(&var->typ))
+      return ezyt_optarr_init(var, t);
+    return ezyt_array_lit(value, &var->typ.ext.array_t->typ, t);
+  }
+
+  ezyemit_str(out, " = ");
+  if (arr->inline_cap > 0)
+    return ezyt_svec_init(var, t);
+  bool starts_null = var->typ.nullable && (value == NULL || ezyt_is_null_lit(value));
+  if (starts_null || value == NULL || (is_lit && value->data.n_array_lit.count == 0))
+  {
+    ezyemit_str(out, starts_null ? "{.len = SIZE_MAX, .guide = " : "{.guide = ");
+    ezyemit_uint(out, arr->length);
+    ezyemit_str(out, ", .max = ");
+    ezyemit_uint(out, arr->max_length);
+    ezyemit_char(out, '}');
+    return true;
+  }
+  if (!is_lit)
+    return ezytranspile_expression(value, t); // shares the storage of another array
+  if (arr->typ.typ == ezy_ast_dt_array)
+  {
+    ezy_log_warn("Nested array literals are not supported for dynamic array '%.*s'", (int)var->name.len, var->name.ptr);
+    return false;
+  }
+
+  if (!ezyt_vec_name(&var->typ, out))
+    return false;
+  ezyemit_str(out, "_from(");
+  ezyemit_uint(out, arr->length);
+  ezyemit_str(out, ", ");
+  ezyemit_uint(out, arr->max_length);
+  ezyemit_str(out, ", (");
+  ezytranspile_datatype(&arr->typ, out);
+  ezyemit_str(out, "[])");
+  if (!ezyt_array_lit(value, &arr->typ, t))
+    return false;
+  ezyemit_str(out, ", ");
+  ezyemit_uint(out, value->data.n_array_lit.count);
+  ezyemit_char(out, ')');
+  return true;
+}
+
+bool ezytranspile_variable_decl(ezy_ast_node_t *node, struct ezyt_ctx *t)
+{
+  ezy_emit_t *out = &t->out;
+  struct ezy_ast_variable_t var = node->data.n_variable;
+  // declaration types are inferred by ezysema_infer_types
+  if (var.typ.typ == ezy_ast_dt_infer)
+  {
+    ezy_log_warn("Type of variable '%.*s' was not inferred", (int)var.name.len, var.name.ptr);
+    return false;
+  }
+
+  if (!ezytranspile_datatype(&var.typ, out))
+  {
+    ezy_log_warn("Unsupported variable type %d", var.typ.typ);
+    return false;
+  }
+
+  ezyemit_char(out, ' ');
+  ezyemit_ident(out, var.name);
+  if (var.typ.typ == ezy_ast_dt_array)
+    return ezyt_array_init(&var, t);
+  bool starts_null = var.value == NULL || ezyt_is_null_lit(var.value);
+  if (starts_null && (var.typ.typ == ezy_ast_dt_var || ezyt_is_opt(&var.typ) || ezyt_union_nullable(&var.typ)))
+  {
+    // constant form, also valid at file scope
+    ezyemit_str(out, " = ");
+    return ezyt_null_value(&var.typ, true, out);
+  }
+  if (var.typ.typ == ezy_ast_dt_struct && var.value == NULL)
+  {
+    // fields that do not start as zero bits, see ezyt_field_needs_init
+    ezyemit_str(out, " = {");
+    if (!ezyt_struct_defaults(var.typ.ext.struct_t, NULL, false, out))
+      ezyemit_char(out, '0');
+    ezyemit_char(out, '}');
+    return true;
+  }
+  if (var.value != NULL)
+  {
+    ezyemit_str(out, " = ");
+    // a struct literal initializes as a brace list, also at file scope
+    t->struct_root = var.value->type == ezy_ast_node_struct_lit ? var.value : NULL;
+    bool ok = ezyt_expression_as(var.value, &var.typ, t);
+    t->struct_root = NULL;
+    if (!ok)
+    {
+      ezy_log_warn("Unsupported variable initializer node type %d", var.value->type);
+      return false;
+    }
+  }
+  return true;
+}
+
+bool ezytranspile_literal(ezy_ast_node_t *node, ezy_emit_t *out)
+{
+  struct ezy_ast_literal_t lit = node->data.n_literal;
+  switch (lit.typ)
+  {
+  case ezy_ast_dt_int64:
+  case ezy_ast_dt_int32:
+  case ezy_ast_dt_int16:
+  case ezy_ast_dt_int8:
+    ezyemit_int(out, lit.value.t_int64);
+    break;
+
+  case ezy_ast_dt_uint64:
+  case ezy_ast_dt_uint32:
+  case ezy_ast_dt_uint16:
+  case ezy_ast_dt_uint8:
+    ezyemit_uint(out, lit.value.t_uint64);
+    break;
+
+  case ezy_ast_dt_float32:
+  case ezy_ast_dt_float64:
+    ezyemit_float(out, lit.value.t_float64);
+    break;
+
+  case ezy_ast_dt_string:
+    ezyt_str_lit(lit.value.t_string, false, out);
+    break;
+
+  case ezy_ast_dt_bool:
+    ezyemit_str(out, lit.value.t_uint64 ? "true" : "false");
+    break;
+
+  case ezy_ast_dt_char:
+    ezyt_append_char_literal(lit.value.t_char, out);
+    break;
+  default:
+    ezyemit_fmt(out, "/* unsupported literal type %d */", lit.typ);
+    return false;
+  }
+  return true;
+}
+
+// ================ Expressions ================
+// Expressions are emitted by a single ezywalk pass, so arbitrarily deep
+// expressions do not recurse on the C stack.
+
+// ================ print ================
+// print(a, b, ...) writes its arguments separated by spaces. It is
+// specialized at transpile time: runs of literal arguments (and the
+// separators around them) are formatted here and written as one constant,
+// every other argument goes to a typed writer from the runtime (ezyrt.h).
+// The call becomes a comma expression:
+//   print("n:", n, 2.5)  ->  (ezyrt_write("n: ", 3), ezyrt_write_i64((int64_t)(n)), ezyrt_write(" 2.5", 4), (void)0)
+
+static inline bool ezyt_is_builtin(struct ezy_ast_call_t *call, const char *name)
+{
+  // only the builtin, not a user function that happens to share a prefix
+  size_t len = strlen(name);
+  return call->sym != NULL && call->sym->kind == ezy_sym_builtin &&
+         call->func_name.len == len && memcmp(call->func_name.ptr, name, len) == 0;
+}
+
+static inline bool ezyt_is_print(struct ezy_ast_call_t *call)
+{
+  return ezyt_is_builtin(call, "print");
+}
+
+static inline bool ezyt_print_is_const(ezy_ast_node_t *arg)
+{
+  return arg->type == ezy_ast_node_literal;
+}
+
+// writer call around a non-literal argument
+static bool ezyt_print_writer(enum ezy_ast_datatype_typ typ, const char **prefix, const char **suffix)
+{
+  switch (typ)
+  {
+  case ezy_ast_dt_int8:
+  case ezy_ast_dt_int16:
+  case ezy_ast_dt_int32:
+  case ezy_ast_dt_int64:
+    *prefix = "ezyrt_write_i64((int64_t)(";
+    *suffix = "))";
+    return true;
+  case ezy_ast_dt_uint8:
+  case ezy_ast_dt_uint16:
+  case ezy_ast_dt_uint32:
+  case ezy_ast_dt_uint64:
+    *prefix = "ezyrt_write_u64((uint64_t)(";
+    *suffix = "))";
+    return true;
+  case ezy_ast_dt_float32:
+    *prefix = "ezyrt_write_f32((float)(";
+    *suffix = "))";
+    return true;
+  case ezy_ast_dt_float64:
+  case ezy_ast_dt_unknown: // a C function's result, C converts it to double
+    *prefix = "ezyrt_write_f64((double)(";
+    *suffix = "))";
+    return true;
+  case ezy_ast_dt_bool:
+    *prefix = "ezyrt_write_str((";
+    *suffix = ") ? \"true\" : \"false\")";
+    return true;
+  case ezy_ast_dt_string:
+    *prefix = "ezyrt_write_s(";
+    *suffix = ")";
+    return true;
+  case ezy_ast_dt_char:
+    *prefix = "ezyrt_write_char(";
+    *suffix = ")";
+    return true;
+  case ezy_ast_dt_var:
+    *prefix = "ezyrt_write_var(";
+    *suffix = ")";
+    return true;
+  default:
+    // evaluate for side effects, print nothing
+    *prefix = "((void)(";
+    *suffix = "))";
+    return false;
+  }
+}
+
+// T? prints its value or null and a union its member, through the var writer
+static bool ezyt_print_open(const struct ezy_ast_datatype_t *dt, ezy_emit_t *out)
+{
+  const char *prefix, *suffix;
+  if (ezyt_is_opt(dt) && dt->typ != ezy_ast_dt_array)
+  {
+    ezyemit_str(out, "ezyrt_write_var(");
+    ezyt_opt_call(dt, "to_var", out);
+    return true;
+  }
+  if (ezyt_is_union(dt))
+  {
+    ezyemit_str(out, "ezyrt_write_var(");
+    ezyt_union_call(dt->ext.union_t, "to_var", out);
+    return true;
+  }
+  bool ok = ezyt_print_writer(dt->typ, &prefix, &suffix);
+  ezyemit_str(out, prefix);
+  return ok;
+}
+
+static void ezyt_print_close(const struct ezy_ast_datatype_t *dt, ezy_emit_t *out)
+{
+  const char *prefix, *suffix;
+  if ((ezyt_is_opt(dt) && dt->typ != ezy_ast_dt_array) || ezyt_is_union(dt))
+  {
+    ezyemit_str(out, "))");
+    return;
+  }
+  ezyt_print_writer(dt->typ, &prefix, &suffix);
+  ezyemit_str(out, suffix);
+}
+
+// the text a literal prints, formatted exactly like the runtime writers
+bool ezytranspile_print_literal(ezy_ast_node_t *node, ezy_emit_t *raw)
+{
+  struct ezy_ast_literal_t *lit = &node->data.n_literal;
+  switch (lit->typ)
+  {
+  case ezy_ast_dt_int8:
+  case ezy_ast_dt_int16:
+  case ezy_ast_dt_int32:
+  case ezy_ast_dt_int64:
+    ezyemit_int(raw, lit->value.t_int64);
+    return true;
+  case ezy_ast_dt_uint8:
+  case ezy_ast_dt_uint16:
+  case ezy_ast_dt_uint32:
+  case ezy_ast_dt_uint64:
+    ezyemit_uint(raw, lit->value.t_uint64);
+    return true;
+  case ezy_ast_dt_float32:
+  case ezy_ast_dt_float64:
+  {
+    char buf[ezyrt_fmt_f64_max];
+    size_t n = lit->typ == ezy_ast_dt_float32 ? ezyrt_fmt_f32(buf, (float)lit->value.t_float64)
+                                              : ezyrt_fmt_f64(buf, lit->value.t_float64);
+    ezyemit_bytes(raw, buf, n);
+    return true;
+  }
+  case ezy_ast_dt_bool:
+    ezyemit_str(raw, lit->value.t_uint64 ? "true" : "false");
+    return true;
+  case ezy_ast_dt_char:
+    ezyemit_char(raw, lit->value.t_char);
+    return true;
+  case ezy_ast_dt_null:
+    ezyemit_str(raw, "null");
+    return true;
+  case ezy_ast_dt_string:
+  {
+    // same escapes as ezyt_append_str_literal
+    ezy_cstr_t str = lit->value.t_string;
+    for (size_t i = 0; i < str.len; i++)
+    {
+      char c = str.ptr[i];
+      if (c != '\\' || i + 1 == str.len)
+      {
+        ezyemit_char(raw, c);
+        continue;
+      }
+      switch (str.ptr[++i])
+      {
+      case 'n': ezyemit_char(raw, '\n'); break;
+      case 't': ezyemit_char(raw, '\t'); break;
+      case '\\': ezyemit_char(raw, '\\'); break;
+      case '"': ezyemit_char(raw, '"'); break;
+      case '\'': ezyemit_char(raw, '\''); break;
+      default:
+        ezy_log_warn("Unsupported escape sequence \\%c in string literal", str.ptr[i]);
+        ezyemit_char(raw, '\\');
+        ezyemit_char(raw, str.ptr[i]);
+        break;
+      }
+    }
+    return true;
+  }
+  default:
+    return false;
+  }
+}
+
+// Write the constant run that ends right before argument `end`: the
+// separators and literal arguments after the previous non-literal one.
+// With end == arg_count it is the tail of the call.
+static void ezyt_print_const_run(struct ezy_ast_call_t *call, size_t end, ezy_emit_t *out)
+{
+  size_t begin = end;
+  while (begin > 0 && ezyt_print_is_const(&call->args[begin - 1]))
+    begin--;
+
+  ezy_emit_t raw;
+  ezyemit_init(&raw);
+  // separator i sits between argument i - 1 and argument i
+  for (size_t i = begin; i <= end; i++)
+  {
+    if (i >= 1 && i < call->arg_count)
+      ezyemit_char(&raw, ' ');
+    if (i < end && !ezytranspile_print_literal(&call->args[i], &raw))
+      ezy_log_warn("Unsupported literal type %d in print", call->args[i].data.n_literal.typ);
   }
 
-  for (size_t i = 0; i < sizeof(type_mapping) / sizeof(type_mapping[0]); i++)
+  size_t len = 0;
+  for (ezy_multistr_t *c = raw.head; c != NULL; c = c->next)
+    len += c->str.len;
+  if (len > 0)
   {
-    if (datatype->typ == type_mapping[i].typ)
+    ezyemit_str(out, "ezyrt_write(\"");
+    for (ezy_multistr_t *c = raw.head; c != NULL; c = c->next)
     {
-      ezyt_append(out, "%s", type_mapping[i].c_type);
-      return true;
+      for (size_t i = 0; i < c->str.len; i++)
+      {
+        unsigned char ch = (unsigned char)c->str.ptr[i];
+        if (ch == '"' || ch == '\\')
+        {
+          ezyemit_char(out, '\\');
+          ezyemit_char(out, (char)ch);
+        }
+        else if (ch == '\n')
+          ezyemit_str(out, "\\n");
+        else if (ch == '\t')
+          ezyemit_str(out, "\\t");
+        else if (ch >= 32 && ch <= 126)
+          ezyemit_char(out, (char)ch);
+        else
+        {
+          // octal, a following hex digit cannot extend it
+          ezyemit_fmt(out, "\\%03o", ch);
+        }
+      }
     }
+    ezyemit_str(out, "\", ");
+    ezyemit_uint(out, len);
+    ezyemit_str(out, "), ");
   }
+  ezyemit_free(raw.head);
+}
 
-  if ( datatype->is_ptr ) {
-    ezyt_append(out, " *");
+static const struct ezy_ast_datatype_t *ezyt_expected(struct ezywalk_t *w, ezy_ast_node_t *node);
+
+// array literals are only emitted as brace lists, see ezyt_array_init; a
+// fixed array field of a struct literal is one too
+static inline bool ezyt_array_lit_allowed(struct ezywalk_t *w, ezy_ast_node_t *node)
+{
+  struct ezyt_ctx *ctx = w->ctx;
+  if (w->parent != NULL && w->parent->type == ezy_ast_node_struct_lit)
+  {
+    const struct ezy_ast_datatype_t *field = ezyt_expected(w, node);
+    return field->typ == ezy_ast_dt_array && !field->ext.array_t->dynamic && !ezyt_is_optarr(field);
   }
+  return w->parent != NULL ? w->parent->type == ezy_ast_node_array_lit : ctx->array_init;
+}
 
-  return false;
+// a struct literal inside a brace list is a brace list itself, elsewhere
+// it is a compound literal
+static inline bool ezyt_struct_lit_braced(struct ezywalk_t *w, ezy_ast_node_t *node)
+{
+  struct ezyt_ctx *ctx = w->ctx;
+  if (w->parent == NULL)
+    return node == ctx->struct_root;
+  return w->parent->type == ezy_ast_node_struct_lit || w->parent->type == ezy_ast_node_array_lit;
 }
 
-void ezyt_append_char_literal(char c, ezy_multistr_t **out)
+// Literal element `node` of a struct literal in its constant form (no
+// conversion call), so the literal also initializes a file scope struct.
+// Only tests whether there is one if `out` is NULL.
+static bool ezyt_field_literal(struct ezywalk_t *w, ezy_ast_node_t *node, const struct ezy_ast_datatype_t *want, ezy_emit_t *out)
 {
-  ezyt_append(out, "\'");
-  switch (c)
+  if (w->parent == NULL || w->parent->type != ezy_ast_node_struct_lit || node->type != ezy_ast_node_literal)
+    return false;
+  if (ezyt_is_null_lit(node) && (want->typ == ezy_ast_dt_var || ezyt_is_opt(want) || ezyt_union_nullable(want)))
   {
-  case '\n':
-    ezyt_append(out, "\\n");
-    break;
-  case '\t':
-    ezyt_append(out, "\\t");
-    break;
-  case '\\':
-    ezyt_append(out, "\\\\");
-    break;
-  case '\'':
-    ezyt_append(out, "\\\'");
-    break;
-  default:
-    if (c >= 32 && c <= 126)
-    {
-      ezyt_append(out, "%c", c);
-    }
-    else
+    if (out != NULL)
+      ezyt_field_init(want, out);
+    return true;
+  }
+  if (node->data.n_literal.typ == ezy_ast_dt_string && want->typ == ezy_ast_dt_string)
+  {
+    if (out != NULL)
+      ezyt_str_lit(node->data.n_literal.value.t_string, true, out);
+    return true;
+  }
+  if (ezyt_opt_flagged(want) && !ezyt_is_null_lit(node) && !ezyt_opt_flagged(&node->eval_typ))
+  {
+    if (out != NULL)
     {
-      ezyt_append(out, "\\x%02x", (unsigned char)c);
+      ezyemit_str(out, "{.value = ");
+      ezytranspile_literal(node, out);
+      ezyemit_str(out, ", .has = true}");
     }
-    break;
+    return true;
   }
-  ezyt_append(out, "\'");
+  return false;
 }
 
-void ezyt_append_str_literal(ezy_cstr_t str, ezy_multistr_t **out)
+// Type the parent stores `node` as (see the var section), NULL when the
+// value is used as it is.
+static const struct ezy_ast_datatype_t *ezyt_expected(struct ezywalk_t *w, ezy_ast_node_t *node)
 {
-  // handle escaping
-  ezyt_append(out, "\"");
-  bool has_escape = false;
-  for (size_t i = 0; i < str.len; i++)
+  struct ezyt_ctx *ctx = w->ctx;
+  ezy_ast_node_t *parent = w->parent;
+  if (parent == NULL)
+    return ctx->want;
+
+  switch (parent->type)
   {
-    char c = str.ptr[i];
-    if (has_escape)
-    {
-      has_escape = false;
-      switch (c)
-      {
-      case 'n':
-        ezyt_append(out, "\\n");
-        break;
-      case 't':
-        ezyt_append(out, "\\t");
-        break;
-      case '\\':
-        ezyt_append(out, "\\\\");
-        break;
-      case '"':
-        ezyt_append(out, "\\\"");
-        break;
-      case '\'':
-        ezyt_append(out, "\\\'");
-        break;
-      default:
-        ezy_log_warn("Unsupported escape sequence \\%c in string literal", c);
-        if (c >= 32 && c <= 126)
-          ezyt_append(out, "<?\\%c>", c);
-        else
-          ezyt_append(out, "<?\\x%02x>", (unsigned char)c);
-        break;
-      }
-      continue;
-    }
-    if (c == '\\')
-    {
-      has_escape = true;
-      continue;
-    }
-    if (c >= 32 && c <= 126)
-    {
-      ezyt_append(out, "%c", c);
-    }
-    else
+  case ezy_ast_node_binop:
+  {
+    struct ezy_ast_binop_t *binop = &parent->data.n_binop;
+    if (binop->operator == ezy_op_assign)
+      return node == binop->right ? &binop->left->eval_typ : NULL;
+    if (ezyt_var_binop(parent) != NULL)
+      return &ezyt_dt_var;
+    return ezyt_null_test(parent) != NULL ? NULL : &ezyt_dt_plain;
+  }
+  case ezy_ast_node_array_lit:
+    if (parent == ctx->array_root)
+      return ctx->array_elem;
+    return &parent->eval_typ.ext.array_t->typ;
+  case ezy_ast_node_index:
+    return node == parent->data.n_index.index ? &ezyt_dt_int64 : &ezyt_dt_plain;
+  case ezy_ast_node_member:
+    return &ezyt_dt_plain;
+  case ezy_ast_node_struct_lit:
+  {
+    struct ezy_ast_struct_lit_t *lit = &parent->data.n_struct_lit;
+    return &parent->eval_typ.ext.struct_t->members[lit->fields[node - lit->elements]].typ;
+  }
+  case ezy_ast_node_call:
+  {
+    struct ezy_ast_call_t *call = parent->data.n_call;
+    size_t i = (size_t)(node - call->args);
+    bool repr;
+    if (ezyt_is_builtin(call, "push"))
     {
-      ezyt_append(out, "\\x%02x", (unsigned char)c);
+      if (i == 0)
+        return &ezyt_dt_plain;
+      return ezyt_is_vec(&call->args[0].eval_typ) ? &call->args[0].eval_typ.ext.array_t->typ : NULL;
     }
+    if (ezyt_is_type_id(call, &repr))
+      return ezyt_is_opt(&node->eval_typ) ? &ezyt_dt_var : NULL; // null or the value's tag
+    if (call->sym == NULL)
+      return &ezyt_dt_c; // C function
+    if (call->sym->kind == ezy_sym_function && i < call->sym->decl.function->param_count)
+      return &call->sym->decl.function->params[i].typ;
+    return NULL;
   }
-  if (has_escape) {
-    ezy_log_warn("String ends with trailing backslash");
-    ezyt_append(out, "<?\\>");
+  default:
+    return NULL;
   }
-  ezyt_append(out, "\"");
 }
 
-bool ezytranspile_binop_single_v(struct ezy_ast_node_t* left_or_right, ezy_multistr_t **out)
+// typeof on a typed argument without side effects is just the constant
+static inline bool ezyt_type_id_folds(ezy_ast_node_t *arg)
+{
+  return arg->type == ezy_ast_node_variable || arg->type == ezy_ast_node_literal || arg->type == ezy_ast_node_datatype;
+}
+
+static void ezyt_type_id_close(struct ezy_ast_call_t *call, bool repr, ezy_emit_t *out)
 {
-  ezy_ast_node_t *node = left_or_right;
-  if ( node->type == ezy_ast_node_literal )
+  ezy_ast_node_t *arg = call->arg_count == 1 ? &call->args[0] : NULL;
+  if (arg == NULL)
+    return;
+  if (arg->eval_typ.typ == ezy_ast_dt_var || ezyt_is_opt(&arg->eval_typ))
   {
-    struct ezy_ast_literal_t lit = node->data.n_literal;
-    if (!ezytranspile_literal(node, out))
-    {
-      ezy_log_warn("Unsupported literal type %d in binary operand", lit.typ);
-      return false;
-    }
-  } else if ( node->type == ezy_ast_node_variable ) {
-    struct ezy_ast_variable_t var = node->data.n_variable;
-    ezyt_append(out, "%.*s", var.name.len, var.name.ptr);
-  } else if ( node->type == ezy_ast_node_call ) {
-    if (!ezytranspile_call(node, out))
-    {
-      ezy_log_warn("Unsupported call node in binary operand");
-      return false;
-    }
+    ezyemit_str(out, repr ? ").tag & ezyrt_tag_repr_mask)" : ").tag)");
+    return;
   }
-  else
+  if (ezyt_is_union(&arg->eval_typ))
   {
-    ezy_log_warn("Unsupported node type %d in binary operand", node->type);
-    return false;
+    ezyemit_str(out, repr ? ").tag] & ezyrt_tag_repr_mask)" : ").tag]");
+    return;
+  }
+  const char *tag = ezyt_tag_name(arg->eval_typ.typ, repr);
+  if (tag != NULL && !ezyt_type_id_folds(arg))
+  {
+    ezyemit_str(out, "), ");
+    ezyemit_str(out, tag);
+    ezyemit_char(out, ')');
   }
+}
 
-  return true;
+// `typeof(u) == typeof(T)` on a union u, with T folding to a constant:
+// the typeof call on u, whose tag is compared; NULL for any other node
+static ezy_ast_node_t *ezyt_union_tag_test(ezy_ast_node_t *node, enum ezy_ast_datatype_typ *typ)
+{
+  if (node == NULL || node->type != ezy_ast_node_binop)
+    return NULL;
+  struct ezy_ast_binop_t *binop = &node->data.n_binop;
+  if ((binop->operator != ezy_op_cond_eq && binop->operator != ezy_op_cond_neq) || binop->left == NULL || binop->right == NULL)
+    return NULL;
+  ezy_ast_node_t *sides[2] = {binop->left, binop->right};
+  for (size_t i = 0; i < 2; i++)
+  {
+    ezy_ast_node_t *u_call = sides[i], *t_call = sides[1 - i];
+    if (u_call->type != ezy_ast_node_call || t_call->type != ezy_ast_node_call ||
+        !ezyt_is_builtin(u_call->data.n_call, "typeof") || !ezyt_is_builtin(t_call->data.n_call, "typeof") ||
+        u_call->data.n_call->arg_count != 1 || t_call->data.n_call->arg_count != 1)
+      return NULL;
+    const struct ezy_ast_datatype_t *u_dt = &u_call->data.n_call->args[0].eval_typ;
+    ezy_ast_node_t *t_arg = &t_call->data.n_call->args[0];
+    if (ezyt_is_union(u_dt) && !ezyt_is_union(&t_arg->eval_typ) && !ezyt_is_opt(&t_arg->eval_typ) &&
+        ezyt_tag_name(t_arg->eval_typ.typ, false) != NULL && ezyt_type_id_folds(t_arg))
+    {
+      *typ = t_arg->eval_typ.typ;
+      return u_call;
+    }
+  }
+  return NULL;
+}
+
+// `((u).tag == ezy_union_U_tag_T)`, constant if T is not a member
+static void ezyt_union_tag_test_emit(ezy_ast_node_t *node, bool open, ezy_emit_t *out)
+{
+  enum ezy_ast_datatype_typ typ;
+  const struct ezy_ast_datatype_t *dt = &ezyt_union_tag_test(node, &typ)->data.n_call->args[0].eval_typ;
+  const struct ezy_ast_union_t *u = dt->ext.union_t;
+  bool eq = node->data.n_binop.operator == ezy_op_cond_eq;
+  size_t tag = ezyt_union_null_tag(u);
+  bool member = typ == ezy_ast_dt_null ? ezyt_union_nullable(dt) : ezyt_union_member(u, typ, &tag);
+  if (!member)
+    ezyemit_str(out, open ? "((void)(" : eq ? "), false)" : "), true)");
+  else if (open)
+    ezyemit_str(out, "((");
+  else
+    ezyemit_fmt(out, ").tag %s " ezyt_union_fmt "_tag_%s)", eq ? "==" : "!=", ezyt_union_arg(u),
+                tag < u->count ? ezyt_union_field(u->mem_typlist[tag].typ) : "null");
 }
 
-bool ezytranspile_binop(ezy_ast_node_t *node, ezy_multistr_t **out)
+static enum ezywalk_action ezyt_expr_pre(struct ezywalk_t *w, ezy_ast_node_t *node)
 {
-  struct ezy_ast_binop_t binop = node->data.n_binop;
-  ezy_ast_node_t *left = binop.left;
-  ezy_ast_node_t *right = binop.right;
+  struct ezyt_ctx *ctx = w->ctx;
+  ezy_emit_t *out = &ctx->out;
 
-  if (left && left->type == ezy_ast_node_binop)
+  const struct ezy_ast_datatype_t *want = ezyt_expected(w, node);
+  if (ezyt_field_literal(w, node, want, out))
+    return ezywalk_skip;
+  if (!ezyt_conv_open(node, want, out))
   {
-    ezyt_append(out, "(");
-    if (!ezytranspile_binop(left, out))
-    return false;
-    ezyt_append(out, ")");
-  } else {
-    if (!ezytranspile_binop_single_v(left, out))
-      return false;
+    ctx->expr_ok = false;
+    return ezywalk_skip;
   }
-  
-  static const struct {
-    enum ezy_op_typ op;
-    const char *c_op;
-  } op_mapping[] = {
-      {ezy_op_plus, "+"},
-      {ezy_op_minus, "-"},
-      {ezy_op_asterisk, "*"},
-      {ezy_op_divide, "/"},
-      {ezy_op_modulo, "%"},
-  };
+  if (ezyt_conv_kind(&node->eval_typ, want) == ezyt_conv_null)
+    return ezywalk_skip;
 
-  const char *c_op = NULL;
-  for (size_t i = 0; i < sizeof(op_mapping) / sizeof(op_mapping[0]); i++)
+  switch (node->type)
   {
-    if (binop.operator == op_mapping[i].op)
+  case ezy_ast_node_literal:
+    if (node->data.n_literal.typ == ezy_ast_dt_string && w->parent != NULL && w->parent->type == ezy_ast_node_array_lit &&
+        want != NULL && want->typ == ezy_ast_dt_string)
     {
-      c_op = op_mapping[i].c_op;
-      break;
+      // element of a brace list, which may be at file scope
+      ezyt_str_lit(node->data.n_literal.value.t_string, true, out);
+      return ezywalk_skip;
     }
-  }
-  if (c_op == NULL)
-  {
-    ezy_log_warn("Unsupported binary operator %d", binop.operator);
-    return false;
-  }
-
-  ezyt_append(out, " %s ", c_op);
-
-  if ( right && right->type == ezy_ast_node_binop ) {
-    ezyt_append(out, "(");
-    if (!ezytranspile_binop(right, out))
-      return false;
-    ezyt_append(out, ")");
-    return true;
-  } else {
-    if (!ezytranspile_binop_single_v(right, out))
-      return false;
-    return true;
-  }
+    if (!ezytranspile_literal(node, out))
+    {
+      ezy_log_warn("Unsupported literal type %d in expression", node->data.n_literal.typ);
+      ctx->expr_ok = false;
+    }
+    return ezywalk_skip;
 
-  ezy_log_warn("Unsupported node type %d in binary operator right operand", right->type);
-  return false; // should not reach here
-}
+  case ezy_ast_node_variable:
+    ezyemit_ident(out, node->data.n_variable.name);
+    return ezywalk_skip;
 
-bool ezytranspile_variable_decl(ezy_ast_node_t *node, ezy_multistr_t **out)
-{
-  struct ezy_ast_variable_t var = node->data.n_variable;
-  // variable type can be inferred from initializer if type is infer
-  if (var.typ.typ == ezy_ast_dt_infer)
+  case ezy_ast_node_binop:
   {
-    if (var.value == NULL)
+    struct ezy_ast_binop_t *binop = &node->data.n_binop;
+    if (ezytranspile_binop_cop(binop->operator) == NULL)
     {
-      ezy_log_warn("Cannot infer type of variable '%.*s' without initializer", var.name.len, var.name.ptr);
-      return false;
+      ezy_log_warn("Unsupported binary operator %d", binop->operator);
+      ctx->expr_ok = false;
+      return ezywalk_skip;
     }
-    // only support inferring from literals for now
-    if (var.value->type == ezy_ast_node_literal)
+    if (binop->left == NULL || binop->right == NULL)
     {
-      var.typ.typ = var.value->data.n_literal.typ;
+      ezy_log_warn("Binary operator %d is missing an operand", binop->operator);
+      ctx->expr_ok = false;
+      return ezywalk_skip;
     }
-    else
+    enum ezy_ast_datatype_typ tested;
+    if (ezyt_union_tag_test(node, &tested) != NULL)
     {
-      ezy_log_warn("Cannot infer type of variable '%.*s' from non-literal initializer", var.name.len, var.name.ptr);
-      return false;
+      ezyt_union_tag_test_emit(node, true, out);
+      return ezywalk_continue;
     }
-  };
-
-  if (!ezytranspile_datatype(&var.typ, out))
-  {
-    ezy_log_warn("Unsupported variable type %d", var.typ.typ);
-    return false;
+    const char *var_fn = ezyt_var_binop(node);
+    if (var_fn != NULL)
+    {
+      ezyemit_str(out, var_fn);
+      return ezywalk_continue;
+    }
+    const char *str_fn = ezyt_str_binop(node);
+    if (str_fn != NULL)
+    {
+      if (ezyt_str_concat_inner(w, node))
+        return ezywalk_continue;
+      if (ezyt_is_str_concat(node) && node->data.n_binop.stack_buf > 0)
+        ezyemit_fmt(out, "ezyrt_str_concat_in(ezy_sbuf[%u], ezyrt_str_stack_size, (ezyrt_str[]){",
+                    node->data.n_binop.stack_buf - 1);
+      else
+        ezyemit_str(out, str_fn);
+      return ezywalk_continue;
+    }
+    if (ezyt_null_test(node) != NULL)
+    {
+      ezyt_null_test_emit(node, true, out);
+      return ezywalk_continue;
+    }
+    if (ezyt_optarr_store(node))
+      return ezywalk_continue; // the index opens the call
+    if (binop->operator != ezy_op_assign &&
+        (binop->left->eval_typ.typ == ezy_ast_dt_struct || binop->right->eval_typ.typ == ezy_ast_dt_struct))
+    {
+      ezy_log_warn("Operator %d is not defined for structs, only assignment is", binop->operator);
+      ctx->expr_ok = false;
+      return ezywalk_skip;
+    }
+    if (w->parent != NULL && w->parent->type == ezy_ast_node_binop)
+    {
+      ezyemit_char(out, '(');
+    }
+    // `10 / 3` is floating division unless the declaration asks for an integer
+    if (binop->operator == ezy_op_divide && !ezyt_is_int_dt(node->eval_typ.typ) &&
+        ezyt_is_int_dt(binop->left->eval_typ.typ) && ezyt_is_int_dt(binop->right->eval_typ.typ))
+    {
+      ezyemit_str(out, "(double)");
+    }
+    return ezywalk_continue;
   }
 
-  ezyt_append(out, " %.*s", var.name.len, var.name.ptr);
-  if (var.value != NULL)
+  case ezy_ast_node_call:
   {
-    ezyt_append(out, " = ");
-    if (var.value->type == ezy_ast_node_literal)
+    struct ezy_ast_call_t *call = node->data.n_call;
+    if (ezyt_is_builtin(call, "push"))
     {
-      if (!ezytranspile_literal(var.value, out))
+      // push(arr, v)  ->  ezy_vec_T_push(&(arr), v)
+      if (call->arg_count != 2 || !ezyt_is_vec(&call->args[0].eval_typ))
       {
-        ezy_log_warn("Unsupported literal type %d for variable initializer", var.value->data.n_literal.typ);
-        return false;
+        ezy_log_warn("push expects a dynamic array and a value");
+        ctx->expr_ok = false;
+        return ezywalk_skip;
       }
+      if (!ezyt_vec_name(&call->args[0].eval_typ, out))
+      {
+        ctx->expr_ok = false;
+        return ezywalk_skip;
+      }
+      ezyemit_str(out, "_push(&(");
+      return ezywalk_continue;
     }
-    else if ( var.value->type == ezy_ast_node_binop )
+    bool repr;
+    enum ezy_ast_datatype_typ tested;
+    if (ezyt_union_tag_test(w->parent, &tested) == node)
+      return ezywalk_continue; // only the union is emitted, see ezyt_union_tag_test_emit
+    if (ezyt_is_type_id(call, &repr))
     {
-      if (!ezytranspile_binop(var.value, out))
+      ezy_ast_node_t *arg = call->arg_count == 1 ? &call->args[0] : NULL;
+      const char *tag = arg != NULL ? ezyt_tag_name(arg->eval_typ.typ, repr) : NULL;
+      if (arg != NULL && ezyt_is_union(&arg->eval_typ))
       {
-        ezy_log_warn("Unsupported binary operator in variable initializer");
-        return false;
+        // the runtime tag of the member held
+        ezyemit_fmt(out, "%s" ezyt_union_fmt "_ids[(", repr ? "(" : "", ezyt_union_arg(arg->eval_typ.ext.union_t));
+        return ezywalk_continue;
+      }
+      if (arg != NULL && (arg->eval_typ.typ == ezy_ast_dt_var || ezyt_is_opt(&arg->eval_typ)))
+      {
+        ezyemit_str(out, "((");
+        return ezywalk_continue;
+      }
+      if (tag == NULL)
+      {
+        ezy_log_warn("%.*s expects one value of a known type", (int)call->func_name.len, call->func_name.ptr);
+        ctx->expr_ok = false;
+        return ezywalk_skip;
+      }
+      if (ezyt_type_id_folds(arg))
+      {
+        ezyemit_str(out, tag);
+        return ezywalk_skip;
       }
+      ezyemit_str(out, "((void)(");
+      return ezywalk_continue;
     }
-    else
+    if (!ezyt_is_print(call))
     {
-      ezy_log_warn("Unsupported variable initializer node type %d", var.value->type);
-      return false;
+      ezyemit_ident(out, call->func_name);
+      ezyemit_char(out, '(');
+      return ezywalk_continue;
     }
-  }
-  return true;
-}
 
-const char* ezytranspile_dt_cfmt(enum ezy_ast_datatype_typ dt) {
-  switch (dt) {
-    case ezy_ast_dt_int8: return "%" PRId8;
-    case ezy_ast_dt_uint8: return "%" PRIu8;
-    case ezy_ast_dt_int16: return "%" PRId16;
-    case ezy_ast_dt_uint16: return "%" PRIu16;
-    case ezy_ast_dt_int32: return "%" PRId32;
-    case ezy_ast_dt_uint32: return "%" PRIu32;
-    case ezy_ast_dt_int64: return "%" PRId64;
-    case ezy_ast_dt_uint64: return "%" PRIu64;
-    case ezy_ast_dt_float32: return "%g";
-    case ezy_ast_dt_float64: return "%g";
-    case ezy_ast_dt_bool: return "%s";
-    case ezy_ast_dt_char: return "%c";
-    case ezy_ast_dt_string: return "%s";
-    default: return "/* unsupported type */ %s";
+    ezyemit_char(out, '(');
+    return ezywalk_continue;
   }
-}
 
-bool ezytranspile_literal(ezy_ast_node_t *node, ezy_multistr_t **out)
-{
-  struct ezy_ast_literal_t lit = node->data.n_literal;
-  const char* fmt = ezytranspile_dt_cfmt(lit.typ);
-  switch (lit.typ)
-  {
-  case ezy_ast_dt_int64:
-  case ezy_ast_dt_int32:
-  case ezy_ast_dt_int16:
-  case ezy_ast_dt_int8:
-    ezyt_append(out, fmt, lit.value.t_int64);
-    break;
-
-  case ezy_ast_dt_uint64:
-  case ezy_ast_dt_uint32:
-  case ezy_ast_dt_uint16:
-  case ezy_ast_dt_uint8:
-    ezyt_append(out, fmt, lit.value.t_uint64);
-    break;
+  case ezy_ast_node_array_lit:
+    if (!ezyt_array_lit_allowed(w, node))
+    {
+      ezy_log_warn("Array literals are only supported as array initializers");
+      ctx->expr_ok = false;
+      return ezywalk_skip;
+    }
+    ezyemit_char(out, '{');
+    return ezywalk_continue;
 
-  case ezy_ast_dt_float32:
-  case ezy_ast_dt_float64:
-    ezyt_append(out, fmt, lit.value.t_float64);
-    break;
+  case ezy_ast_node_struct_lit:
+    // fields are matched by ezysema_infer_types, which reported a mismatch
+    if (node->eval_typ.typ != ezy_ast_dt_struct || node->data.n_struct_lit.fields == NULL)
+    {
+      ctx->expr_ok = false;
+      return ezywalk_skip;
+    }
+    if (!ezyt_struct_lit_braced(w, node))
+      ezyemit_fmt(out, "(" ezyt_struct_fmt ")", ezyt_struct_arg(node->eval_typ.ext.struct_t));
+    ezyemit_char(out, '{');
+    return ezywalk_continue;
 
-  case ezy_ast_dt_string:
-    ezyt_append_str_literal(lit.value.t_string, out);
-    break;
+  case ezy_ast_node_index:
+  {
+    ezy_ast_node_t *base = node->data.n_index.base;
+    if (base->eval_typ.typ != ezy_ast_dt_array)
+    {
+      ezy_log_warn("Cannot index a value of type %d", base->eval_typ.typ);
+      ctx->expr_ok = false;
+      return ezywalk_skip;
+    }
+    if (ezyt_is_optarr(&base->eval_typ))
+    {
+      ezyt_optarr_name(&base->eval_typ, out);
+      ezyemit_str(out, ezyt_optarr_stored(w, node) ? "_set(&(" : "_get(&(");
+      return ezywalk_continue;
+    }
+    if (node->data.n_index.checked && ezyt_is_vec(&base->eval_typ))
+    {
+      // checked: *name_at(v, i), a small vector by address
+      ezyemit_str(out, "(*");
+      ezyt_vec_name(&base->eval_typ, out);
+      ezyemit_str(out, base->eval_typ.ext.array_t->inline_cap > 0 ? "_at(&(" : "_at(");
+      return ezywalk_continue;
+    }
+    if (base->type == ezy_ast_node_binop)
+      ezyemit_char(out, '(');
+    if (ezyt_is_vec(&base->eval_typ) && base->eval_typ.ext.array_t->inline_cap > 0)
+    {
+      // small vector: elements are inline or on the heap
+      ezyt_vec_name(&base->eval_typ, out);
+      ezyemit_str(out, "_data(&(");
+    }
+    return ezywalk_continue;
+  }
 
-  case ezy_ast_dt_bool:
-    ezyt_append(out, "%s", lit.value.t_uint64 ? "true" : "false");
-    break;
+  case ezy_ast_node_member:
+  {
+    struct ezy_ast_member_t *member = &node->data.n_member;
+    struct ezy_ast_datatype_t *obj = &member->object->eval_typ;
+    if (obj->typ == ezy_ast_dt_struct)
+    {
+      // typed by ezysema_infer_types, which reported an unknown field
+      if (node->eval_typ.typ == ezy_ast_dt_infer || node->eval_typ.typ == ezy_ast_dt_unknown)
+      {
+        ctx->expr_ok = false;
+        return ezywalk_skip;
+      }
+      if (member->object->type == ezy_ast_node_binop)
+        ezyemit_char(out, '(');
+      return ezywalk_continue;
+    }
+    if (obj->typ != ezy_ast_dt_array || member->name.len != 6 || memcmp(member->name.ptr, "length", 6) != 0)
+    {
+      ezy_log_warn("Unsupported member '%.*s'", (int)member->name.len, member->name.ptr);
+      ctx->expr_ok = false;
+      return ezywalk_skip;
+    }
+    if (!obj->ext.array_t->dynamic)
+    {
+      ezyemit_str(out, "(int64_t)");
+      ezyemit_uint(out, obj->ext.array_t->length);
+      return ezywalk_skip;
+    }
+    ezyemit_str(out, "(int64_t)(");
+    return ezywalk_continue;
+  }
 
-  case ezy_ast_dt_char:
-    ezyt_append_char_literal(lit.value.t_char, out);
-    break;
   default:
-    ezyt_append(out, "/* unsupported literal type %d */", lit.typ);
-    return false;
+    ezy_log_warn("Unsupported node type %d in expression", node->type);
+    ctx->expr_ok = false;
+    return ezywalk_skip;
   }
-  return true;
 }
 
-bool ezytranspile_call(ezy_ast_node_t *node, ezy_multistr_t **out)
+static enum ezywalk_action ezyt_expr_child(struct ezywalk_t *w, ezy_ast_node_t *node, size_t child)
 {
-  struct ezy_ast_call_t *call_data = node->data.n_call;
-  // check for built-in functions
-  if ( strncmp(call_data->func_name.ptr, "print", call_data->func_name.len) == 0)
+  struct ezyt_ctx *ctx = w->ctx;
+  ezy_emit_t *out = &ctx->out;
+
+  enum ezy_ast_datatype_typ tested;
+  ezy_ast_node_t *tag_tested = ezyt_union_tag_test(node, &tested);
+  if (tag_tested != NULL)
+  {
+    ezy_ast_node_t *operand = child == 0 ? node->data.n_binop.left : node->data.n_binop.right;
+    return operand == tag_tested ? ezywalk_continue : ezywalk_skip;
+  }
+  if (node->type == ezy_ast_node_binop && ezyt_null_test(node) != NULL)
+  {
+    // only the tested operand is emitted
+    ezy_ast_node_t *operand = child == 0 ? node->data.n_binop.left : node->data.n_binop.right;
+    return operand == ezyt_null_test(node) ? ezywalk_continue : ezywalk_skip;
+  }
+  if (node->type == ezy_ast_node_binop && child == 1)
+  {
+    if (ezyt_var_binop(node) != NULL || ezyt_str_binop(node) != NULL || ezyt_optarr_store(node))
+    {
+      ezyemit_str(out, ", ");
+      return ezywalk_continue;
+    }
+    ezyemit_char(out, ' ');
+    ezyemit_str(out, ezytranspile_binop_cop(node->data.n_binop.operator));
+    ezyemit_char(out, ' ');
+  }
+  else if (node->type == ezy_ast_node_array_lit && child > 0)
+  {
+    ezyemit_str(out, ", ");
+  }
+  else if (node->type == ezy_ast_node_struct_lit)
+  {
+    // designated, positional elements follow the declaration order
+    struct ezy_ast_struct_lit_t *lit = &node->data.n_struct_lit;
+    ezyemit_str(out, child > 0 ? ", ." : ".");
+    ezyemit_ident(out, node->eval_typ.ext.struct_t->members[lit->fields[child]].name);
+    ezyemit_str(out, " = ");
+  }
+  else if (node->type == ezy_ast_node_index && child == 1)
   {
-    ezyt_append(out, "printf(\"");
-
-    // first pass : format string
-    for (size_t i = 0; i < call_data->arg_count; i++)
+    ezy_ast_node_t *base = node->data.n_index.base;
+    bool checked = node->data.n_index.checked;
+    if (ezyt_is_optarr(&base->eval_typ))
     {
-      switch (call_data->args[i].type)
-      {
-        case ezy_ast_node_literal:
-          ezyt_append(out, "%s", ezytranspile_dt_cfmt(call_data->args[i].data.n_literal.typ));
-          break;
-        case ezy_ast_node_variable:
-          ezyt_append(out, "/* todo: variable */");
-          break;
-        case ezy_ast_node_call:
-          ezyt_append(out, "/* todo: nested call */");
-          break;
-        case ezy_ast_node_binop:
-          ezyt_append(out, "/* todo: binop result */");
-          break;
-        default:
-          ezyt_append(out, "/* unsupported arg type %d */", call_data->args[i].type);
-          break;
-      }
-      if (i < call_data->arg_count - 1)
-      {
-        ezyt_append(out, " ");
-      }
+      ezyemit_str(out, checked ? "), ezyrt_index(" : "), ");
+      return ezywalk_continue;
     }
-
-    ezyt_append(out, "\", ");
-
-    // second pass : arguments
-    for (size_t i = 0; i < call_data->arg_count; i++)
+    if (checked && ezyt_is_vec(&base->eval_typ))
     {
-      switch (call_data->args[i].type)
-      {
-        case ezy_ast_node_literal:
-          struct ezy_ast_datatype_t dt = { .typ = call_data->args[i].data.n_literal.typ };
-          // explicitly typecast non-string/char/bool literals to ensure correct printf formatting
-          if ( dt.typ != ezy_ast_dt_string && dt.typ != ezy_ast_dt_char && dt.typ != ezy_ast_dt_bool ) {
-            ezyt_append(out, "(");
-            ezytranspile_datatype(&dt, out);
-            ezyt_append(out, ")");
-          }
-          ezytranspile_literal(&call_data->args[i], out);
-          break;
-        case ezy_ast_node_variable:
-          ezyt_append(out, "/* todo: variable */");
-          continue;
-        case ezy_ast_node_call:
-          ezyt_append(out, "/* todo: nested call */");
-          continue;
-        case ezy_ast_node_binop:
-          ezyt_append(out, "/* todo: binop result */");
-          continue;
-        default:
-          ezyt_append(out, "/* unsupported arg type %d */", call_data->args[i].type);
-          continue;
-      }
-      if (i < call_data->arg_count - 1)
-      {
-        ezyt_append(out, ", ");
-      }
+      ezyemit_str(out, base->eval_typ.ext.array_t->inline_cap > 0 ? "), " : ", ");
+      return ezywalk_continue;
     }
-    
-    ezyt_append(out, ")");
-    return true;
+    if (base->type == ezy_ast_node_binop)
+      ezyemit_char(out, ')');
+    if (!ezyt_is_vec(&base->eval_typ))
+      ezyemit_str(out, checked ? "[ezyrt_index(" : "[");
+    else if (base->eval_typ.ext.array_t->inline_cap > 0)
+      ezyemit_str(out, "))[");
+    else
+      ezyemit_str(out, ".data[");
   }
-
-  // other function calls
-  ezyt_append(out, "%.*s(", call_data->func_name.len, call_data->func_name.ptr);
-  for (size_t i = 0; i < call_data->arg_count; i++)
+  else if (node->type == ezy_ast_node_call)
   {
-    if (!ezytranspile_expression(&call_data->args[i], out))
+    struct ezy_ast_call_t *call = node->data.n_call;
+    if (ezyt_is_builtin(call, "push"))
     {
-      ezy_log_warn("Unsupported argument type %d in function call", call_data->args[i].type);
-      ezyt_append(out, "/* unsupported arg type %d */", call_data->args[i].type);
-      continue;
+      if (child == 1)
+        ezyemit_str(out, "), ");
+      return ezywalk_continue;
     }
-    if (i < call_data->arg_count - 1)
+    if (!ezyt_is_print(call))
     {
-      ezyt_append(out, ", ");
+      if (child > 0)
+        ezyemit_str(out, ", ");
+      return ezywalk_continue;
     }
-  }
-  ezyt_append(out, ")");
+    // close the writer of the previous argument
+    if (child > 0 && !ezyt_print_is_const(&call->args[child - 1]))
+    {
+      ezyt_print_close(&call->args[child - 1].eval_typ, out);
+      ezyemit_str(out, ", ");
+    }
+    if (ezyt_print_is_const(&call->args[child]))
+      return ezywalk_skip; // folded into a constant run
 
-  return true;
+    ezyt_print_const_run(call, child, out);
+    if (!ezyt_print_open(&call->args[child].eval_typ, out))
+      ezy_log_warn("Cannot print argument %zu of statically unknown type", child);
+  }
+  return ezywalk_continue;
 }
 
-bool ezytranspile_expression(ezy_ast_node_t *node, ezy_multistr_t **out)
+static enum ezywalk_action ezyt_expr_post(struct ezywalk_t *w, ezy_ast_node_t *node)
 {
-  bool res = false;
-
-  if (node->type == ezy_ast_node_call)
-    res = ezytranspile_call(node, out);
-
-  else if (node->type == ezy_ast_node_binop)
-    res = ezytranspile_binop(node, out);
-
-  else if (node->type == ezy_ast_node_literal)
-    res = ezytranspile_literal(node, out);
+  struct ezyt_ctx *ctx = w->ctx;
+  ezy_emit_t *out = &ctx->out;
 
-  else if (node->type == ezy_ast_node_variable)
+  enum ezy_ast_datatype_typ tested;
+  if (node->type == ezy_ast_node_binop)
+  {
+    if (ezyt_union_tag_test(node, &tested) != NULL)
+      ezyt_union_tag_test_emit(node, false, out);
+    else if (ezyt_null_test(node) != NULL)
+      ezyt_null_test_emit(node, false, out);
+    else if (ezyt_is_str_concat(node))
+    {
+      if (!ezyt_str_concat_inner(w, node))
+        ezyemit_fmt(out, "}, %zu)", ezyt_str_concat_count(node));
+    }
+    else if (ezyt_var_binop(node) != NULL || ezyt_str_binop(node) != NULL || ezyt_optarr_store(node) ||
+             (w->parent != NULL && w->parent->type == ezy_ast_node_binop))
+      ezyemit_char(out, ')');
+  }
+  else if (node->type == ezy_ast_node_call)
+  {
+    struct ezy_ast_call_t *call = node->data.n_call;
+    bool repr;
+    if (ezyt_union_tag_test(w->parent, &tested) == node)
+    {
+      // closed by the comparison
+    }
+    else if (ezyt_is_type_id(call, &repr))
+    {
+      ezyt_type_id_close(call, repr, out);
+    }
+    else
+    {
+      if (ezyt_is_print(call))
+      {
+        if (call->arg_count > 0 && !ezyt_print_is_const(&call->args[call->arg_count - 1]))
+        {
+          ezyt_print_close(&call->args[call->arg_count - 1].eval_typ, out);
+          ezyemit_str(out, ", ");
+        }
+        ezyt_print_const_run(call, call->arg_count, out);
+        ezyemit_str(out, "(void)0");
+      }
+      ezyemit_char(out, ')');
+    }
+  }
+  else if (node->type == ezy_ast_node_array_lit && ezyt_array_lit_allowed(w, node))
+  {
+    ezyemit_char(out, '}');
+  }
+  else if (node->type == ezy_ast_node_struct_lit)
+  {
+    if (node->eval_typ.typ != ezy_ast_dt_struct || node->data.n_struct_lit.fields == NULL)
+      return ezywalk_continue; // nothing was opened
+    struct ezy_ast_struct_lit_t *lit = &node->data.n_struct_lit;
+    if (!ezyt_struct_defaults(node->eval_typ.ext.struct_t, lit, lit->count > 0, out) && lit->count == 0)
+      ezyemit_char(out, '0');
+    ezyemit_char(out, '}');
+  }
+  else if (node->type == ezy_ast_node_index && ezyt_is_optarr(&node->data.n_index.base->eval_typ))
+  {
+    if (node->data.n_index.checked)
+      ezyemit_fmt(out, ", %zu)", node->data.n_index.base->eval_typ.ext.array_t->length);
+    if (!ezyt_optarr_stored(w, node))
+      ezyemit_char(out, ')'); // a store is closed by its assignment
+  }
+  else if (node->type == ezy_ast_node_index && node->data.n_index.base->eval_typ.typ == ezy_ast_dt_array)
+  {
+    const struct ezy_ast_datatype_t *base = &node->data.n_index.base->eval_typ;
+    if (!node->data.n_index.checked)
+      ezyemit_char(out, ']');
+    else if (ezyt_is_vec(base))
+      ezyemit_str(out, "))");
+    else
+      ezyemit_fmt(out, ", %zu)]", base->ext.array_t->length);
+  }
+  else if (node->type == ezy_ast_node_member && ezyt_is_vec(&node->data.n_member.object->eval_typ))
   {
-    struct ezy_ast_variable_t var = node->data.n_variable;
-    ezyt_append(out, "%.*s", var.name.len, var.name.ptr);
-    res = true;
+    ezyemit_str(out, ").len");
   }
+  else if (node->type == ezy_ast_node_member && node->data.n_member.object->eval_typ.typ == ezy_ast_dt_struct)
+  {
+    ezyemit_str(out, node->data.n_member.object->type == ezy_ast_node_binop ? ")." : ".");
+    ezyemit_ident(out, node->data.n_member.name);
+  }
+  const struct ezy_ast_datatype_t *want = ezyt_expected(w, node);
+  if (!ezyt_field_literal(w, node, want, NULL))
+    ezyt_conv_close(node, want, out);
+  return ezywalk_continue;
+}
 
-  return res;
+// emit `node` converted to `want` (NULL: as it is)
+static bool ezyt_expression_as(ezy_ast_node_t *node, const struct ezy_ast_datatype_t *want, struct ezyt_ctx *t)
+{
+  t->expr_ok = true;
+  t->want = want;
+  ezywalk_node(&t->expr_walk, node);
+  t->want = NULL;
+  return t->expr_ok;
+}
+
+bool ezytranspile_expression(ezy_ast_node_t *node, struct ezyt_ctx *t)
+{
+  return ezyt_expression_as(node, NULL, t);
 }
 
-bool ezytranspile_stmt(ezy_ast_node_t *node, ezy_multistr_t **out)
+bool ezytranspile_stmt(ezy_ast_node_t *node, struct ezyt_ctx *t)
 {
+  ezy_emit_t *out = &t->out;
   bool res = false;
 
   if (node->type == ezy_ast_node_variable_decl)
-    res = ezytranspile_variable_decl(node, out);
+    res = ezytranspile_variable_decl(node, t);
+  else if (node->type == ezy_ast_node_return)
+    res = ezytranspile_return(node, t);
   else
-    res = ezytranspile_expression(node, out);
+    res = ezytranspile_expression(node, t);
 
   if (res)
   {
-    ezyt_append(out, ";\n");
+    ezyemit_str(out, ";\n");
   }
   else
   {
-    ezyt_append(out, "/* failed to transpile statement of type %d */\n", node->type);
+    ezy_log_error("failed to transpile statement of type %d", node->type);
+    t->failed = true;
   }
 
   return res;
 }
 
-bool ezytranspile_function(ezy_ast_node_t *node, ezy_multistr_t **out)
+bool ezytranspile_return(ezy_ast_node_t *node, struct ezyt_ctx *t)
 {
+  ezy_emit_t *out = &t->out;
+  ezy_ast_node_t *value = node->data.n_return.value;
+  if (value == NULL)
+  {
+    ezyt_exit_code(t, out);
+    // a bare return from a function that also returns values returns null
+    struct ezy_ast_datatype_t *ret = t->fn != NULL ? &t->fn->return_typ : NULL;
+    if (ezyt_void_main(t->fn))
+    {
+      ezyemit_str(out, "return 0");
+      return true;
+    }
+    if (ret == NULL || (ret->typ != ezy_ast_dt_var && !ezyt_is_opt(ret) && !ezyt_union_nullable(ret)))
+    {
+      ezyemit_str(out, "return");
+      return true;
+    }
+    ezyemit_str(out, "return ");
+    return ezyt_null_value(ret, false, out);
+  }
+  if (ezyt_exit_code(t, NULL))
+  {
+    // the value is computed before anything is released, it holds none
+    // of it (ezysema_check_regions, and stack arrays do not escape)
+    ezyemit_str(out, "{\n");
+    if (!ezytranspile_datatype(&t->fn->return_typ, out))
+      return false;
+    ezyemit_str(out, " ezy_ret = ");
+    bool ok = ezyt_expression_as(value, &t->fn->return_typ, t);
+    ezyemit_str(out, ";\n");
+    ezyt_exit_code(t, out);
+    ezyemit_str(out, "return ezy_ret;\n}");
+    return ok;
+  }
+  ezyemit_str(out, "return ");
+  return ezyt_expression_as(value, t->fn != NULL ? &t->fn->return_typ : NULL, t);
+}
 
-  const char *return_type = NULL;
-  struct ezy_ast_function_t *fn = node->data.n_function;
-
+bool ezytranspile_function_signature(struct ezy_ast_function_t *fn, ezy_emit_t *out)
+{
+  if (ezyt_void_main(fn))
+  {
+    ezyemit_str(out, "int main(void)");
+    return true;
+  }
+  if (fn->return_typ.typ == ezy_ast_dt_array && !fn->return_typ.ext.array_t->dynamic)
+  {
+    ezy_log_error("Function %.*s cannot return a fixed array", (int)fn->name.len, fn->name.ptr);
+    return false;
+  }
   if (!ezytranspile_datatype(&fn->return_typ, out))
   {
-    ezy_log_warn("Unsupported return type for function %.*s", (int)fn->name.len, fn->name.ptr);
+    ezy_log_error("Unsupported return type for function %.*s", (int)fn->name.len, fn->name.ptr);
     return false;
   }
 
-  ezyt_append(out, " %.*s(", (int)fn->name.len, fn->name.ptr);
+  ezyemit_char(out, ' ');
+  ezyemit_ident(out, fn->name);
+  ezyemit_char(out, '(');
 
   for (size_t i = 0; i < fn->param_count; i++)
   {
@@ -582,86 +3329,642 @@ bool ezytranspile_function(ezy_ast_node_t *node, ezy_multistr_t **out)
     if (!ezytranspile_datatype(&fn->params[i].typ, out))
     {
       ezy_log_warn("Unsupported parameter type for function %.*s", (int)fn->name.len, fn->name.ptr);
-      ezyt_append(out, "/* unsupported param type */ void* %.*s", (int)fn->params[i].name.len, fn->params[i].name.ptr);
+      ezyemit_str(out, "/* unsupported param type */ void* ");
+      ezyemit_ident(out, fn->params[i].name);
     }
     else
     {
       // leading space is required for correct formatting
-      ezyt_append(out, " %.*s", (int)fn->params[i].name.len, fn->params[i].name.ptr);
+      ezyemit_char(out, ' ');
+      ezyemit_ident(out, fn->params[i].name);
+      ezyt_array_suffix(&fn->params[i].typ, out);
     }
     if (i < fn->param_count - 1)
     {
-      ezyt_append(out, ", ");
+      ezyemit_str(out, ", ");
     }
   }
 
-  ezyt_append(out, ")");
+  ezyemit_char(out, ')');
+  return true;
+}
+
+bool ezytranspile_function(ezy_ast_node_t *node, struct ezyt_ctx *t)
+{
+  ezy_emit_t *out = &t->out;
+  struct ezy_ast_function_t *fn = node->data.n_function;
+
+  if (!ezytranspile_function_signature(fn, out))
+    return false;
 
   if (fn->body != NULL)
   {
-    ezyt_append(out, " {\n");
+    ezyemit_str(out, " {\n");
+    t->fn = fn;
+    // @region: allocations until every return come from the region
+    if (fn->region)
+      ezyemit_str(out, "ezyrt_region_mark ezy_region = ezyrt_region_enter();\n");
+    for (size_t i = 0; ezyt_void_main(fn) && i < fn->param_count; i++)
+    {
+      if (!ezytranspile_datatype(&fn->params[i].typ, out))
+        return false;
+      ezyemit_char(out, ' ');
+      ezyemit_ident(out, fn->params[i].name);
+      ezyt_array_suffix(&fn->params[i].typ, out);
+      ezyemit_str(out, " = {0};\n");
+    }
+    unsigned bufs = ezyt_stack_bufs(fn->body);
+    if (bufs > 0)
+      ezyemit_fmt(out, "char ezy_sbuf[%u][ezyrt_str_stack_size];\n", bufs);
     ezy_ast_node_t *body_node = fn->body;
+    bool returned = false;
     while (body_node != NULL)
     {
-      ezytranspile_stmt(body_node, out);
+      t->stmt = body_node;
+      ezytranspile_stmt(body_node, t);
+      returned = body_node->type == ezy_ast_node_return;
       body_node = body_node->next;
     }
-    ezyt_append(out, "}\n");
+    t->stmt = NULL;
+    if (!returned)
+      ezyt_exit_code(t, out);
+    if (!returned && ezyt_void_main(fn))
+      ezyemit_str(out, "return 0;\n");
+    t->fn = NULL;
+    ezyemit_str(out, "}\n");
   }
   else
   {
-    ezyt_append(out, ";\n");
+    ezyemit_str(out, ";\n");
+  }
+
+  return true;
+}
+
+// a file scope var needs a constant initializer, not ezyrt_var_<T>(x)
+//   let var g = 5;  ->  ezyrt_var g = {.as.i = 5, .tag = ezyrt_tag_i32}
+static bool ezyt_var_global(struct ezy_ast_variable_t *var, struct ezyt_ctx *t)
+{
+  ezy_emit_t *out = &t->out;
+  ezy_ast_node_t *value = var->value;
+  enum ezy_ast_datatype_typ typ = value->eval_typ.typ;
+  const char *tag = ezyt_tag_name(typ, false);
+  if (value->type != ezy_ast_node_literal || tag == NULL)
+  {
+    ezy_log_warn("Global var '%.*s' must be initialized with a literal", (int)var->name.len, var->name.ptr);
+    return false;
+  }
+
+  ezyemit_str(out, "ezyrt_var ");
+  ezyemit_ident(out, var->name);
+  ezyemit_str(out, " = {");
+  if (typ != ezy_ast_dt_null)
+  {
+    const char *field = ".as.u = ";
+    if (typ == ezy_ast_dt_int8 || typ == ezy_ast_dt_int16 || typ == ezy_ast_dt_int32 || typ == ezy_ast_dt_int64)
+      field = ".as.i = ";
+    else if (typ == ezy_ast_dt_float32 || typ == ezy_ast_dt_float64)
+      field = ".as.f = ";
+    else if (typ == ezy_ast_dt_string)
+      field = ".as.s = ";
+    ezyemit_str(out, field);
+    if (typ == ezy_ast_dt_string)
+      ezyt_append_str_literal(value->data.n_literal.value.t_string, out);
+    else if (!ezytranspile_literal(value, out))
+      return false;
+    ezyemit_str(out, ", ");
+  }
+  ezyemit_str(out, ".tag = ");
+  ezyemit_str(out, tag);
+  if (typ == ezy_ast_dt_string)
+  {
+    ezyemit_str(out, ", .len = sizeof(");
+    ezyt_append_str_literal(value->data.n_literal.value.t_string, out);
+    ezyemit_str(out, ") - 1");
   }
+  ezyemit_char(out, '}');
+  return true;
+}
+
+// a file scope T? needs a constant initializer, not ezyrt_opt_<T>_some(x)
+//   let int? g = 5;  ->  ezyrt_opt_i32 g = {.value = 5, .has = true}
+static bool ezyt_opt_global(struct ezy_ast_variable_t *var, struct ezyt_ctx *t)
+{
+  ezy_emit_t *out = &t->out;
+  if (!ezytranspile_datatype(&var->typ, out))
+    return false;
+  ezyemit_char(out, ' ');
+  ezyemit_ident(out, var->name);
+  ezyemit_str(out, " = ");
+  if (ezyt_opt_flagged(&var->typ))
+    ezyemit_str(out, "{.value = ");
+  if (!ezytranspile_literal(var->value, out))
+    return false;
+  if (ezyt_opt_flagged(&var->typ))
+    ezyemit_str(out, ", .has = true}");
+  return true;
+}
+
+// a file scope string needs the brace form of its literal
+//   let string g = "hi";  ->  ezyrt_str g = ezyrt_str_lit_init("hi")
+static bool ezyt_str_global(struct ezy_ast_variable_t *var, struct ezyt_ctx *t)
+{
+  ezy_emit_t *out = &t->out;
+  if (!ezytranspile_datatype(&var->typ, out))
+    return false;
+  ezyemit_char(out, ' ');
+  ezyemit_ident(out, var->name);
+  ezyemit_str(out, " = ");
+  ezyt_str_lit(var->value->data.n_literal.value.t_string, true, out);
+  return true;
+}
 
+// a file scope union needs a constant initializer, not a compound literal
+//   let Num g = 5;  ->  ezy_union_Num g = {.as.i32 = 5, .tag = ezy_union_Num_tag_i32}
+static bool ezyt_union_global(struct ezy_ast_variable_t *var, struct ezyt_ctx *t)
+{
+  ezy_emit_t *out = &t->out;
+  const struct ezy_ast_union_t *u = var->typ.ext.union_t;
+  size_t tag;
+  if (!ezyt_union_store_member(u, var->value->eval_typ.typ, &tag))
+  {
+    ezy_log_warn("Union %.*s has no member for a value of type %d", ezyt_union_arg(u), var->value->eval_typ.typ);
+    return false;
+  }
+  const char *field = ezyt_union_field(u->mem_typlist[tag].typ);
+  ezyemit_fmt(out, ezyt_union_fmt " ", ezyt_union_arg(u));
+  ezyemit_ident(out, var->name);
+  ezyemit_fmt(out, " = {.as.%s = ", field);
+  if (var->value->eval_typ.typ == ezy_ast_dt_string)
+    ezyt_str_lit(var->value->data.n_literal.value.t_string, true, out);
+  else if (!ezytranspile_literal(var->value, out))
+    return false;
+  ezyemit_fmt(out, ", .tag = " ezyt_union_fmt "_tag_%s}", ezyt_union_arg(u), field);
   return true;
 }
 
+// a file scope struct needs constants: literals, brace lists of them, and
+// no literal that becomes a var or a union (a call or a compound literal)
+static bool ezyt_const_init(ezy_ast_node_t *node, const struct ezy_ast_datatype_t *dt)
+{
+  if (node->type == ezy_ast_node_struct_lit)
+  {
+    struct ezy_ast_struct_lit_t *lit = &node->data.n_struct_lit;
+    for (size_t i = 0; lit->fields != NULL && i < lit->count; i++)
+    {
+      if (!ezyt_const_init(&lit->elements[i], &dt->ext.struct_t->members[lit->fields[i]].typ))
+        return false;
+    }
+    return true;
+  }
+  if (node->type == ezy_ast_node_array_lit)
+  {
+    if (dt->typ != ezy_ast_dt_array)
+      return false;
+    for (size_t i = 0; i < node->data.n_array_lit.count; i++)
+    {
+      if (!ezyt_const_init(&node->data.n_array_lit.elements[i], &dt->ext.array_t->typ))
+        return false;
+    }
+    return true;
+  }
+  if (node->type != ezy_ast_node_literal)
+    return false;
+  return ezyt_is_null_lit(node) ||
+         !(dt->typ == ezy_ast_dt_var || ezyt_is_union(dt) || (dt->nullable && dt->typ == ezy_ast_dt_bool));
+}
+
 // top level
-void ezytranspile_top_level(ezy_ast_node_t *node, ezy_multistr_t **out)
+void ezytranspile_top_level(ezy_ast_node_t *node, struct ezyt_ctx *t)
 {
+  ezy_emit_t *out = &t->out;
   if (node == NULL)
     return;
+  bool ok = true;
 
   switch (node->type)
   {
   case ezy_ast_node_function:
-    ezytranspile_function(node, out);
+    ok = ezytranspile_function(node, t);
     break;
   case ezy_ast_node_variable_decl:
-    ezytranspile_variable_decl(node, out);
+  {
+    // file scope initializers must be constant, so no ezy_vec_T_from
+    struct ezy_ast_variable_t *var = &node->data.n_variable;
+    if (ezyt_is_vec(&var->typ) && var->value != NULL && !ezyt_is_null_lit(var->value) &&
+        !(var->value->type == ezy_ast_node_array_lit && var->value->data.n_array_lit.count == 0))
+    {
+      ezy_log_error("Global dynamic array '%.*s' must start empty", (int)var->name.len, var->name.ptr);
+      ok = false;
+      break;
+    }
+    if (var->typ.typ == ezy_ast_dt_var && var->value != NULL)
+    {
+      ok = ezyt_var_global(var, t);
+      if (ok)
+        ezyemit_str(out, ";\n");
+      break;
+    }
+    if (ezyt_is_opt(&var->typ) && (ezyt_opt_flagged(&var->typ) || var->typ.typ == ezy_ast_dt_bool) &&
+        var->value != NULL && var->value->type == ezy_ast_node_literal && !ezyt_is_null_lit(var->value))
+    {
+      ok = ezyt_opt_global(var, t);
+      if (ok)
+        ezyemit_str(out, ";\n");
+      break;
+    }
+    if (var->typ.typ == ezy_ast_dt_string && var->value != NULL && var->value->type == ezy_ast_node_literal &&
+        var->value->data.n_literal.typ == ezy_ast_dt_string)
+    {
+      ok = ezyt_str_global(var, t);
+      if (ok)
+        ezyemit_str(out, ";\n");
+      break;
+    }
+    if (ezyt_is_union(&var->typ) && var->value != NULL && var->value->type == ezy_ast_node_literal && !ezyt_is_null_lit(var->value))
+    {
+      ok = ezyt_union_global(var, t);
+      if (ok)
+        ezyemit_str(out, ";\n");
+      break;
+    }
+    if (var->typ.typ == ezy_ast_dt_struct && var->value != NULL && !ezyt_const_init(var->value, &var->typ))
+    {
+      ezy_log_error("Global struct '%.*s' must be initialized with literals", (int)var->name.len, var->name.ptr);
+      ok = false;
+      break;
+    }
+    ok = ezytranspile_variable_decl(node, t);
+    if (ok)
+      ezyemit_str(out, ";\n");
     break;
+  }
+  case ezy_ast_node_union:
+  case ezy_ast_node_struct:
+    break; // defined in the prologue
   default:
-    ezy_log_warn("Unsupported AST node type %d in transpilation", node->type);
+    ezy_log_error("Unsupported AST node type %d in transpilation", node->type);
+    ok = false;
     break;
   }
+  if (!ok)
+    t->failed = true;
 }
 
 static const char *c_biolerplate =
+    "#include <stdio.h>\n"
     "#include <stdint.h>\n"
+    "#include <stdlib.h>\n"
+    "#include <math.h>\n"
     "#include <stdbool.h>\n"
+    "\n"
+    "#include <ezyrt.h>\n"
+    "#include <ezyrt_str.h>\n"
+    "#include <ezyrt_var.h>\n"
+    "#include <ezyrt_opt.h>\n"
     "\n";
 
+static void ezyt_ctx_init(struct ezyt_ctx *t)
+{
+  ezyemit_init(&t->out);
+  t->expr_walk = (struct ezywalk_t){
+      .pre = ezyt_expr_pre,
+      .child = ezyt_expr_child,
+      .post = ezyt_expr_post,
+      .ctx = t,
+  };
+  t->expr_ok = true;
+  t->array_init = false;
+  t->want = NULL;
+  t->array_root = NULL;
+  t->array_elem = NULL;
+  t->fn = NULL;
+  t->struct_root = NULL;
+  t->stmt = NULL;
+  t->failed = false;
+}
+
+// returns the generated chain, NULL if nothing was written or on failure:
+// out of memory, or a node that could not be transpiled (reported already)
+static ezy_multistr_t *ezyt_ctx_finish(struct ezyt_ctx *t, bool *ok)
+{
+  ezywalk_release(&t->expr_walk);
+  if (t->out.failed)
+    ezy_log_error("Memory allocation failed in the transpiler");
+  if (t->out.failed || t->failed)
+  {
+    ezyemit_free(t->out.head);
+    *ok = false;
+    return NULL;
+  }
+  return t->out.head;
+}
+
+// boilerplate and prototypes, so calls may precede definitions
+static void ezyt_prologue(ezy_ast_node_t *node, const struct ezytranspile_opts *opts, struct ezyt_ctx *t)
+{
+  ezyemit_str(&t->out, c_biolerplate);
+
+  for (ezy_ast_node_t *fn_node = node; fn_node != NULL; fn_node = fn_node->next)
+  {
+    if (fn_node->type == ezy_ast_node_function && fn_node->data.n_function->region)
+    {
+      ezyemit_str(&t->out, "#include <ezyrt_region.h>\n\n");
+      break;
+    }
+  }
+
+  // unions before the vectors, they may be elements
+  for (ezy_ast_node_t *u_node = node; u_node != NULL; u_node = u_node->next)
+  {
+    if (u_node->type == ezy_ast_node_union)
+      ezyt_union_define(u_node->data.n_union, &t->out);
+  }
+
+  // one vector type per dynamic array element type (and inline capacity),
+  // structs among them where their fields need them
+  ezyt_stack_select(node, opts->small_array_max, opts->stats);
+  ezyt_bounds_select(node, opts->checks, opts->stats);
+  struct ezyt_vec_set vecs = {0};
+  ezyt_vec_set_collect(&vecs, node);
+  bool any_vec = false;
+  for (size_t i = 0; i < vecs.count; i++)
+    any_vec |= vecs.types[i].typ == ezy_ast_dt_array;
+  if (any_vec)
+    ezyemit_str(&t->out, "#include <ezyrt_vec.h>\n\n");
+  for (size_t i = 0; i < vecs.count; i++)
+  {
+    if (vecs.types[i].typ == ezy_ast_dt_struct)
+    {
+      ezyt_struct_define(vecs.types[i].ext.struct_t, &t->out);
+      continue;
+    }
+    struct ezy_ast_array_t *arr = vecs.types[i].ext.array_t;
+    if (!arr->dynamic)
+    {
+      // bitmap array: the optional type, then its value type
+      struct ezy_ast_datatype_t value = arr->typ;
+      value.nullable = false;
+      ezyemit_str(&t->out, "ezyrt_optarr_define(");
+      ezyemit_str(&t->out, vecs.names[i]);
+      ezyemit_str(&t->out, ", ");
+      ezytranspile_datatype(&arr->typ, &t->out);
+      ezyemit_str(&t->out, ", ");
+      ezytranspile_datatype(&value, &t->out);
+      ezyemit_str(&t->out, ", ");
+      ezyemit_uint(&t->out, arr->length);
+      ezyemit_str(&t->out, ")\n");
+      continue;
+    }
+    ezyemit_str(&t->out, arr->inline_cap > 0 ? "ezyrt_svec_define(" : "ezyrt_vec_define(");
+    ezyemit_str(&t->out, vecs.names[i]);
+    ezyemit_str(&t->out, ", ");
+    ezytranspile_datatype(&arr->typ, &t->out);
+    if (arr->inline_cap > 0)
+    {
+      ezyemit_str(&t->out, ", ");
+      ezyemit_uint(&t->out, arr->inline_cap);
+    }
+    ezyemit_str(&t->out, ")\n");
+  }
+  if (vecs.count > 0)
+    ezyemit_char(&t->out, '\n');
+  free(vecs.names);
+  free(vecs.types);
+
+  for (ezy_ast_node_t *fn_node = node; fn_node != NULL; fn_node = fn_node->next)
+  {
+    if (fn_node->type == ezy_ast_node_function && ezytranspile_function_signature(fn_node->data.n_function, &t->out))
+      ezyemit_str(&t->out, ";\n");
+  }
+  ezyemit_char(&t->out, '\n');
+}
+
+// ================ Layout report ================
+// --dump-layout: every struct with its size and padding in declaration
+// order and as laid out, then each field at its offset.
+
+ezy_multistr_t *ezytranspile_layout_report(ezy_ast_node_t *node)
+{
+  ezy_emit_t out;
+  ezyemit_init(&out);
+  bool any = false;
+  for (; node != NULL; node = node->next)
+  {
+    if (node->type != ezy_ast_node_struct)
+      continue;
+    const struct ezy_ast_struct_t *s = node->data.n_struct;
+    any = true;
+    size_t *order = malloc(sizeof(size_t) * s->count * 3);
+    if (order == NULL)
+      break;
+    size_t *decl_order = order + s->count, *offsets = order + s->count * 2;
+    for (size_t i = 0; i < s->count; i++)
+      decl_order[i] = i;
+    size_t size, align, padding, decl_size, decl_align, decl_padding;
+    if (!ezyt_struct_order(s, order) || !ezyt_struct_measure(s, order, offsets, &size, &align, &padding) ||
+        !ezyt_struct_measure(s, decl_order, NULL, &decl_size, &decl_align, &decl_padding))
+    {
+      ezyemit_fmt(&out, "struct %.*s: no C layout\n\n", ezyt_struct_arg(s));
+      free(order);
+      continue;
+    }
+
+    ezyemit_fmt(&out, "struct %.*s%s: %zu bytes, align %zu, padding %zu\n", ezyt_struct_arg(s), s->abi ? " (@abi)" : "", size,
+                align, padding);
+    ezyemit_fmt(&out, "  declaration order: %zu bytes, padding %zu\n", decl_size, decl_padding);
+    ezyemit_str(&out, "  offset  size  field\n");
+    for (size_t i = 0; i < s->count; i++)
+    {
+      struct ezy_ast_args_t *field = &s->members[order[i]];
+      size_t field_size, field_align;
+      ezyt_dt_layout(&field->typ, &field_size, &field_align);
+      ezyemit_fmt(&out, "  %6zu  %4zu  %.*s: ", offsets[i], field_size, (int)field->name.len, field->name.ptr);
+      ezytranspile_datatype(&field->typ, &out);
+      ezyt_array_suffix(&field->typ, &out);
+      ezyemit_char(&out, '\n');
+    }
+    ezyemit_char(&out, '\n');
+    free(order);
+  }
+  if (!any)
+    ezyemit_str(&out, "(no structs)\n");
+  if (out.failed)
+  {
+    ezyemit_free(out.head);
+    return NULL;
+  }
+  return out.head;
+}
+
 ezy_multistr_t *ezytranspile_c(ezy_ast_node_t *node)
 {
-  ezy_multistr_t *head = ezyparse_arena_alloc(sizeof(ezy_multistr_t));
-  char *ptr = ezyparse_arena_alloc(ezyt_max_cstr_size); // allocate 64KB for output
-  if (ptr == NULL || head == NULL)
+  return ezytranspile_c_parallel(node, 1);
+}
+
+// ================ Parallel code generation ================
+// Every top-level node is a segment with its own chain. Workers claim
+// segments in order from a shared counter; the chains are spliced back
+// together in declaration order.
+
+struct ezyt_segment
+{
+  ezy_ast_node_t *node;
+  ezy_multistr_t *head;
+  ezy_multistr_t *tail;
+  bool ok;
+};
+
+struct ezyt_jobs
+{
+  struct ezyt_segment *segs;
+  size_t count;
+#if !defined(_WIN32)
+  atomic_size_t next;
+#else
+  size_t next;
+#endif
+};
+
+static void ezyt_run_segment(struct ezyt_segment *seg)
+{
+  struct ezyt_ctx t;
+  ezyt_ctx_init(&t);
+  ezytranspile_top_level(seg->node, &t);
+  seg->ok = true;
+  seg->tail = t.out.tail;
+  seg->head = ezyt_ctx_finish(&t, &seg->ok);
+}
+
+static void *ezyt_worker(void *arg)
+{
+  struct ezyt_jobs *jobs = arg;
+  while (true)
+  {
+#if !defined(_WIN32)
+    size_t i = atomic_fetch_add(&jobs->next, 1);
+#else
+    size_t i = jobs->next++;
+#endif
+    if (i >= jobs->count)
+      break;
+    ezyt_run_segment(&jobs->segs[i]);
+  }
+  return NULL;
+}
+
+ezy_multistr_t *ezytranspile_c_parallel(ezy_ast_node_t *node, int threads)
+{
+  struct ezytranspile_opts opts = {.jobs = threads, .small_array_max = ezytranspile_small_array_default};
+  return ezytranspile_c_opts(node, &opts);
+}
+
+ezy_multistr_t *ezytranspile_c_opts(ezy_ast_node_t *node, const struct ezytranspile_opts *opts)
+{
+  bool ok = true;
+  int threads = opts->jobs;
+  struct ezyt_ctx t;
+  ezyt_ctx_init(&t);
+  ezyt_prologue(node, opts, &t);
+
+  size_t count = 0;
+  for (ezy_ast_node_t *n = node; n != NULL; n = n->next)
+    count++;
+
+  if (threads <= 1 || count < 2)
+  {
+    // single context, no splicing
+    for (; node != NULL; node = node->next)
+      ezytranspile_top_level(node, &t);
+    return ezyt_ctx_finish(&t, &ok);
+  }
+
+  ezy_multistr_t *tail = t.out.tail;
+  ezy_multistr_t *head = ezyt_ctx_finish(&t, &ok);
+
+  struct ezyt_jobs jobs = {.count = count};
+  jobs.segs = calloc(count, sizeof(struct ezyt_segment));
+  if (jobs.segs == NULL)
   {
     ezy_log_warn("Memory allocation failed in ezytranspile_c");
+    ezyemit_free(head);
     return NULL;
   }
-  head->str.ptr = ptr;
-  head->str.len = 0;
-  head->next = NULL;
-  ezy_multistr_t *current = head;
+  size_t i = 0;
+  for (ezy_ast_node_t *n = node; n != NULL; n = n->next)
+    jobs.segs[i++].node = n;
+
+#if !defined(_WIN32)
+  atomic_init(&jobs.next, 0);
+  if ((size_t)threads > count)
+    threads = (int)count;
+  pthread_t *workers = malloc(sizeof(pthread_t) * (size_t)threads);
+  int started = 0;
+  if (workers != NULL)
+  {
+    // the calling thread is worker 0
+    for (; started < threads - 1; started++)
+    {
+      if (pthread_create(&workers[started], NULL, ezyt_worker, &jobs) != 0)
+        break;
+    }
+  }
+  ezyt_worker(&jobs);
+  for (int w = 0; w < started; w++)
+    pthread_join(workers[w], NULL);
+  free(workers);
+#else
+  ezyt_worker(&jobs); // no threads on this platform, same result
+#endif
 
-  // Initial boilerplate for C output
-  ezyt_append_buf(&current, c_biolerplate, strlen(c_biolerplate));
+  // splice in declaration order
+  for (i = 0; i < count; i++)
+  {
+    struct ezyt_segment *seg = &jobs.segs[i];
+    ok &= seg->ok;
+    if (seg->head == NULL)
+      continue;
+    if (tail != NULL)
+      tail->next = seg->head;
+    else
+      head = seg->head;
+    tail = seg->tail;
+  }
+  free(jobs.segs);
 
-  while (node != NULL)
+  if (!ok)
   {
-    ezytranspile_top_level(node, &current);
-    node = node->next;
+    ezyemit_free(head);
+    return NULL;
   }
   return head;
-}
\ No newline at end of file
+}
+
+bool ezytranspile_c_prologue(ezy_ast_node_t *node, const struct ezytranspile_opts *opts, ezy_multistr_t **head,
+                             ezy_multistr_t **tail)
+{
+  bool ok = true;
+  struct ezyt_ctx t;
+  ezyt_ctx_init(&t);
+  ezyt_prologue(node, opts, &t);
+  *tail = t.out.tail;
+  *head = ezyt_ctx_finish(&t, &ok);
+  return ok;
+}
+
+bool ezytranspile_c_range(ezy_ast_node_t *first, ezy_ast_node_t *end, ezy_multistr_t **head, ezy_multistr_t **tail)
+{
+  bool ok = true;
+  struct ezyt_ctx t;
+  ezyt_ctx_init(&t);
+  for (ezy_ast_node_t *node = first; node != end; node = node->next)
+    ezytranspile_top_level(node, &t);
+  *tail = t.out.tail;
+  *head = ezyt_ctx_finish(&t, &ok);
+  return ok;
+}
+
+void ezytranspile_c_free(ezy_multistr_t *code)
+{
+  ezyemit_free(code);
+}
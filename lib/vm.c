@@ -0,0 +1,304 @@
+#include <ezy_log.h>
+#include <ezy_vm.h>
+#include <ezyrt.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// ================ Externs ================
+// The C functions bytecode can call without a compiler to link them.
+
+static const struct {
+  struct ezyvm_extern ext;
+  union {
+    double (*d_d)(double);
+    double (*d_dd)(double, double);
+    int (*i_i)(int);
+    long (*l_l)(long);
+  } fn;
+} ezyvm_externs[] = {
+  {{"sqrt", ezyvm_sig_d_d}, {.d_d = sqrt}},
+  {{"pow", ezyvm_sig_d_dd}, {.d_dd = pow}},
+  {{"fabs", ezyvm_sig_d_d}, {.d_d = fabs}},
+  {{"floor", ezyvm_sig_d_d}, {.d_d = floor}},
+  {{"ceil", ezyvm_sig_d_d}, {.d_d = ceil}},
+  {{"sin", ezyvm_sig_d_d}, {.d_d = sin}},
+  {{"cos", ezyvm_sig_d_d}, {.d_d = cos}},
+  {{"tan", ezyvm_sig_d_d}, {.d_d = tan}},
+  {{"exp", ezyvm_sig_d_d}, {.d_d = exp}},
+  {{"log", ezyvm_sig_d_d}, {.d_d = log}},
+  {{"fmod", ezyvm_sig_d_dd}, {.d_dd = fmod}},
+  {{"abs", ezyvm_sig_i_i}, {.i_i = abs}},
+  {{"labs", ezyvm_sig_l_l}, {.l_l = labs}},
+};
+
+#define ezyvm_extern_count (sizeof ezyvm_externs / sizeof *ezyvm_externs)
+
+int ezyvm_extern_find(ezy_cstr_t name)
+{
+  for (size_t i = 0; i < ezyvm_extern_count; i++)
+  {
+    const char *n = ezyvm_externs[i].ext.name;
+    if (strlen(n) == name.len && memcmp(n, name.ptr, name.len) == 0)
+      return (int)i;
+  }
+  return -1;
+}
+
+const struct ezyvm_extern *ezyvm_extern_get(int index)
+{
+  return &ezyvm_externs[index].ext;
+}
+
+// ================ Interpreter ================
+// Frames overlap: a call's arguments sit in consecutive registers of the
+// caller, which become the callee's first registers, and the callee
+// returns its value in its register 0, the caller's first argument.
+
+#define ezyvm_stack_slots (1u << 18)
+#define ezyvm_max_frames (1u << 14)
+
+struct ezyvm_frame {
+  const uint32_t *pc; // where the caller resumes
+  ezyvm_value *r;     // the caller's registers
+};
+
+static void ezyvm_fail(const char *what)
+{
+  fprintf(stderr, "ezy: %s\n", what);
+  exit(EXIT_FAILURE); // runs the atexit flush of the program's output
+}
+
+static inline void ezyvm_conv(ezyvm_value v, uint32_t kind, ezyvm_value *out)
+{
+  switch (kind)
+  {
+  case ezyvm_conv_i8: out->i = (int8_t)v.i; break;
+  case ezyvm_conv_u8: out->u = (uint8_t)v.u; break;
+  case ezyvm_conv_i16: out->i = (int16_t)v.i; break;
+  case ezyvm_conv_u16: out->u = (uint16_t)v.u; break;
+  case ezyvm_conv_i32: out->i = (int32_t)v.i; break;
+  case ezyvm_conv_u32: out->u = (uint32_t)v.u; break;
+  case ezyvm_conv_bool: out->u = v.u != 0; break;
+  case ezyvm_conv_f32: out->f = (float)v.f; break;
+  case ezyvm_conv_i2f: out->f = (double)v.i; break;
+  case ezyvm_conv_u2f: out->f = (double)v.u; break;
+  case ezyvm_conv_f2i: out->i = (int64_t)v.f; break;
+  case ezyvm_conv_f2u: out->u = (uint64_t)v.f; break;
+  case ezyvm_conv_f2bool: out->u = v.f != 0; break;
+  default: break;
+  }
+}
+
+int ezyvm_run(const struct ezyvm_program *prog)
+{
+  if (prog->failed || prog->entry >= prog->func_count)
+    return EXIT_FAILURE;
+  ezyvm_value *stack = calloc(ezyvm_stack_slots, sizeof *stack);
+  struct ezyvm_frame *frames = malloc(ezyvm_max_frames * sizeof *frames);
+  ezyvm_value *g = calloc(prog->global_count > 0 ? prog->global_count : 1, sizeof *g);
+  if (stack == NULL || frames == NULL || g == NULL)
+  {
+    ezy_log_error("bytecode: out of memory for the stack");
+    free(stack);
+    free(frames);
+    free(g);
+    return EXIT_FAILURE;
+  }
+  const ezyvm_value *stack_end = stack + ezyvm_stack_slots;
+  const ezyvm_value *k = prog->consts;
+  const struct ezyvm_function *funcs = prog->funcs;
+  const struct ezyvm_function *entry = &funcs[prog->entry];
+  const uint32_t *pc = prog->code + entry->code;
+  ezyvm_value *r = stack; // main's parameters, if any, are zero
+  size_t depth = 0;
+  int status = 0;
+  uint32_t i;
+
+  if (entry->regs > ezyvm_stack_slots)
+    ezyvm_fail("stack overflow");
+
+#define A ezyvm_a(i)
+#define B ezyvm_b(i)
+#define C ezyvm_c(i)
+#define Bx ezyvm_bx(i)
+
+  // computed goto: every handler dispatches the next instruction itself,
+  // one indirect jump per handler instead of a shared one in a switch
+#if defined(__GNUC__)
+  static const void *const labels[ezyvm_op_count] = {
+#define ezyvm_label(name) &&ezyvm_l_##name,
+    ezyvm_opcodes(ezyvm_label)
+#undef ezyvm_label
+  };
+#define ezyvm_case(name) ezyvm_l_##name:
+#define ezyvm_next() \
+  do { \
+    i = *pc++; \
+    goto *labels[ezyvm_op(i)]; \
+  } while (0)
+  ezyvm_next();
+#else
+#define ezyvm_case(name) case ezyvm_op_##name:
+#define ezyvm_next() continue
+  for (;;)
+  {
+    i = *pc++;
+    switch (ezyvm_op(i))
+    {
+#endif
+
+  ezyvm_case(move)
+    r[A] = r[B];
+    ezyvm_next();
+  ezyvm_case(loadk)
+    r[A] = k[Bx];
+    ezyvm_next();
+  ezyvm_case(getg)
+    r[A] = g[Bx];
+    ezyvm_next();
+  ezyvm_case(setg)
+    g[Bx] = r[A];
+    ezyvm_next();
+  ezyvm_case(add)
+    r[A].u = r[B].u + r[C].u;
+    ezyvm_next();
+  ezyvm_case(sub)
+    r[A].u = r[B].u - r[C].u;
+    ezyvm_next();
+  ezyvm_case(mul)
+    r[A].u = r[B].u * r[C].u;
+    ezyvm_next();
+  ezyvm_case(div_i)
+    if (r[C].i == 0)
+      ezyvm_fail("division by zero");
+    r[A].i = r[C].i == -1 ? (int64_t)(0 - r[B].u) : r[B].i / r[C].i;
+    ezyvm_next();
+  ezyvm_case(div_u)
+    if (r[C].u == 0)
+      ezyvm_fail("division by zero");
+    r[A].u = r[B].u / r[C].u;
+    ezyvm_next();
+  ezyvm_case(mod_i)
+    if (r[C].i == 0)
+      ezyvm_fail("division by zero");
+    r[A].i = r[C].i == -1 ? 0 : r[B].i % r[C].i;
+    ezyvm_next();
+  ezyvm_case(mod_u)
+    if (r[C].u == 0)
+      ezyvm_fail("division by zero");
+    r[A].u = r[B].u % r[C].u;
+    ezyvm_next();
+  ezyvm_case(addf)
+    r[A].f = r[B].f + r[C].f;
+    ezyvm_next();
+  ezyvm_case(subf)
+    r[A].f = r[B].f - r[C].f;
+    ezyvm_next();
+  ezyvm_case(mulf)
+    r[A].f = r[B].f * r[C].f;
+    ezyvm_next();
+  ezyvm_case(divf)
+    r[A].f = r[B].f / r[C].f;
+    ezyvm_next();
+  ezyvm_case(eq)
+    r[A].u = r[B].u == r[C].u;
+    ezyvm_next();
+  ezyvm_case(ne)
+    r[A].u = r[B].u != r[C].u;
+    ezyvm_next();
+  ezyvm_case(eqf)
+    r[A].u = r[B].f == r[C].f;
+    ezyvm_next();
+  ezyvm_case(nef)
+    r[A].u = r[B].f != r[C].f;
+    ezyvm_next();
+  ezyvm_case(conv)
+    ezyvm_conv(r[B], C, &r[A]);
+    ezyvm_next();
+  ezyvm_case(call)
+  {
+    const struct ezyvm_function *fn = &funcs[Bx];
+    if (depth == ezyvm_max_frames || r + A + fn->regs > stack_end)
+      ezyvm_fail("stack overflow");
+    frames[depth++] = (struct ezyvm_frame){.pc = pc, .r = r};
+    r += A;
+    pc = prog->code + fn->code;
+    ezyvm_next();
+  }
+  ezyvm_case(ccall)
+  {
+    ezyvm_value *args = &r[A];
+    switch (ezyvm_externs[Bx].ext.sig)
+    {
+    case ezyvm_sig_d_d: args[0].f = ezyvm_externs[Bx].fn.d_d(args[0].f); break;
+    case ezyvm_sig_d_dd: args[0].f = ezyvm_externs[Bx].fn.d_dd(args[0].f, args[1].f); break;
+    case ezyvm_sig_i_i: args[0].i = ezyvm_externs[Bx].fn.i_i((int)args[0].i); break;
+    case ezyvm_sig_l_l: args[0].i = ezyvm_externs[Bx].fn.l_l((long)args[0].i); break;
+    }
+    ezyvm_next();
+  }
+  ezyvm_case(ret)
+    r[0] = r[A];
+    if (depth == 0)
+    {
+      status = (int)r[0].i;
+      goto done;
+    }
+    depth--;
+    r = frames[depth].r;
+    pc = frames[depth].pc;
+    ezyvm_next();
+  ezyvm_case(ret0)
+    if (depth == 0)
+      goto done;
+    depth--;
+    r = frames[depth].r;
+    pc = frames[depth].pc;
+    ezyvm_next();
+  ezyvm_case(write_k)
+    ezyrt_write(prog->strings + ezyvm_str_off(k[Bx].u), ezyvm_str_len(k[Bx].u));
+    ezyvm_next();
+  ezyvm_case(write_i)
+    ezyrt_write_i64(r[A].i);
+    ezyvm_next();
+  ezyvm_case(write_u)
+    ezyrt_write_u64(r[A].u);
+    ezyvm_next();
+  ezyvm_case(write_f)
+    ezyrt_write_f64(r[A].f);
+    ezyvm_next();
+  ezyvm_case(write_f32)
+    ezyrt_write_f32((float)r[A].f);
+    ezyvm_next();
+  ezyvm_case(write_b)
+    if (r[A].u)
+      ezyrt_write("true", 4);
+    else
+      ezyrt_write("false", 5);
+    ezyvm_next();
+  ezyvm_case(write_s)
+    ezyrt_write(prog->strings + ezyvm_str_off(r[A].u), ezyvm_str_len(r[A].u));
+    ezyvm_next();
+
+#if !defined(__GNUC__)
+    default:
+      ezyvm_fail("invalid instruction");
+    }
+  }
+#endif
+
+done:
+#undef ezyvm_case
+#undef ezyvm_next
+#undef A
+#undef B
+#undef C
+#undef Bx
+  ezyrt_flush();
+  free(stack);
+  free(frames);
+  free(g);
+  return status;
+}
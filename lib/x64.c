@@ -0,0 +1,1412 @@
+#include <ezy_ast_walk.h>
+#include <ezy_elf.h>
+#include <ezy_emit.h>
+#include <ezy_log.h>
+#include <ezy_symtab.h>
+#include <ezy_transpile_c.h>
+#include <ezy_vm.h>
+#include <ezy_x64.h>
+#include <stdlib.h>
+#include <string.h>
+
+// ================ Values ================
+// Values are held the way C holds them, so a program prints the same
+// through either backend: an integer in a 64-bit register, sign or zero
+// extended from its C type, a float in the low lane of an xmm register.
+// Expressions leave their value in rax or xmm0; rcx and xmm1 hold a right
+// operand, rdx, r11 and xmm2 are scratch. A string is only ever a literal
+// here, held as a pointer to its length and text in .rodata.
+
+enum ezyx_ctype {
+  ezyx_bad = 0, // not lowered, an error was reported
+  ezyx_none,    // void
+  ezyx_i8,
+  ezyx_u8,
+  ezyx_i16,
+  ezyx_u16,
+  ezyx_i32,
+  ezyx_u32,
+  ezyx_i64,
+  ezyx_u64,
+  ezyx_bool,
+  ezyx_f32,
+  ezyx_f64,
+  ezyx_str,
+};
+
+enum ezyx_reg {
+  ezyx_rax, ezyx_rcx, ezyx_rdx, ezyx_rbx, ezyx_rsp, ezyx_rbp, ezyx_rsi, ezyx_rdi,
+  ezyx_r8, ezyx_r9, ezyx_r10, ezyx_r11, ezyx_r12, ezyx_r13, ezyx_r14, ezyx_r15,
+};
+
+#define ezyx_stack (-1) // a local without a register
+
+static const int ezyx_int_args[] = {ezyx_rdi, ezyx_rsi, ezyx_rdx, ezyx_rcx, ezyx_r8, ezyx_r9};
+#define ezyx_int_arg_max 6
+#define ezyx_float_arg_max 8
+
+// linear scan pools: locals live across a call need a callee-saved
+// register, others may take a caller-saved one no expression uses
+static const int ezyx_callee_saved[] = {ezyx_rbx, ezyx_r12, ezyx_r13, ezyx_r14, ezyx_r15};
+static const int ezyx_caller_saved[] = {ezyx_rsi, ezyx_rdi, ezyx_r8, ezyx_r9, ezyx_r10};
+#define ezyx_xmm_first 8 // xmm8..xmm15, there are no callee-saved xmm registers
+
+static inline bool ezyx_is_float(enum ezyx_ctype t)
+{
+  return t == ezyx_f32 || t == ezyx_f64;
+}
+
+static inline bool ezyx_is_signed(enum ezyx_ctype t)
+{
+  return t == ezyx_i8 || t == ezyx_i16 || t == ezyx_i32 || t == ezyx_i64;
+}
+
+static enum ezyx_ctype ezyx_ctype_of(const struct ezy_ast_datatype_t *dt)
+{
+  if (dt->nullable || dt->is_ptr)
+    return ezyx_bad;
+  switch (dt->typ)
+  {
+  case ezy_ast_dt_void: return ezyx_none;
+  case ezy_ast_dt_int8: return ezyx_i8;
+  case ezy_ast_dt_uint8: return ezyx_u8;
+  case ezy_ast_dt_int16: return ezyx_i16;
+  case ezy_ast_dt_uint16: return ezyx_u16;
+  case ezy_ast_dt_int32: return ezyx_i32;
+  case ezy_ast_dt_uint32: return ezyx_u32;
+  case ezy_ast_dt_int64: return ezyx_i64;
+  case ezy_ast_dt_uint64: return ezyx_u64;
+  case ezy_ast_dt_bool: return ezyx_bool;
+  case ezy_ast_dt_float32: return ezyx_f32;
+  case ezy_ast_dt_float64: return ezyx_f64;
+  case ezy_ast_dt_string: return ezyx_str;
+  default: return ezyx_bad;
+  }
+}
+
+// C's usual arithmetic conversions
+static enum ezyx_ctype ezyx_common(enum ezyx_ctype a, enum ezyx_ctype b)
+{
+  if (a == ezyx_f64 || b == ezyx_f64)
+    return ezyx_f64;
+  if (a == ezyx_f32 || b == ezyx_f32)
+    return ezyx_f32;
+  a = a < ezyx_i32 || a == ezyx_bool ? ezyx_i32 : a;
+  b = b < ezyx_i32 || b == ezyx_bool ? ezyx_i32 : b;
+  if (a == b)
+    return a;
+  if (a >= ezyx_i64 || b >= ezyx_i64)
+    return a == ezyx_u64 || b == ezyx_u64 ? ezyx_u64 : ezyx_i64;
+  return ezyx_u32;
+}
+
+// ================ Function state ================
+
+struct ezyx_local {
+  struct ezy_symbol_t *sym; // NULL for a parameter
+  enum ezyx_ctype typ;
+  bool used;
+  bool crosses;   // live across a call
+  uint32_t start; // positions of the first and last touch
+  uint32_t end;
+  int reg; // gpr or xmm number, ezyx_stack
+  int32_t disp; // [rbp + disp] on the stack
+};
+
+struct ezyx_arg {
+  bool flt;
+  int reg;   // once all are pushed, ezyx_stack past the registers
+  int depth; // g->depth once it was pushed
+};
+
+struct ezyx_gen {
+  struct ezyelf_obj *obj;
+  struct ezy_ast_function_t *fn;
+
+  struct ezyx_local *locals; // parameters first
+  size_t count;
+  size_t cap;
+
+  uint32_t *calls; // positions of the calls, ascending
+  size_t call_count;
+  size_t call_cap;
+  uint32_t pos;
+
+  struct ezywalk_t walk;
+  enum ezyx_ctype *types; // of the values computed, for their parents
+  size_t type_count;
+  size_t type_cap;
+  struct ezyx_arg *args; // arguments pushed for the calls underway
+  size_t arg_count;
+  size_t arg_cap;
+
+  unsigned saved; // callee-saved registers the function uses
+  int saved_count;
+  size_t slots;   // 8 byte stack slots
+  size_t frame;   // bytes below the saved registers, slots and alignment
+  int depth;      // bytes pushed below the frame
+  size_t true_at; // "true" and "false" in .rodata, once per object
+  size_t false_at;
+  bool bools;
+  bool failed;
+};
+
+static bool ezyx_unsupported(struct ezyx_gen *g, const char *what, int detail)
+{
+  ezy_log_error("native backend: %s (%d) in function %.*s is not supported, use the C backend", what, detail,
+                (int)g->fn->name.len, g->fn->name.ptr);
+  g->failed = true;
+  return false;
+}
+
+static bool ezyx_reserve(struct ezyx_gen *g, void **items, size_t *cap, size_t need, size_t size)
+{
+  if (need <= *cap)
+    return true;
+  size_t n = *cap > 0 ? *cap * 2 : 32;
+  void *p = realloc(*items, n * size);
+  if (p == NULL)
+  {
+    ezy_log_error("native backend: out of memory");
+    g->failed = true;
+    return false;
+  }
+  *items = p;
+  *cap = n;
+  return true;
+}
+
+static inline ezy_cstr_t ezyx_name(const char *s)
+{
+  return (ezy_cstr_t){.ptr = s, .len = strlen(s)};
+}
+
+// ================ Encoding ================
+
+static inline size_t ezyx_here(struct ezyx_gen *g)
+{
+  return g->obj->text.len;
+}
+
+static inline void ezyx_byte(struct ezyx_gen *g, uint8_t b)
+{
+  ezyelf_append(g->obj, &g->obj->text, &b, 1);
+}
+
+static void ezyx_le(struct ezyx_gen *g, uint64_t v, size_t n)
+{
+  uint8_t b[8];
+  for (size_t i = 0; i < n; i++)
+    b[i] = (uint8_t)(v >> (8 * i));
+  ezyelf_append(g->obj, &g->obj->text, b, n);
+}
+
+// [prefix] [REX] opcode: one to three bytes, escapes first
+static void ezyx_head(struct ezyx_gen *g, uint8_t prefix, bool w, uint32_t op, int reg, int rm)
+{
+  if (prefix != 0)
+    ezyx_byte(g, prefix);
+  uint8_t rex = (uint8_t)(0x40 | (w ? 8 : 0) | ((reg & 8) >> 1) | ((rm & 8) >> 3));
+  if (rex != 0x40)
+    ezyx_byte(g, rex);
+  if (op > 0xffff)
+    ezyx_byte(g, (uint8_t)(op >> 16));
+  if (op > 0xff)
+    ezyx_byte(g, (uint8_t)(op >> 8));
+  ezyx_byte(g, (uint8_t)op);
+}
+
+// ModRM.reg is `reg` (a register or an opcode extension), r/m the register `rm`
+static void ezyx_op(struct ezyx_gen *g, uint8_t prefix, bool w, uint32_t op, int reg, int rm)
+{
+  ezyx_head(g, prefix, w, op, reg, rm);
+  ezyx_byte(g, (uint8_t)(0xc0 | (reg & 7) << 3 | (rm & 7)));
+}
+
+// r/m is [rbp + disp]
+static void ezyx_op_rbp(struct ezyx_gen *g, uint8_t prefix, bool w, uint32_t op, int reg, int32_t disp)
+{
+  ezyx_head(g, prefix, w, op, reg, 0);
+  ezyx_byte(g, (uint8_t)(0x85 | (reg & 7) << 3));
+  ezyx_le(g, (uint32_t)disp, 4);
+}
+
+// r/m is [rsp + disp]
+static void ezyx_op_rsp(struct ezyx_gen *g, uint8_t prefix, bool w, uint32_t op, int reg, int32_t disp)
+{
+  ezyx_head(g, prefix, w, op, reg, 0);
+  ezyx_byte(g, (uint8_t)(0x84 | (reg & 7) << 3));
+  ezyx_byte(g, 0x24); // SIB: no index, base rsp
+  ezyx_le(g, (uint32_t)disp, 4);
+}
+
+// r/m is [rax + disp]
+static void ezyx_op_rax(struct ezyx_gen *g, uint8_t prefix, bool w, uint32_t op, int reg, int8_t disp)
+{
+  ezyx_head(g, prefix, w, op, reg, 0);
+  ezyx_byte(g, (uint8_t)(0x40 | (reg & 7) << 3));
+  ezyx_byte(g, (uint8_t)disp);
+}
+
+// r/m is [rip + offset in .rodata]
+static void ezyx_op_rodata(struct ezyx_gen *g, uint8_t prefix, bool w, uint32_t op, int reg, size_t offset)
+{
+  ezyx_head(g, prefix, w, op, reg, 0);
+  ezyx_byte(g, (uint8_t)(0x05 | (reg & 7) << 3));
+  // the displacement is relative to the end of the instruction, 4 bytes on
+  ezyelf_reloc(g->obj, ezyx_here(g), ezyelf_sym_rodata, ezyelf_r_x86_64_pc32, (int64_t)offset - 4);
+  ezyx_le(g, 0, 4);
+}
+
+static void ezyx_mov_imm(struct ezyx_gen *g, int r, uint64_t v)
+{
+  if (v <= UINT32_MAX)
+  {
+    // mov r32, imm32 zero extends
+    if (r >= 8)
+      ezyx_byte(g, 0x41);
+    ezyx_byte(g, (uint8_t)(0xb8 + (r & 7)));
+    ezyx_le(g, v, 4);
+  }
+  else if ((int64_t)v >= INT32_MIN && (int64_t)v < 0)
+  {
+    ezyx_op(g, 0, true, 0xc7, 0, r); // sign extended imm32
+    ezyx_le(g, v, 4);
+  }
+  else
+  {
+    ezyx_byte(g, (uint8_t)(0x48 | (r >> 3)));
+    ezyx_byte(g, (uint8_t)(0xb8 + (r & 7)));
+    ezyx_le(g, v, 8);
+  }
+}
+
+static void ezyx_push(struct ezyx_gen *g, int r)
+{
+  if (r >= 8)
+    ezyx_byte(g, 0x41);
+  ezyx_byte(g, (uint8_t)(0x50 + (r & 7)));
+  g->depth += 8;
+}
+
+static void ezyx_pop(struct ezyx_gen *g, int r)
+{
+  if (r >= 8)
+    ezyx_byte(g, 0x41);
+  ezyx_byte(g, (uint8_t)(0x58 + (r & 7)));
+  g->depth -= 8;
+}
+
+static void ezyx_rsp_add(struct ezyx_gen *g, int32_t n)
+{
+  ezyx_op(g, 0, true, 0x81, n < 0 ? 5 : 0, ezyx_rsp); // sub / add rsp, imm32
+  ezyx_le(g, (uint32_t)(n < 0 ? -n : n), 4);
+}
+
+// a short forward jump, patched by ezyx_land
+static size_t ezyx_jump(struct ezyx_gen *g, uint8_t op)
+{
+  ezyx_byte(g, op);
+  ezyx_byte(g, 0);
+  return ezyx_here(g) - 1;
+}
+
+static void ezyx_land(struct ezyx_gen *g, size_t at)
+{
+  if (at < g->obj->text.len)
+    g->obj->text.data[at] = (uint8_t)(ezyx_here(g) - at - 1);
+}
+
+// call through the PLT, rsp 16 byte aligned as the ABI wants
+static void ezyx_call(struct ezyx_gen *g, ezy_cstr_t name)
+{
+  bool pad = g->depth % 16 != 0;
+  if (pad)
+    ezyx_rsp_add(g, -8);
+  ezyx_byte(g, 0xe8);
+  ezyelf_reloc(g->obj, ezyx_here(g), ezyelf_symbol(g->obj, name), ezyelf_r_x86_64_plt32, -4);
+  ezyx_le(g, 0, 4);
+  if (pad)
+    ezyx_rsp_add(g, 8);
+}
+
+static void ezyx_load_f64(struct ezyx_gen *g, int x, double v)
+{
+  uint8_t bytes[8];
+  memcpy(bytes, &v, sizeof bytes);
+  ezyx_op_rodata(g, 0xf2, false, 0x0f10, x, ezyelf_rodata(g->obj, bytes, sizeof bytes, 8)); // movsd
+}
+
+// ================ Conversions ================
+
+// Extend r (rax or rcx) from its low bits to `t`, the C conversion
+// between integer types.
+static void ezyx_extend(struct ezyx_gen *g, int r, enum ezyx_ctype t)
+{
+  switch (t)
+  {
+  case ezyx_i8: ezyx_op(g, 0, true, 0x0fbe, r, r); break;  // movsx r64, r8
+  case ezyx_u8: ezyx_op(g, 0, true, 0x0fb6, r, r); break;  // movzx
+  case ezyx_i16: ezyx_op(g, 0, true, 0x0fbf, r, r); break;
+  case ezyx_u16: ezyx_op(g, 0, true, 0x0fb7, r, r); break;
+  case ezyx_i32: ezyx_op(g, 0, true, 0x63, r, r); break;   // movsxd
+  case ezyx_u32: ezyx_op(g, 0, false, 0x89, r, r); break;  // mov r32, r32
+  case ezyx_bool:
+    ezyx_op(g, 0, true, 0x85, r, r);   // test
+    ezyx_op(g, 0, false, 0x0f95, 0, r); // setne
+    ezyx_op(g, 0, true, 0x0fb6, r, r);
+    break;
+  default: break;
+  }
+}
+
+// Convert the value in r (an integer) or x (a float) from `from` to `to`,
+// the result is in r or x by its type. r is rax or rcx, x xmm0 or xmm1.
+static void ezyx_convert(struct ezyx_gen *g, enum ezyx_ctype from, enum ezyx_ctype to, int r, int x)
+{
+  if (from == to)
+    return;
+  bool ff = ezyx_is_float(from), tf = ezyx_is_float(to);
+  if (!ff && !tf)
+  {
+    ezyx_extend(g, r, to);
+    return;
+  }
+  if (ff && tf)
+  {
+    ezyx_op(g, from == ezyx_f32 ? 0xf3 : 0xf2, false, 0x0f5a, x, x); // cvtss2sd / cvtsd2ss
+    return;
+  }
+  if (!ff)
+  {
+    uint8_t p = to == ezyx_f32 ? 0xf3 : 0xf2;
+    if (from != ezyx_u64)
+    {
+      ezyx_op(g, 0, false, 0x0f57, x, x); // xorps, no dependency on the old value
+      ezyx_op(g, p, true, 0x0f2a, x, r);  // cvtsi2s[sd]
+      return;
+    }
+    // no unsigned conversion: halve a value with the top bit set,
+    // keeping the low bit for rounding, and double the result
+    ezyx_op(g, 0, true, 0x85, r, r);
+    size_t big = ezyx_jump(g, 0x78); // js
+    ezyx_op(g, 0, false, 0x0f57, x, x);
+    ezyx_op(g, p, true, 0x0f2a, x, r);
+    size_t done = ezyx_jump(g, 0xeb);
+    ezyx_land(g, big);
+    ezyx_op(g, 0, true, 0x89, r, ezyx_rdx);
+    ezyx_op(g, 0, true, 0xd1, 5, ezyx_rdx); // shr rdx, 1
+    ezyx_op(g, 0, false, 0x83, 4, r);       // and r32, 1
+    ezyx_byte(g, 1);
+    ezyx_op(g, 0, true, 0x09, r, ezyx_rdx); // or rdx, r
+    ezyx_op(g, 0, false, 0x0f57, x, x);
+    ezyx_op(g, p, true, 0x0f2a, x, ezyx_rdx);
+    ezyx_op(g, p, false, 0x0f58, x, x); // add x, x
+    ezyx_land(g, done);
+    return;
+  }
+  uint8_t p = from == ezyx_f32 ? 0xf3 : 0xf2;
+  if (to == ezyx_bool)
+  {
+    // nonzero, NaN included
+    ezyx_op(g, 0, false, 0x0f57, 2, 2);
+    ezyx_op(g, from == ezyx_f32 ? 0 : 0x66, false, 0x0f2e, x, 2); // ucomis
+    ezyx_op(g, 0, false, 0x0f95, 0, r);                           // setne
+    ezyx_op(g, 0, false, 0x0f9a, 0, ezyx_rdx);                    // setp dl
+    ezyx_op(g, 0, false, 0x08, ezyx_rdx, r);                      // or r8, dl
+    ezyx_op(g, 0, true, 0x0fb6, r, r);
+    return;
+  }
+  if (to != ezyx_u64)
+  {
+    ezyx_op(g, p, true, 0x0f2c, r, x); // cvtts[sd]2si r64, truncating
+    ezyx_extend(g, r, to);
+    return;
+  }
+  // 2^63 and above: convert the value less 2^63 and set the top bit
+  if (from == ezyx_f32)
+  {
+    uint32_t bits = 0x5f000000; // 2^63
+    ezyx_op_rodata(g, 0xf3, false, 0x0f10, 2, ezyelf_rodata(g->obj, &bits, sizeof bits, 4));
+  }
+  else
+  {
+    ezyx_load_f64(g, 2, 9223372036854775808.0);
+  }
+  ezyx_op(g, from == ezyx_f32 ? 0 : 0x66, false, 0x0f2e, x, 2);
+  size_t big = ezyx_jump(g, 0x73); // jae
+  ezyx_op(g, p, true, 0x0f2c, r, x);
+  size_t done = ezyx_jump(g, 0xeb);
+  ezyx_land(g, big);
+  ezyx_op(g, p, false, 0x0f5c, x, 2); // sub x, 2^63
+  ezyx_op(g, p, true, 0x0f2c, r, x);
+  ezyx_mov_imm(g, ezyx_rdx, UINT64_C(1) << 63);
+  ezyx_op(g, 0, true, 0x31, ezyx_rdx, r); // xor r, rdx
+  ezyx_land(g, done);
+}
+
+// ================ Locals ================
+// Every parameter and local has one home for its whole life, picked by
+// linear scan over its live interval: the positions (in evaluation
+// order) of its first and last touch. With no branches or loops in the
+// language an interval is exact. Whatever finds no register gets a stack
+// slot below the saved registers.
+
+static struct ezyx_local *ezyx_local(struct ezyx_gen *g, struct ezy_symbol_t *sym)
+{
+  if (sym == NULL)
+    return NULL;
+  if (sym->kind == ezy_sym_param && sym->decl.param >= g->fn->params &&
+      sym->decl.param < g->fn->params + g->fn->param_count)
+    return &g->locals[sym->decl.param - g->fn->params];
+  if (sym->kind == ezy_sym_local && sym->slot < g->count && g->locals[sym->slot].sym == sym)
+    return &g->locals[sym->slot];
+  return NULL;
+}
+
+static bool ezyx_touch(struct ezyx_gen *g, ezy_ast_node_t *var)
+{
+  struct ezyx_local *l = ezyx_local(g, var->data.n_variable.sym);
+  if (l == NULL)
+    return ezyx_unsupported(g, "a global or unresolved variable", var->type);
+  uint32_t at = ++g->pos;
+  if (!l->used && l->sym != NULL) // parameters are live from the entry
+    l->start = at;
+  l->used = true;
+  l->end = at;
+  return true;
+}
+
+static void ezyx_call_at(struct ezyx_gen *g)
+{
+  if (ezyx_reserve(g, (void **)&g->calls, &g->call_cap, g->call_count + 1, sizeof *g->calls))
+    g->calls[g->call_count++] = ++g->pos;
+}
+
+static inline bool ezyx_is_print(struct ezy_ast_call_t *call)
+{
+  return call->sym != NULL && call->sym->kind == ezy_sym_builtin && call->func_name.len == 5 &&
+         memcmp(call->func_name.ptr, "print", 5) == 0;
+}
+
+// Number the touches and calls of a statement, in the order the
+// expression walk evaluates them, walking rather than recursing: sources
+// nobody writes by hand nest expressions as deep as they like.
+
+static inline bool ezyx_is_print_arg(struct ezywalk_t *w)
+{
+  return w->parent != NULL && w->parent->type == ezy_ast_node_call && ezyx_is_print(w->parent->data.n_call);
+}
+
+static enum ezywalk_action ezyx_scan_pre(struct ezywalk_t *w, ezy_ast_node_t *node)
+{
+  struct ezyx_gen *g = w->ctx;
+  switch (node->type)
+  {
+  case ezy_ast_node_literal:
+  case ezy_ast_node_return:
+    return ezywalk_continue;
+  case ezy_ast_node_variable:
+    return ezyx_touch(g, node) ? ezywalk_continue : ezywalk_stop;
+  case ezy_ast_node_binop:
+  {
+    ezy_ast_node_t *left = node->data.n_binop.left;
+    if (node->data.n_binop.operator == ezy_op_assign && left->type != ezy_ast_node_variable)
+      return ezyx_unsupported(g, "assignment to an element or field", left->type), ezywalk_stop;
+    return ezywalk_continue;
+  }
+  case ezy_ast_node_call:
+  {
+    struct ezy_ast_call_t *call = node->data.n_call;
+    if (call->sym != NULL && call->sym->kind == ezy_sym_builtin && !ezyx_is_print(call))
+      return ezyx_unsupported(g, "a builtin other than print", node->type), ezywalk_stop;
+    return ezywalk_continue;
+  }
+  case ezy_ast_node_variable_decl:
+  {
+    struct ezy_ast_variable_t *var = &node->data.n_variable;
+    enum ezyx_ctype typ = ezyx_ctype_of(&var->typ);
+    if (typ == ezyx_bad || typ == ezyx_none || var->sym == NULL || var->sym->kind != ezy_sym_local)
+      return ezyx_unsupported(g, "a variable of this type", var->typ.typ), ezywalk_stop;
+    if (var->value == NULL)
+      return ezyx_unsupported(g, "a variable without a value", var->typ.typ), ezywalk_stop;
+    return ezywalk_continue;
+  }
+  default:
+    return ezyx_unsupported(g, "this kind of node", node->type), ezywalk_stop;
+  }
+}
+
+static enum ezywalk_action ezyx_scan_child(struct ezywalk_t *w, ezy_ast_node_t *node, size_t child)
+{
+  struct ezyx_gen *g = w->ctx;
+  if (node->type == ezy_ast_node_binop && node->data.n_binop.operator == ezy_op_assign && child == 0)
+    return ezywalk_skip; // touched once the value is computed
+  if (node->type == ezy_ast_node_call && ezyx_is_print(node->data.n_call))
+  {
+    if (node->data.n_call->args[child].type == ezy_ast_node_literal)
+      return ezywalk_skip;
+    ezyx_call_at(g); // the literals before it
+  }
+  return ezywalk_continue;
+}
+
+static enum ezywalk_action ezyx_scan_post(struct ezywalk_t *w, ezy_ast_node_t *node)
+{
+  struct ezyx_gen *g = w->ctx;
+  if (node->type == ezy_ast_node_binop && node->data.n_binop.operator == ezy_op_assign &&
+      !ezyx_touch(g, node->data.n_binop.left))
+    return ezywalk_stop;
+  if (node->type == ezy_ast_node_call)
+    ezyx_call_at(g);
+  if (node->type == ezy_ast_node_variable_decl)
+  {
+    struct ezy_ast_variable_t *var = &node->data.n_variable;
+    if (!ezyx_reserve(g, (void **)&g->locals, &g->cap, g->count + 1, sizeof *g->locals))
+      return ezywalk_stop;
+    var->sym->slot = (uint32_t)g->count;
+    g->locals[g->count++] = (struct ezyx_local){.sym = var->sym, .typ = ezyx_ctype_of(&var->typ)};
+    ezy_ast_node_t ref = {.type = ezy_ast_node_variable, .data.n_variable.sym = var->sym};
+    if (!ezyx_touch(g, &ref))
+      return ezywalk_stop;
+  }
+  if (ezyx_is_print_arg(w))
+    ezyx_call_at(g); // its writer
+  return ezywalk_continue;
+}
+
+static bool ezyx_crosses(struct ezyx_gen *g, const struct ezyx_local *l)
+{
+  // the first call after the start
+  size_t lo = 0, hi = g->call_count;
+  while (lo < hi)
+  {
+    size_t mid = lo + (hi - lo) / 2;
+    if (g->calls[mid] <= l->start)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+  return lo < g->call_count && g->calls[lo] < l->end;
+}
+
+static int ezyx_take(unsigned *free_regs, const int *pool, size_t n)
+{
+  for (size_t i = 0; i < n; i++)
+  {
+    if (*free_regs & (1u << pool[i]))
+    {
+      *free_regs &= ~(1u << pool[i]);
+      return pool[i];
+    }
+  }
+  return ezyx_stack;
+}
+
+static inline bool ezyx_is_callee_saved(int r)
+{
+  return r == ezyx_rbx || r >= ezyx_r12;
+}
+
+// Poletto and Sarkar's linear scan. Locals are numbered by declaration,
+// which is the order of their starts, parameters first at 0.
+static void ezyx_allocate(struct ezyx_gen *g, size_t int_params)
+{
+  unsigned free_gpr = 0, free_xmm = 0xff00;
+  for (size_t i = 0; i < sizeof ezyx_callee_saved / sizeof *ezyx_callee_saved; i++)
+    free_gpr |= 1u << ezyx_callee_saved[i];
+  for (size_t i = 0; i < sizeof ezyx_caller_saved / sizeof *ezyx_caller_saved; i++)
+    free_gpr |= 1u << ezyx_caller_saved[i];
+  // incoming registers stay free of homes, parameters move without conflicts
+  for (size_t i = 0; i < int_params; i++)
+    free_gpr &= ~(1u << ezyx_int_args[i]);
+
+  size_t active_cap = g->count;
+  size_t *active = malloc((active_cap > 0 ? active_cap : 1) * sizeof *active);
+  size_t active_count = 0;
+  if (active == NULL)
+  {
+    ezy_log_error("native backend: out of memory");
+    g->failed = true;
+    return;
+  }
+  g->saved = 0;
+  g->slots = 0;
+  for (size_t i = 0; i < g->count; i++)
+  {
+    struct ezyx_local *l = &g->locals[i];
+    l->reg = ezyx_stack;
+    if (!l->used)
+      continue;
+    l->crosses = ezyx_crosses(g, l);
+    for (size_t a = 0; a < active_count;)
+    {
+      struct ezyx_local *o = &g->locals[active[a]];
+      if (o->end >= l->start)
+      {
+        a++;
+        continue;
+      }
+      if (ezyx_is_float(o->typ))
+        free_xmm |= 1u << o->reg;
+      else
+        free_gpr |= 1u << o->reg;
+      active[a] = active[--active_count];
+    }
+
+    bool flt = ezyx_is_float(l->typ);
+    if (flt && !l->crosses)
+      l->reg = ezyx_take(&free_xmm, (const int[]){8, 9, 10, 11, 12, 13, 14, 15}, 8);
+    else if (!flt && !l->crosses)
+      l->reg = ezyx_take(&free_gpr, ezyx_caller_saved, sizeof ezyx_caller_saved / sizeof *ezyx_caller_saved);
+    if (!flt && l->reg == ezyx_stack)
+      l->reg = ezyx_take(&free_gpr, ezyx_callee_saved, sizeof ezyx_callee_saved / sizeof *ezyx_callee_saved);
+    if (l->reg == ezyx_stack && !(flt && l->crosses))
+    {
+      // spill whichever compatible interval ends last
+      size_t victim = active_count;
+      for (size_t a = 0; a < active_count; a++)
+      {
+        struct ezyx_local *o = &g->locals[active[a]];
+        bool fits = flt ? ezyx_is_float(o->typ) : !ezyx_is_float(o->typ) && (!l->crosses || ezyx_is_callee_saved(o->reg));
+        if (fits && o->end > l->end && (victim == active_count || o->end > g->locals[active[victim]].end))
+          victim = a;
+      }
+      if (victim < active_count)
+      {
+        struct ezyx_local *o = &g->locals[active[victim]];
+        l->reg = o->reg;
+        o->reg = ezyx_stack;
+        active[victim] = active[--active_count];
+      }
+    }
+    if (l->reg != ezyx_stack)
+    {
+      active[active_count++] = i;
+      if (!flt && ezyx_is_callee_saved(l->reg))
+        g->saved |= 1u << l->reg;
+    }
+  }
+  free(active);
+
+  g->saved_count = 0;
+  for (int r = 0; r < 16; r++)
+    g->saved_count += (g->saved >> r) & 1;
+  for (size_t i = 0; i < g->count; i++)
+  {
+    struct ezyx_local *l = &g->locals[i];
+    if (l->used && l->reg == ezyx_stack)
+      l->disp = -8 * (int32_t)(g->saved_count + 1 + g->slots++);
+  }
+}
+
+static void ezyx_load(struct ezyx_gen *g, const struct ezyx_local *l, int r, int x)
+{
+  if (ezyx_is_float(l->typ))
+  {
+    if (l->reg != ezyx_stack)
+      ezyx_op(g, 0, false, 0x0f28, x, l->reg); // movaps
+    else
+      ezyx_op_rbp(g, l->typ == ezyx_f32 ? 0xf3 : 0xf2, false, 0x0f10, x, l->disp);
+  }
+  else if (l->reg != ezyx_stack)
+    ezyx_op(g, 0, true, 0x89, l->reg, r);
+  else
+    ezyx_op_rbp(g, 0, true, 0x8b, r, l->disp);
+}
+
+static void ezyx_store(struct ezyx_gen *g, const struct ezyx_local *l, int r, int x)
+{
+  if (ezyx_is_float(l->typ))
+  {
+    if (l->reg != ezyx_stack)
+      ezyx_op(g, 0, false, 0x0f28, l->reg, x);
+    else
+      ezyx_op_rbp(g, l->typ == ezyx_f32 ? 0xf3 : 0xf2, false, 0x0f11, x, l->disp);
+  }
+  else if (l->reg != ezyx_stack)
+    ezyx_op(g, 0, true, 0x89, r, l->reg);
+  else
+    ezyx_op_rbp(g, 0, true, 0x89, r, l->disp);
+}
+
+// ================ Expressions ================
+// Evaluated by a walk, post-order: a node's value is in rax or xmm0 when
+// its post hook runs, and its type goes on g->types for its parent. A
+// binop keeps its left value on the machine stack while the right one is
+// computed, unless the right is a literal or a local loaded straight into
+// rcx or xmm1. Call arguments are pushed as they come, with a record each
+// on g->args.
+
+static bool ezyx_push_type(struct ezyx_gen *g, enum ezyx_ctype t)
+{
+  if (!ezyx_reserve(g, (void **)&g->types, &g->type_cap, g->type_count + 1, sizeof *g->types))
+    return false;
+  g->types[g->type_count++] = t;
+  return true;
+}
+
+static inline enum ezyx_ctype ezyx_pop_type(struct ezyx_gen *g)
+{
+  return g->type_count > 0 ? g->types[--g->type_count] : ezyx_bad;
+}
+
+static inline bool ezyx_is_operand(ezy_ast_node_t *node)
+{
+  return node->type == ezy_ast_node_literal || node->type == ezy_ast_node_variable;
+}
+
+// a literal or a local into r or x
+static enum ezyx_ctype ezyx_operand(struct ezyx_gen *g, ezy_ast_node_t *node, int r, int x)
+{
+  if (node->type == ezy_ast_node_variable)
+  {
+    struct ezyx_local *l = ezyx_local(g, node->data.n_variable.sym);
+    if (l == NULL)
+      return ezyx_unsupported(g, "a global or unresolved variable", node->type), ezyx_bad;
+    ezyx_load(g, l, r, x);
+    return l->typ;
+  }
+  struct ezy_ast_literal_t *lit = &node->data.n_literal;
+  switch (lit->typ)
+  {
+  case ezy_ast_dt_int32:
+  case ezy_ast_dt_int64:
+    ezyx_mov_imm(g, r, (uint64_t)lit->value.t_int64);
+    return lit->typ == ezy_ast_dt_int32 ? ezyx_i32 : ezyx_i64;
+  case ezy_ast_dt_uint64:
+    ezyx_mov_imm(g, r, lit->value.t_uint64);
+    return ezyx_u64;
+  case ezy_ast_dt_float64:
+    ezyx_load_f64(g, x, lit->value.t_float64);
+    return ezyx_f64;
+  case ezy_ast_dt_string:
+  {
+    // its length, then the text as print writes it, NUL terminated
+    ezy_emit_t raw;
+    ezyemit_init(&raw);
+    ezytranspile_print_literal(node, &raw);
+    uint64_t len = 0;
+    for (ezy_multistr_t *c = raw.head; c != NULL; c = c->next)
+      len += c->str.len;
+    size_t at = ezyelf_rodata(g->obj, &len, sizeof len, 8);
+    for (ezy_multistr_t *c = raw.head; c != NULL; c = c->next)
+      ezyelf_append(g->obj, &g->obj->rodata, c->str.ptr, c->str.len);
+    ezyelf_append(g->obj, &g->obj->rodata, "", 1);
+    ezyemit_free(raw.head);
+    ezyx_op_rodata(g, 0, true, 0x8d, r, at); // lea
+    return ezyx_str;
+  }
+  default:
+    ezyx_unsupported(g, "a literal of this type outside print", lit->typ);
+    return ezyx_bad;
+  }
+}
+
+static void ezyx_push_value(struct ezyx_gen *g, enum ezyx_ctype t)
+{
+  if (ezyx_is_float(t))
+    ezyx_op(g, 0x66, true, 0x0f7e, 0, ezyx_rax); // movq rax, xmm0
+  ezyx_push(g, ezyx_rax);
+}
+
+static void ezyx_pop_value(struct ezyx_gen *g, enum ezyx_ctype t)
+{
+  ezyx_pop(g, ezyx_rax);
+  if (ezyx_is_float(t))
+    ezyx_op(g, 0x66, true, 0x0f6e, 0, ezyx_rax); // movq xmm0, rax
+}
+
+static enum ezyx_ctype ezyx_binop(struct ezyx_gen *g, ezy_ast_node_t *node)
+{
+  struct ezy_ast_binop_t *binop = &node->data.n_binop;
+  enum ezyx_ctype rt = ezyx_pop_type(g);
+  if (binop->operator == ezy_op_assign)
+  {
+    struct ezyx_local *l = ezyx_local(g, binop->left->data.n_variable.sym);
+    if (l == NULL || rt == ezyx_bad || rt == ezyx_none || (rt == ezyx_str) != (l->typ == ezyx_str))
+      return ezyx_unsupported(g, "this assignment", binop->operator), ezyx_bad;
+    ezyx_convert(g, rt, l->typ, ezyx_rax, 0);
+    ezyx_store(g, l, ezyx_rax, 0);
+    return l->typ;
+  }
+
+  enum ezyx_ctype lt = ezyx_pop_type(g);
+  if (!ezyx_is_operand(binop->right))
+  {
+    // computed over the left value, which waits on the stack
+    if (ezyx_is_float(rt))
+      ezyx_op(g, 0, false, 0x0f28, 1, 0); // movaps xmm1, xmm0
+    else
+      ezyx_op(g, 0, true, 0x89, ezyx_rax, ezyx_rcx);
+    ezyx_pop_value(g, lt);
+  }
+  if (rt == ezyx_bad || rt == ezyx_none || rt == ezyx_str)
+    return ezyx_unsupported(g, "an operand of this type", binop->operator), ezyx_bad;
+
+  enum ezyx_ctype ot = ezyx_common(lt, rt);
+  // `10 / 3` is floating division unless the declaration asks for an integer
+  if (binop->operator == ezy_op_divide && !ezyx_is_float(lt) && !ezyx_is_float(rt) &&
+      ezyx_is_float(ezyx_ctype_of(&node->eval_typ)))
+    ot = ezyx_f64;
+  ezyx_convert(g, lt, ot, ezyx_rax, 0);
+  ezyx_convert(g, rt, ot, ezyx_rcx, 1);
+
+  bool eq = binop->operator == ezy_op_cond_eq;
+  if (eq || binop->operator == ezy_op_cond_neq)
+  {
+    if (ezyx_is_float(ot))
+    {
+      // unordered compares unequal
+      ezyx_op(g, ot == ezyx_f32 ? 0 : 0x66, false, 0x0f2e, 0, 1);    // ucomis
+      ezyx_op(g, 0, false, eq ? 0x0f94 : 0x0f95, 0, ezyx_rax);       // sete / setne
+      ezyx_op(g, 0, false, eq ? 0x0f9b : 0x0f9a, 0, ezyx_rcx);       // setnp / setp
+      ezyx_op(g, 0, false, eq ? 0x20 : 0x08, ezyx_rcx, ezyx_rax);    // and / or
+    }
+    else
+    {
+      ezyx_op(g, 0, true, 0x39, ezyx_rcx, ezyx_rax); // cmp
+      ezyx_op(g, 0, false, eq ? 0x0f94 : 0x0f95, 0, ezyx_rax);
+    }
+    ezyx_op(g, 0, true, 0x0fb6, ezyx_rax, ezyx_rax);
+    return ezyx_i32;
+  }
+
+  if (ezyx_is_float(ot))
+  {
+    uint32_t op;
+    switch (binop->operator)
+    {
+    case ezy_op_plus: op = 0x0f58; break;
+    case ezy_op_minus: op = 0x0f5c; break;
+    case ezy_op_asterisk: op = 0x0f59; break;
+    case ezy_op_divide: op = 0x0f5e; break;
+    default: return ezyx_unsupported(g, "this operator on floats", binop->operator), ezyx_bad;
+    }
+    ezyx_op(g, ot == ezyx_f32 ? 0xf3 : 0xf2, false, op, 0, 1);
+    return ot;
+  }
+
+  switch (binop->operator)
+  {
+  case ezy_op_plus: ezyx_op(g, 0, true, 0x01, ezyx_rcx, ezyx_rax); break;
+  case ezy_op_minus: ezyx_op(g, 0, true, 0x29, ezyx_rcx, ezyx_rax); break;
+  case ezy_op_asterisk: ezyx_op(g, 0, true, 0x0faf, ezyx_rax, ezyx_rcx); break; // imul
+  case ezy_op_divide:
+  case ezy_op_modulo:
+    if (ezyx_is_signed(ot))
+    {
+      ezyx_byte(g, 0x48), ezyx_byte(g, 0x99);      // cqo
+      ezyx_op(g, 0, true, 0xf7, 7, ezyx_rcx);     // idiv
+    }
+    else
+    {
+      ezyx_op(g, 0, false, 0x31, ezyx_rdx, ezyx_rdx);
+      ezyx_op(g, 0, true, 0xf7, 6, ezyx_rcx); // div
+    }
+    if (binop->operator == ezy_op_modulo)
+      ezyx_op(g, 0, true, 0x89, ezyx_rdx, ezyx_rax);
+    break;
+  default:
+    return ezyx_unsupported(g, "this operator", binop->operator), ezyx_bad;
+  }
+  ezyx_extend(g, ezyx_rax, ot); // 32-bit results wrap
+  return ot;
+}
+
+// What a call calls: a function of the program, a C function every
+// backend knows, or any other C function, taken as unprototyped.
+struct ezyx_callee {
+  struct ezy_ast_function_t *fn;
+  const struct ezyvm_extern *ext;
+  enum ezyx_ctype ext_typ; // a known C function takes and returns it, in each signature
+};
+
+static struct ezyx_callee ezyx_callee(struct ezy_ast_call_t *call)
+{
+  struct ezyx_callee c = {0};
+  if (call->sym != NULL && call->sym->kind == ezy_sym_function)
+    c.fn = call->sym->decl.function;
+  int ext = c.fn == NULL ? ezyvm_extern_find(call->func_name) : -1;
+  c.ext = ext >= 0 ? ezyvm_extern_get(ext) : NULL;
+  c.ext_typ = c.ext == NULL                ? ezyx_bad
+              : c.ext->sig == ezyvm_sig_i_i ? ezyx_i32
+              : c.ext->sig == ezyvm_sig_l_l ? ezyx_i64
+                                            : ezyx_f64;
+  return c;
+}
+
+static bool ezyx_call_check(struct ezyx_gen *g, struct ezy_ast_call_t *call)
+{
+  struct ezyx_callee c = ezyx_callee(call);
+  if (c.fn != NULL && c.fn->param_count != call->arg_count)
+    return ezyx_unsupported(g, "a call with the wrong argument count", (int)call->arg_count);
+  if (c.ext != NULL && call->arg_count != (c.ext->sig == ezyvm_sig_d_dd ? 2u : 1u))
+    return ezyx_unsupported(g, "a call with the wrong argument count", (int)call->arg_count);
+  return true;
+}
+
+// Argument i of a call, of type t, converted to its parameter's type and
+// pushed: its evaluation may have called, and calls clobber the registers.
+static bool ezyx_call_arg(struct ezyx_gen *g, struct ezy_ast_call_t *call, size_t i, enum ezyx_ctype t)
+{
+  struct ezyx_callee c = ezyx_callee(call);
+  // an unprototyped C function gets the default promotions
+  enum ezyx_ctype pt = c.fn != NULL    ? ezyx_ctype_of(&c.fn->params[i].typ)
+                       : c.ext != NULL ? c.ext_typ
+                       : ezyx_is_float(t) ? ezyx_f64
+                                          : t;
+  if (t == ezyx_none || t == ezyx_str || pt == ezyx_bad || pt == ezyx_str)
+    return ezyx_unsupported(g, "an argument of this type", (int)i);
+  if (!ezyx_reserve(g, (void **)&g->args, &g->arg_cap, g->arg_count + 1, sizeof *g->args))
+    return false;
+  ezyx_convert(g, t, pt, ezyx_rax, 0);
+  ezyx_push_value(g, pt);
+  g->args[g->arg_count++] = (struct ezyx_arg){.flt = ezyx_is_float(pt), .depth = g->depth};
+  return true;
+}
+
+// All arguments pushed: load them into their registers. Those past the
+// registers are copied below, last first, where the ABI wants them, and
+// all of it is dropped after the call.
+static enum ezyx_ctype ezyx_call_expr(struct ezyx_gen *g, struct ezy_ast_call_t *call)
+{
+  struct ezyx_callee c = ezyx_callee(call);
+  struct ezyx_arg *args = g->args + g->arg_count - call->arg_count;
+  int base = call->arg_count > 0 ? args[0].depth - 8 : g->depth;
+  size_t ints = 0, floats = 0, stacked = 0;
+  for (size_t i = 0; i < call->arg_count; i++)
+  {
+    args[i].reg = ezyx_stack;
+    if (args[i].flt ? floats < ezyx_float_arg_max : ints < ezyx_int_arg_max)
+      args[i].reg = args[i].flt ? (int)floats++ : ezyx_int_args[ints++];
+    else
+      stacked++;
+  }
+  if (stacked > 0 && (g->depth + 8 * (int)stacked) % 16 != 0)
+  {
+    ezyx_rsp_add(g, -8);
+    g->depth += 8;
+  }
+  for (size_t i = call->arg_count; i-- > 0;)
+  {
+    if (args[i].reg != ezyx_stack)
+      continue;
+    ezyx_op_rsp(g, 0, false, 0xff, 6, g->depth - args[i].depth); // push [rsp + disp]
+    g->depth += 8;
+  }
+  for (size_t i = 0; i < call->arg_count; i++)
+  {
+    if (args[i].reg == ezyx_stack)
+      continue;
+    if (args[i].flt)
+      ezyx_op_rsp(g, 0xf2, false, 0x0f10, args[i].reg, g->depth - args[i].depth); // movsd
+    else
+      ezyx_op_rsp(g, 0, true, 0x8b, args[i].reg, g->depth - args[i].depth);
+  }
+  g->arg_count -= call->arg_count;
+
+  if (c.fn == NULL)
+    ezyx_mov_imm(g, ezyx_rax, floats); // vector registers used, for variadic callees
+  ezyx_call(g, call->func_name);
+  if (g->depth > base)
+    ezyx_rsp_add(g, g->depth - base);
+  g->depth = base;
+  if (c.ext != NULL && !ezyx_is_float(c.ext_typ))
+    ezyx_extend(g, ezyx_rax, c.ext_typ);
+  if (c.ext != NULL)
+    return c.ext_typ;
+  if (c.fn == NULL)
+    return ezyx_none; // its result is left to the C compiler in the C backend
+  enum ezyx_ctype rt = ezyx_ctype_of(&c.fn->return_typ);
+  if (rt == ezyx_bad)
+    return ezyx_unsupported(g, "a call returning this type", c.fn->return_typ.typ), ezyx_bad;
+  if (!ezyx_is_float(rt) && rt != ezyx_none)
+    ezyx_extend(g, ezyx_rax, rt); // bits above the type are unspecified
+  return rt;
+}
+
+// ================ print ================
+// Like the transpiled print: runs of literals and separators are one
+// constant written with ezyrt_write_slow, other arguments go through the
+// typed writers picked by their static type.
+
+static void ezyx_print_run(struct ezyx_gen *g, struct ezy_ast_call_t *call, size_t end)
+{
+  size_t begin = end;
+  while (begin > 0 && call->args[begin - 1].type == ezy_ast_node_literal)
+    begin--;
+  ezy_emit_t raw;
+  ezyemit_init(&raw);
+  for (size_t i = begin; i <= end; i++)
+  {
+    if (i >= 1 && i < call->arg_count)
+      ezyemit_char(&raw, ' ');
+    if (i < end && !ezytranspile_print_literal(&call->args[i], &raw))
+      ezyx_unsupported(g, "a literal of this type in print", call->args[i].data.n_literal.typ);
+  }
+  size_t at = 0, len = 0;
+  for (ezy_multistr_t *c = raw.head; c != NULL; c = c->next)
+  {
+    size_t off = len == 0 ? ezyelf_rodata(g->obj, c->str.ptr, c->str.len, 1)
+                          : ezyelf_append(g->obj, &g->obj->rodata, c->str.ptr, c->str.len);
+    at = len == 0 ? off : at;
+    len += c->str.len;
+  }
+  ezyemit_free(raw.head);
+  if (len == 0)
+    return;
+  ezyx_op_rodata(g, 0, true, 0x8d, ezyx_rdi, at); // lea
+  ezyx_mov_imm(g, ezyx_rsi, len);
+  ezyx_call(g, ezyx_name("ezyrt_write_slow"));
+}
+
+// write the value of print's argument `arg`, of type t
+static bool ezyx_print_value(struct ezyx_gen *g, ezy_ast_node_t *arg, enum ezyx_ctype t)
+{
+  if (t == ezyx_none && arg->eval_typ.typ == ezy_ast_dt_unknown)
+    return ezyx_unsupported(g, "printing the result of an unknown C function", (int)arg->type);
+  if (t == ezyx_none)
+    return true; // evaluated for its side effects, prints nothing
+  enum ezyx_ctype want = ezyx_ctype_of(&arg->eval_typ);
+  switch (want)
+  {
+  case ezyx_i8:
+  case ezyx_i16:
+  case ezyx_i32:
+  case ezyx_i64:
+    ezyx_convert(g, t, ezyx_i64, ezyx_rax, 0);
+    ezyx_op(g, 0, true, 0x89, ezyx_rax, ezyx_rdi);
+    ezyx_call(g, ezyx_name("ezyrt_write_i64"));
+    return true;
+  case ezyx_u8:
+  case ezyx_u16:
+  case ezyx_u32:
+  case ezyx_u64:
+    ezyx_convert(g, t, ezyx_u64, ezyx_rax, 0);
+    ezyx_op(g, 0, true, 0x89, ezyx_rax, ezyx_rdi);
+    ezyx_call(g, ezyx_name("ezyrt_write_u64"));
+    return true;
+  case ezyx_f32:
+    ezyx_convert(g, t, ezyx_f32, ezyx_rax, 0);
+    ezyx_call(g, ezyx_name("ezyrt_write_f32"));
+    return true;
+  case ezyx_f64:
+    ezyx_convert(g, t, ezyx_f64, ezyx_rax, 0);
+    ezyx_call(g, ezyx_name("ezyrt_write_f64"));
+    return true;
+  case ezyx_str:
+    ezyx_op_rax(g, 0, true, 0x8b, ezyx_rsi, 0); // its length
+    ezyx_op_rax(g, 0, true, 0x8d, ezyx_rdi, 8); // lea, its text
+    ezyx_call(g, ezyx_name("ezyrt_write_slow"));
+    return true;
+  case ezyx_bool:
+    if (!g->bools)
+    {
+      g->true_at = ezyelf_rodata(g->obj, "true", 4, 1);
+      g->false_at = ezyelf_rodata(g->obj, "false", 5, 1);
+      g->bools = true;
+    }
+    ezyx_convert(g, t, ezyx_bool, ezyx_rax, 0);
+    ezyx_op_rodata(g, 0, true, 0x8d, ezyx_rdi, g->true_at);
+    ezyx_op_rodata(g, 0, true, 0x8d, ezyx_r11, g->false_at);
+    ezyx_mov_imm(g, ezyx_rsi, 4);
+    ezyx_mov_imm(g, ezyx_rdx, 5);
+    ezyx_op(g, 0, false, 0x85, ezyx_rax, ezyx_rax);
+    ezyx_op(g, 0, true, 0x0f44, ezyx_rdi, ezyx_r11);  // cmovz
+    ezyx_op(g, 0, false, 0x0f44, ezyx_rsi, ezyx_rdx);
+    ezyx_call(g, ezyx_name("ezyrt_write_slow"));
+    return true;
+  default:
+    return ezyx_unsupported(g, "printing a value of this type", arg->eval_typ.typ);
+  }
+}
+
+// ================ Walk ================
+
+// A node's value is computed: print writes it, a call pushes it as an
+// argument, any other parent takes its type off g->types, and the value
+// of a statement is dropped.
+static bool ezyx_value(struct ezyx_gen *g, ezy_ast_node_t *parent, ezy_ast_node_t *node, enum ezyx_ctype t)
+{
+  if (t == ezyx_bad)
+    return false;
+  if (parent == NULL)
+    return true;
+  if (parent->type == ezy_ast_node_call)
+  {
+    struct ezy_ast_call_t *call = parent->data.n_call;
+    if (ezyx_is_print(call))
+      return ezyx_print_value(g, node, t);
+    return ezyx_call_arg(g, call, (size_t)(node - call->args), t);
+  }
+  return ezyx_push_type(g, t);
+}
+
+static enum ezywalk_action ezyx_expr_pre(struct ezywalk_t *w, ezy_ast_node_t *node)
+{
+  struct ezyx_gen *g = w->ctx;
+  if (node->type == ezy_ast_node_call && !ezyx_is_print(node->data.n_call) && !ezyx_call_check(g, node->data.n_call))
+    return ezywalk_stop;
+  return ezywalk_continue;
+}
+
+static enum ezywalk_action ezyx_expr_child(struct ezywalk_t *w, ezy_ast_node_t *node, size_t child)
+{
+  struct ezyx_gen *g = w->ctx;
+  if (node->type == ezy_ast_node_binop)
+  {
+    struct ezy_ast_binop_t *binop = &node->data.n_binop;
+    if (binop->operator == ezy_op_assign)
+      return child == 0 ? ezywalk_skip : ezywalk_continue; // stored to once computed
+    if (child == 0)
+      return ezywalk_continue;
+    enum ezyx_ctype lt = g->type_count > 0 ? g->types[g->type_count - 1] : ezyx_bad;
+    if (lt == ezyx_bad || lt == ezyx_none || lt == ezyx_str)
+      return ezyx_unsupported(g, "an operand of this type", binop->operator), ezywalk_stop;
+    if (!ezyx_is_operand(binop->right))
+    {
+      ezyx_push_value(g, lt);
+      return ezywalk_continue;
+    }
+    enum ezyx_ctype rt = ezyx_operand(g, binop->right, ezyx_rcx, 1);
+    return rt != ezyx_bad && ezyx_push_type(g, rt) ? ezywalk_skip : ezywalk_stop;
+  }
+  if (node->type == ezy_ast_node_call && ezyx_is_print(node->data.n_call))
+  {
+    if (node->data.n_call->args[child].type == ezy_ast_node_literal)
+      return ezywalk_skip; // folded into a constant run
+    ezyx_print_run(g, node->data.n_call, child);
+  }
+  return ezywalk_continue;
+}
+
+static bool ezyx_return(struct ezyx_gen *g, ezy_ast_node_t *node);
+static bool ezyx_init(struct ezyx_gen *g, ezy_ast_node_t *node);
+
+static enum ezywalk_action ezyx_expr_post(struct ezywalk_t *w, ezy_ast_node_t *node)
+{
+  struct ezyx_gen *g = w->ctx;
+  enum ezyx_ctype t;
+  switch (node->type)
+  {
+  case ezy_ast_node_literal:
+  case ezy_ast_node_variable:
+    t = ezyx_operand(g, node, ezyx_rax, 0);
+    break;
+  case ezy_ast_node_binop:
+    t = ezyx_binop(g, node);
+    break;
+  case ezy_ast_node_call:
+    if (ezyx_is_print(node->data.n_call))
+    {
+      ezyx_print_run(g, node->data.n_call, node->data.n_call->arg_count);
+      t = ezyx_none;
+    }
+    else
+    {
+      t = ezyx_call_expr(g, node->data.n_call);
+    }
+    break;
+  case ezy_ast_node_variable_decl:
+    return ezyx_init(g, node) ? ezywalk_continue : ezywalk_stop;
+  case ezy_ast_node_return:
+    return ezyx_return(g, node) ? ezywalk_continue : ezywalk_stop;
+  default:
+    ezyx_unsupported(g, "this kind of expression", node->type);
+    t = ezyx_bad;
+    break;
+  }
+  return ezyx_value(g, w->parent, node, t) ? ezywalk_continue : ezywalk_stop;
+}
+
+// ================ Functions ================
+// push rbp; mov rbp, rsp; push the callee-saved registers in use; sub rsp
+// for the stack slots, keeping rsp 16 byte aligned. Every return restores
+// them inline, there are no jumps to a shared epilogue.
+
+static void ezyx_epilogue(struct ezyx_gen *g)
+{
+  if (g->frame > 0)
+    ezyx_op_rbp(g, 0, true, 0x8d, ezyx_rsp, -8 * g->saved_count); // lea rsp, [rbp - saved]
+  for (int r = 15; r >= 0; r--)
+  {
+    if (g->saved & (1u << r))
+    {
+      ezyx_pop(g, r);
+      g->depth += 8; // restored for the next return
+    }
+  }
+  ezyx_pop(g, ezyx_rbp);
+  g->depth += 8;
+  ezyx_byte(g, 0xc3);
+}
+
+static inline bool ezyx_is_main(const struct ezy_ast_function_t *fn)
+{
+  return fn->name.len == 4 && memcmp(fn->name.ptr, "main", 4) == 0;
+}
+
+static bool ezyx_return(struct ezyx_gen *g, ezy_ast_node_t *node)
+{
+  enum ezyx_ctype rt = ezyx_ctype_of(&g->fn->return_typ);
+  ezy_ast_node_t *value = node != NULL ? node->data.n_return.value : NULL;
+  if (value != NULL)
+  {
+    enum ezyx_ctype t = ezyx_pop_type(g);
+    if (t == ezyx_bad || t == ezyx_none || rt == ezyx_none)
+      return ezyx_unsupported(g, "returning a value of this type", value->eval_typ.typ);
+    ezyx_convert(g, t, rt, ezyx_rax, 0);
+  }
+  else if (ezyx_is_main(g->fn))
+  {
+    ezyx_op(g, 0, false, 0x31, ezyx_rax, ezyx_rax); // main returns 0
+  }
+  ezyx_epilogue(g);
+  return true;
+}
+
+// a declaration's value is computed, it goes to the local's home
+static bool ezyx_init(struct ezyx_gen *g, ezy_ast_node_t *node)
+{
+  struct ezyx_local *l = ezyx_local(g, node->data.n_variable.sym);
+  enum ezyx_ctype t = ezyx_pop_type(g);
+  if (t == ezyx_bad || t == ezyx_none || (t == ezyx_str) != (l->typ == ezyx_str))
+    return ezyx_unsupported(g, "initializing a variable with this type", node->data.n_variable.value->eval_typ.typ);
+  ezyx_convert(g, t, l->typ, ezyx_rax, 0);
+  ezyx_store(g, l, ezyx_rax, 0);
+  return true;
+}
+
+static bool ezyx_function(struct ezyx_gen *g, struct ezy_ast_function_t *fn)
+{
+  g->fn = fn;
+  g->count = g->call_count = 0;
+  g->type_count = g->arg_count = 0;
+  g->pos = 0;
+  g->depth = 0;
+  if (fn->body == NULL)
+    return true;
+  enum ezyx_ctype rt = ezyx_ctype_of(&fn->return_typ);
+  if (rt == ezyx_bad || rt == ezyx_str)
+    return ezyx_unsupported(g, "a return of this type", fn->return_typ.typ);
+  if (!ezyx_reserve(g, (void **)&g->locals, &g->cap, fn->param_count, sizeof *g->locals))
+    return false;
+  size_t ints = 0;
+  for (size_t i = 0; i < fn->param_count; i++)
+  {
+    enum ezyx_ctype t = ezyx_ctype_of(&fn->params[i].typ);
+    if (t == ezyx_bad || t == ezyx_none || t == ezyx_str)
+      return ezyx_unsupported(g, "a parameter of this type", fn->params[i].typ.typ);
+    ints += !ezyx_is_float(t);
+    g->locals[g->count++] = (struct ezyx_local){.typ = t};
+  }
+  g->walk.pre = ezyx_scan_pre;
+  g->walk.child = ezyx_scan_child;
+  g->walk.post = ezyx_scan_post;
+  g->walk.ctx = g;
+  if (!ezywalk_list(&g->walk, fn->body))
+    return false;
+  ezyx_allocate(g, ints < ezyx_int_arg_max ? ints : ezyx_int_arg_max);
+  if (g->failed)
+    return false;
+
+  size_t start = ezyx_here(g);
+  ezyx_push(g, ezyx_rbp);
+  ezyx_op(g, 0, true, 0x89, ezyx_rsp, ezyx_rbp);
+  for (int r = 0; r < 16; r++)
+  {
+    if (g->saved & (1u << r))
+      ezyx_push(g, r);
+  }
+  g->frame = g->slots * 8 + (g->saved_count + g->slots) % 2 * 8;
+  if (g->frame > 0)
+    ezyx_rsp_add(g, -(int32_t)g->frame);
+  g->depth = 0; // rsp is aligned from here
+
+  // parameters move to their homes, extended: C leaves the bits above
+  // a narrow type unspecified. Those past the registers are above the
+  // return address, in order. A void main's start at zero like in the C
+  // backend, nothing is bound to them.
+  bool zeroed = ezyx_is_main(fn) && rt == ezyx_none;
+  size_t floats = 0, stacked = 0;
+  ints = 0;
+  for (size_t i = 0; i < fn->param_count; i++)
+  {
+    struct ezyx_local *l = &g->locals[i];
+    bool flt = ezyx_is_float(l->typ);
+    int in = ezyx_stack;
+    int32_t disp = 0;
+    if (flt ? floats < ezyx_float_arg_max : ints < ezyx_int_arg_max)
+      in = flt ? (int)floats++ : ezyx_int_args[ints++];
+    else
+      disp = 16 + 8 * (int32_t)stacked++;
+    if (!l->used)
+      continue;
+    if (zeroed)
+    {
+      ezyx_op(g, 0, false, 0x31, ezyx_rax, ezyx_rax);
+      ezyx_op(g, 0, false, 0x0f57, 0, 0); // xorps
+      ezyx_store(g, l, ezyx_rax, 0);
+      continue;
+    }
+    if (flt)
+    {
+      if (in == ezyx_stack)
+        ezyx_op_rbp(g, l->typ == ezyx_f32 ? 0xf3 : 0xf2, false, 0x0f10, 0, disp);
+      ezyx_store(g, l, ezyx_rax, in == ezyx_stack ? 0 : in);
+      continue;
+    }
+    if (in == ezyx_stack)
+      ezyx_op_rbp(g, 0, true, 0x8b, ezyx_rax, disp);
+    else
+      ezyx_op(g, 0, true, 0x89, in, ezyx_rax);
+    ezyx_extend(g, ezyx_rax, l->typ);
+    ezyx_store(g, l, ezyx_rax, 0);
+  }
+
+  g->walk.pre = ezyx_expr_pre;
+  g->walk.child = ezyx_expr_child;
+  g->walk.post = ezyx_expr_post;
+  if (!ezywalk_list(&g->walk, fn->body))
+    return false;
+  ezy_ast_node_t *last = fn->body;
+  while (last->next != NULL)
+    last = last->next;
+  if (last->type != ezy_ast_node_return)
+    ezyx_return(g, NULL);
+  ezyelf_define(g->obj, ezyelf_symbol(g->obj, fn->name), start, ezyx_here(g) - start);
+  return !g->failed;
+}
+
+ezy_multistr_t *ezyx64_object(ezy_ast_node_t *root)
+{
+  struct ezyelf_obj obj;
+  ezyelf_init(&obj);
+  struct ezyx_gen g = {.obj = &obj};
+  bool ok = true;
+  for (ezy_ast_node_t *node = root; node != NULL; node = node->next)
+  {
+    if (node->type == ezy_ast_node_function)
+    {
+      g.failed = false;
+      ok = ezyx_function(&g, node->data.n_function) && ok;
+      continue;
+    }
+    ezy_log_error("native backend: top level node %d is not supported, use the C backend", node->type);
+    ok = false;
+  }
+  ezy_multistr_t *out = ok ? ezyelf_finish(&obj) : NULL;
+  free(g.locals);
+  free(g.calls);
+  free(g.types);
+  free(g.args);
+  ezywalk_release(&g.walk);
+  ezyelf_free(&obj);
+  return out;
+}
+
+void ezyx64_free(ezy_multistr_t *obj)
+{
+  ezyemit_free(obj);
+}
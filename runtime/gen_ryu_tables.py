@@ -0,0 +1,55 @@
+#!/usr/bin/env python3
+# Generates runtime/src/ryu_tables.h, the 5^i tables used by the
+# shortest-roundtrip double formatter (Ryu, Ulf Adams 2018).
+#
+#   python3 runtime/gen_ryu_tables.py > runtime/src/ryu_tables.h
+
+POW5_INV_BITCOUNT = 125
+POW5_BITCOUNT = 125
+POW5_INV_TABLE_SIZE = 342
+POW5_TABLE_SIZE = 326
+MASK64 = (1 << 64) - 1
+
+
+def split(v):
+    return v & MASK64, v >> 64
+
+
+def main():
+    out = []
+    out.append("// generated by runtime/gen_ryu_tables.py, do not edit")
+    out.append("#if !defined(ezyrt_ryu_tables_h)")
+    out.append("#define ezyrt_ryu_tables_h")
+    out.append("")
+    out.append("#include <stdint.h>")
+    out.append("")
+    out.append("#define EZYRT_POW5_INV_BITCOUNT %d" % POW5_INV_BITCOUNT)
+    out.append("#define EZYRT_POW5_BITCOUNT %d" % POW5_BITCOUNT)
+    out.append("")
+
+    # floor(2^(bits(5^i) - 1 + 125) / 5^i) + 1
+    out.append("static const uint64_t ezyrt_pow5_inv_split[%d][2] = {" % POW5_INV_TABLE_SIZE)
+    for i in range(POW5_INV_TABLE_SIZE):
+        pow5 = 5 ** i
+        j = pow5.bit_length() - 1 + POW5_INV_BITCOUNT
+        lo, hi = split((1 << j) // pow5 + 1)
+        out.append("    {%su, %su}," % (lo, hi))
+    out.append("};")
+    out.append("")
+
+    # 5^i normalized to exactly 125 bits
+    out.append("static const uint64_t ezyrt_pow5_split[%d][2] = {" % POW5_TABLE_SIZE)
+    for i in range(POW5_TABLE_SIZE):
+        pow5 = 5 ** i
+        shift = pow5.bit_length() - POW5_BITCOUNT
+        v = pow5 >> shift if shift >= 0 else pow5 << -shift
+        lo, hi = split(v)
+        out.append("    {%su, %su}," % (lo, hi))
+    out.append("};")
+    out.append("")
+    out.append("#endif // ezyrt_ryu_tables_h")
+    print("\n".join(out))
+
+
+if __name__ == "__main__":
+    main()
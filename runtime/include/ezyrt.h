@@ -0,0 +1,102 @@
+#if !defined(ezyrt_h)
+#define ezyrt_h
+
+// Ezy runtime: buffered output and number formatting for generated C.
+// Built once as a static archive (libezyrt.a) and linked into every
+// program produced by ezc.
+
+#include <ezyrt_str.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+// ================ Output ================
+// stdout goes through one large user-space buffer. It is flushed when
+// full, by ezyrt_flush, and at exit (registered on the first write).
+
+#define ezyrt_out_size (256 * 1024)
+
+struct ezyrt_out {
+  char *pos;
+  char *end; // equals pos until the first write sets the buffer up
+  char buf[ezyrt_out_size];
+};
+
+extern struct ezyrt_out ezyrt_stdout;
+
+// Make room for `n` bytes (flushing if needed) and return where to write.
+// Requests larger than the buffer return NULL after a flush.
+char *ezyrt_reserve_slow(size_t n);
+void ezyrt_write_slow(const char *s, size_t n);
+void ezyrt_flush(void);
+
+static inline void ezyrt_write(const char *s, size_t n)
+{
+  if ((size_t)(ezyrt_stdout.end - ezyrt_stdout.pos) >= n)
+  {
+    memcpy(ezyrt_stdout.pos, s, n);
+    ezyrt_stdout.pos += n;
+    return;
+  }
+  ezyrt_write_slow(s, n);
+}
+
+static inline void ezyrt_write_str(const char *s)
+{
+  ezyrt_write(s, strlen(s));
+}
+
+static inline void ezyrt_write_s(ezyrt_str s)
+{
+  ezyrt_write(ezyrt_str_data(&s), ezyrt_str_len(s));
+}
+
+static inline void ezyrt_write_char(char c)
+{
+  if (ezyrt_stdout.pos != ezyrt_stdout.end)
+  {
+    *ezyrt_stdout.pos++ = c;
+    return;
+  }
+  ezyrt_write_slow(&c, 1);
+}
+
+void ezyrt_write_i64(int64_t v);
+void ezyrt_write_u64(uint64_t v);
+void ezyrt_write_f64(double v);
+void ezyrt_write_f32(float v);
+
+// ================ Formatting ================
+// Plain formatters, also used by the compiler to pre-format literals so
+// folded constants print exactly like runtime values.
+
+#define ezyrt_fmt_i64_max 20
+#define ezyrt_fmt_u64_max 20
+#define ezyrt_fmt_f64_max 32
+
+size_t ezyrt_fmt_u64(char *buf, uint64_t v);
+size_t ezyrt_fmt_i64(char *buf, int64_t v);
+
+// Shortest decimal that reads back as `v` (Ryu). Plain notation when
+// 1e-7 < |v| < 1e21, scientific otherwise:
+// 2, 0.1, 123.456, 1e+21, 1.5e-07, -0, inf, nan
+size_t ezyrt_fmt_f64(char *buf, double v);
+// Same for a float: the shortest decimal that reads back as the float,
+// 1.1f is 1.1 where ezyrt_fmt_f64 would give 1.100000023841858
+size_t ezyrt_fmt_f32(char *buf, float v);
+
+// ================ Bounds ================
+// Checked array indexing, emitted where ezc cannot prove the index in
+// range (see --checks). A negative index converts to a huge unsigned
+// value, so one compare covers both ends.
+
+_Noreturn void ezyrt_index_fail(int64_t i, size_t n);
+
+static inline size_t ezyrt_index(int64_t i, size_t n)
+{
+  if ((uint64_t)i >= n)
+    ezyrt_index_fail(i, n);
+  return (size_t)i;
+}
+
+#endif // ezyrt_h
@@ -0,0 +1,149 @@
+#if !defined(ezyrt_opt_h)
+#define ezyrt_opt_h
+
+// Optional values (`T?`) for generated code. A type with a bit pattern no
+// value uses stores null there (a niche) and stays the same size:
+//   string?  ezyrt_str, ezyrt_str_null (a slice at NULL)
+//   bool?    uint8_t, ezyrt_opt_bool_null
+//   var?     ezyrt_var, the null tag
+//   T[]?     the vector, len == SIZE_MAX (ezyrt_vec.h)
+// Numbers and char use every bit pattern, so they carry a flag after the
+// value: int32? is {int32_t value; bool has}. Fixed arrays of those keep
+// the flags in a bitmap after the values (ezyrt_optarr_define) instead of
+// padding every element. The sizes are checked in runtime/src/opt.c.
+//
+// Reading a null optional as a plain value is fatal.
+
+#include <ezyrt_var.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Report reading a null value on stderr and exit, buffered stdout is still flushed.
+_Noreturn void ezyrt_null_fail(const char *what);
+
+#define ezyrt_opt_define(name, T, ctor, read)                                             \
+  typedef struct name                                                                     \
+  {                                                                                       \
+    T value;                                                                              \
+    bool has;                                                                             \
+  } name;                                                                                 \
+                                                                                          \
+  static inline name name##_some(T x)                                                     \
+  {                                                                                       \
+    name o;                                                                               \
+    o.value = x;                                                                          \
+    o.has = true;                                                                         \
+    return o;                                                                             \
+  }                                                                                       \
+                                                                                          \
+  static inline T name##_get(name o)                                                      \
+  {                                                                                       \
+    if (!o.has)                                                                           \
+      ezyrt_null_fail("value is null");                                                   \
+    return o.value;                                                                       \
+  }                                                                                       \
+                                                                                          \
+  static inline ezyrt_var name##_to_var(name o)                                           \
+  {                                                                                       \
+    return o.has ? ctor(o.value) : ezyrt_var_null();                                      \
+  }                                                                                       \
+                                                                                          \
+  static inline name name##_from_var(ezyrt_var v)                                         \
+  {                                                                                       \
+    name o = {0};                                                                         \
+    if (v.tag != ezyrt_tag_null)                                                          \
+      o = name##_some((T)read(v));                                                        \
+    return o;                                                                             \
+  }
+
+ezyrt_opt_define(ezyrt_opt_i8, int8_t, ezyrt_var_i8, ezyrt_var_as_i64)
+ezyrt_opt_define(ezyrt_opt_u8, uint8_t, ezyrt_var_u8, ezyrt_var_as_u64)
+ezyrt_opt_define(ezyrt_opt_i16, int16_t, ezyrt_var_i16, ezyrt_var_as_i64)
+ezyrt_opt_define(ezyrt_opt_u16, uint16_t, ezyrt_var_u16, ezyrt_var_as_u64)
+ezyrt_opt_define(ezyrt_opt_i32, int32_t, ezyrt_var_i32, ezyrt_var_as_i64)
+ezyrt_opt_define(ezyrt_opt_u32, uint32_t, ezyrt_var_u32, ezyrt_var_as_u64)
+ezyrt_opt_define(ezyrt_opt_i64, int64_t, ezyrt_var_i64, ezyrt_var_as_i64)
+ezyrt_opt_define(ezyrt_opt_u64, uint64_t, ezyrt_var_u64, ezyrt_var_as_u64)
+ezyrt_opt_define(ezyrt_opt_f32, float, ezyrt_var_f32, ezyrt_var_as_f64)
+ezyrt_opt_define(ezyrt_opt_f64, double, ezyrt_var_f64, ezyrt_var_as_f64)
+ezyrt_opt_define(ezyrt_opt_char, char, ezyrt_var_char, ezyrt_var_as_char)
+
+// ================ Niches ================
+
+typedef uint8_t ezyrt_opt_bool;
+
+#define ezyrt_opt_bool_null 2
+
+static inline ezyrt_opt_bool ezyrt_opt_bool_some(bool b)
+{
+  return b;
+}
+
+static inline bool ezyrt_opt_bool_get(ezyrt_opt_bool o)
+{
+  if (o == ezyrt_opt_bool_null)
+    ezyrt_null_fail("value is null");
+  return o != 0;
+}
+
+static inline ezyrt_var ezyrt_opt_bool_to_var(ezyrt_opt_bool o)
+{
+  return o != ezyrt_opt_bool_null ? ezyrt_var_bool(o != 0) : ezyrt_var_null();
+}
+
+static inline ezyrt_opt_bool ezyrt_opt_bool_from_var(ezyrt_var v)
+{
+  return v.tag != ezyrt_tag_null ? ezyrt_var_as_bool(v) : ezyrt_opt_bool_null;
+}
+
+// string? is an ezyrt_str that may be ezyrt_str_null
+static inline ezyrt_str ezyrt_opt_str_get(ezyrt_str s)
+{
+  if (ezyrt_str_is_null(s))
+    ezyrt_null_fail("string is null");
+  return s;
+}
+
+static inline ezyrt_var ezyrt_opt_str_to_var(ezyrt_str s)
+{
+  return !ezyrt_str_is_null(s) ? ezyrt_var_str(s) : ezyrt_var_null();
+}
+
+static inline ezyrt_str ezyrt_opt_str_from_var(ezyrt_var v)
+{
+  return v.tag != ezyrt_tag_null ? ezyrt_var_as_str(v) : ezyrt_str_null;
+}
+
+// ================ Fixed arrays of optionals ================
+// ezyrt_optarr_define(name, opt, T, N) is an array of N `opt` values
+// (opt is one of the flagged types above, T its value type) stored as N
+// plain values and an N bit presence bitmap. Zeroed, every element is null.
+
+#define ezyrt_optarr_define(name, opt, T, N)                                              \
+  typedef struct name                                                                     \
+  {                                                                                       \
+    T value[N];                                                                           \
+    uint8_t has[((N) + 7) / 8];                                                           \
+  } name;                                                                                 \
+                                                                                          \
+  static inline opt name##_get(const name *a, int64_t i)                                  \
+  {                                                                                       \
+    opt o;                                                                                \
+    o.value = a->value[i];                                                                \
+    o.has = (a->has[i >> 3] >> (i & 7)) & 1;                                              \
+    return o;                                                                             \
+  }                                                                                       \
+                                                                                          \
+  static inline opt name##_set(name *a, int64_t i, opt o)                                 \
+  {                                                                                       \
+    uint8_t bit = (uint8_t)(1u << (i & 7));                                               \
+    a->value[i] = o.value;                                                                \
+    if (o.has)                                                                            \
+      a->has[i >> 3] |= bit;                                                              \
+    else                                                                                  \
+      a->has[i >> 3] &= (uint8_t)~bit;                                                    \
+    return o;                                                                             \
+  }
+
+#endif // ezyrt_opt_h
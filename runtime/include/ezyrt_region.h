@@ -0,0 +1,85 @@
+#if !defined(ezyrt_region_h)
+#define ezyrt_region_h
+
+// Region allocation for generated code, the runtime counterpart of the
+// compiler's ezyparse_arena. Every thread owns one region: a chain of
+// blocks handed out by bumping a pointer. A function declared
+// `@region fn` enters the region on entry and leaves it on return, and
+// everything the runtime allocates in between (vector storage, built
+// strings, boxed vars) comes from the region and is released at once.
+// Blocks are kept for the next call, so a steady workload stops calling
+// malloc after the first few calls.
+//
+// Entering nests: a mark records the bump position, leaving resets to
+// it. Outside any region ezyrt_alloc and friends are malloc, realloc and
+// free. ezyc checks that region memory cannot outlive the call (see
+// Architecture.md), so no pointer into a released region is ever used.
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdlib.h>
+
+#define ezyrt_region_block_min (64 * 1024)
+#define ezyrt_region_align 16
+
+typedef struct ezyrt_region_block {
+  struct ezyrt_region_block *next; // newer block, kept when released
+  size_t size;
+  size_t used;
+  _Alignas(ezyrt_region_align) char data[];
+} ezyrt_region_block;
+
+typedef struct ezyrt_region {
+  ezyrt_region_block *first;
+  ezyrt_region_block *current; // blocks after it are empty spares
+  size_t depth;                // nesting of ezyrt_region_enter
+} ezyrt_region;
+
+// where ezyrt_region_leave resets the bump pointer to
+typedef struct ezyrt_region_mark {
+  ezyrt_region_block *block;
+  size_t used;
+} ezyrt_region_mark;
+
+extern _Thread_local ezyrt_region ezyrt_region_tls;
+
+ezyrt_region_mark ezyrt_region_enter(void);
+void ezyrt_region_leave(ezyrt_region_mark mark);
+
+// Return every block of this thread's region to malloc, outside any region.
+void ezyrt_region_trim(void);
+
+void *ezyrt_region_alloc_slow(size_t n);
+void *ezyrt_realloc_slow(void *p, size_t old_size, size_t n);
+bool ezyrt_region_owns(const void *p);
+
+static inline void *ezyrt_alloc(size_t n)
+{
+  ezyrt_region *r = &ezyrt_region_tls;
+  if (r->depth == 0)
+    return malloc(n);
+  ezyrt_region_block *b = r->current;
+  size_t at = b != NULL ? (b->used + ezyrt_region_align - 1) & ~(size_t)(ezyrt_region_align - 1) : 0;
+  if (b == NULL || n > b->size - at || at > b->size)
+    return ezyrt_region_alloc_slow(n);
+  b->used = at + n;
+  return b->data + at;
+}
+
+// `old_size` is the size `p` was allocated with, region memory does not
+// record it
+static inline void *ezyrt_realloc(void *p, size_t old_size, size_t n)
+{
+  if (ezyrt_region_tls.depth == 0 || p == NULL)
+    return ezyrt_region_tls.depth == 0 ? realloc(p, n) : ezyrt_alloc(n);
+  return ezyrt_realloc_slow(p, old_size, n);
+}
+
+// region memory is released with its region, only heap memory is freed
+static inline void ezyrt_free(void *p)
+{
+  if (ezyrt_region_tls.depth == 0 || !ezyrt_region_owns(p))
+    free(p);
+}
+
+#endif // ezyrt_region_h
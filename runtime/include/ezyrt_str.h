@@ -0,0 +1,138 @@
+#if !defined(ezyrt_str_h)
+#define ezyrt_str_h
+
+// Ezy strings: 16 bytes, passed and returned in registers like a var.
+// A string is either
+//   a slice   {ptr, len}: text that lives elsewhere (a literal, a C string,
+//             a heap buffer). The top bit of len marks the form.
+//   inline    up to 14 bytes kept in the struct, NUL padded, with the
+//             length in the last byte. Zeroed memory is the empty string.
+// The length is always known, nothing calls strlen. Text is never
+// modified once a string points at it, so copies share it freely.
+// Slices made here (literals, concatenation) keep a NUL after the text;
+// ezyrt_str_cstr hands that to C, and copies only when it is missing.
+//
+// string? stores null as a slice with a NULL pointer (see ezyrt_opt.h).
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__
+#error "ezyrt_str keeps its form bit in the last byte, little endian only"
+#endif
+
+#define ezyrt_str_inline_max 14
+#define ezyrt_str_slice_bit ((size_t)1 << (sizeof(size_t) * 8 - 1))
+
+typedef struct ezyrt_str {
+  union {
+    struct {
+      const char *ptr;
+      size_t len; // | ezyrt_str_slice_bit
+    } slice;
+    char bytes[16];
+  };
+} ezyrt_str;
+
+_Static_assert(sizeof(ezyrt_str) == 16, "ezyrt_str must stay two eightbytes");
+
+// a literal, `s` must be a string literal: no copy and no strlen
+#define ezyrt_str_lit_init(s) {.slice = {(s), (sizeof(s) - 1) | ezyrt_str_slice_bit}}
+#define ezyrt_str_lit(s) ((ezyrt_str)ezyrt_str_lit_init(s))
+
+#define ezyrt_str_null_init {.slice = {NULL, ezyrt_str_slice_bit}}
+#define ezyrt_str_null ((ezyrt_str)ezyrt_str_null_init)
+
+static inline bool ezyrt_str_is_inline(ezyrt_str s)
+{
+  return ((uint8_t)s.bytes[15] & 0x80) == 0;
+}
+
+static inline bool ezyrt_str_is_null(ezyrt_str s)
+{
+  return !ezyrt_str_is_inline(s) && s.slice.ptr == NULL;
+}
+
+static inline size_t ezyrt_str_len(ezyrt_str s)
+{
+  return ezyrt_str_is_inline(s) ? (uint8_t)s.bytes[15] : s.slice.len & ~ezyrt_str_slice_bit;
+}
+
+// the text, `len` bytes; a pointer into `s` itself for an inline string
+static inline const char *ezyrt_str_data(const ezyrt_str *s)
+{
+  return ezyrt_str_is_inline(*s) ? s->bytes : s->slice.ptr;
+}
+
+// a slice over `n` bytes at `p`, no copy
+static inline ezyrt_str ezyrt_str_slice(const char *p, size_t n)
+{
+  ezyrt_str s;
+  s.slice.ptr = p;
+  s.slice.len = n | ezyrt_str_slice_bit;
+  return s;
+}
+
+// a string returned by C: a slice over it, NULL becomes null
+static inline ezyrt_str ezyrt_str_c(const char *cstr)
+{
+  return cstr != NULL ? ezyrt_str_slice(cstr, strlen(cstr)) : ezyrt_str_null;
+}
+
+// a copy of `n` bytes at `p`, inline when it fits
+ezyrt_str ezyrt_str_from(const char *p, size_t n);
+
+static inline bool ezyrt_str_eq(ezyrt_str a, ezyrt_str b)
+{
+  size_t n = ezyrt_str_len(a);
+  return n == ezyrt_str_len(b) && memcmp(ezyrt_str_data(&a), ezyrt_str_data(&b), n) == 0;
+}
+
+// NUL terminated text for C, valid as long as `s` is; a heap copy only
+// for a slice without a NUL after it (one of a C string's tail, say)
+const char *ezyrt_str_cstr_slow(const ezyrt_str *s);
+
+static inline const char *ezyrt_str_cstr(const ezyrt_str *s)
+{
+  if (ezyrt_str_is_inline(*s))
+    return s->bytes;
+  if (s->slice.ptr == NULL || s->slice.ptr[s->slice.len & ~ezyrt_str_slice_bit] == '\0')
+    return s->slice.ptr;
+  return ezyrt_str_cstr_slow(s);
+}
+
+// ================ Building ================
+// A builder appends into one buffer that grows geometrically, so a chain
+// of appends copies every byte a constant number of times. Finishing it
+// returns an inline string or a slice that owns the buffer.
+
+typedef struct ezyrt_strbuf {
+  char *data;
+  size_t len;
+  size_t cap;
+} ezyrt_strbuf;
+
+void ezyrt_strbuf_reserve(ezyrt_strbuf *b, size_t n);
+void ezyrt_strbuf_append(ezyrt_strbuf *b, const char *p, size_t n);
+
+static inline void ezyrt_strbuf_append_str(ezyrt_strbuf *b, ezyrt_str s)
+{
+  ezyrt_strbuf_append(b, ezyrt_str_data(&s), ezyrt_str_len(s));
+}
+
+ezyrt_str ezyrt_strbuf_finish(ezyrt_strbuf *b);
+
+// a + b + ...: the lengths are summed first, so a result longer than
+// 14 bytes is one exact allocation and one copy of every part
+ezyrt_str ezyrt_str_concat(const ezyrt_str *parts, size_t n);
+
+// Buffer of a concatenation whose result never leaves its function
+#define ezyrt_str_stack_size 128
+
+// The same, built in `buf` (`cap` bytes on the caller's stack) when the
+// text and its NUL fit, else allocated like ezyrt_str_concat
+ezyrt_str ezyrt_str_concat_in(char *buf, size_t cap, const ezyrt_str *parts, size_t n);
+
+#endif // ezyrt_str_h
@@ -0,0 +1,254 @@
+#if !defined(ezyrt_var_h)
+#define ezyrt_var_h
+
+// The `var` type: a 16 byte tagged value. Numbers, bool, char and null
+// live in the payload, so making a var from them never allocates; arrays
+// are boxed and the payload points to a heap copy. A string keeps its
+// text where it is: the payload is the pointer, its length sits after
+// the tag. Only a short string held inline in its ezyrt_str (built at run
+// time, ezyrt_str.h) is copied to the heap, once.
+// Two eightbytes are passed and returned in registers on x86-64 and
+// AArch64, a var costs the same to copy as two integers.
+//
+// typeof(v) is the tag. type_repr(v) masks off the bits that only tell
+// apart types sharing a representation (char and uint8).
+
+#include <ezyrt_str.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+enum ezyrt_tag {
+  ezyrt_tag_null = 0,
+  ezyrt_tag_bool,
+  // integers alternate signed / unsigned, narrow to wide
+  ezyrt_tag_i8,
+  ezyrt_tag_u8,
+  ezyrt_tag_i16,
+  ezyrt_tag_u16,
+  ezyrt_tag_i32,
+  ezyrt_tag_u32,
+  ezyrt_tag_i64,
+  ezyrt_tag_u64,
+  ezyrt_tag_f32,
+  ezyrt_tag_f64,
+  ezyrt_tag_string,
+  ezyrt_tag_array,
+
+  ezyrt_tag_char = ezyrt_tag_u8 | 0x10,
+};
+
+#define ezyrt_tag_repr_mask 0x0f
+
+typedef struct ezyrt_var {
+  union {
+    int64_t i;  // signed integers, sign extended
+    uint64_t u; // unsigned integers, bool and char, zero extended
+    double f;   // float32 is widened, exactly
+    const char *s;
+    void *box;
+  } as;
+  uint8_t tag;
+  uint32_t len; // of a string
+} ezyrt_var;
+
+_Static_assert(sizeof(ezyrt_var) == 16, "ezyrt_var must stay two eightbytes");
+
+// Report a type error on stderr and exit, buffered stdout is still flushed.
+_Noreturn void ezyrt_var_fail(const char *what, ezyrt_var v);
+
+// Report reading union `name` as the type tagged `want` while it holds `held`.
+_Noreturn void ezyrt_union_fail(const char *name, uint8_t want, uint8_t held);
+
+// heap copy of `size` bytes at `src`, tagged `tag`
+ezyrt_var ezyrt_var_box(uint8_t tag, const void *src, size_t size);
+
+// fixed arrays are boxed by value, `x` must be an array lvalue
+#define ezyrt_var_of_array(x) ezyrt_var_box(ezyrt_tag_array, (x), sizeof(x))
+
+void ezyrt_write_var(ezyrt_var v);
+
+// ================ Making vars ================
+
+static inline ezyrt_var ezyrt_var_null(void)
+{
+  return (ezyrt_var){.tag = ezyrt_tag_null};
+}
+
+#define ezyrt_var_ctor(suffix, T, field, tag_)                                                \
+  static inline ezyrt_var ezyrt_var_##suffix(T x)                                           \
+  {                                                                                         \
+    ezyrt_var v;                                                                            \
+    v.as.field = x;                                                                         \
+    v.tag = tag_;                                                                           \
+    return v;                                                                               \
+  }
+
+ezyrt_var_ctor(i8, int8_t, i, ezyrt_tag_i8)
+ezyrt_var_ctor(u8, uint8_t, u, ezyrt_tag_u8)
+ezyrt_var_ctor(i16, int16_t, i, ezyrt_tag_i16)
+ezyrt_var_ctor(u16, uint16_t, u, ezyrt_tag_u16)
+ezyrt_var_ctor(i32, int32_t, i, ezyrt_tag_i32)
+ezyrt_var_ctor(u32, uint32_t, u, ezyrt_tag_u32)
+ezyrt_var_ctor(i64, int64_t, i, ezyrt_tag_i64)
+ezyrt_var_ctor(u64, uint64_t, u, ezyrt_tag_u64)
+ezyrt_var_ctor(f32, float, f, ezyrt_tag_f32)
+ezyrt_var_ctor(f64, double, f, ezyrt_tag_f64)
+ezyrt_var_ctor(bool, bool, u, ezyrt_tag_bool)
+ezyrt_var_ctor(char, unsigned char, u, ezyrt_tag_char)
+
+#undef ezyrt_var_ctor
+
+// an inline string (or one of 4 GiB and more)
+ezyrt_var ezyrt_var_str_slow(ezyrt_str s);
+
+static inline ezyrt_var ezyrt_var_str(ezyrt_str s)
+{
+  if (ezyrt_str_is_inline(s) || (s.slice.len & ~ezyrt_str_slice_bit) > UINT32_MAX)
+    return ezyrt_var_str_slow(s);
+  ezyrt_var v;
+  v.as.s = s.slice.ptr;
+  v.tag = ezyrt_tag_string;
+  v.len = (uint32_t)s.slice.len;
+  return v;
+}
+
+// ================ Reading vars ================
+// Any number converts to any number (like a C cast). Anything else must
+// hold exactly the requested type.
+
+static inline bool ezyrt_tag_is_int(uint8_t tag)
+{
+  return (tag >= ezyrt_tag_i8 && tag <= ezyrt_tag_u64) || tag == ezyrt_tag_char;
+}
+
+static inline bool ezyrt_tag_is_float(uint8_t tag)
+{
+  return tag == ezyrt_tag_f32 || tag == ezyrt_tag_f64;
+}
+
+static inline bool ezyrt_tag_is_signed(uint8_t tag)
+{
+  return tag >= ezyrt_tag_i8 && tag <= ezyrt_tag_i64 && (tag & 1) == 0;
+}
+
+static inline int64_t ezyrt_var_as_i64(ezyrt_var v)
+{
+  if (ezyrt_tag_is_int(v.tag))
+    return v.as.i; // same bits as the C conversion from uint64_t
+  if (!ezyrt_tag_is_float(v.tag))
+    ezyrt_var_fail("expected a number, var holds", v);
+  return (int64_t)v.as.f;
+}
+
+static inline uint64_t ezyrt_var_as_u64(ezyrt_var v)
+{
+  if (ezyrt_tag_is_int(v.tag))
+    return v.as.u;
+  if (!ezyrt_tag_is_float(v.tag))
+    ezyrt_var_fail("expected a number, var holds", v);
+  return (uint64_t)v.as.f;
+}
+
+static inline double ezyrt_var_as_f64(ezyrt_var v)
+{
+  if (ezyrt_tag_is_float(v.tag))
+    return v.as.f;
+  if (!ezyrt_tag_is_int(v.tag))
+    ezyrt_var_fail("expected a number, var holds", v);
+  return ezyrt_tag_is_signed(v.tag) ? (double)v.as.i : (double)v.as.u;
+}
+
+static inline bool ezyrt_var_as_bool(ezyrt_var v)
+{
+  if (v.tag != ezyrt_tag_bool)
+    ezyrt_var_fail("expected a bool, var holds", v);
+  return v.as.u != 0;
+}
+
+static inline char ezyrt_var_as_char(ezyrt_var v)
+{
+  return (char)ezyrt_var_as_u64(v);
+}
+
+static inline ezyrt_str ezyrt_var_as_str(ezyrt_var v)
+{
+  if (v.tag != ezyrt_tag_string)
+    ezyrt_var_fail("expected a string, var holds", v);
+  return ezyrt_str_slice(v.as.s, v.len);
+}
+
+// ================ Arithmetic ================
+// Same promotions as typed code: floats win, then the wider integer,
+// unsigned wins ties, narrow integers become int32. `/` on two integers
+// is floating division, as in `let x = 10 / 3`. Integer results wrap.
+
+// op is one of + - * / %
+ezyrt_var ezyrt_var_arith_slow(char op, ezyrt_var a, ezyrt_var b);
+bool ezyrt_var_eq_slow(ezyrt_var a, ezyrt_var b);
+
+static inline uint8_t ezyrt_tag_promote_int(uint8_t a, uint8_t b)
+{
+  // char counts as uint8, narrow types promote to int32
+  a = a == ezyrt_tag_char ? ezyrt_tag_u8 : a;
+  b = b == ezyrt_tag_char ? ezyrt_tag_u8 : b;
+  a = a < ezyrt_tag_i32 ? ezyrt_tag_i32 : a;
+  b = b < ezyrt_tag_i32 ? ezyrt_tag_i32 : b;
+  uint8_t hi = a > b ? a : b;
+  // at equal width the unsigned tag is the larger one
+  return hi;
+}
+
+// integer result `bits` narrowed to `tag`
+static inline ezyrt_var ezyrt_var_int(uint8_t tag, uint64_t bits)
+{
+  ezyrt_var v;
+  v.tag = tag;
+  switch (tag)
+  {
+  case ezyrt_tag_i32:
+    v.as.i = (int32_t)(uint32_t)bits;
+    break;
+  case ezyrt_tag_u32:
+    v.as.u = (uint32_t)bits;
+    break;
+  default:
+    v.as.u = bits;
+    break;
+  }
+  return v;
+}
+
+#define ezyrt_var_int_op(name, op_char, expr)                                                 \
+  static inline ezyrt_var ezyrt_var_##name(ezyrt_var a, ezyrt_var b)                         \
+  {                                                                                         \
+    if (ezyrt_tag_is_int(a.tag) && ezyrt_tag_is_int(b.tag))                                 \
+      return ezyrt_var_int(ezyrt_tag_promote_int(a.tag, b.tag), expr);                      \
+    return ezyrt_var_arith_slow(op_char, a, b);                                             \
+  }
+
+ezyrt_var_int_op(add, '+', a.as.u + b.as.u)
+ezyrt_var_int_op(sub, '-', a.as.u - b.as.u)
+ezyrt_var_int_op(mul, '*', a.as.u * b.as.u)
+
+#undef ezyrt_var_int_op
+
+static inline ezyrt_var ezyrt_var_div(ezyrt_var a, ezyrt_var b)
+{
+  return ezyrt_var_arith_slow('/', a, b);
+}
+
+static inline ezyrt_var ezyrt_var_mod(ezyrt_var a, ezyrt_var b)
+{
+  return ezyrt_var_arith_slow('%', a, b);
+}
+
+// numbers compare by value, strings by content, arrays by identity
+static inline bool ezyrt_var_eq(ezyrt_var a, ezyrt_var b)
+{
+  if (a.tag == b.tag && a.tag != ezyrt_tag_string && !ezyrt_tag_is_float(a.tag))
+    return a.as.u == b.as.u;
+  return ezyrt_var_eq_slow(a, b);
+}
+
+#endif // ezyrt_var_h
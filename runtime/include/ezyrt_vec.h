@@ -0,0 +1,204 @@
+#if !defined(ezyrt_vec_h)
+#define ezyrt_vec_h
+
+// Dynamic arrays for generated code. ezyrt_vec_define(name, T) expands to
+// a vector type and its functions for one element type, so access and
+// growth are typed: no void* and no element size passed around at run time.
+//
+//   guide: initial capacity, the first push allocates exactly that much
+//   max:   hard limit on the length (0 = none). Storage for max elements
+//          is allocated once and never moves; pushing past it is fatal.
+//
+// A zeroed vector with guide/max set is valid and owns no storage, so
+// declarations (even at file scope) need no function call. An optional
+// array (T[]?) is the same vector, null while len == SIZE_MAX.
+
+#include <ezyrt.h>
+#include <ezyrt_opt.h>
+#include <ezyrt_region.h>
+#include <ezyrt_var.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define ezyrt_vec_min_cap 8
+
+// Report the failure on stderr and exit, buffered stdout is still flushed.
+void ezyrt_vec_fail(const char *what, size_t n);
+
+#define ezyrt_vec_define(name, T)                                                         \
+  typedef struct name                                                                     \
+  {                                                                                       \
+    T *data;                                                                              \
+    size_t len;                                                                           \
+    size_t cap;                                                                           \
+    size_t guide;                                                                         \
+    size_t max;                                                                           \
+  } name;                                                                                 \
+                                                                                          \
+  /* geometric growth, the first allocation is the guide (or the max) */                  \
+  static inline void name##_grow(name *v, size_t need)                                    \
+  {                                                                                       \
+    size_t cap;                                                                           \
+    if (v->max != 0)                                                                      \
+    {                                                                                     \
+      if (need > v->max)                                                                  \
+        ezyrt_vec_fail("array is full, max length", v->max);                              \
+      cap = v->max;                                                                       \
+    }                                                                                     \
+    else                                                                                  \
+    {                                                                                     \
+      cap = v->cap != 0 ? v->cap * 2 : v->guide != 0 ? v->guide : ezyrt_vec_min_cap;     \
+      if (cap < need)                                                                     \
+        cap = need;                                                                       \
+    }                                                                                     \
+    if (cap > SIZE_MAX / sizeof(T))                                                       \
+      ezyrt_vec_fail("array too large, length", cap);                                     \
+    T *data = (T *)ezyrt_realloc(v->data, v->cap * sizeof(T), cap * sizeof(T));           \
+    if (data == NULL)                                                                     \
+      ezyrt_vec_fail("out of memory growing array to length", cap);                       \
+    v->data = data;                                                                       \
+    v->cap = cap;                                                                         \
+  }                                                                                       \
+                                                                                          \
+  static inline void name##_push(name *v, T x)                                            \
+  {                                                                                       \
+    if (v->len == v->cap)                                                                 \
+      name##_grow(v, v->len + 1);                                                         \
+    v->data[v->len++] = x;                                                                \
+  }                                                                                       \
+                                                                                          \
+  static inline name name##_from(size_t guide, size_t max, T const *src, size_t n)        \
+  {                                                                                       \
+    name v = {.data = NULL, .len = 0, .cap = 0, .guide = guide, .max = max};              \
+    if (n > 0)                                                                            \
+    {                                                                                     \
+      name##_grow(&v, n);                                                                 \
+      memcpy(v.data, src, n * sizeof(T));                                                 \
+      v.len = n;                                                                          \
+    }                                                                                     \
+    return v;                                                                             \
+  }                                                                                       \
+                                                                                          \
+  /* a checked element, by value so that any array expression can be indexed */          \
+  static inline T *name##_at(name v, int64_t i)                                           \
+  {                                                                                       \
+    return v.data + ezyrt_index(i, v.len);                                                \
+  }                                                                                       \
+                                                                                          \
+  static inline void name##_free(name *v)                                                 \
+  {                                                                                       \
+    ezyrt_free(v->data);                                                                  \
+    v->data = NULL;                                                                       \
+    v->len = 0;                                                                           \
+    v->cap = 0;                                                                           \
+  }                                                                                       \
+                                                                                          \
+  /* the array of a T[]? that is not null */                                              \
+  static inline name *name##_get(name *v)                                                 \
+  {                                                                                       \
+    if (v->len == SIZE_MAX)                                                               \
+      ezyrt_null_fail("array is null");                                                   \
+    return v;                                                                             \
+  }                                                                                       \
+                                                                                          \
+  /* boxed into a var, the copy shares the heap elements */                               \
+  static inline ezyrt_var name##_to_var(name v)                                           \
+  {                                                                                       \
+    if (v.len == SIZE_MAX)                                                                \
+      return ezyrt_var_null();                                                            \
+    return ezyrt_var_box(ezyrt_tag_array, &v, sizeof v);                                  \
+  }
+
+// ================ Small vectors ================
+// ezyrt_svec_define(name, T, N) keeps up to N elements inside the struct
+// (on the stack for locals) and moves them to the heap only when a push
+// needs more. With max <= N the heap is never used. There is no pointer
+// into the struct itself, so copies stay valid.
+
+#define ezyrt_svec_define(name, T, N)                                                    \
+  typedef struct name                                                                     \
+  {                                                                                       \
+    size_t len;                                                                           \
+    size_t cap; /* N while inline */                                                      \
+    size_t max;                                                                           \
+    T *heap;    /* NULL while inline */                                                   \
+    T buf[N];                                                                             \
+  } name;                                                                                 \
+                                                                                          \
+  static inline T *name##_data(name *v)                                                   \
+  {                                                                                       \
+    return v->heap != NULL ? v->heap : v->buf;                                            \
+  }                                                                                       \
+                                                                                          \
+  static inline void name##_grow(name *v, size_t need)                                    \
+  {                                                                                       \
+    if (v->max != 0 && need > v->max)                                                     \
+      ezyrt_vec_fail("array is full, max length", v->max);                                \
+    size_t cap = v->cap * 2;                                                              \
+    if (cap < need)                                                                       \
+      cap = need;                                                                         \
+    if (v->max != 0 && cap > v->max)                                                      \
+      cap = v->max;                                                                       \
+    if (cap > SIZE_MAX / sizeof(T))                                                       \
+      ezyrt_vec_fail("array too large, length", cap);                                     \
+    T *heap = (T *)ezyrt_realloc(v->heap, v->heap != NULL ? v->cap * sizeof(T) : 0,       \
+                                 cap * sizeof(T));                                        \
+    if (heap == NULL)                                                                     \
+      ezyrt_vec_fail("out of memory growing array to length", cap);                       \
+    if (v->heap == NULL)                                                                  \
+      memcpy(heap, v->buf, v->len * sizeof(T)); /* spill */                               \
+    v->heap = heap;                                                                       \
+    v->cap = cap;                                                                         \
+  }                                                                                       \
+                                                                                          \
+  static inline void name##_push(name *v, T x)                                            \
+  {                                                                                       \
+    if (v->len == v->cap)                                                                 \
+      name##_grow(v, v->len + 1);                                                         \
+    name##_data(v)[v->len++] = x;                                                         \
+  }                                                                                       \
+                                                                                          \
+  static inline name name##_from(size_t max, T const *src, size_t n)                      \
+  {                                                                                       \
+    name v = {.len = 0, .cap = N, .max = max, .heap = NULL};                              \
+    if (n > N)                                                                            \
+      name##_grow(&v, n);                                                                 \
+    memcpy(name##_data(&v), src, n * sizeof(T));                                          \
+    v.len = n;                                                                            \
+    return v;                                                                             \
+  }                                                                                       \
+                                                                                          \
+  /* a checked element */                                                                 \
+  static inline T *name##_at(name *v, int64_t i)                                          \
+  {                                                                                       \
+    return name##_data(v) + ezyrt_index(i, v->len);                                       \
+  }                                                                                       \
+                                                                                          \
+  static inline void name##_free(name *v)                                                 \
+  {                                                                                       \
+    ezyrt_free(v->heap);                                                                  \
+    v->heap = NULL;                                                                       \
+    v->len = 0;                                                                           \
+    v->cap = N;                                                                           \
+  }                                                                                       \
+                                                                                          \
+  /* the array of a T[]? that is not null */                                              \
+  static inline name *name##_get(name *v)                                                 \
+  {                                                                                       \
+    if (v->len == SIZE_MAX)                                                               \
+      ezyrt_null_fail("array is null");                                                   \
+    return v;                                                                             \
+  }                                                                                       \
+                                                                                          \
+  /* boxed into a var, the copy shares the heap elements */                               \
+  static inline ezyrt_var name##_to_var(name v)                                           \
+  {                                                                                       \
+    if (v.len == SIZE_MAX)                                                                \
+      return ezyrt_var_null();                                                            \
+    return ezyrt_var_box(ezyrt_tag_array, &v, sizeof v);                                  \
+  }
+
+#endif // ezyrt_vec_h
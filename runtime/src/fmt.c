@@ -0,0 +1,448 @@
+#include <ezyrt.h>
+#include <stdbool.h>
+
+#include "ryu_tables.h"
+
+// ================ Integers ================
+
+static const char ezyrt_digits2[201] =
+    "00010203040506070809"
+    "10111213141516171819"
+    "20212223242526272829"
+    "30313233343536373839"
+    "40414243444546474849"
+    "50515253545556575859"
+    "60616263646566676869"
+    "70717273747576777879"
+    "80818283848586878889"
+    "90919293949596979899";
+
+static inline unsigned ezyrt_decimal_len(uint64_t v)
+{
+  unsigned n = 1;
+  for (;;)
+  {
+    if (v < 10) return n;
+    if (v < 100) return n + 1;
+    if (v < 1000) return n + 2;
+    if (v < 10000) return n + 3;
+    v /= 10000;
+    n += 4;
+  }
+}
+
+// write exactly `len` digits of v ending at buf + len
+static inline void ezyrt_put_digits(char *buf, uint64_t v, unsigned len)
+{
+  char *p = buf + len;
+  while (v >= 100)
+  {
+    unsigned i = (unsigned)(v % 100) * 2;
+    v /= 100;
+    *--p = ezyrt_digits2[i + 1];
+    *--p = ezyrt_digits2[i];
+  }
+  if (v >= 10)
+  {
+    unsigned i = (unsigned)v * 2;
+    *--p = ezyrt_digits2[i + 1];
+    *--p = ezyrt_digits2[i];
+  }
+  else if (p > buf)
+  {
+    *--p = (char)('0' + v);
+  }
+}
+
+size_t ezyrt_fmt_u64(char *buf, uint64_t v)
+{
+  unsigned len = ezyrt_decimal_len(v);
+  ezyrt_put_digits(buf, v, len);
+  return len;
+}
+
+size_t ezyrt_fmt_i64(char *buf, int64_t v)
+{
+  if (v < 0)
+  {
+    *buf = '-';
+    return 1 + ezyrt_fmt_u64(buf + 1, 0 - (uint64_t)v);
+  }
+  return ezyrt_fmt_u64(buf, (uint64_t)v);
+}
+
+// ================ Doubles (Ryu) ================
+// Shortest round-trip digits after Ulf Adams, "Ryu: fast float-to-string
+// conversion" (PLDI 2018), full-table variant for IEEE binary64. A float
+// goes through the same steps with its own, narrower, rounding interval:
+// every binary32 value is m2 * 2^e2 within the range of the tables.
+
+#define ezyrt_mantissa_bits 52
+#define ezyrt_exponent_bits 11
+#define ezyrt_bias 1023
+
+static inline uint32_t ezyrt_pow5bits(int32_t e)
+{
+  // ceil(log2(5^e)) for e > 0, 1 for e == 0
+  return (uint32_t)(((uint32_t)e * 1217359) >> 19) + 1;
+}
+
+static inline uint32_t ezyrt_log10_pow2(int32_t e)
+{
+  return ((uint32_t)e * 78913) >> 18;
+}
+
+static inline uint32_t ezyrt_log10_pow5(int32_t e)
+{
+  return ((uint32_t)e * 732923) >> 20;
+}
+
+static inline uint32_t ezyrt_pow5_factor(uint64_t v)
+{
+  uint32_t count = 0;
+  while (v % 5 == 0)
+  {
+    v /= 5;
+    count++;
+  }
+  return count;
+}
+
+static inline bool ezyrt_multiple_of_pow5(uint64_t v, uint32_t p)
+{
+  return ezyrt_pow5_factor(v) >= p;
+}
+
+static inline bool ezyrt_multiple_of_pow2(uint64_t v, uint32_t p)
+{
+  return (v & ((1ull << p) - 1)) == 0;
+}
+
+// (m * mul) >> j for a 128-bit multiplier, j >= 64
+static inline uint64_t ezyrt_mul_shift64(uint64_t m, const uint64_t *mul, int32_t j)
+{
+#if defined(__SIZEOF_INT128__)
+  __uint128_t b0 = (__uint128_t)m * mul[0];
+  __uint128_t b2 = (__uint128_t)m * mul[1];
+  return (uint64_t)(((b0 >> 64) + b2) >> (j - 64));
+#else
+  // 64x64 -> 128 from 32-bit halves
+  uint64_t lo0, hi0, lo2, hi2;
+  {
+    uint64_t a = m, b = mul[0];
+    uint64_t al = (uint32_t)a, ah = a >> 32, bl = (uint32_t)b, bh = b >> 32;
+    uint64_t t0 = al * bl, t1 = ah * bl, t2 = al * bh, t3 = ah * bh;
+    uint64_t mid = (t0 >> 32) + (uint32_t)t1 + (uint32_t)t2;
+    lo0 = (mid << 32) | (uint32_t)t0;
+    hi0 = t3 + (t1 >> 32) + (t2 >> 32) + (mid >> 32);
+  }
+  {
+    uint64_t a = m, b = mul[1];
+    uint64_t al = (uint32_t)a, ah = a >> 32, bl = (uint32_t)b, bh = b >> 32;
+    uint64_t t0 = al * bl, t1 = ah * bl, t2 = al * bh, t3 = ah * bh;
+    uint64_t mid = (t0 >> 32) + (uint32_t)t1 + (uint32_t)t2;
+    lo2 = (mid << 32) | (uint32_t)t0;
+    hi2 = t3 + (t1 >> 32) + (t2 >> 32) + (mid >> 32);
+  }
+  (void)lo0;
+  uint64_t sum_lo = hi0 + lo2;
+  uint64_t sum_hi = hi2 + (sum_lo < hi0);
+  int32_t s = j - 64;
+  if (s == 0)
+    return sum_lo;
+  return (sum_hi << (64 - s)) | (sum_lo >> s);
+#endif
+}
+
+struct ezyrt_dec {
+  uint64_t digits;
+  int32_t exponent; // value = digits * 10^exponent
+};
+
+// value = m2 * 2^e2 (e2 already lowered by 2 for the interval), the
+// interval below is half as wide when m2 is the smallest of its binade
+static struct ezyrt_dec ezyrt_shortest(uint64_t m2, int32_t e2, uint32_t mm_shift)
+{
+  bool accept_bounds = (m2 & 1) == 0;
+
+  // step 2: the interval of values that round to this number
+  uint64_t mv = 4 * m2;
+
+  // step 3: convert to decimal
+  uint64_t vr, vp, vm;
+  int32_t e10;
+  bool vm_trailing_zeros = false;
+  bool vr_trailing_zeros = false;
+  if (e2 >= 0)
+  {
+    uint32_t q = ezyrt_log10_pow2(e2) - (e2 > 3);
+    e10 = (int32_t)q;
+    int32_t k = EZYRT_POW5_INV_BITCOUNT + (int32_t)ezyrt_pow5bits((int32_t)q) - 1;
+    int32_t i = -e2 + (int32_t)q + k;
+    vr = ezyrt_mul_shift64(4 * m2, ezyrt_pow5_inv_split[q], i);
+    vp = ezyrt_mul_shift64(4 * m2 + 2, ezyrt_pow5_inv_split[q], i);
+    vm = ezyrt_mul_shift64(4 * m2 - 1 - mm_shift, ezyrt_pow5_inv_split[q], i);
+    if (q <= 21)
+    {
+      // only one of mp, mv, mm can be a multiple of 5, if any
+      if (mv % 5 == 0)
+        vr_trailing_zeros = ezyrt_multiple_of_pow5(mv, q);
+      else if (accept_bounds)
+        vm_trailing_zeros = ezyrt_multiple_of_pow5(mv - 1 - mm_shift, q);
+      else
+        vp -= ezyrt_multiple_of_pow5(mv + 2, q);
+    }
+  }
+  else
+  {
+    uint32_t q = ezyrt_log10_pow5(-e2) - (-e2 > 1);
+    e10 = (int32_t)q + e2;
+    int32_t i = -e2 - (int32_t)q;
+    int32_t k = (int32_t)ezyrt_pow5bits(i) - EZYRT_POW5_BITCOUNT;
+    int32_t j = (int32_t)q - k;
+    vr = ezyrt_mul_shift64(4 * m2, ezyrt_pow5_split[i], j);
+    vp = ezyrt_mul_shift64(4 * m2 + 2, ezyrt_pow5_split[i], j);
+    vm = ezyrt_mul_shift64(4 * m2 - 1 - mm_shift, ezyrt_pow5_split[i], j);
+    if (q <= 1)
+    {
+      // mv has at least q trailing zero bits
+      vr_trailing_zeros = true;
+      if (accept_bounds)
+        vm_trailing_zeros = mm_shift == 1;
+      else
+        --vp;
+    }
+    else if (q < 63)
+    {
+      vr_trailing_zeros = ezyrt_multiple_of_pow2(mv, q);
+    }
+  }
+
+  // step 4: drop digits while the interval still holds a shorter number
+  int32_t removed = 0;
+  uint8_t last_removed = 0;
+  uint64_t output;
+  if (vm_trailing_zeros || vr_trailing_zeros)
+  {
+    // rare path, exact ties need the trailing-zero bookkeeping
+    while (vp / 10 > vm / 10)
+    {
+      vm_trailing_zeros &= vm % 10 == 0;
+      vr_trailing_zeros &= last_removed == 0;
+      last_removed = (uint8_t)(vr % 10);
+      vr /= 10;
+      vp /= 10;
+      vm /= 10;
+      removed++;
+    }
+    if (vm_trailing_zeros)
+    {
+      while (vm % 10 == 0)
+      {
+        vr_trailing_zeros &= last_removed == 0;
+        last_removed = (uint8_t)(vr % 10);
+        vr /= 10;
+        vp /= 10;
+        vm /= 10;
+        removed++;
+      }
+    }
+    if (vr_trailing_zeros && last_removed == 5 && vr % 2 == 0)
+      last_removed = 4; // exactly .5, round to even
+    output = vr + ((vr == vm && (!accept_bounds || !vm_trailing_zeros)) || last_removed >= 5);
+  }
+  else
+  {
+    bool round_up = false;
+    if (vp / 100 > vm / 100)
+    {
+      round_up = vr % 100 >= 50;
+      vr /= 100;
+      vp /= 100;
+      vm /= 100;
+      removed += 2;
+    }
+    while (vp / 10 > vm / 10)
+    {
+      round_up = vr % 10 >= 5;
+      vr /= 10;
+      vp /= 10;
+      vm /= 10;
+      removed++;
+    }
+    output = vr + (vr == vm || round_up);
+  }
+
+  return (struct ezyrt_dec){.digits = output, .exponent = e10 + removed};
+}
+
+static struct ezyrt_dec ezyrt_d2d(uint64_t ieee_mantissa, uint32_t ieee_exponent)
+{
+  if (ieee_exponent == 0)
+    return ezyrt_shortest(ieee_mantissa, 1 - ezyrt_bias - ezyrt_mantissa_bits - 2, 1);
+  return ezyrt_shortest((1ull << ezyrt_mantissa_bits) | ieee_mantissa,
+                        (int32_t)ieee_exponent - ezyrt_bias - ezyrt_mantissa_bits - 2,
+                        ieee_mantissa != 0 || ieee_exponent <= 1);
+}
+
+#define ezyrt_f32_mantissa_bits 23
+#define ezyrt_f32_exponent_bits 8
+#define ezyrt_f32_bias 127
+
+static struct ezyrt_dec ezyrt_f2d(uint32_t ieee_mantissa, uint32_t ieee_exponent)
+{
+  if (ieee_exponent == 0)
+    return ezyrt_shortest(ieee_mantissa, 1 - ezyrt_f32_bias - ezyrt_f32_mantissa_bits - 2, 1);
+  return ezyrt_shortest((1u << ezyrt_f32_mantissa_bits) | ieee_mantissa,
+                        (int32_t)ieee_exponent - ezyrt_f32_bias - ezyrt_f32_mantissa_bits - 2,
+                        ieee_mantissa != 0 || ieee_exponent <= 1);
+}
+
+// integers below 2^53 (2^24 for a float) skip Ryu, their digits are
+// exact already; value = m2 * 2^e2 with a normal m2 of `bits` bits
+static inline bool ezyrt_small_int(uint64_t m2, int32_t e2, int32_t bits, struct ezyrt_dec *d)
+{
+  if (e2 > 0 || e2 < -bits)
+    return false;
+  uint64_t mask = (1ull << -e2) - 1;
+  if ((m2 & mask) != 0)
+    return false; // has a fractional part
+  d->digits = m2 >> -e2;
+  d->exponent = 0;
+  // trailing zeros are dropped so formatting sees the shortest digits
+  while (d->digits % 10 == 0)
+  {
+    d->digits /= 10;
+    d->exponent++;
+  }
+  return true;
+}
+
+// nan, inf and zero: how many bytes were written, 0 for any other value
+static inline size_t ezyrt_fmt_special(char *buf, bool sign, bool max_exponent, bool zero_exponent, bool zero_mantissa)
+{
+  char *p = buf;
+  if (max_exponent && !zero_mantissa)
+  {
+    memcpy(p, "nan", 3);
+    return 3;
+  }
+  if (!max_exponent && !(zero_exponent && zero_mantissa))
+    return 0;
+  if (sign)
+    *p++ = '-';
+  if (max_exponent)
+  {
+    memcpy(p, "inf", 3);
+    p += 3;
+  }
+  else
+  {
+    *p++ = '0';
+  }
+  return (size_t)(p - buf);
+}
+
+// the digits of d at p, plain or scientific like printf's %g would pick
+static char *ezyrt_fmt_dec(char *p, struct ezyrt_dec d)
+{
+  unsigned len = ezyrt_decimal_len(d.digits);
+  // value = 0.DIGITS * 10^point
+  int32_t point = d.exponent + (int32_t)len;
+
+  if (point >= (int32_t)len && point <= 21)
+  {
+    // 1500 -> "1500"
+    ezyrt_put_digits(p, d.digits, len);
+    p += len;
+    for (int32_t i = (int32_t)len; i < point; i++)
+      *p++ = '0';
+  }
+  else if (point > 0 && point <= 21)
+  {
+    // 12.5 -> digits with a point inside
+    ezyrt_put_digits(p + 1, d.digits, len);
+    memmove(p, p + 1, (size_t)point);
+    p[point] = '.';
+    p += len + 1;
+  }
+  else if (point > -6 && point <= 0)
+  {
+    // 0.00125
+    *p++ = '0';
+    *p++ = '.';
+    for (int32_t i = point; i < 0; i++)
+      *p++ = '0';
+    ezyrt_put_digits(p, d.digits, len);
+    p += len;
+  }
+  else
+  {
+    // 1.25e+30, 5e-07
+    ezyrt_put_digits(p + 1, d.digits, len);
+    p[0] = p[1];
+    if (len > 1)
+    {
+      p[1] = '.';
+      p += len + 1;
+    }
+    else
+    {
+      p += 1;
+    }
+    int32_t e = point - 1;
+    *p++ = 'e';
+    *p++ = e < 0 ? '-' : '+';
+    uint32_t ae = (uint32_t)(e < 0 ? -e : e);
+    if (ae < 10)
+      *p++ = '0'; // two digits at least, like printf
+    p += ezyrt_fmt_u64(p, ae);
+  }
+  return p;
+}
+
+size_t ezyrt_fmt_f64(char *buf, double v)
+{
+  uint64_t bits;
+  memcpy(&bits, &v, sizeof(bits));
+  bool sign = (bits >> 63) != 0;
+  uint64_t ieee_mantissa = bits & ((1ull << ezyrt_mantissa_bits) - 1);
+  uint32_t ieee_exponent = (uint32_t)((bits >> ezyrt_mantissa_bits) & ((1u << ezyrt_exponent_bits) - 1));
+
+  size_t special = ezyrt_fmt_special(buf, sign, ieee_exponent == (1u << ezyrt_exponent_bits) - 1, ieee_exponent == 0,
+                                     ieee_mantissa == 0);
+  if (special > 0)
+    return special;
+
+  char *p = buf;
+  if (sign)
+    *p++ = '-';
+  struct ezyrt_dec d;
+  if (!ezyrt_small_int((1ull << ezyrt_mantissa_bits) | ieee_mantissa,
+                       (int32_t)ieee_exponent - ezyrt_bias - ezyrt_mantissa_bits, ezyrt_mantissa_bits, &d))
+    d = ezyrt_d2d(ieee_mantissa, ieee_exponent);
+  return (size_t)(ezyrt_fmt_dec(p, d) - buf);
+}
+
+size_t ezyrt_fmt_f32(char *buf, float v)
+{
+  uint32_t bits;
+  memcpy(&bits, &v, sizeof(bits));
+  bool sign = (bits >> 31) != 0;
+  uint32_t ieee_mantissa = bits & ((1u << ezyrt_f32_mantissa_bits) - 1);
+  uint32_t ieee_exponent = (bits >> ezyrt_f32_mantissa_bits) & ((1u << ezyrt_f32_exponent_bits) - 1);
+
+  size_t special = ezyrt_fmt_special(buf, sign, ieee_exponent == (1u << ezyrt_f32_exponent_bits) - 1,
+                                     ieee_exponent == 0, ieee_mantissa == 0);
+  if (special > 0)
+    return special;
+
+  char *p = buf;
+  if (sign)
+    *p++ = '-';
+  struct ezyrt_dec d;
+  if (!ezyrt_small_int((1u << ezyrt_f32_mantissa_bits) | ieee_mantissa,
+                       (int32_t)ieee_exponent - ezyrt_f32_bias - ezyrt_f32_mantissa_bits, ezyrt_f32_mantissa_bits, &d))
+    d = ezyrt_f2d(ieee_mantissa, ieee_exponent);
+  return (size_t)(ezyrt_fmt_dec(p, d) - buf);
+}
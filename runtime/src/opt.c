@@ -0,0 +1,44 @@
+#include <ezyrt_opt.h>
+#include <ezyrt_vec.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+void ezyrt_null_fail(const char *what)
+{
+  fprintf(stderr, "ezy: %s\n", what);
+  exit(EXIT_FAILURE); // runs the atexit flush of ezyrt_stdout
+}
+
+// ================ Sizes ================
+// Expected sizeof of every optional representation (x86-64 and AArch64).
+// Niches cost nothing, a flag costs the value's alignment, an array of
+// flagged values costs one bit per element.
+
+ezyrt_vec_define(ezyrt_size_vec, int32_t)
+ezyrt_optarr_define(ezyrt_size_optarr_i32_16, ezyrt_opt_i32, int32_t, 16)
+ezyrt_optarr_define(ezyrt_size_optarr_f64_8, ezyrt_opt_f64, double, 8)
+ezyrt_optarr_define(ezyrt_size_optarr_u8_64, ezyrt_opt_u8, uint8_t, 64)
+
+#define ezyrt_expect_size(T, n) _Static_assert(sizeof(T) == (n), "sizeof(" #T ") != " #n)
+
+// niches
+ezyrt_expect_size(ezyrt_opt_bool, 1);
+ezyrt_expect_size(ezyrt_str, 16);
+ezyrt_expect_size(ezyrt_var, 16);
+ezyrt_expect_size(ezyrt_size_vec, 5 * sizeof(size_t));
+// value + flag
+ezyrt_expect_size(ezyrt_opt_i8, 2);
+ezyrt_expect_size(ezyrt_opt_u8, 2);
+ezyrt_expect_size(ezyrt_opt_char, 2);
+ezyrt_expect_size(ezyrt_opt_i16, 4);
+ezyrt_expect_size(ezyrt_opt_u16, 4);
+ezyrt_expect_size(ezyrt_opt_i32, 8);
+ezyrt_expect_size(ezyrt_opt_u32, 8);
+ezyrt_expect_size(ezyrt_opt_f32, 8);
+ezyrt_expect_size(ezyrt_opt_i64, 16);
+ezyrt_expect_size(ezyrt_opt_u64, 16);
+ezyrt_expect_size(ezyrt_opt_f64, 16);
+// bitmap arrays, vs 128, 128 and 128 bytes as arrays of flagged values
+ezyrt_expect_size(ezyrt_size_optarr_i32_16, 16 * 4 + 4);
+ezyrt_expect_size(ezyrt_size_optarr_f64_8, 8 * 8 + 8);
+ezyrt_expect_size(ezyrt_size_optarr_u8_64, 64 + 8);
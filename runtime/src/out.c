@@ -0,0 +1,116 @@
+#if !defined(_WIN32)
+#define _POSIX_C_SOURCE 200809L
+#endif
+
+#include <ezyrt.h>
+#include <errno.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#if defined(_WIN32)
+#include <io.h>
+#define ezyrt_os_write(fd, p, n) _write((fd), (p), (unsigned)(n))
+#else
+#include <unistd.h>
+#define ezyrt_os_write(fd, p, n) write((fd), (p), (n))
+#endif
+
+struct ezyrt_out ezyrt_stdout = {
+    .pos = ezyrt_stdout.buf,
+    .end = ezyrt_stdout.buf, // empty until ezyrt_setup, so the first write lands in the slow path
+};
+
+static bool ezyrt_ready = false;
+
+static void ezyrt_write_fd(const char *p, size_t n)
+{
+  while (n > 0)
+  {
+    long w = (long)ezyrt_os_write(1, p, n);
+    if (w < 0)
+    {
+      if (errno == EINTR)
+        continue;
+      return; // nowhere to report to, drop the output like stdio would
+    }
+    p += w;
+    n -= (size_t)w;
+  }
+}
+
+void ezyrt_flush(void)
+{
+  size_t n = (size_t)(ezyrt_stdout.pos - ezyrt_stdout.buf);
+  ezyrt_stdout.pos = ezyrt_stdout.buf;
+  if (n > 0)
+  {
+    fflush(stdout); // keep ordering with anything printed through stdio
+    ezyrt_write_fd(ezyrt_stdout.buf, n);
+  }
+}
+
+static void ezyrt_setup(void)
+{
+  ezyrt_ready = true;
+  ezyrt_stdout.pos = ezyrt_stdout.buf;
+  ezyrt_stdout.end = ezyrt_stdout.buf + ezyrt_out_size;
+  atexit(ezyrt_flush);
+}
+
+char *ezyrt_reserve_slow(size_t n)
+{
+  if (!ezyrt_ready)
+    ezyrt_setup();
+  if ((size_t)(ezyrt_stdout.end - ezyrt_stdout.pos) < n)
+    ezyrt_flush();
+  if (n > ezyrt_out_size)
+    return NULL;
+  return ezyrt_stdout.pos;
+}
+
+void ezyrt_write_slow(const char *s, size_t n)
+{
+  char *dst = ezyrt_reserve_slow(n);
+  if (dst == NULL)
+  {
+    // larger than the whole buffer, skip the copy
+    ezyrt_write_fd(s, n);
+    return;
+  }
+  memcpy(dst, s, n);
+  ezyrt_stdout.pos += n;
+}
+
+// ================ Typed writers ================
+
+static inline char *ezyrt_reserve(size_t n)
+{
+  if ((size_t)(ezyrt_stdout.end - ezyrt_stdout.pos) >= n)
+    return ezyrt_stdout.pos;
+  return ezyrt_reserve_slow(n);
+}
+
+void ezyrt_write_i64(int64_t v)
+{
+  char *dst = ezyrt_reserve(ezyrt_fmt_i64_max);
+  ezyrt_stdout.pos += ezyrt_fmt_i64(dst, v);
+}
+
+void ezyrt_write_u64(uint64_t v)
+{
+  char *dst = ezyrt_reserve(ezyrt_fmt_u64_max);
+  ezyrt_stdout.pos += ezyrt_fmt_u64(dst, v);
+}
+
+void ezyrt_write_f64(double v)
+{
+  char *dst = ezyrt_reserve(ezyrt_fmt_f64_max);
+  ezyrt_stdout.pos += ezyrt_fmt_f64(dst, v);
+}
+
+void ezyrt_write_f32(float v)
+{
+  char *dst = ezyrt_reserve(ezyrt_fmt_f64_max);
+  ezyrt_stdout.pos += ezyrt_fmt_f32(dst, v);
+}
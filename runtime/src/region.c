@@ -0,0 +1,115 @@
+#include <ezyrt_region.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+_Thread_local ezyrt_region ezyrt_region_tls;
+
+ezyrt_region_mark ezyrt_region_enter(void)
+{
+  ezyrt_region *r = &ezyrt_region_tls;
+  r->depth++;
+  return (ezyrt_region_mark){.block = r->current, .used = r->current != NULL ? r->current->used : 0};
+}
+
+void ezyrt_region_leave(ezyrt_region_mark mark)
+{
+  ezyrt_region *r = &ezyrt_region_tls;
+  // blocks filled since the mark become spares, in place
+  ezyrt_region_block *b = mark.block != NULL ? mark.block->next : r->first;
+  for (; b != NULL && r->current != NULL && b != r->current->next; b = b->next)
+    b->used = 0;
+  if (mark.block != NULL)
+  {
+    mark.block->used = mark.used;
+    r->current = mark.block;
+  }
+  else
+  {
+    r->current = r->first;
+  }
+  r->depth--;
+}
+
+void ezyrt_region_trim(void)
+{
+  ezyrt_region *r = &ezyrt_region_tls;
+  if (r->depth != 0)
+    return;
+  for (ezyrt_region_block *b = r->first; b != NULL;)
+  {
+    ezyrt_region_block *next = b->next;
+    free(b);
+    b = next;
+  }
+  *r = (ezyrt_region){0};
+}
+
+static _Noreturn void ezyrt_region_fail(size_t n)
+{
+  fprintf(stderr, "ezy: out of memory allocating %zu bytes in a region\n", n);
+  exit(EXIT_FAILURE); // runs the atexit flush of ezyrt_stdout
+}
+
+void *ezyrt_region_alloc_slow(size_t n)
+{
+  ezyrt_region *r = &ezyrt_region_tls;
+  if (n > SIZE_MAX / 2 - sizeof(ezyrt_region_block))
+    ezyrt_region_fail(n);
+  // a spare block that fits, else a new one after the current block:
+  // twice the last size, so a region needs O(log n) blocks
+  ezyrt_region_block *b = r->current != NULL ? r->current->next : r->first;
+  if (b == NULL || b->size < n)
+  {
+    size_t size = r->current != NULL ? r->current->size * 2 : ezyrt_region_block_min;
+    if (size < n)
+      size = n;
+    ezyrt_region_block *fresh = malloc(sizeof(ezyrt_region_block) + size);
+    if (fresh == NULL)
+      ezyrt_region_fail(n);
+    fresh->size = size;
+    fresh->used = 0;
+    fresh->next = b;
+    if (r->current != NULL)
+      r->current->next = fresh;
+    else
+      r->first = fresh;
+    b = fresh;
+  }
+  r->current = b;
+  b->used = n;
+  return b->data;
+}
+
+bool ezyrt_region_owns(const void *p)
+{
+  const ezyrt_region *r = &ezyrt_region_tls;
+  const char *c = p;
+  if (r->current == NULL)
+    return false;
+  for (const ezyrt_region_block *b = r->first; b != NULL; b = b->next)
+  {
+    // pointer comparison across objects, fine on flat address spaces
+    if ((uintptr_t)c >= (uintptr_t)b->data && (uintptr_t)c < (uintptr_t)(b->data + b->used))
+      return true;
+    if (b == r->current)
+      break;
+  }
+  return false;
+}
+
+void *ezyrt_realloc_slow(void *p, size_t old_size, size_t n)
+{
+  if (!ezyrt_region_owns(p))
+    return realloc(p, n); // heap memory from before the region stays heap
+  ezyrt_region_block *b = ezyrt_region_tls.current;
+  if ((char *)p + old_size == b->data + b->used && n <= b->size - ((char *)p - b->data))
+  {
+    // the newest allocation grows in place
+    b->used = (size_t)((char *)p - b->data) + n;
+    return p;
+  }
+  void *q = ezyrt_alloc(n);
+  memcpy(q, p, old_size < n ? old_size : n);
+  return q;
+}
@@ -0,0 +1,138 @@
+#include <ezyrt_region.h>
+#include <ezyrt_str.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+static _Noreturn void ezyrt_str_fail(const char *what, size_t n)
+{
+  fprintf(stderr, "ezy: %s %zu\n", what, n);
+  exit(EXIT_FAILURE); // runs the atexit flush of ezyrt_stdout
+}
+
+static inline ezyrt_str ezyrt_str_inline(const char *p, size_t n)
+{
+  ezyrt_str s;
+  memset(s.bytes, 0, sizeof s.bytes);
+  if (n > 0)
+    memcpy(s.bytes, p, n);
+  s.bytes[15] = (char)n;
+  return s;
+}
+
+// `n` bytes and a NUL on the heap
+static char *ezyrt_str_alloc(size_t n)
+{
+  if (n >= ezyrt_str_slice_bit - 1)
+    ezyrt_str_fail("string too long, length", n);
+  char *p = ezyrt_alloc(n + 1);
+  if (p == NULL)
+    ezyrt_str_fail("out of memory allocating a string of length", n);
+  p[n] = '\0';
+  return p;
+}
+
+ezyrt_str ezyrt_str_from(const char *p, size_t n)
+{
+  if (n <= ezyrt_str_inline_max)
+    return ezyrt_str_inline(p, n);
+  char *copy = ezyrt_str_alloc(n);
+  memcpy(copy, p, n);
+  return ezyrt_str_slice(copy, n);
+}
+
+const char *ezyrt_str_cstr_slow(const ezyrt_str *s)
+{
+  size_t n = ezyrt_str_len(*s);
+  char *copy = ezyrt_str_alloc(n);
+  memcpy(copy, ezyrt_str_data(s), n);
+  return copy;
+}
+
+// ================ Building ================
+
+void ezyrt_strbuf_reserve(ezyrt_strbuf *b, size_t n)
+{
+  // one byte more for the NUL of the finished slice
+  if (b->cap - b->len > n)
+    return;
+  if (n >= ezyrt_str_slice_bit - 1 - b->len)
+    ezyrt_str_fail("string too long, length", b->len);
+  size_t cap = b->cap * 2; // the first allocation is exact
+  if (cap < b->len + n + 1)
+    cap = b->len + n + 1;
+  char *data = ezyrt_realloc(b->data, b->cap, cap);
+  if (data == NULL)
+    ezyrt_str_fail("out of memory growing a string to length", cap);
+  b->data = data;
+  b->cap = cap;
+}
+
+void ezyrt_strbuf_append(ezyrt_strbuf *b, const char *p, size_t n)
+{
+  ezyrt_strbuf_reserve(b, n);
+  memcpy(b->data + b->len, p, n);
+  b->len += n;
+}
+
+ezyrt_str ezyrt_strbuf_finish(ezyrt_strbuf *b)
+{
+  ezyrt_str s;
+  if (b->len <= ezyrt_str_inline_max)
+  {
+    s = ezyrt_str_inline(b->data, b->len);
+    ezyrt_free(b->data);
+  }
+  else
+  {
+    b->data[b->len] = '\0';
+    s = ezyrt_str_slice(b->data, b->len);
+  }
+  *b = (ezyrt_strbuf){0};
+  return s;
+}
+
+ezyrt_str ezyrt_str_concat(const ezyrt_str *parts, size_t n)
+{
+  return ezyrt_str_concat_in(NULL, 0, parts, n);
+}
+
+ezyrt_str ezyrt_str_concat_in(char *buf, size_t cap, const ezyrt_str *parts, size_t n)
+{
+  size_t total = 0;
+  for (size_t i = 0; i < n; i++)
+  {
+    size_t len = ezyrt_str_len(parts[i]);
+    if (len >= ezyrt_str_slice_bit - 1 - total)
+      ezyrt_str_fail("string too long, length", total);
+    total += len;
+  }
+  // short results are built in place, no allocation
+  ezyrt_str s;
+  char *dst;
+  if (total <= ezyrt_str_inline_max)
+  {
+    memset(s.bytes, 0, sizeof s.bytes);
+    s.bytes[15] = (char)total;
+    dst = s.bytes;
+  }
+  else
+  {
+    if (total < cap)
+    {
+      dst = buf;
+      dst[total] = '\0';
+    }
+    else
+    {
+      dst = ezyrt_str_alloc(total);
+    }
+    s = ezyrt_str_slice(dst, total);
+  }
+  for (size_t i = 0, at = 0; i < n; i++)
+  {
+    size_t len = ezyrt_str_len(parts[i]);
+    memcpy(dst + at, ezyrt_str_data(&parts[i]), len);
+    at += len;
+  }
+  return s;
+}
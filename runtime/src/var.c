@@ -0,0 +1,165 @@
+#include <ezyrt.h>
+#include <ezyrt_region.h>
+#include <ezyrt_var.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const char *ezyrt_tag_name(uint8_t tag)
+{
+  switch (tag)
+  {
+  case ezyrt_tag_null: return "null";
+  case ezyrt_tag_bool: return "bool";
+  case ezyrt_tag_i8: return "int8";
+  case ezyrt_tag_u8: return "uint8";
+  case ezyrt_tag_i16: return "int16";
+  case ezyrt_tag_u16: return "uint16";
+  case ezyrt_tag_i32: return "int32";
+  case ezyrt_tag_u32: return "uint32";
+  case ezyrt_tag_i64: return "int64";
+  case ezyrt_tag_u64: return "uint64";
+  case ezyrt_tag_f32: return "float32";
+  case ezyrt_tag_f64: return "float64";
+  case ezyrt_tag_string: return "string";
+  case ezyrt_tag_array: return "array";
+  case ezyrt_tag_char: return "char";
+  default: return "?";
+  }
+}
+
+void ezyrt_var_fail(const char *what, ezyrt_var v)
+{
+  fprintf(stderr, "ezy: %s %s\n", what, ezyrt_tag_name(v.tag));
+  exit(EXIT_FAILURE); // runs the atexit flush of ezyrt_stdout
+}
+
+void ezyrt_union_fail(const char *name, uint8_t want, uint8_t held)
+{
+  fprintf(stderr, "ezy: union %s holds %s, not %s\n", name, ezyrt_tag_name(held), ezyrt_tag_name(want));
+  exit(EXIT_FAILURE);
+}
+
+ezyrt_var ezyrt_var_box(uint8_t tag, const void *src, size_t size)
+{
+  ezyrt_var v = {.tag = tag};
+  v.as.box = ezyrt_alloc(size != 0 ? size : 1);
+  if (v.as.box == NULL)
+    ezyrt_var_fail("out of memory boxing", v);
+  memcpy(v.as.box, src, size);
+  return v;
+}
+
+ezyrt_var ezyrt_var_str_slow(ezyrt_str s)
+{
+  ezyrt_var v = {.tag = ezyrt_tag_string};
+  size_t n = ezyrt_str_len(s);
+  if (n > UINT32_MAX)
+    ezyrt_var_fail("string too long for", v);
+  if (ezyrt_str_is_inline(s))
+    s = ezyrt_str_slice(ezyrt_str_cstr_slow(&s), n); // heap copy, still NUL terminated
+  v.as.s = s.slice.ptr;
+  v.len = (uint32_t)n;
+  return v;
+}
+
+void ezyrt_write_var(ezyrt_var v)
+{
+  switch (v.tag)
+  {
+  case ezyrt_tag_null:
+    ezyrt_write("null", 4);
+    break;
+  case ezyrt_tag_bool:
+    ezyrt_write_str(v.as.u ? "true" : "false");
+    break;
+  case ezyrt_tag_char:
+    ezyrt_write_char((char)v.as.u);
+    break;
+  case ezyrt_tag_f32:
+    ezyrt_write_f32((float)v.as.f);
+    break;
+  case ezyrt_tag_f64:
+    ezyrt_write_f64(v.as.f);
+    break;
+  case ezyrt_tag_string:
+    ezyrt_write(v.as.s, v.len);
+    break;
+  case ezyrt_tag_array:
+    ezyrt_write("[array]", 7);
+    break;
+  default:
+    if (ezyrt_tag_is_signed(v.tag))
+      ezyrt_write_i64(v.as.i);
+    else
+      ezyrt_write_u64(v.as.u);
+    break;
+  }
+}
+
+// ================ Arithmetic ================
+
+static ezyrt_var ezyrt_var_float_op(char op, double a, double b)
+{
+  switch (op)
+  {
+  case '+': return ezyrt_var_f64(a + b);
+  case '-': return ezyrt_var_f64(a - b);
+  case '*': return ezyrt_var_f64(a * b);
+  default: return ezyrt_var_f64(a / b);
+  }
+}
+
+ezyrt_var ezyrt_var_arith_slow(char op, ezyrt_var a, ezyrt_var b)
+{
+  bool a_num = ezyrt_tag_is_int(a.tag) || ezyrt_tag_is_float(a.tag);
+  bool b_num = ezyrt_tag_is_int(b.tag) || ezyrt_tag_is_float(b.tag);
+  if (!a_num || !b_num)
+    ezyrt_var_fail("arithmetic on a non-number:", a_num ? b : a);
+
+  if (op == '%')
+  {
+    if (!ezyrt_tag_is_int(a.tag) || !ezyrt_tag_is_int(b.tag))
+      ezyrt_var_fail("% needs integers, var holds", ezyrt_tag_is_int(a.tag) ? b : a);
+    uint8_t tag = ezyrt_tag_promote_int(a.tag, b.tag);
+    if (b.as.u == 0)
+      ezyrt_var_fail("modulo by zero of", a);
+    if (tag == ezyrt_tag_u32 || tag == ezyrt_tag_u64)
+      return ezyrt_var_int(tag, tag == ezyrt_tag_u32 ? (uint32_t)a.as.u % (uint32_t)b.as.u : a.as.u % b.as.u);
+    if (b.as.i == -1)
+      return ezyrt_var_int(tag, 0); // INT_MIN % -1 traps in C
+    return ezyrt_var_int(tag, (uint64_t)(a.as.i % b.as.i));
+  }
+
+  if (ezyrt_tag_is_int(a.tag) && ezyrt_tag_is_int(b.tag) && op != '/')
+  {
+    // wrapping, like the inline fast paths
+    uint64_t r = op == '+' ? a.as.u + b.as.u : op == '-' ? a.as.u - b.as.u : a.as.u * b.as.u;
+    return ezyrt_var_int(ezyrt_tag_promote_int(a.tag, b.tag), r);
+  }
+
+  ezyrt_var r = ezyrt_var_float_op(op, ezyrt_var_as_f64(a), ezyrt_var_as_f64(b));
+  if (a.tag != ezyrt_tag_f64 && b.tag != ezyrt_tag_f64 && (a.tag == ezyrt_tag_f32 || b.tag == ezyrt_tag_f32))
+    return ezyrt_var_f32((float)r.as.f);
+  return r;
+}
+
+bool ezyrt_var_eq_slow(ezyrt_var a, ezyrt_var b)
+{
+  if (a.tag == ezyrt_tag_string && b.tag == ezyrt_tag_string)
+    return a.len == b.len && (a.as.s == b.as.s || memcmp(a.as.s, b.as.s, a.len) == 0);
+  if (ezyrt_tag_is_float(a.tag) || ezyrt_tag_is_float(b.tag))
+  {
+    bool a_num = ezyrt_tag_is_int(a.tag) || ezyrt_tag_is_float(a.tag);
+    bool b_num = ezyrt_tag_is_int(b.tag) || ezyrt_tag_is_float(b.tag);
+    return a_num && b_num && ezyrt_var_as_f64(a) == ezyrt_var_as_f64(b);
+  }
+  if (ezyrt_tag_is_int(a.tag) && ezyrt_tag_is_int(b.tag))
+  {
+    // a negative value never equals an unsigned one
+    bool a_neg = ezyrt_tag_is_signed(a.tag) && a.as.i < 0;
+    bool b_neg = ezyrt_tag_is_signed(b.tag) && b.as.i < 0;
+    return a_neg == b_neg && a.as.u == b.as.u;
+  }
+  return a.tag == b.tag && a.as.u == b.as.u; // null, bool, arrays
+}
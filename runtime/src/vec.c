@@ -0,0 +1,16 @@
+#include <ezyrt.h>
+#include <ezyrt_vec.h>
+#include <inttypes.h>
+#include <stdio.h>
+
+void ezyrt_vec_fail(const char *what, size_t n)
+{
+  fprintf(stderr, "ezy: %s %zu\n", what, n);
+  exit(EXIT_FAILURE); // runs the atexit flush of ezyrt_stdout
+}
+
+void ezyrt_index_fail(int64_t i, size_t n)
+{
+  fprintf(stderr, "ezy: index %" PRId64 " out of range for length %zu\n", i, n);
+  exit(EXIT_FAILURE);
+}
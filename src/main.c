@@ -1,39 +1,63 @@
+#if !defined(_WIN32)
+#define _POSIX_C_SOURCE 200809L
+#endif
+
 #include <ezy_lexer.h>
+#include <errno.h>
 #include <stdlib.h>
+#include <string.h>
+#include <ezy_ast_walk.h>
+#include <ezy_cache.h>
+#include <ezy_compile.h>
+#include <ezy_daemon.h>
 #include <ezy_log.h>
+#include <ezy_output.h>
 #include <ezy_parser.h>
 #include <ezy_parser_arena.h>
+#include <ezy_project.h>
+#include <ezy_report.h>
+#include <ezy_sema.h>
 #include <ezy_transpile_c.h>
+#include <ezy_vm.h>
+#include <ezy_x64.h>
+
+#if !defined(_WIN32)
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
 
-void print_ast_node(ezy_ast_node_t* node, int indent) {
-  for (int i = 0; i < indent * 2; i++) {
-    ezy_log_raw("  ");
+// indentation is capped so very deep trees do not print quadratic whitespace
+#define print_ast_max_indent 64
+
+static void print_ast_indent(size_t depth) {
+  static const char spaces[] = "                                                                "
+                               "                                                                "
+                               "                                                                "
+                               "                                                                ";
+  if (depth > print_ast_max_indent) {
+    depth = print_ast_max_indent;
   }
+  ezy_log_raw("%.*s", (int)(depth * 4), spaces);
+}
+
+static enum ezywalk_action print_ast_pre(struct ezywalk_t* w, ezy_ast_node_t* node) {
+  print_ast_indent(w->depth);
   switch (node->type) {
     case ezy_ast_node_variable:
-      ezy_log_raw("Variable(name: %.*s, type: %d", node->data.n_variable.name.len, node->data.n_variable.name.ptr, node->data.n_variable.typ.typ);
-      if (node->data.n_variable.value) {
-        ezy_log_raw(", value: \n");
-        print_ast_node(node->data.n_variable.value, indent + 1);
-        for (int i = 0; i < indent * 2; i++) {
-          ezy_log_raw("  ");
-        }
-        ezy_log_raw(")\n");
-      } else {
-        ezy_log_raw(", value: NULL)\n");
-      }
+      ezy_log_raw("Variable(name: %.*s, type: %d)\n", (int)node->data.n_variable.name.len, node->data.n_variable.name.ptr, node->eval_typ.typ);
       break;
     case ezy_ast_node_literal:
       ezy_log_raw("Literal(");
       switch (node->data.n_literal.typ) {
+        case ezy_ast_dt_int32:
         case ezy_ast_dt_int64:
-          ezy_log_raw("int64: %lld", node->data.n_literal.value.t_int64);
+          ezy_log_raw("int%d: %lld", node->data.n_literal.typ == ezy_ast_dt_int32 ? 32 : 64, (long long)node->data.n_literal.value.t_int64);
           break;
         case ezy_ast_dt_uint64:
           ezy_log_raw("uint64: %llu", (unsigned long long)node->data.n_literal.value.t_uint64);
           break;
         case ezy_ast_dt_string:
-          ezy_log_raw("string: \"%.*s\"", node->data.n_literal.value.t_string.len, node->data.n_literal.value.t_string.ptr);
+          ezy_log_raw("string: \"%.*s\"", (int)node->data.n_literal.value.t_string.len, node->data.n_literal.value.t_string.ptr);
           break;
         case ezy_ast_dt_float64:
           ezy_log_raw("float64: %g", node->data.n_literal.value.t_float64);
@@ -45,63 +69,371 @@ void print_ast_node(ezy_ast_node_t* node, int indent) {
       ezy_log_raw(")\n");
       break;
     case ezy_ast_node_binop:
-      ezy_log_raw("BinaryOperator(operator: %d, left: \n", node->data.n_binop.operator);
-      if (node->data.n_binop.left != NULL) {
-        print_ast_node(node->data.n_binop.left, indent + 1);
-      }
-      if ( node-> data.n_binop.right != NULL )
-      {
-        for (int i = 0; i < indent * 2; i++) {
-          ezy_log_raw("  ");
-        }
-        ezy_log_raw(", right: \n");
-        print_ast_node(node->data.n_binop.right, indent + 1);
-      }
-      for (int i = 0; i < indent * 2; i++) {
-        ezy_log_raw("  ");
-      }
-      ezy_log_raw(")\n");
+      ezy_log_raw("BinaryOperator(operator: %d, type: %d, left: \n", node->data.n_binop.operator, node->eval_typ.typ);
       break;
     case ezy_ast_node_variable_decl:
-      ezy_log_raw("DeclVariable(isConst: %s, type: %d, value: \n", node->data.n_variable.typ.is_const ? "true" : "false", node->data.n_variable.typ.typ);
-      print_ast_node(node->data.n_variable.value, indent + 1);
+      ezy_log_raw("DeclVariable(name: %.*s, isConst: %s, type: %d, value: \n", (int)node->data.n_variable.name.len, node->data.n_variable.name.ptr,
+        node->data.n_variable.typ.is_const ? "true" : "false", node->data.n_variable.typ.typ);
       break;
     case ezy_ast_node_function:
       ezy_log_raw("Function(");
-      ezy_log_raw("name: %.*s, return_type: %d, params: ", node->data.n_function->name.len, node->data.n_function->name.ptr, node->data.n_function->return_typ.typ);
-      for (int i = 0; i < node->data.n_function->param_count; i++) {
+      ezy_log_raw("name: %.*s, return_type: %d, params: ", (int)node->data.n_function->name.len, node->data.n_function->name.ptr, node->data.n_function->return_typ.typ);
+      for (size_t i = 0; i < node->data.n_function->param_count; i++) {
         ezy_log_raw("%d:", node->data.n_function->params[i].typ.typ);
-        ezy_log_raw("%.*s ", node->data.n_function->params[i].name.len, node->data.n_function->params[i].name.ptr);
+        ezy_log_raw("%.*s ", (int)node->data.n_function->params[i].name.len, node->data.n_function->params[i].name.ptr);
       }
       ezy_log_raw("):\n");
-      print_ast_node(node->data.n_function->body, indent + 1);
       break;
     case ezy_ast_node_call:
-      ezy_log_raw("FunctionCall(name: %.*s, args: \n", node->data.n_call->func_name.len, node->data.n_call->func_name.ptr);
-      for (size_t i = 0; i < node->data.n_call->arg_count; i++) {
-        print_ast_node(&node->data.n_call->args[i], indent + 1);
-      }
-      for (int i = 0; i < indent * 2; i++) {
-        ezy_log_raw("  ");
-      }
-      ezy_log_raw(")\n");
+      ezy_log_raw("FunctionCall(name: %.*s, type: %d, args: \n", (int)node->data.n_call->func_name.len, node->data.n_call->func_name.ptr, node->eval_typ.typ);
+      break;
+    case ezy_ast_node_return:
+      ezy_log_raw("Return(type: %d, value: \n", node->eval_typ.typ);
       break;
     default:
-      ezy_log("Other Node Type: %d\n", node->type);
+      ezy_log_raw("Other Node Type: %d\n", node->type);
       break;
   }
-  if (node->next) {
-    print_ast_node(node->next, indent);
+  return ezywalk_continue;
+}
+
+static enum ezywalk_action print_ast_child(struct ezywalk_t* w, ezy_ast_node_t* node, size_t child) {
+  if (node->type == ezy_ast_node_binop && child == 1) {
+    print_ast_indent(w->depth);
+    ezy_log_raw(", right: \n");
   }
+  return ezywalk_continue;
 }
 
-int main(int argc, const char** argv) {
-  ezy_log("start of program");
-  if ( argc < 2 ) {
+static enum ezywalk_action print_ast_post(struct ezywalk_t* w, ezy_ast_node_t* node) {
+  switch (node->type) {
+    case ezy_ast_node_binop:
+    case ezy_ast_node_variable_decl:
+    case ezy_ast_node_call:
+    case ezy_ast_node_return:
+      print_ast_indent(w->depth);
+      ezy_log_raw(")\n");
+      break;
+    default:
+      break;
+  }
+  return ezywalk_continue;
+}
+
+void print_ast(ezy_ast_node_t* root) {
+  struct ezywalk_t w = {
+    .pre = print_ast_pre,
+    .child = print_ast_child,
+    .post = print_ast_post,
+  };
+  ezywalk_list(&w, root);
+  ezywalk_release(&w);
+}
+
+struct ezc_options {
+  const char** inputs; // several: the modules of one program
+  size_t input_count;
+  const char* output; // NULL: dump to the log, "-": stdout
+  unsigned output_flags;
+  bool dump_layout; // struct layouts to stdout (stderr if the C goes there)
+  bool emit_obj;    // an x86-64 ELF object instead of C
+  bool run;         // `ezc run`: interpret as bytecode, no output file
+  bool build;       // `ezc build`: an executable through the C compiler
+  bool timings;     // stage times of `ezc build`
+  bool cache;       // `ezc build` through the object cache
+  bool cache_stats; // `ezc cache`: print the cache counters
+  const char* cache_dir; // NULL: see ezycache_open
+  uint64_t cache_max;    // bytes, 0 for the default
+  const char** cc_flags; // passed to the C compiler by `ezc build`
+  size_t cc_flag_count;
+  struct ezytranspile_opts transpile;
+  struct ezyreport report; // --time-report[=json] when report.on
+};
+
+// options of the C compiler `ezc build` passes through
+static bool is_cc_flag(const char* arg) {
+  return strncmp(arg, "-O", 2) == 0 || strncmp(arg, "-march=", 7) == 0 || strncmp(arg, "-mtune=", 7) == 0 ||
+         strncmp(arg, "-flto", 5) == 0 || strcmp(arg, "-g") == 0 || strcmp(arg, "-static") == 0;
+}
+
+static void print_usage(void) {
+  ezy_log_raw("\nusage: ezc run [--time-report[=json]] <input.ez>...\n");
+  ezy_log_raw("       ezc build [-o <executable>] [-O<n>] [-march=<cpu>] [-flto] [-g] [--timings] [-j <threads>]\n");
+  ezy_log_raw("                 [--cache|--no-cache] [--cache-dir=<dir>] [--cache-max=<MiB>] [--time-report[=json]] <input.ez>...\n");
+  ezy_log_raw("       ezc cache [--cache-dir=<dir>]\n");
+  ezy_log_raw("       ezc --daemon [--socket=<path>]   (clients: EZY_DAEMON=<path> ezc ...)\n");
+  ezy_log_raw("       ezc [-o <file.c>|-] [--emit=c|obj] [--atomic] [-j <threads>] [--small-array <n>] [--checks=off|on|elide] [--dump-layout]\n");
+  ezy_log_raw("           [--time-report[=json]] <input.ez>...\n");
+}
+
+static bool parse_options(int argc, const char** argv, struct ezc_options* opts) {
+  *opts = (struct ezc_options){
+    .transpile = {.jobs = 1, .small_array_max = ezytranspile_small_array_default},
+  };
+  opts->inputs = malloc((size_t)argc * sizeof *opts->inputs);
+  if (opts->inputs == NULL) {
+    ezy_log_error("failed to allocate the input list");
+    return false;
+  }
+  int first = 1;
+  if (argc > 1 && strcmp(argv[1], "run") == 0) {
+    opts->run = true;
+    first = 2;
+  } else if (argc > 1 && strcmp(argv[1], "build") == 0) {
+    opts->build = true;
+    first = 2;
+    opts->cc_flags = malloc((size_t)argc * sizeof *opts->cc_flags);
+    if (opts->cc_flags == NULL) {
+      ezy_log_error("failed to allocate the compiler flags");
+      return false;
+    }
+    // a configured cache directory turns the cache on
+    const char* dir = getenv("EZY_CACHE_DIR");
+    opts->cache = dir != NULL && dir[0] != '\0';
+  } else if (argc > 1 && strcmp(argv[1], "cache") == 0) {
+    opts->cache_stats = true;
+    first = 2;
+  }
+  for (int i = first; i < argc; i++) {
+    const char* arg = argv[i];
+    if (strcmp(arg, "-o") == 0) {
+      if (i + 1 >= argc) {
+        ezy_log_error("-o expects a file name or '-'");
+        return false;
+      }
+      opts->output = argv[++i];
+    } else if (strcmp(arg, "-j") == 0) {
+      char* end = NULL;
+      long jobs = i + 1 < argc ? strtol(argv[++i], &end, 10) : 0;
+      if (end == NULL || *end != '\0' || jobs < 1 || jobs > 1024) {
+        ezy_log_error("-j expects a thread count between 1 and 1024");
+        return false;
+      }
+      opts->transpile.jobs = (int)jobs;
+    } else if (strcmp(arg, "--small-array") == 0) {
+      char* end = NULL;
+      long n = i + 1 < argc ? strtol(argv[++i], &end, 10) : -1;
+      if (end == NULL || *end != '\0' || n < 0 || n > 4096) {
+        ezy_log_error("--small-array expects an element count between 0 and 4096");
+        return false;
+      }
+      opts->transpile.small_array_max = (size_t)n;
+    } else if (strncmp(arg, "--checks=", 9) == 0) {
+      const char* mode = arg + 9;
+      if (strcmp(mode, "elide") == 0) {
+        opts->transpile.checks = ezytranspile_checks_elide;
+      } else if (strcmp(mode, "on") == 0) {
+        opts->transpile.checks = ezytranspile_checks_on;
+      } else if (strcmp(mode, "off") == 0) {
+        opts->transpile.checks = ezytranspile_checks_off;
+      } else {
+        ezy_log_error("--checks expects off, on or elide");
+        return false;
+      }
+    } else if (strncmp(arg, "--emit=", 7) == 0) {
+      const char* kind = arg + 7;
+      if (strcmp(kind, "c") == 0) {
+        opts->emit_obj = false;
+      } else if (strcmp(kind, "obj") == 0) {
+        opts->emit_obj = true;
+      } else {
+        ezy_log_error("--emit expects c or obj");
+        return false;
+      }
+    } else if (opts->build && is_cc_flag(arg)) {
+      opts->cc_flags[opts->cc_flag_count++] = arg;
+    } else if (opts->build && strcmp(arg, "--timings") == 0) {
+      opts->timings = true;
+    } else if (opts->build && strcmp(arg, "--cache") == 0) {
+      opts->cache = true;
+    } else if (opts->build && strcmp(arg, "--no-cache") == 0) {
+      opts->cache = false;
+    } else if ((opts->build || opts->cache_stats) && strncmp(arg, "--cache-dir=", 12) == 0) {
+      opts->cache_dir = arg + 12;
+      opts->cache = true;
+    } else if (opts->build && strncmp(arg, "--cache-max=", 12) == 0) {
+      char* end = NULL;
+      unsigned long long mib = strtoull(arg + 12, &end, 10);
+      if (end == arg + 12 || *end != '\0' || mib < 1 || mib > (1ull << 30)) {
+        ezy_log_error("--cache-max expects a size in MiB");
+        return false;
+      }
+      opts->cache_max = (uint64_t)mib << 20;
+    } else if (strcmp(arg, "--atomic") == 0) {
+      opts->output_flags |= ezyout_flag_atomic;
+    } else if (strcmp(arg, "--time-report") == 0 || strcmp(arg, "--time-report=json") == 0) {
+      opts->report.on = true;
+      opts->report.json = arg[13] == '=';
+    } else if (strcmp(arg, "--dump-layout") == 0) {
+      opts->dump_layout = true;
+    } else if (arg[0] == '-' && arg[1] != '\0') {
+      ezy_log_error("unknown option: %s", arg);
+      return false;
+    } else {
+      opts->inputs[opts->input_count++] = arg;
+    }
+  }
+  if (opts->cache_stats) {
+    if (opts->input_count > 0) {
+      ezy_log_error("ezc cache takes no input file");
+      return false;
+    }
+    return true;
+  }
+  if (opts->input_count == 0) {
     ezy_log_error("no input file specified");
+    return false;
+  }
+  if (opts->run && (opts->output != NULL || opts->emit_obj)) {
+    ezy_log_error("ezc run writes no output file, -o and --emit do not apply");
+    return false;
+  }
+  if (opts->build && (opts->emit_obj || (opts->output != NULL && strcmp(opts->output, "-") == 0))) {
+    ezy_log_error("ezc build writes an executable, -o - and --emit do not apply");
+    return false;
+  }
+  if (opts->emit_obj && (opts->output == NULL || strcmp(opts->output, "-") == 0)) {
+    ezy_log_error("--emit=obj writes a binary object and needs -o <file.o>");
+    return false;
+  }
+  return true;
+}
+
+// `rel` next to the ezc binary, which sits at the top of the tree the
+// runtime is built in
+static char* tree_path(const char* argv0, const char* rel) {
+  const char* slash = strrchr(argv0, '/');
+  size_t dir = slash != NULL ? (size_t)(slash - argv0) + 1 : 0;
+  char* path = malloc(dir + strlen(rel) + 1);
+  if (path != NULL) {
+    memcpy(path, argv0, dir);
+    strcpy(path + dir, rel);
+  }
+  return path;
+}
+
+// not const: the build fills in opts->report
+static int build(const char* argv0, struct ezc_options* opts) {
+  char* include = tree_path(argv0, "runtime/include");
+  char* lib = tree_path(argv0, "obj/libezyrt.a");
+  struct ezycompile_opts build_opts = {
+    .output = opts->output,
+    .cc_flags = opts->cc_flags,
+    .cc_flag_count = opts->cc_flag_count,
+    .runtime_include = include,
+    .runtime_lib = lib,
+    .timings = opts->timings,
+    .cache = opts->cache,
+    .cache_dir = opts->cache_dir,
+    .cache_max = opts->cache_max,
+    .report = &opts->report,
+    .transpile = opts->transpile,
+  };
+  int status = 1;
+  if (include != NULL && lib != NULL) {
+    status = opts->input_count == 1 ? ezycompile_opts(opts->inputs[0], &build_opts)
+                                    : ezycompile_files(opts->inputs, opts->input_count, &build_opts);
+  }
+  free(include);
+  free(lib);
+  return status;
+}
+
+static int cache_stats(const struct ezc_options* opts) {
+  struct ezycache cache;
+  struct ezycache_stats stats;
+  if (!ezycache_open(&cache, opts->cache_dir, 0)) {
     return 1;
   }
-  const char* filename = argv[1];
+  bool ok = ezycache_stats(&cache, &stats);
+  if (ok) {
+    uint64_t lookups = stats.hits + stats.misses;
+    printf("cache directory  %s\n", cache.dir);
+    printf("hits             %llu (%.1f%%)\n", (unsigned long long)stats.hits,
+           lookups > 0 ? 100.0 * (double)stats.hits / (double)lookups : 0.0);
+    printf("misses           %llu\n", (unsigned long long)stats.misses);
+    printf("entries          %llu\n", (unsigned long long)stats.entries);
+    printf("size             %.1f MiB\n", (double)stats.bytes / (1 << 20));
+    printf("evicted          %llu\n", (unsigned long long)stats.evicted);
+  } else {
+    ezy_log_error("failed to read the cache statistics in %s", cache.dir);
+  }
+  ezycache_close(&cache);
+  return ok ? 0 : 1;
+}
+
+// everything after the front end, for a single file or a project
+static int compile_program(ezy_ast_node_t* ast_root, struct ezc_options* opts, struct ezyproject* proj) {
+  struct ezyreport* report = &opts->report;
+  if ( opts->run ) {
+    struct ezyvm_program prog;
+    bool compiled = ezyvm_compile(ast_root, &prog);
+    ezyreport_phase(report, "bytecode");
+    int status = compiled ? ezyvm_run(&prog) : 1;
+    ezyreport_phase(report, "run");
+    ezyvm_free(&prog);
+    return status;
+  }
+  print_ast(ast_root);
+  ezyreport_phase(report, "dump ast");
+
+  if ( opts->dump_layout ) {
+    ezy_multistr_t* layout = ezytranspile_layout_report(ast_root);
+    FILE* dest = opts->output != NULL && strcmp(opts->output, "-") == 0 ? stderr : stdout;
+    for (ezy_multistr_t* chunk = layout; chunk != NULL; chunk = chunk->next) {
+      fwrite(chunk->str.ptr, 1, chunk->str.len, dest);
+    }
+    ezytranspile_c_free(layout);
+    ezyreport_phase(report, "layout");
+  }
+
+  if ( opts->emit_obj ) {
+    ezy_log("generating x86-64 object...");
+    ezy_multistr_t* object = ezyx64_object(ast_root);
+    ezyreport_phase(report, "codegen");
+    int status = object != NULL && ezyout_write_file(opts->output, object, opts->output_flags) ? 0 : 1;
+    ezyreport_phase(report, "write");
+    if ( report->on ) {
+      report->output_bytes += ezyreport_count_bytes(object);
+    }
+    ezyx64_free(object);
+    return status;
+  }
+
+  ezy_log("transpiling to C...");
+  struct ezytranspile_stats stats = {0};
+  opts->transpile.stats = &stats;
+  ezy_multistr_t* c_code = proj != NULL ? ezyproject_transpile_c(proj, &opts->transpile)
+                                        : ezytranspile_c_opts(ast_root, &opts->transpile);
+  ezy_log("escape analysis: %zu of %zu allocation sites moved to the stack", stats.stack_sites, stats.alloc_sites);
+  ezy_log("bounds checks: %zu of %zu elided", stats.index_elided, stats.index_sites);
+  ezyreport_phase(report, "transpile");
+
+  int status = 0;
+  if ( c_code == NULL ) {
+    ezy_log_error("transpiling failed, nothing was written");
+    status = 1;
+  } else if ( opts->output != NULL ) {
+    ezy_log("writing %s", opts->output);
+    if ( !ezyout_write_file(opts->output, c_code, opts->output_flags) ) {
+      status = 1;
+    }
+  } else {
+    ezy_log("Transpiled C code:\n");
+    for (ezy_multistr_t* chunk = c_code; chunk != NULL; chunk = chunk->next) {
+      ezy_log_raw("%.*s", (int)chunk->str.len, chunk->str.ptr);
+    }
+  }
+  ezyreport_phase(report, "write");
+  if ( report->on ) {
+    report->output_bytes += ezyreport_count_bytes(c_code);
+  }
+  ezytranspile_c_free(c_code);
+  return status;
+}
+
+static int compile_file(struct ezc_options* opts) {
+  const char* filename = opts->inputs[0];
   FILE* f = fopen(filename, "rb");
   if ( f == NULL ) {
     ezy_log_error("failed to open input file: %s", filename);
@@ -121,23 +453,193 @@ int main(int argc, const char** argv) {
   fclose(f);
 
   ezy_log("file loaded: %s", filename);
+  struct ezyreport* report = &opts->report;
+  ezyreport_phase(report, "read");
+  if ( report->on ) {
+    // the parser lexes on demand, lex once more alone to time it
+    ezylex_scan(buffer);
+    ezyreport_phase(report, "lex");
+  }
   // now to test the parser...
   ezy_log("parsing...");
+  size_t tokens = ezylex_token_count();
   ezy_ast_node_t* ast_root = ezyparse_parse(buffer);
+  bool front_ok = ezyparse_error_count() == 0;
+  ezyreport_phase(report, "parse");
 
   ezy_log("parsed\n");
-  print_ast_node(ast_root, 0);
 
-  ezy_log("transpiling to C...");
-  ezy_multistr_t* c_code = ezytranspile_c(ast_root);
+  ezy_log("resolving names...");
+  front_ok &= ezysema_resolve(ast_root);
+  ezyreport_phase(report, "resolve");
 
-  ezy_log("Transpiled C code:\n");
-  while (c_code != NULL) {
-    ezy_log_raw("%.*s", (int)c_code->str.len, c_code->str.ptr);
-    c_code = c_code->next;
-  }
+  ezy_log("inferring types...");
+  front_ok &= ezysema_infer_types(ast_root); // typed anyway, for its errors too
+  ezyreport_phase(report, "infer types");
 
+  int status = 1;
+  if ( front_ok ) {
+    status = compile_program(ast_root, opts, NULL);
+  } else {
+    ezy_log_error("%s has errors, nothing was compiled", filename);
+  }
+  if ( report->on ) {
+    report->modules = 1;
+    report->tokens = ezylex_token_count() - tokens;
+    report->nodes = ezyreport_count_nodes(ast_root);
+    ezyreport_arena(report, NULL);
+  }
   ezyparse_arena_clear(); // clear all parser allocations at once
   free(buffer);
-  return 0;
-}
\ No newline at end of file
+  return status;
+}
+
+// several modules: parsed, analysed and transpiled on -j workers
+static int compile_project(struct ezc_options* opts) {
+  ezy_log("loading %zu modules...", opts->input_count);
+  struct ezyproject proj;
+  int status = 1;
+  if ( ezyproject_load(&proj, opts->inputs, opts->input_count, opts->transpile.jobs, &opts->report) ) {
+    ezy_log("%zu modules in %zu dependency groups", proj.module_count, proj.unit_count);
+    status = compile_program(proj.program, opts, &proj);
+    if ( opts->report.on ) {
+      opts->report.nodes = ezyreport_count_nodes(proj.program);
+    }
+  }
+  ezyproject_free(&proj);
+  return status;
+}
+
+static bool is_manifest(const char* path) {
+  size_t len = strlen(path);
+  return len > 7 && strcmp(path + len - 7, ".ezproj") == 0;
+}
+
+static int ezc_main(int argc, const char** argv) {
+  ezy_log("start of program");
+  struct ezc_options opts;
+  if ( !parse_options(argc, argv, &opts) ) {
+    free(opts.inputs);
+    free(opts.cc_flags);
+    print_usage();
+    return 1;
+  }
+  if ( opts.report.on ) {
+    ezyreport_start(&opts.report);
+  }
+  // a lone .ezproj input lists the modules
+  char** listed = NULL;
+  size_t listed_count = 0;
+  int status = 1;
+  if ( opts.input_count == 1 && is_manifest(opts.inputs[0]) ) {
+    if ( !ezyproject_manifest(opts.inputs[0], &listed, &listed_count) ) {
+      free(opts.inputs);
+      free(opts.cc_flags);
+      return 1;
+    }
+    free(opts.inputs);
+    opts.inputs = (const char**)listed;
+    opts.input_count = listed_count;
+  }
+  if ( opts.cache_stats ) {
+    status = cache_stats(&opts);
+  } else if ( opts.build ) {
+    status = build(argv[0], &opts);
+  } else if ( opts.input_count > 1 || listed != NULL ) {
+    status = compile_project(&opts);
+  } else {
+    status = compile_file(&opts);
+  }
+  if ( opts.report.on && !opts.cache_stats ) {
+    // on stdout, unless the C or the program's output goes there
+    bool stdout_taken = opts.run || (!opts.build && opts.output != NULL && strcmp(opts.output, "-") == 0);
+    if ( stdout_taken ) {
+      fputc('\n', stderr); // log lines do not end with one
+    }
+    ezyreport_print(&opts.report, stdout_taken ? stderr : stdout);
+  }
+  if ( listed != NULL ) {
+    ezyproject_manifest_free(listed, listed_count);
+  } else {
+    free(opts.inputs);
+  }
+  free(opts.cc_flags);
+  return status;
+}
+
+#if !defined(_WIN32)
+// `ezc run` executes the program, which may exit or never return: it
+// gets a child of the server, compiles run in the server itself
+static int daemon_job(int argc, const char** argv) {
+  if ( argc < 2 || strcmp(argv[1], "run") != 0 ) {
+    return ezc_main(argc, argv);
+  }
+  fflush(stdout);
+  fflush(stderr);
+  pid_t pid = fork();
+  if ( pid == 0 ) {
+    exit(ezc_main(argc, argv));
+  }
+  int status;
+  while ( pid > 0 && waitpid(pid, &status, 0) < 0 ) {
+    if ( errno != EINTR ) {
+      return 1;
+    }
+  }
+  if ( pid < 0 ) {
+    ezy_log_error("failed to start a process for ezc run");
+    return 1;
+  }
+  return WIFEXITED(status) ? WEXITSTATUS(status) : 128 + WTERMSIG(status);
+}
+#else
+#define daemon_job ezc_main
+#endif
+
+// ezc --daemon [--socket=<path>]
+static int serve(int argc, const char** argv) {
+  char path[256];
+  const char* sock = NULL;
+  for (int i = 2; i < argc; i++) {
+    if (strncmp(argv[i], "--socket=", 9) == 0) {
+      sock = argv[i] + 9;
+    } else {
+      ezy_log_error("unknown option: %s", argv[i]);
+      print_usage();
+      return 1;
+    }
+  }
+  if (sock == NULL) {
+    if (!ezydaemon_default_path(path, sizeof path)) {
+      ezy_log_error("no socket path, use --socket=<path>");
+      return 1;
+    }
+    sock = path;
+  }
+  ezyparse_arena_retain(true);
+  // the log is line after line of small writes, batch them: the server
+  // flushes stderr at the end of every request
+  static char log_buffer[1 << 16];
+  setvbuf(stderr, log_buffer, _IOFBF, sizeof log_buffer);
+  return ezydaemon_serve(sock, daemon_job);
+}
+
+int main(int argc, const char** argv) {
+  if ( argc > 1 && strcmp(argv[1], "--daemon") == 0 ) {
+    return serve(argc, argv);
+  }
+  // with EZY_DAEMON set, hand the whole command line to the server on
+  // that socket ("" for the default one), compile here if none answers
+  const char* sock = getenv("EZY_DAEMON");
+  if ( sock != NULL ) {
+    char path[256];
+    int status;
+    if ( sock[0] == '\0' && ezydaemon_default_path(path, sizeof path) ) {
+      sock = path;
+    }
+    if ( sock[0] != '\0' && ezydaemon_forward(sock, argc, argv, &status) ) {
+      return status;
+    }
+  }
+  return ezc_main(argc, argv);
+}
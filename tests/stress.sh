@@ -0,0 +1,86 @@
+#!/bin/sh
+# Sources nobody writes by hand, generated here, must compile without
+# ezc's stack growing with them:
+#  - a function of 1,000,000 statements, through C and the native backend
+#  - a 100,000 term expression, as deep in the AST, through C, the
+#    native backend and the VM
+#  - 100,000 nested parentheses, refused with an error instead of a crash
+# The C is checked, not compiled: cc itself gives up on such sources.
+#
+#   tests/stress.sh [path/to/ezc]      (or: make stress)
+
+set -u
+ezc=${1:-./ezc}
+lib=$(dirname "$ezc")/obj/libezyrt.a
+dir=$(mktemp -d "${TMPDIR:-/tmp}/ezc-stress.XXXXXX") || exit 1
+trap 'rm -rf "$dir"' EXIT
+failed=0
+
+# check NAME WANT GOT
+check() {
+  if [ "$2" = "$3" ]; then
+    echo "ok    $1"
+  else
+    echo "FAIL  $1: expected $2, got $3"
+    failed=1
+  fi
+}
+
+# run_ezc ARGS...: exit status of ezc, its log (a line per token) dropped
+run_ezc() {
+  "$ezc" "$@" 2>/dev/null
+  echo $?
+}
+
+awk 'BEGIN {
+  print "fn int64 count() {"
+  print "  let int64 x = 0;"
+  for (i = 0; i < 1000000; i++)
+    print "  x = x + 1;"
+  print "  return x;"
+  print "}"
+  print "fn main() {"
+  print "  print(count(), \"\\n\");"
+  print "}"
+}' >"$dir/long.ez"
+
+awk 'BEGIN {
+  printf "fn main() {\n  let int64 y = 0"
+  for (i = 0; i < 100000; i++)
+    printf " + 1"
+  printf ";\n  print(y, \"\\n\");\n}\n"
+}' >"$dir/deep.ez"
+
+awk 'BEGIN {
+  printf "fn main() {\n  let int64 y = "
+  for (i = 0; i < 100000; i++)
+    printf "(1 + "
+  printf "0"
+  for (i = 0; i < 100000; i++)
+    printf ")"
+  printf ";\n  print(y, \"\\n\");\n}\n"
+}' >"$dir/nested.ez"
+
+check "1M statements to C" 0 "$(run_ezc -o "$dir/long.c" "$dir/long.ez")"
+check "1M statements in the C" 1000000 "$(grep -c 'x = (x + 1);' "$dir/long.c")"
+
+check "1M statements to an object" 0 "$(run_ezc --emit=obj -o "$dir/long.o" "$dir/long.ez")"
+if ${CC:-cc} -o "$dir/long" "$dir/long.o" "$lib" -lm; then
+  check "1M statements run" 1000000 "$("$dir/long" | tr -d ' \n')"
+else
+  check "1M statements link" 0 1
+fi
+
+check "100k deep expression to C" 0 "$(run_ezc -o "$dir/deep.c" "$dir/deep.ez")"
+check "100k deep expression in the C" 100000 "$(grep -o '+ 1' "$dir/deep.c" | wc -l | tr -d ' ')"
+check "100k deep expression to an object" 0 "$(run_ezc --emit=obj -o "$dir/deep.o" "$dir/deep.ez")"
+if ${CC:-cc} -o "$dir/deep" "$dir/deep.o" "$lib" -lm; then
+  check "100k deep expression object run" 100000 "$("$dir/deep" | tr -d ' \n')"
+else
+  check "100k deep expression link" 0 1
+fi
+check "100k deep expression in the VM" 100000 "$("$ezc" run "$dir/deep.ez" 2>/dev/null | tr -d ' \n')"
+
+check "100k nested parentheses" 1 "$(run_ezc -o "$dir/nested.c" "$dir/nested.ez")"
+
+exit $failed
@@ -0,0 +1,62 @@
+#!/bin/sh
+# Transpiler tests: every program here is compiled to C, each line of
+# its .expect must appear in that C as is, and when there is a .out the
+# program is built with cc and must print exactly that and exit 0.
+#
+#   tests/transpile/run.sh [path/to/ezc]      (or: make check-transpile)
+
+set -u
+ezc=${1:-./ezc}
+lib=$(dirname "$ezc")/obj/libezyrt.a
+include=$(dirname "$ezc")/runtime/include
+cc=${CC:-cc}
+here=$(dirname "$0")
+dir=$(mktemp -d "${TMPDIR:-/tmp}/ezc-transpile.XXXXXX") || exit 1
+trap 'rm -rf "$dir"' EXIT
+failed=0
+
+for src in "$here"/*.ez; do
+  name=$(basename "$src" .ez)
+  # ezc logs every token, keep the log only when it failed
+  if ! "$ezc" -o "$dir/$name.c" "$src" 2>"$dir/$name.log"; then
+    echo "FAIL  $name: did not transpile"
+    grep 'ezy_error' "$dir/$name.log"
+    failed=1
+    continue
+  fi
+  ok=1
+  if [ -f "$here/$name.expect" ]; then
+    while IFS= read -r line; do
+      if [ -n "$line" ] && ! grep -qF -- "$line" "$dir/$name.c"; then
+        echo "FAIL  $name: no '$line' in the C"
+        ok=0
+      fi
+    done <"$here/$name.expect"
+  fi
+  if [ $ok = 1 ] && [ -f "$here/$name.out" ]; then
+    if ! $cc -Werror=implicit-function-declaration -I"$include" -o "$dir/$name.bin" "$dir/$name.c" "$lib" -lm \
+      2>"$dir/$name.cc"; then
+      echo "FAIL  $name: cc rejected the C"
+      cat "$dir/$name.cc"
+      ok=0
+    else
+      "$dir/$name.bin" >"$dir/$name.run"
+      status=$?
+      if [ $status != 0 ]; then
+        echo "FAIL  $name: exited with $status"
+        ok=0
+      elif ! cmp -s "$here/$name.out" "$dir/$name.run"; then
+        echo "FAIL  $name: output differs from $name.out"
+        diff "$here/$name.out" "$dir/$name.run"
+        ok=0
+      fi
+    fi
+  fi
+  if [ $ok = 1 ]; then
+    echo "ok    $name"
+  else
+    failed=1
+  fi
+done
+
+exit $failed
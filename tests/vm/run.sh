@@ -0,0 +1,47 @@
+#!/bin/sh
+# Differential test of `ezc run`: every program here and in tests/x64 is
+# built through C (ezc -o, cc) and run by the bytecode interpreter, both
+# must print exactly its .out.
+#
+#   tests/vm/run.sh [path/to/ezc]      (or: make check-vm)
+
+set -u
+ezc=${1:-./ezc}
+lib=$(dirname "$ezc")/obj/libezyrt.a
+include=$(dirname "$ezc")/runtime/include
+cc=${CC:-cc}
+here=$(dirname "$0")
+dir=$(mktemp -d "${TMPDIR:-/tmp}/ezc-vm.XXXXXX") || exit 1
+trap 'rm -rf "$dir"' EXIT
+failed=0
+
+for src in "$here"/*.ez "$here"/../x64/*.ez; do
+  name=$(basename "$src" .ez)
+  out=${src%.ez}.out
+  # ezc logs every token, keep the log only when it failed
+  if ! "$ezc" -o "$dir/$name.c" "$src" 2>"$dir/$name.log" ||
+    ! $cc -w -I"$include" -o "$dir/$name.bin" "$dir/$name.c" "$lib" -lm; then
+    echo "FAIL  $name: C path did not build"
+    grep 'ezy_error' "$dir/$name.log"
+    failed=1
+    continue
+  fi
+  "$dir/$name.bin" >"$dir/$name.c.out"
+  if ! "$ezc" run "$src" >"$dir/$name.vm.out" 2>"$dir/$name.log"; then
+    echo "FAIL  $name: ezc run failed"
+    grep 'ezy_error' "$dir/$name.log"
+    failed=1
+  elif ! cmp -s "$out" "$dir/$name.c.out"; then
+    echo "FAIL  $name: C output differs from $name.out"
+    diff "$out" "$dir/$name.c.out"
+    failed=1
+  elif ! cmp -s "$dir/$name.c.out" "$dir/$name.vm.out"; then
+    echo "FAIL  $name: ezc run output differs from C"
+    diff "$dir/$name.c.out" "$dir/$name.vm.out"
+    failed=1
+  else
+    echo "ok    $name"
+  fi
+done
+
+exit $failed
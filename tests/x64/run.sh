@@ -0,0 +1,51 @@
+#!/bin/sh
+# Differential test of the native backend: every program here is built
+# twice, through C (ezc -o, cc) and as an x86-64 object (--emit=obj),
+# and both runs must print exactly its .out. The examples that both
+# backends take are run too, with their .out here.
+#
+#   tests/x64/run.sh [path/to/ezc]      (or: make check-x64)
+
+set -u
+ezc=${1:-./ezc}
+lib=$(dirname "$ezc")/obj/libezyrt.a
+include=$(dirname "$ezc")/runtime/include
+cc=${CC:-cc}
+here=$(dirname "$0")
+dir=$(mktemp -d "${TMPDIR:-/tmp}/ezc-x64.XXXXXX") || exit 1
+trap 'rm -rf "$dir"' EXIT
+failed=0
+
+for src in "$here"/*.ez "$here"/../../examples/helloworld/helloworld.ez; do
+  name=$(basename "$src" .ez)
+  # ezc logs every token, keep the log only when it failed
+  if ! "$ezc" -o "$dir/$name.c" "$src" 2>"$dir/$name.log" ||
+    ! $cc -w -I"$include" -o "$dir/$name.c.bin" "$dir/$name.c" "$lib" -lm; then
+    echo "FAIL  $name: C path did not build"
+    grep 'ezy_error' "$dir/$name.log"
+    failed=1
+    continue
+  fi
+  if ! "$ezc" --emit=obj -o "$dir/$name.o" "$src" 2>"$dir/$name.log" ||
+    ! $cc -o "$dir/$name.o.bin" "$dir/$name.o" "$lib" -lm; then
+    echo "FAIL  $name: object did not build"
+    grep 'ezy_error' "$dir/$name.log"
+    failed=1
+    continue
+  fi
+  "$dir/$name.c.bin" >"$dir/$name.c.out"
+  "$dir/$name.o.bin" >"$dir/$name.o.out"
+  if ! cmp -s "$here/$name.out" "$dir/$name.c.out"; then
+    echo "FAIL  $name: C output differs from $name.out"
+    diff "$here/$name.out" "$dir/$name.c.out"
+    failed=1
+  elif ! cmp -s "$dir/$name.c.out" "$dir/$name.o.out"; then
+    echo "FAIL  $name: object output differs from C"
+    diff "$dir/$name.c.out" "$dir/$name.o.out"
+    failed=1
+  else
+    echo "ok    $name"
+  fi
+done
+
+exit $failed